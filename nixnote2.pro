@@ -2,7 +2,7 @@ QT += core gui widgets printsupport webkit webkitwidgets sql network xml dbus qm
 DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0
 unix {
     CONFIG += link_pkgconfig
-    PKGCONFIG += poppler-qt5 libcurl tidy hunspell
+    PKGCONFIG += poppler-qt5 libcurl tidy hunspell zlib
 }
 
 unix:!mac:LIBS += -lpthread -g -rdynamic
@@ -12,6 +12,7 @@ win32:INCLUDEPATH += "$$PWD/winlib/includes"
 win32:INCLUDEPATH += "$$PWD/winlib/includes/hunspell"
 win32:LIBS += -L"$$PWD/winlib" -lpoppler-qt5
 win32:LIBS += -L"$$PWD/winlib" -ltidy
+win32:LIBS += -L"$$PWD/winlib" -lz
 win32:LIBS += -L"$$PWD/winlib" -lhunspell-$$[HUNSPELL_VERSION]
 win32:RC_ICONS += "$$PWD/resources/images/windowIcon.ico"
 
@@ -108,8 +109,12 @@ SOURCES += \
     src/exits/exitpoint.cpp \
     src/filters/filtercriteria.cpp \
     src/filters/filterengine.cpp \
+    src/filters/notesnippets.cpp \
     src/filters/notesortfilterproxymodel.cpp \
     src/filters/remotequery.cpp \
+    src/filters/resourcehits.cpp \
+    src/filters/searchquery.cpp \
+    src/filters/tagfilter.cpp \
     src/gui/browserWidgets/authoreditor.cpp \
     src/gui/browserWidgets/colormenu.cpp \
     src/gui/browserWidgets/dateeditor.cpp \
@@ -160,6 +165,7 @@ SOURCES += \
     src/gui/plugins/popplerviewer.cpp \
     src/gui/reminderorderdelegate.cpp \
     src/gui/shortcutkeys.cpp \
+    src/gui/snippetdelegate.cpp \
     src/gui/traymenu.cpp \
     src/gui/treewidgeteditor.cpp \
     src/gui/truefalsedelegate.cpp \
@@ -193,6 +199,7 @@ SOURCES += \
     src/sql/configstore.cpp \
     src/sql/databaseconnection.cpp \
     src/sql/databaseupgrade.cpp \
+    src/sql/dataversion.cpp \
     src/sql/datastore.cpp \
     src/sql/favoritesrecord.cpp \
     src/sql/favoritestable.cpp \
@@ -203,6 +210,7 @@ SOURCES += \
     src/sql/notetable.cpp \
     src/sql/nsqlquery.cpp \
     src/sql/resourcetable.cpp \
+    src/sql/searchindextable.cpp \
     src/sql/searchtable.cpp \
     src/sql/sharednotebooktable.cpp \
     src/sql/tagtable.cpp \
@@ -215,11 +223,18 @@ SOURCES += \
     src/html/thumbnailer.cpp \
     src/threads/browserrunner.cpp \
     src/threads/counterrunner.cpp \
+    src/threads/searchrunner.cpp \
+    src/threads/fileremover.cpp \
     src/threads/indexrunner.cpp \
     src/threads/syncrunner.cpp \
+    src/threads/uploadpipeline.cpp \
+    src/threads/noteuploadsender.cpp \
     src/utilities/crossmemorymapper.cpp \
     src/utilities/debugtool.cpp \
     src/utilities/encrypt.cpp \
+    src/utilities/extractedtextcache.cpp \
+    src/utilities/gzipdevice.cpp \
+    src/utilities/metrics.cpp \
     src/utilities/mimereference.cpp \
     src/utilities/noteindexer.cpp \
     src/utilities/nuuid.cpp \
@@ -228,9 +243,11 @@ SOURCES += \
     src/watcher/filewatcher.cpp \
     src/watcher/filewatchermanager.cpp \
     src/xml/batchimport.cpp \
+    src/xml/backupmanifest.cpp \
     src/xml/exportdata.cpp \
     src/xml/importdata.cpp \
     src/xml/importenex.cpp \
+    src/xml/importpipeline.cpp \
     src/xml/xmlhighlighter.cpp \
     src/quentier/utility/StringUtils.cpp \
     src/quentier/utility/StringUtils_p.cpp
@@ -303,8 +320,12 @@ HEADERS  += \
     src/exits/exitpoint.h \
     src/filters/filtercriteria.h \
     src/filters/filterengine.h \
+    src/filters/notesnippets.h \
     src/filters/notesortfilterproxymodel.h \
     src/filters/remotequery.h \
+    src/filters/resourcehits.h \
+    src/filters/searchquery.h \
+    src/filters/tagfilter.h \
     src/gui/browserWidgets/authoreditor.h \
     src/gui/browserWidgets/colormenu.h \
     src/gui/browserWidgets/dateeditor.h \
@@ -355,6 +376,7 @@ HEADERS  += \
     src/gui/plugins/popplerviewer.h \
     src/gui/reminderorderdelegate.h \
     src/gui/shortcutkeys.h \
+    src/gui/snippetdelegate.h \
     src/gui/traymenu.h \
     src/gui/treewidgeteditor.h \
     src/gui/truefalsedelegate.h \
@@ -396,6 +418,7 @@ HEADERS  += \
     src/sql/configstore.h \
     src/sql/databaseconnection.h \
     src/sql/databaseupgrade.h \
+    src/sql/dataversion.h \
     src/sql/datastore.h \
     src/sql/favoritesrecord.h \
     src/sql/favoritestable.h \
@@ -406,6 +429,7 @@ HEADERS  += \
     src/sql/notetable.h \
     src/sql/nsqlquery.h \
     src/sql/resourcetable.h \
+    src/sql/searchindextable.h \
     src/sql/searchtable.h \
     src/sql/sharednotebooktable.h \
     src/sql/tagtable.h \
@@ -418,11 +442,18 @@ HEADERS  += \
     src/html/thumbnailer.h \
     src/threads/browserrunner.h \
     src/threads/counterrunner.h \
+    src/threads/searchrunner.h \
+    src/threads/fileremover.h \
     src/threads/indexrunner.h \
     src/threads/syncrunner.h \
+    src/threads/uploadpipeline.h \
+    src/threads/noteuploadsender.h \
     src/utilities/crossmemorymapper.h \
     src/utilities/debugtool.h \
     src/utilities/encrypt.h \
+    src/utilities/extractedtextcache.h \
+    src/utilities/gzipdevice.h \
+    src/utilities/metrics.h \
     src/utilities/mimereference.h \
     src/utilities/noteindexer.h \
     src/utilities/nuuid.h \
@@ -431,9 +462,11 @@ HEADERS  += \
     src/watcher/filewatcher.h \
     src/watcher/filewatchermanager.h \
     src/xml/batchimport.h \
+    src/xml/backupmanifest.h \
     src/xml/exportdata.h \
     src/xml/importdata.h \
     src/xml/importenex.h \
+    src/xml/importpipeline.h \
     src/xml/xmlhighlighter.h \
     src/quentier/utility/StringUtils.h \
     src/quentier/utility/StringUtils_p.h
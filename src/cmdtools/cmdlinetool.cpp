@@ -34,6 +34,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #include "src/email/smtpclient.h"
 #include "src/utilities/mimereference.h"
 #include "src/threads/syncrunner.h"
+#include "src/xml/backupmanifest.h"
 
 
 extern Global global;
@@ -133,6 +134,14 @@ int CmdLineTool::run(StartupConfig &config) {
         QLOG_DEBUG() << "Command: signalOtherGui";
         return signalGui(config);
     }
+    if (config.dumpMetrics()) {
+        QLOG_DEBUG() << "Command: dumpMetrics";
+        return dumpMetrics(config);
+    }
+    if (config.verifyBackup()) {
+        QLOG_DEBUG() << "Command: verifyBackup";
+        return verifyBackup(config);
+    }
     return 0;
 }
 
@@ -428,12 +437,11 @@ int CmdLineTool::addNote(StartupConfig config) {
                 QByteArray ba = file.readAll();
                 file.close();
 
-                MimeReference mimeRef;
                 QString extension = filename;
                 int endPos = filename.lastIndexOf(".");
                 if (endPos != -1)
                     extension = extension.mid(endPos);
-                QString mime =  mimeRef.getMimeFromExtension(extension);
+                QString mime =  MimeReference::getMimeFromExtension(extension);
                 Resource newRes;
                 bool attachment = true;
                 if (mime == "application/pdf" || mime.startsWith("image/"))
@@ -585,12 +593,11 @@ int CmdLineTool::appendNote(StartupConfig config) {
                 QByteArray ba = file.readAll();
                 file.close();
 
-                MimeReference mimeRef;
                 QString extension = filename;
                 int endPos = filename.lastIndexOf(".");
                 if (endPos != -1)
                     extension = extension.mid(endPos);
-                QString mime =  mimeRef.getMimeFromExtension(extension);
+                QString mime =  MimeReference::getMimeFromExtension(extension);
                 Resource newRes;
                 bool attachment = true;
                 if (mime == "application/pdf" || mime.startsWith("image/"))
@@ -698,6 +705,34 @@ int CmdLineTool::exportNotes(StartupConfig config) {
 
 
 
+// Check a backup chain (full backup + incrementals) against the database
+int CmdLineTool::verifyBackup(StartupConfig config) {
+    if (config.verifyBackupFile.trimmed() == "") {
+        std::cout << tr("Backup file not specified.").toStdString() << endl;
+        return 16;
+    }
+    if (global.sharedMemory->attach()) {
+        std::cout << tr("This cannot be done with NixNote running.").toStdString() << endl;
+        return 16;
+    }
+    global.db = new DatabaseConnection(NN_DB_CONNECTION_NAME);  // Startup the database
+
+    QStringList chain = BackupManifest::chain(config.verifyBackupFile);
+    for (int i=0; i<chain.size(); i++)
+        std::cout << chain[i].toStdString() << endl;
+
+    QStringList problems;
+    if (BackupManifest::verifyChain(config.verifyBackupFile, global.db, problems)) {
+        std::cout << tr("Backup is complete.").toStdString() << endl;
+        return 0;
+    }
+    for (int i=0; i<problems.size(); i++)
+        std::cout << problems[i].toStdString() << endl;
+    return 1;
+}
+
+
+
 // Import notes from a nnex file.
 int CmdLineTool::importNotes(StartupConfig config) {
     if (global.sharedMemory->attach()) {
@@ -838,3 +873,49 @@ int CmdLineTool::signalGui(StartupConfig config) {
 
     return 0;
 }
+
+
+
+// Print the performance metrics.  If NixNote is running its live metrics are
+// requested, otherwise the last snapshot written to the logs directory is shown.
+int CmdLineTool::dumpMetrics(StartupConfig config) {
+    Q_UNUSED(config);
+    QByteArray json;
+
+    global.sharedMemory->unlock();
+    global.sharedMemory->detach();
+    if (global.sharedMemory->attach()) {
+        NUuid uuid;
+        QString returnUuid = uuid.create();
+        CrossMemoryMapper sharedMemory(returnUuid);
+        if (sharedMemory.allocate(500 * 1024) != QSharedMemory::SharedMemoryError::NoError)
+            return 16;
+
+        sharedMemory.clearMemory();
+        global.sharedMemory->write("DUMP_METRICS:" + returnUuid);
+
+        int maxWait = 5;
+        for (int cnt=0; json.isEmpty() && cnt<maxWait; cnt++) {
+            QByteArray data = sharedMemory.read();
+            if (!data.startsWith('\0'))
+                json = QByteArray(data.constData());
+            else
+                sleep(1);
+        }
+        if (json.isEmpty()) {
+            std::cout << tr("No response received from NixNote.").toStdString() << endl;
+            return 16;
+        }
+    } else {
+        QFile file(global.fileManager.getMetricsFileName());
+        if (!file.open(QIODevice::ReadOnly)) {
+            std::cout << tr("No metrics snapshot found in ").toStdString()
+                      << global.fileManager.getLogsDirPath("").toStdString() << endl;
+            return 16;
+        }
+        json = file.readAll();
+        file.close();
+    }
+    std::cout << json.toStdString() << endl;
+    return 0;
+}
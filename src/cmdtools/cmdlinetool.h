@@ -46,6 +46,8 @@ public:
     int closeNotebook(StartupConfig config);
     int sync();
     int signalGui(StartupConfig config);
+    int dumpMetrics(StartupConfig config);
+    int verifyBackup(StartupConfig config);
 
 signals:
 
@@ -185,9 +185,8 @@ void EmailNote::prepareEmailMessage(MimeMessage *message, QString note, QString
 
     // Add all the images
     for (int i=0; i<images.size(); i++) {
-        MimeReference mimeRef;
         QString localFile = images[i];
-        QString mime = mimeRef.getMimeFromFileName(localFile);
+        QString mime = MimeReference::getMimeFromFileName(localFile);
         MimeInlineFile *file = new MimeInlineFile(new QFile(localFile));
         QString lidFile = localFile.mid(localFile.lastIndexOf(QDir::separator())+1);
         qint32 lid = lidFile.mid(0,lidFile.lastIndexOf(".")).toInt();
@@ -206,9 +205,8 @@ void EmailNote::prepareEmailMessage(MimeMessage *message, QString note, QString
 
     // Add all the attachments
     for (int i=0; i<attachments.size(); i++) {
-        MimeReference mimeRef;
         QString localFile = attachments[i];
-        QString mime = mimeRef.getMimeFromFileName(localFile);
+        QString mime = MimeReference::getMimeFromFileName(localFile);
         MimeInlineFile *file = new MimeInlineFile(new QFile(localFile));
         QString lidFile = localFile.mid(localFile.lastIndexOf(QDir::separator())+1);
         qint32 lid = lidFile.mid(0,lidFile.lastIndexOf(".")).toInt();
@@ -32,6 +32,7 @@ ExtractNotes::ExtractNotes(QObject *parent) :
 {
     this->deleteAfterExtract=false;
     this->verifyDelete=true;
+    this->incremental=false;
 }
 
 
@@ -83,5 +84,19 @@ void ExtractNotes::backupDB() {
         return;
     }
     ExportData exports(backup, true, this);
+    if (incremental) {
+        QString base = baseFile;
+        if (base == "") {
+            global.settings->beginGroup(INI_GROUP_BACKUP);
+            base = global.settings->value("lastBackup", "").toString();
+            global.settings->endGroup();
+        }
+        if (base == "")
+            std::cout << QString(tr("No previous backup found, doing a full backup.")).toStdString() << endl;
+        else
+            exports.setIncrementalBase(base);
+    }
     exports.backupData(this->outputFile);
+    if (exports.lastError != 0)
+        std::cout << exports.errorMessage.toStdString() << endl;
 }
@@ -33,6 +33,8 @@ public:
     QString query;
     QString outputFile;
     bool backup;
+    bool incremental;
+    QString baseFile;
     bool deleteAfterExtract;
     bool verifyDelete;
     
@@ -518,6 +518,46 @@ qint32 CommunicationManager::uploadNote(Note &note, QString token) {
     return updateSequenceNum;
 }
 
+// Upload a note to the user's account without waiting for Evernote.  The
+// request is serialized here, so the note (and its resource data) can be
+// released as soon as this returns.
+AsyncResult *CommunicationManager::uploadNoteAsync(const Note &note) {
+    QLOG_DEBUG() << "uploadNoteAsync " << note.guid << ", " << note.title;
+    if (note.updateSequenceNum.isSet() && note.updateSequenceNum > 0)
+        return myNoteStore->updateNoteAsync(note, authToken);
+    return myNoteStore->createNoteAsync(note, authToken);
+}
+
+
+
+// Take the answer of uploadNoteAsync().  Errors are reported the same way
+// as by uploadNote(); on success the note is replaced by what Evernote
+// returned and its new update sequence number is returned.
+qint32 CommunicationManager::uploadNoteFinished(Note &note, QVariant result, QSharedPointer<EverCloudExceptionData> exception) {
+    qint32 updateSequenceNum = 0;
+    try {
+        if (!exception.isNull())
+            exception->throwException();
+        note = result.value<Note>();
+        updateSequenceNum = note.updateSequenceNum;
+    } catch (ThriftException &e) {
+        reportError(CommunicationError::ThriftException, e.type(), e.what());
+    } catch (EDAMUserException &e) {
+        reportError(CommunicationError::EDAMUserException, e.errorCode, e.what());
+    } catch (EDAMSystemException &e) {
+        handleEDAMSystemException(e, note.title);
+    } catch (EDAMNotFoundException &e) {
+        handleEDAMNotFoundException(e, note.title);
+    } catch (EverCloudException &e) {
+        reportError(CommunicationError::StdException, 16, e.what());
+    }
+
+    QLOG_DEBUG() << "uploadNoteFinished " << note.guid << ", updateSequenceNum=" << updateSequenceNum;
+    return updateSequenceNum;
+}
+
+
+
 void CommunicationManager::reportError(
         const CommunicationError::CommunicationErrorType errorType,
         int code,
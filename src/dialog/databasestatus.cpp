@@ -24,6 +24,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #include "src/sql/notetable.h"
 #include "src/sql/resourcetable.h"
 #include "src/global.h"
+#include "src/html/thumbnailer.h"
 
 extern Global global;
 
@@ -54,6 +55,12 @@ DatabaseStatus::DatabaseStatus(QWidget *parent) :
     textGrid->addWidget(new QLabel(QString::number(unindexedResources)),4,2);
     textGrid->addWidget(new QLabel(tr("Thumbnails needed:")), 5,1);
     textGrid->addWidget(new QLabel(QString::number(thumbnailsNeeded)),5,2);
+    if (global.thumbnailer != nullptr) {
+        textGrid->addWidget(new QLabel(tr("Thumbnails queued:")), 6,1);
+        textGrid->addWidget(new QLabel(QString::number(global.thumbnailer->getQueueSize())),6,2);
+        textGrid->addWidget(new QLabel(tr("Thumbnails per second:")), 7,1);
+        textGrid->addWidget(new QLabel(QString::number(global.thumbnailer->getThroughput(), 'f', 2)),7,2);
+    }
 
 
     QHBoxLayout *buttonLayout = new QHBoxLayout();
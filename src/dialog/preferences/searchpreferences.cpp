@@ -55,7 +55,15 @@ SearchPreferences::SearchPreferences(QWidget *parent) :
 
     tagSelectionOr = new QCheckBox(tr("Show Any Matching Tags When Selecting Multiple Tags"));
     mainLayout->addWidget(tagSelectionOr,row++,0);
-    tagSelectionOr->setChecked(global.indexPDFLocally);
+    tagSelectionOr->setChecked(global.getTagSelectionOr());
+
+    tagSelectionChildren = new QCheckBox(tr("Include Child Tags When Selecting a Tag"));
+    mainLayout->addWidget(tagSelectionChildren,row++,0);
+    tagSelectionChildren->setChecked(global.getTagSelectionChildren());
+
+    liveSearch = new QCheckBox(tr("Search While Typing"));
+    mainLayout->addWidget(liveSearch,row++,0);
+    liveSearch->setChecked(global.getLiveSearch());
 
     indexPDF = new QCheckBox(tr("Index PDFs locally"));
     mainLayout->addWidget(indexPDF,row++,0);
@@ -102,6 +110,8 @@ void SearchPreferences::saveValues() {
     global.setClearTagsOnSearch(clearNotebookOnSearch->isChecked());
     global.setClearSearchOnNotebook(clearSearchOnNotebook->isChecked());
     global.setTagSelectionOr(tagSelectionOr->isChecked());
+    global.setTagSelectionChildren(tagSelectionChildren->isChecked());
+    global.setLiveSearch(liveSearch->isChecked());
     global.setIndexPDFLocally(indexPDF->isChecked());
 
     //global.saveSettingForceSearchLowerCase(forceSearchLowerCase->isChecked());
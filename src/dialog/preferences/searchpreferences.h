@@ -37,6 +37,8 @@ private:
     QCheckBox *clearNotebookOnSearch;   // Clear notebook on search text changes
     QCheckBox *clearTagsOnSearch;      // Clear tag selection on search text changes
     QCheckBox *tagSelectionOr;          // "OR" tag selections.
+    QCheckBox *tagSelectionChildren;    // Include the tags under a selected tag
+    QCheckBox *liveSearch;              // Search while typing
 
     QCheckBox *forceSearchLowerCase;
     QCheckBox *forceSearchWithoutDiacritics;
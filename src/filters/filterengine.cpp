@@ -29,12 +29,17 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #include "src/sql/nsqlquery.h"
 #include "src/sql/favoritesrecord.h"
 #include "src/sql/favoritestable.h"
+#include "src/filters/tagfilter.h"
+#include "src/utilities/metrics.h"
 
 #include <QtSql>
 
 
 extern Global global;
 
+QCache<QString, FilterResult> FilterEngine::cache(FILTER_CACHE_SIZE);
+DataVersion FilterEngine::dataVersion;
+
 FilterEngine::FilterEngine(QObject *parent) :
     QObject(parent)
 {
@@ -42,128 +47,79 @@ FilterEngine::FilterEngine(QObject *parent) :
 
 
 
-// prepare SQL query for selection by tag
-// searched string is in "searchStr"
-// relevance==0 means we a doing primary search
-// relevance>0 means we are doing relevance update search
-// "negativeSearch" may only be passed for relevance==0 and means negative search
-//
-void setupTagSelectionQuery(NSqlQuery &sql, QString searchStr, int relevance, bool negativeSearch) {
-
-    // 0:  search (may then be positive or negative)
-    // >0: relevance update
-    bool isRelevanceUpdate = relevance > 0;
-
-    // is it wildcard search?
-    bool isWildcardSearch = searchStr.contains("*");
-    // this is a bit hack/tinkering - in search we donÄt do automatic right truncating for tags
-    // but for relevance update we do for "title", so let do it also for tags
-    if (isRelevanceUpdate && !isWildcardSearch) {
-        searchStr = searchStr + QString("*");
-        isWildcardSearch = true;
-    }
-
-    QString cmdStr;
-    QString selectionPart;
-    if (!isWildcardSearch) {
-        selectionPart = QString(
-            "("
-                "select lid from datastore where key=:notetagkey"
-                "  and data in (select lid from DataStore where data=:tagname and key=:tagnamekey)"
-                ")"
-        );
-    } else {
-        selectionPart = QString(
-            "("
-                "select lid from datastore where key=:notetagkey"
-                "  and data in (select lid from DataStore where data like :tagname and key=:tagnamekey)"
-                ")"
-        );
-
-        searchStr = searchStr.replace("*", "%");
-    }
-    if (!isRelevanceUpdate) {
-        // positive search: filter out records where tag is not found => "not"
-        // negative search: filter out record where tag IS found
-        QString negateStr = negativeSearch ? QString("") : QString("not");
-        cmdStr = QString("delete from filter where lid ") + negateStr + QString(" in ") + selectionPart;
-    } else {
-        // update record where tag IS found
-        cmdStr = QString("update filter set relevance=relevance+:relevance where lid in ") + selectionPart;
-    }
-
-    sql.prepare(cmdStr);
-    QLOG_DEBUG() << "Tag search query(" << searchStr
-                 << ", relevance=" << relevance
-                 << ", negative:" << negativeSearch
-                 << "): " + cmdStr;
-    sql.bindValue(":tagname", searchStr);
-    sql.bindValue(":tagnamekey", TAG_NAME);
-    sql.bindValue(":notetagkey", NOTE_TAG_LID);
+void FilterEngine::filter(FilterCriteria *newCriteria, QList<qint32> *results) {
+    QLOG_TRACE_IN();
+    static MetricHistogram *latency = Metrics::instance().histogram("filter.filter");
+    static MetricGauge *matches = Metrics::instance().gauge("filter.lastResultCount");
+    static MetricCounter *cacheHits = Metrics::instance().counter("filter.cacheHits");
+    MetricsTimer timer(latency);
+    bool internalSearch = true;
 
-    if (isRelevanceUpdate) {
-        sql.bindValue(":relevance", relevance);
+    FilterCriteria *criteria = newCriteria;
+    if (criteria == nullptr) {
+        criteria = global.getCurrentCriteria();
     }
-}
-
-// prepare SQL query for selection by note title
-// searched string is in "searchStr"
-// relevance==0 means we a doing primary search
-// relevance>0 means we are doing relevance update search
-// "negativeSearch" may only be passed for relevance==0 and means negative search
-//
-void setupTitleSelectionQuery(NSqlQuery &sql, QString searchStr, int relevance, bool negativeSearch) {
-    searchStr = searchStr.replace("*", "%");
-    // 0:  search (may then be positive or negative)
-    // >0: relevance update
-    bool isRelevanceUpdate = relevance > 0;
-
-    // this may happen only if someone posts "intitle:" without term, which doesn't give much sense either
-    if (searchStr == "") {
-        searchStr = "*";
-    }
-    searchStr = searchStr.replace("*", "%");
-
-    // default to right truncation
-    if (!searchStr.endsWith("%"))
-        searchStr = searchStr + QString("%");
-
-    // we also require left truncation, which is a bit unlucky (may also find what we don't expect)
-    if (!searchStr.startsWith("%"))
-        searchStr = QString("%") + searchStr;
-
-    QString cmdStr;
-    QString selectionPart("(select lid from datastore where key=:key and data like :title)");
-
-    if (!isRelevanceUpdate) {
-        // positive search: filter out records (delete) where search term is not found in title => "not"
-        // negative search: filter out record where search term IS found in title => ""
-        QString negateStr = negativeSearch ? QString("") : QString("not");
-        cmdStr = QString("delete from filter where lid ") + negateStr + QString(" in ") + selectionPart;
-    } else {
-        // update record where search term IS found in title
-        cmdStr = QString("update filter set relevance=relevance+:relevance where lid in ") + selectionPart;
+    else {
+        internalSearch = false;
     }
-    sql.prepare(cmdStr);
-    QLOG_DEBUG() << "Title search query(" << searchStr
-                 << ", relevance=" << relevance
-                 << ", negative:" << negativeSearch
-                 << "): " + cmdStr;
 
+    QString key = cacheKey(criteria);
+    qint64 version = dataVersion.current(global.db->conn);
+    FilterResult *cached = cache.object(key);
+    QList <qint32> goodLids;
+    if (cached != nullptr && cached->version == version) {
+        QLOG_DEBUG() << "Filter results found in the cache";
+        cacheHits->increment();
+        restoreResult(*cached);
+        goodLids = cached->lids;
+    } else {
+        runFilters(criteria);
 
-    sql.bindValue(":key", NOTE_TITLE);
-    sql.bindValue(":title", searchStr);
+        FilterResult *result = new FilterResult();
+        result->version = version;
+        NSqlQuery query(global.db);
+        query.exec("select lid, relevance, hit from filter;");
+        while (query.next()) {
+            result->lids.append(query.value(0).toInt());
+            result->relevance.append(query.value(1).toDouble());
+            result->hits.append(query.value(2).toBool());
+        }
+        query.finish();
+        goodLids = result->lids;
+        cache.insert(key, result, qMax(result->lids.size(), 1));
+    }
+    dataVersion.settle(global.db->conn);
+    matches->set(goodLids.size());
 
-    if (isRelevanceUpdate) {
-        sql.bindValue(":relevance", relevance);
+    if (internalSearch) {
+        // Remove any selected notes that are not in the filter.
+        if (global.filterCriteria.size() > 0) {
+            FilterCriteria *criteria = global.getCurrentCriteria();
+            QList <qint32> selectedLids;
+            criteria->getSelectedNotes(selectedLids);
+            for (int i = selectedLids.size() - 1; i >= 0; i--) {
+                if (!goodLids.contains(selectedLids[i]))
+                    selectedLids.removeAll(selectedLids[i]);
+            }
+            criteria->setSelectedNotes(selectedLids);
+            //global.setMessage(QString("Count: ") + QString::number(goodLids.size()), 0);
+        }
+    } else {
+        results->clear();
+        QSet<qint32> found;
+        for (int i = 0; i < goodLids.size(); i++) {
+            if (!found.contains(goodLids[i])) {
+                found.insert(goodLids[i]);
+                results->append(goodLids[i]);
+            }
+        }
     }
 }
 
 
-void FilterEngine::filter(FilterCriteria *newCriteria, QList<qint32> *results) {
-    QLOG_TRACE_IN();
-    bool internalSearch = true;
 
+// Fill the filter table from all the notes
+void FilterEngine::runFilters(FilterCriteria *criteria) {
     NSqlQuery sql(global.db);
     QLOG_DEBUG() << "Purging filters";
     sql.exec("delete from filter");
@@ -176,15 +132,6 @@ void FilterEngine::filter(FilterCriteria *newCriteria, QList<qint32> *results) {
     sql.finish();
     QLOG_DEBUG() << "Reset complete";
 
-
-    FilterCriteria *criteria = newCriteria;
-    if (criteria == nullptr) {
-        criteria = global.getCurrentCriteria();
-    }
-    else {
-        internalSearch = false;
-    }
-
     QLOG_DEBUG() << "Filtering favorite";
     filterFavorite(criteria);
     QLOG_DEBUG() << "Filtering notebooks";
@@ -204,40 +151,102 @@ void FilterEngine::filter(FilterCriteria *newCriteria, QList<qint32> *results) {
                     "where key=:key and lid not in (select lid from filter)");
     sql.bindValue(":key", NOTE_ISPINNED);
     sql.exec();
+    sql.finish();
+}
 
-    // Remove any selected notes that are not in the filter.
-    NSqlQuery query(global.db);
-    QList <qint32> goodLids;
-    query.exec("select lid from filter;");
-    while (query.next()) {
-        goodLids.append(query.value(0).toInt());
-    }
-    query.finish();
 
-    if (internalSearch) {
-        // Remove any selected notes that are not in the filter.
-        if (global.filterCriteria.size() > 0) {
-            FilterCriteria *criteria = global.getCurrentCriteria();
-            QList <qint32> selectedLids;
-            criteria->getSelectedNotes(selectedLids);
-            for (int i = selectedLids.size() - 1; i >= 0; i--) {
-                if (!goodLids.contains(selectedLids[i]))
-                    selectedLids.removeAll(selectedLids[i]);
-            }
-            criteria->setSelectedNotes(selectedLids);
-            //global.setMessage(QString("Count: ") + QString::number(goodLids.size()), 0);
-        }
-    } else {
-        results->clear();
-        for (int i = 0; i < goodLids.size(); i++) {
-            if (!results->contains(goodLids[i])) {
-                results->append(goodLids[i]);
-            }
+QString FilterEngine::searchBaseSql(FilterCriteria *criteria) {
+    QStringList where;
+    where.append("notebooklid not in (select lid from DataStore where key=" +
+                 QString::number(NOTEBOOK_IS_CLOSED) + ")");
+    bool deletedOnly = criteria->isSet() && criteria->isDeletedOnlySet() && criteria->getDeletedOnly();
+    where.append("lid in (select lid from DataStore where key=" + QString::number(NOTE_ACTIVE) +
+                 " and data=" + (deletedOnly ? "0" : "1") + ")");
+
+    if (criteria->isSet() && criteria->isNotebookSet()) {
+        QTreeWidgetItem *notebook = criteria->getNotebook();
+        if (notebook->data(0,Qt::UserRole).toString() == "STACK") {
+            QString stack = notebook->text(0).replace("'", "''");
+            where.append("lid in (select lid from DataStore where key=" + QString::number(NOTE_NOTEBOOK_LID) +
+                         " and data in (select lid from DataStore where key=" + QString::number(NOTEBOOK_STACK) +
+                         " and data='" + stack + "'))");
+        } else {
+            where.append("lid in (select lid from DataStore where key=" + QString::number(NOTE_NOTEBOOK_LID) +
+                         " and data=" + QString::number(notebook->data(0,Qt::UserRole).toInt()) + ")");
         }
     }
+
+    if (criteria->isSet() && criteria->isTagsSet()) {
+        QList<QTreeWidgetItem*> tags = criteria->getTags();
+        QList<qint32> tagLids;
+        for (int i=0; i<tags.size(); i++)
+            tagLids.append(tags[i]->data(0,Qt::UserRole).toInt());
+        TagFilter tagFilter(tagLids, global.getTagSelectionOr(), global.getTagSelectionChildren());
+        if (!tagFilter.isEmpty())
+            where.append("lid in (" + tagFilter.sql() + ")");
+    }
+
+    // Pinned notes are always shown, see runFilters()
+    return "select lid from NoteTable where " + where.join(" and ") +
+            " union select lid from DataStore where key=" + QString::number(NOTE_ISPINNED);
+}
+
+
+// Everything the result of a filter depends on, other than the data.  Dates
+// in searches & attributes are relative to today.
+QString FilterEngine::cacheKey(FilterCriteria *criteria) {
+    QStringList key;
+    key << QDate::currentDate().toString(Qt::ISODate)
+        << QString::number(global.getMinimumRecognitionWeight())
+        << (global.getTagSelectionOr() ? "or" : "and")
+        << (global.getTagSelectionChildren() ? "children" : "");
+    if (!criteria->isSet())
+        return key.join("|");
+
+    if (criteria->isFavoriteSet())
+        key << "favorite:" + QString::number(criteria->getFavorite());
+    if (criteria->isNotebookSet())
+        key << "notebook:" + criteria->getNotebook()->data(0,Qt::UserRole).toString()
+               + "/" + criteria->getNotebook()->text(0);
+    if (criteria->isTagsSet()) {
+        QList<QTreeWidgetItem*> tags = criteria->getTags();
+        QList<qint32> tagLids;
+        for (int i=0; i<tags.size(); i++)
+            tagLids.append(tags[i]->data(0,Qt::UserRole).toInt());
+        qSort(tagLids);
+        QStringList tagKey;
+        for (int i=0; i<tagLids.size(); i++)
+            tagKey.append(QString::number(tagLids[i]));
+        key << "tags:" + tagKey.join(",");
+    }
+    if (criteria->isDeletedOnlySet())
+        key << (criteria->getDeletedOnly() ? "deleted" : "active");
+    if (criteria->isSearchStringSet())
+        key << "search:" + global.normalizeTermForSearchAndIndex(criteria->getSearchString()).simplified();
+    if (criteria->isAttributeSet())
+        key << "attribute:" + criteria->getAttribute()->data(0,Qt::UserRole).toString();
+    return key.join("|");
 }
 
 
+// Put a cached result back in the filter table, a few hundred rows per statement
+void FilterEngine::restoreResult(const FilterResult &result) {
+    NSqlQuery sql(global.db);
+    bool transaction = global.db->conn.transaction();
+    sql.exec("delete from filter");
+    for (int i=0; i<result.lids.size(); i+=FILTER_INSERT_ROWS) {
+        QStringList rows;
+        for (int j=i; j<result.lids.size() && j<i+FILTER_INSERT_ROWS; j++)
+            rows.append("(" + QString::number(result.lids[j]) + ","
+                        + QString::number(result.relevance[j], 'g', 17) + ","
+                        + (result.hits[j] ? "1" : "0") + ")");
+        sql.exec("insert into filter (lid,relevance,hit) values " + rows.join(","));
+    }
+    if (transaction)
+        global.db->conn.commit();
+    sql.finish();
+}
+
 
 void FilterEngine::filterAttributes(FilterCriteria *criteria) {
     if (!criteria->isSet() || !criteria->isAttributeSet()) {
@@ -579,21 +588,11 @@ void FilterEngine::filterFavorite(FilterCriteria *criteria) {
     }
 
     if (rec.type == FavoritesRecord::Tag) {
-        NoteTable noteTable(global.db);
-        TagTable tagTable(global.db);
         NSqlQuery sql(global.db);
-        sql.exec("create temporary table if not exists goodLids (lid integer)");
-        sql.exec("delete from goodLids");
-        QList<qint32> notes;
-        QString tagGuid="";
-        tagTable.getGuid(tagGuid, rec.target.toInt());
-        noteTable.getNotesWithTag(notes, tagGuid);
-        sql.prepare("insert into goodLids (lid) values (:note)");
-        for (qint32 i=0; i<notes.size(); i++) {
-            sql.bindValue(":note", notes[i]);
-            sql.exec();
-        }
-        sql.exec("delete from filter where lid not in (select lid from goodLids)" );
+        sql.prepare("delete from filter where lid not in (select lid from DataStore where key=:key and data=:tagLid)");
+        sql.bindValue(":key", NOTE_TAG_LID);
+        sql.bindValue(":tagLid", rec.target.toInt());
+        sql.exec();
         sql.finish();
     }
 
@@ -617,7 +616,6 @@ void FilterEngine::filterNotebook(FilterCriteria *criteria) {
         QString stackName = criteria->getNotebook()->text(0);
         filterStack(stackName);
     } else {
-        FilterCriteria *criteria = global.getCurrentCriteria();
         qint32 notebookLid = criteria->getNotebook()->data(0,Qt::UserRole).toInt();
         NotebookTable notebookTable(global.db);
         QString notebook;
@@ -628,7 +626,6 @@ void FilterEngine::filterNotebook(FilterCriteria *criteria) {
 
 
 
-
 // If they only chose one notebook, then delete everything else
 void FilterEngine::filterIndividualNotebook(QString &notebook) {
     QLOG_TRACE_IN();
@@ -655,37 +652,15 @@ void FilterEngine::filterStack(QString &stack) {
     if (stack.startsWith("stack:"))
         stack = stack.mid(stack.indexOf("stack:")+6);
 
-    NotebookTable notebookTable(global.db);
-    QList<qint32> books;
-    QList<qint32> stackBooks;
-    notebookTable.getAll(books);
-    notebookTable.getStack(stackBooks, stack);
-
+    // Notes in the stack are removed (negative) or kept
     NSqlQuery sql(global.db);
-    if (negative) {
-        sql.exec("create temporary table if not exists goodLids (lid integer)");
-        sql.exec("delete from goodLids");
-        sql.prepare("insert into goodLids (lid) select lid from DataStore where key=:key");
-        sql.bindValue(":key", NOTEBOOK_GUID);
-        sql.exec();
-        sql.prepare("delete from goodLids where lid=:notebookLid");
-    } else {
-        sql.prepare("Delete from filter where lid in (select lid from DataStore where key=:type and data=:notebookLid)");
-        sql.bindValue(":type", NOTE_NOTEBOOK_LID);
-    }
-
-    for (qint32 i=0; i<books.size(); i++) {
-        if (!stackBooks.contains(books[i])) {
-            sql.bindValue(":notebookLid", books[i]);
-            sql.exec();
-        }
-    }
-
-    if (negative) {
-        sql.prepare("delete from filter where lid in (select lid from DataStore where key=:key and data in (select lid from goodLids))");
-        sql.bindValue(":key", NOTE_NOTEBOOK_LID);
-        sql.exec();
-    }
+    sql.prepare(QString("delete from filter where lid ") + (negative ? "in" : "not in")
+                + " (select lid from DataStore where key=:noteNotebook and data in"
+                + " (select lid from DataStore where key=:stackKey and data=:stack))");
+    sql.bindValue(":noteNotebook", NOTE_NOTEBOOK_LID);
+    sql.bindValue(":stackKey", NOTEBOOK_STACK);
+    sql.bindValue(":stack", stack);
+    sql.exec();
     sql.finish();
 }
 
@@ -697,42 +672,16 @@ void FilterEngine::filterTags(FilterCriteria *criteria) {
         return;
     QLOG_TRACE_IN();
     QList<QTreeWidgetItem*> tags = criteria->getTags();
+    QList<qint32> tagLids;
+    for (qint32 i=0; i<tags.size(); i++)
+        tagLids.append(tags[i]->data(0,Qt::UserRole).toInt());
 
-    if (!global.getTagSelectionOr()) {
-        NSqlQuery query(global.db);
-        for (qint32 i=0; i<tags.size(); i++) {
-            query.prepare("Delete from filter where lid not in (select lid from datastore where key=:notetagkey and data=:data)");
-            query.bindValue(":notetagkey", NOTE_TAG_LID);
-            query.bindValue(":data", tags[i]->data(0,Qt::UserRole).toInt())  ;
-            query.exec();
-        }
-        query.finish();
-    } else {
-        NoteTable noteTable(global.db);
-        TagTable tagTable(global.db);
-        QList<qint32> goodNotes;
-        for (qint32 i=0; i<tags.size(); i++) {
-            QList<qint32> notes;
-            QString tagGuid;
-            tagTable.getGuid(tagGuid, tags[i]->data(0,Qt::UserRole).toInt());
-            noteTable.getNotesWithTag(notes, tagGuid);
-            for (qint32 j=0; j<notes.size(); j++) {
-                if (!goodNotes.contains(notes[j]))
-                    goodNotes.append(notes[j]);
-            }
-        }
-
-        NSqlQuery sql(global.db);
-        sql.exec("create temporary table if not exists goodLids (lid integer)");
-        sql.exec("delete from goodLids");
-        sql.prepare("insert into goodLids (lid) values (:note)");
-        for (qint32 i=0; i<goodNotes.size(); i++) {
-            sql.bindValue(":note", goodNotes[i]);
-            sql.exec();
-        }
-        sql.exec("delete from filter where lid not in (select lid from goodLids)" );
-        sql.finish();
-    }
+    TagFilter tagFilter(tagLids, global.getTagSelectionOr(), global.getTagSelectionChildren());
+    if (tagFilter.isEmpty())
+        return;
+    NSqlQuery sql(global.db);
+    sql.exec("delete from filter where lid not in (" + tagFilter.sql() + ")");
+    sql.finish();
 }
 
 
@@ -770,122 +719,63 @@ void FilterEngine::filterSearchString(FilterCriteria *criteria) {
     }
     QLOG_TRACE_IN();
 
-    anyFlagSet = false;
     QString searchString = global.normalizeTermForSearchAndIndex(criteria->getSearchString());
 
-    if (searchString.trimmed().startsWith("any:", Qt::CaseInsensitive)) {
-        anyFlagSet = true;
-    }
-
     // Tokenize out the words
     QStringList list;
     QLOG_DEBUG() << "Original String Search: " << searchString;
     splitSearchTerms(list, searchString);
 
+    SearchQuery query(list, global.getMinimumRecognitionWeight());
+    query.optimize();
+    anyFlagSet = query.any;
+    QLOG_DEBUG() << "Search terms: " << query.toString();
+
     if (!anyFlagSet)
-        filterSearchStringAll(list);
+        filterSearchStringAll(query);
     else
-        filterSearchStringAny(list);
+        filterSearchStringAny(query);
 }
 
 
-// Split the search term into specific tokens.
-void FilterEngine::splitSearchTerms(QStringList &words, QString search) {
-    QLOG_TRACE_IN();
-    words.clear();
-
-
-    // First go through the string and put null characters between
-    // the search terms.  This helps parse out the terms later, since
-    // some may be in quotes
-    qint32 len = search.length();
-    char nextChar = ' ';
-    bool quote = false;
-    for (qint32 i = 0; i < len; i++) {
-        if (search[i] == nextChar && !quote) {
-            search[i] = '\0';
-            nextChar = ' ';
-        } else {
-            if (search[i] == '\"') {
-                if (!quote) {
-                    quote = true;
-                } else {
-                    quote = false;
-                }
-            }
-        }
-        if (((i + 2) < len) && search[i] == '\\') {
-            i = i + 2;
-        }
-    }
-
-    // Now that we have null characters between them, we parse
-    // out based upon them rather than spaces.
-    qint32 pos = 0;
-    for (qint32 i = 0; i < search.length() && search.length() > 0; i++) {
-        if (search[i] == '\0') {
-            search = search.remove(0, 1);
-            i = -1;
-        } else {
-            pos = search.indexOf(QChar('\0'));
-            if (pos != -1) {
-                words.append(search.left(pos).toLower());
-                search.remove(0, pos);
-                i = -1;
-            } else {
-                words.append(search.toLower());
-                search = "";
-            }
-        }
+// Run the compiled search over the filter table and keep the matching rows
+// with their relevance.
+void FilterEngine::runSearchQuery(SearchQuery &query, bool otherLids) {
+    NSqlQuery sql(global.db);
+    sql.exec("create temp table if not exists filterMatch (lid integer, relevance real, hit integer)");
+    sql.exec("delete from filterMatch");
+
+    sql.prepare("insert into filterMatch (lid, relevance, hit) " + query.sql(otherLids));
+    query.bindValues(sql);
+    QLOG_DEBUG() << "Search query: " << sql.lastQuery();
+    if (QsLogging::Logger::instance().loggingLevel() == QsLogging::TraceLevel) {
+        QStringList plan = query.explain(global.db->conn, otherLids);
+        for (int i=0; i<plan.size(); i++)
+            QLOG_TRACE() << "Search plan: " << plan[i];
+    }
+    if (!sql.exec()) {
+        QLOG_ERROR() << "Search failed: " << sql.lastError();
+        sql.finish();
+        return;
     }
 
-    // Now that we have everything separated, we can remove the unneeded " marks
-    for (qint32 i = 0; i < words.length(); i++) {
-        words[i].remove("\"");
-    }
+    sql.exec("delete from filter");
+    sql.exec("insert into filter (lid, relevance, hit) select lid, relevance, hit from filterMatch");
+    sql.finish();
 }
 
 
 // Filter based upon the words the user specified (as opposed to the notebook, tags ...)
-// this is for the "all" filter (the default), not the "any:"
-// "list" is list of words generated by tokenizing the search term
-void FilterEngine::filterSearchStringAll(QStringList list) {
+// this is for the "all" filter (the default), not the "any:".  Terms the query
+// doesn't compile are run one at a time first.
+void FilterEngine::filterSearchStringAll(SearchQuery &query) {
     QLOG_TRACE_IN();
 
-    // Filter out the records
-    NSqlQuery sql(global.db), sqlnegative(global.db);
-
-    sql.prepare(
-        "Delete from filter where lid not in "
-            "(select lid from SearchIndex where weight>=:weight and content match :word)"
-            "and lid not in (select data from DataStore where key=:key and lid in "
-            "(select lid from SearchIndex where weight>=:weight2 and content match :word2))");
-    sqlnegative.prepare(
-        "Delete from filter where lid in "
-            "(select lid from SearchIndex where weight>=:weight and content match :word)"
-            " or lid in (select data from DataStore where key=:key and lid in "
-            "(select lid from SearchIndex where weight>=:weight2 and content match :word2))");
-
-    sql.bindValue(":weight", global.getMinimumRecognitionWeight());
-    sql.bindValue(":weight2", global.getMinimumRecognitionWeight());
-    sql.bindValue(":key", RESOURCE_NOTE_LID);
-
-    sqlnegative.bindValue(":weight", global.getMinimumRecognitionWeight());
-    sqlnegative.bindValue(":weight2", global.getMinimumRecognitionWeight());
-    sqlnegative.bindValue(":key", RESOURCE_NOTE_LID);
-
-    for (qint32 i = 0; i < list.size(); i++) {
-        QString string = list[i];
-        string.remove(QChar('"'));
-
-        QString origString(string); // copy original unmodified value
-
-        // If we have a notebook search request
-        if (string.startsWith("notebook:", Qt::CaseInsensitive) ||
-            string.startsWith("-notebook:", Qt::CaseInsensitive)) {
-            filterSearchStringNotebookAll(string);
-        } else if (string.startsWith("stack:", Qt::CaseInsensitive) ||
-                   string.startsWith("-stack:", Qt::CaseInsensitive)) {
+    for (qint32 i = 0; i < query.others.size(); i++) {
+        QString string = query.others[i];
+
+        if (string.startsWith("stack:", Qt::CaseInsensitive) ||
+            string.startsWith("-stack:", Qt::CaseInsensitive)) {
             filterStack(string);
         } else if (string.startsWith("todo:", Qt::CaseInsensitive) ||
                    string.startsWith("-todo:", Qt::CaseInsensitive)) {
@@ -899,12 +789,6 @@ void FilterEngine::filterSearchStringAll(QStringList list) {
         } else if (string.startsWith("reminderDoneTime:", Qt::CaseInsensitive) ||
                    string.startsWith("-reminderDoneTime:", Qt::CaseInsensitive)) {
             filterSearchStringReminderDoneTimeAll(string);
-        } else if (string.startsWith("tag:", Qt::CaseInsensitive) ||
-                   string.startsWith("-tag:", Qt::CaseInsensitive)) {
-            filterSearchStringTagAll(string);
-        } else if (string.startsWith("intitle:", Qt::CaseInsensitive) ||
-                   string.startsWith("-intitle:", Qt::CaseInsensitive)) {
-            filterSearchStringIntitleAll(string);
         } else if (string.startsWith("resource:", Qt::CaseInsensitive) ||
                    string.startsWith("-resource:", Qt::CaseInsensitive)) {
             filterSearchStringResourceAll(string);
@@ -942,145 +826,68 @@ void FilterEngine::filterSearchStringAll(QStringList list) {
                    string.startsWith("subjectdate:", Qt::CaseInsensitive) ||
                    string.startsWith("-subjectdate:", Qt::CaseInsensitive)) {
             filterSearchStringDateAll(string);
-        } else if (string.startsWith("-*")) {   // Negative postfix search.  FTS doesn't do this.
-            string = string.mid(1);
-            string = string.replace("*", "%");
-            if (!string.endsWith("%"))
-                string = string + QString("%");
-            NSqlQuery prefix(global.db);
-            prefix.prepare(
-                "Delete from filter where lid in (select lid from SearchIndex where weight>=:weight "
-                    "and content like :word) or lid in (select data from DataStore where lid in "
-                    "(select lid from SearchIndex where weight>:weight2 and content like :word2))");
-
-            prefix.bindValue(":weight", global.getMinimumRecognitionWeight());
-            prefix.bindValue(":weight2", global.getMinimumRecognitionWeight());
-            prefix.bindValue(":word", string);
-            prefix.bindValue(":word2", string);
-            prefix.exec();
-        } else if (string.indexOf("_") >= 0) {    // underscore search.  FTS doesn't do this.
-            string = string.replace("_", "/_");
-            string = string.replace("*", "%");
-            if (!string.endsWith("%"))
-                string = string + QString("%");
-            if (!string.startsWith("%"))
-                string = QString("%") + string;
-            NSqlQuery prefix(global.db);
-            prefix.prepare(
-                "Delete from filter where lid not in (select lid from SearchIndex where weight>=:weight "
-                    "and content like :word escape '/') and "
-                    "lid not in (select data from DataStore where key=:key and lid in (select lid from SearchIndex "
-                    "where weight>:weight2 and content like :word2 escape '/'))");
-
-            prefix.bindValue(":weight", global.getMinimumRecognitionWeight());
-            prefix.bindValue(":weight2", global.getMinimumRecognitionWeight());
-            prefix.bindValue(":word", string);
-            prefix.bindValue(":word2", string);
-            prefix.bindValue(":key", RESOURCE_NOTE_LID);
-            prefix.exec();
-        } else if (string.indexOf("-") >= 0) {    // Hyphen search.  FTS doesn't do this.
-            string = string.replace("*", "%");
-            if (!string.endsWith("%"))
-                string = string + QString("%");
-            if (!string.startsWith("%"))
-                string = QString("%") + string;
-            NSqlQuery prefix(global.db);
-            prefix.prepare(
-                "Delete from filter where lid not in (select lid from SearchIndex where weight>=:weight and content "
-                    "like :word) and lid not in (select data from DataStore where key=:key and lid in (select lid "
-                    "from SearchIndex where weight>:weight2 and content like :word2))");
-
-            prefix.bindValue(":weight", global.getMinimumRecognitionWeight());
-            prefix.bindValue(":weight2", global.getMinimumRecognitionWeight());
-            prefix.bindValue(":word", string);
-            prefix.bindValue(":word2", string);
-            prefix.bindValue(":key", RESOURCE_NOTE_LID);
-            prefix.exec();
-        } else if (string.startsWith("*")) {    // Postfix search.  FTS doesn't do this.
-            string = string.replace("*", "%");
-            if (!string.endsWith("%"))
-                string = string + QString("%");
-            NSqlQuery prefix(global.db);
-            prefix.prepare(
-                "Delete from filter where lid not in (select lid from SearchIndex where weight>=:weight and content "
-                    "like :word) and lid not in (select data from DataStore where key=:key and lid in (select lid "
-                    "from SearchIndex where weight>:weight2 and content like :word2))");
-
-            prefix.bindValue(":weight", global.getMinimumRecognitionWeight());
-            prefix.bindValue(":weight2", global.getMinimumRecognitionWeight());
-            prefix.bindValue(":word", string);
-            prefix.bindValue(":word2", string);
-            prefix.bindValue(":key", RESOURCE_NOTE_LID);
-            prefix.exec();
-        } else {
-            // Filter not found.  Use FTS search (full text search)
-
-            QLOG_TRACE() << "Using FTS search";
-            if (string.startsWith("-")) {
-                string = string.remove(0, 1).trimmed();
-                if (!string.endsWith("*"))
-                    string = string + QString("*");
-                if (string.contains(" "))
-                    string = "\"" + string + "\"";
-                sqlnegative.bindValue(":key", RESOURCE_NOTE_LID);
-                sqlnegative.bindValue(":word", string);
-                sqlnegative.bindValue(":word2", string);
-                sqlnegative.exec();
-            } else {
-                if (!string.endsWith("*"))
-                    string = string + QString("*");
-                if (string.contains(" "))
-                    string = "\"" + string + "\"";
-                sql.bindValue(":key", RESOURCE_NOTE_LID);
-                sql.bindValue(":word", string);
-                sql.bindValue(":word2", string);
-                sql.exec();
-            }
-
-
-            // update relevance by +1 where search term is found in title
-            NSqlQuery relUpdtSql(global.db);
-            setupTitleSelectionQuery(relUpdtSql, origString, 1, true);
-            relUpdtSql.exec();
-
-            // update relevance by +1 where search term is found as tag value
-            setupTagSelectionQuery(relUpdtSql, origString, 1, true);
-            relUpdtSql.exec();
-
-            relUpdtSql.finish();
         }
     }
 
-    // after we are finished, check for "important" notes (marked by tag important*)
-    // update relevance by +1 where search term is found as tag value
-    // here we give boost +3
-    setupTagSelectionQuery(sql, QString("important"), 3, true);
-    sql.exec();
-
-
-    sql.finish();
+    runSearchQuery(query, false);
 }
 
 
-// filter based upon the title string the user specified.  This is for the "all"
-// filter and not the "any".
-void FilterEngine::filterSearchStringIntitleAll(QString searchStr) {
+// Split the search term into specific tokens.
+void FilterEngine::splitSearchTerms(QStringList &words, QString search) {
     QLOG_TRACE_IN();
+    words.clear();
 
-    NSqlQuery sql(global.db);
-    if (!searchStr.startsWith("-")) {
-        // in" title
-        searchStr.remove(0, 8);    // remove 8 chars of "intitle:"
-        setupTitleSelectionQuery(sql, searchStr, 0, false);
-    } else {
-        // NOT "in" title
-        searchStr.remove(0, 9); // remove 9 chars of "!intitle:"
-        setupTitleSelectionQuery(sql, searchStr, 0, true);
+
+    // First go through the string and put null characters between
+    // the search terms.  This helps parse out the terms later, since
+    // some may be in quotes
+    qint32 len = search.length();
+    char nextChar = ' ';
+    bool quote = false;
+    for (qint32 i = 0; i < len; i++) {
+        if (search[i] == nextChar && !quote) {
+            search[i] = '\0';
+            nextChar = ' ';
+        } else {
+            if (search[i] == '\"') {
+                if (!quote) {
+                    quote = true;
+                } else {
+                    quote = false;
+                }
+            }
+        }
+        if (((i + 2) < len) && search[i] == '\\') {
+            i = i + 2;
+        }
+    }
+
+    // Now that we have null characters between them, we parse
+    // out based upon them rather than spaces.
+    qint32 pos = 0;
+    for (qint32 i = 0; i < search.length() && search.length() > 0; i++) {
+        if (search[i] == '\0') {
+            search = search.remove(0, 1);
+            i = -1;
+        } else {
+            pos = search.indexOf(QChar('\0'));
+            if (pos != -1) {
+                words.append(search.left(pos).toLower());
+                search.remove(0, pos);
+                i = -1;
+            } else {
+                words.append(search.toLower());
+                search = "";
+            }
+        }
     }
-    sql.exec();
-    sql.finish();
-}
 
+    // Now that we have everything separated, we can remove the unneeded " marks
+    for (qint32 i = 0; i < words.length(); i++) {
+        words[i].remove("\"");
+    }
+}
 
 
 
@@ -1159,7 +966,6 @@ void FilterEngine::filterSearchStringAuthorAll(QString string) {
 
 
 
-
 // filter based upon the note source the user specified.  This is for the "all"
 // filter and not the "any".
 void FilterEngine::filterSearchStringSourceAll(QString string) {
@@ -1202,7 +1008,6 @@ void FilterEngine::filterSearchStringSourceAll(QString string) {
 
 
 
-
 // filter based upon the note content class the user specified.  This is for the "all"
 // filter and not the "any".
 void FilterEngine::filterSearchStringContentClassAll(QString string) {
@@ -1286,7 +1091,6 @@ void FilterEngine::filterSearchStringPlaceNameAll(QString string) {
 
 
 
-
 // filter based upon the note source application the user specified.  This is for the "all"
 // filter and not the "any".
 void FilterEngine::filterSearchStringSourceApplicationAll(QString string) {
@@ -1329,8 +1133,6 @@ void FilterEngine::filterSearchStringSourceApplicationAll(QString string) {
 
 
 
-
-
 // filter based upon the mime type the user specified.  This is for the "all"
 // filter and not the "any".
 void FilterEngine::filterSearchStringResourceAll(QString string) {
@@ -1413,77 +1215,6 @@ void FilterEngine::filterSearchStringResourceRecognitionTypeAll(QString string)
 
 
 
-
-// filter based upon the tag string the user specified.  This is for the "all"
-// filter and not the "any".
-void FilterEngine::filterSearchStringTagAll(QString string) {
-    QLOG_TRACE_IN();
-    NSqlQuery sql(global.db);
-
-    if (!string.startsWith("-")) {
-        // positive search
-        string.remove(0, 4);
-        if (string == "")
-            string = "*";
-
-        // Filter out the records
-        setupTagSelectionQuery(sql, string, 0, false);
-    } else {
-        // negative search
-        string.remove(0, 5);
-        if (string == "")
-            string = "*";
-
-        // Filter out the records
-        setupTagSelectionQuery(sql, string, 0, true);
-    }
-    sql.exec();
-    sql.finish();
-}
-
-
-
-// filter based upon the notebook string the user specified.  This is for the "all"
-// filter and not the "any".
-void FilterEngine::filterSearchStringNotebookAll(QString string) {
-    QLOG_TRACE_IN();
-    if (!string.startsWith("-")) {
-        string.remove(0,9);
-        if (string == "")
-            string = "*";
-        // Filter out the records
-        NSqlQuery notebookSql(global.db);
-        if (not string.contains("*"))
-            notebookSql.prepare("Delete from filter where lid not in (select lid from NoteTable where notebook = :notebook)");
-        else {
-            notebookSql.prepare("Delete from filter where lid not in (select lid from NoteTable where notebook like :notebook)");
-            string.replace("*", "%");
-        }
-//        notebookSql.bindValue(":type", NOTE_NOTEBOOK_LID);
-        notebookSql.bindValue(":notebook", string);
-        notebookSql.exec();
-        notebookSql.finish();
-
-    } else {
-        string.remove(0,10);
-        if (string == "")
-            string = "*";
-        // Filter out the records
-        NSqlQuery notebookSql(global.db);
-        if (not string.contains("*"))
-            notebookSql.prepare("Delete from filter where lid not in (select lid from NoteTable where notebook <> :notebook)");
-        else {
-            notebookSql.prepare("Delete from filter where lid not in (select lid from NoteTable where notebook not like :notebook)");
-            string.replace("*", "%");
-        }
-        //notebookSql.bindValue(":type", NOTE_NOTEBOOK);
-        notebookSql.bindValue(":notebook", string);
-        notebookSql.exec();
-        notebookSql.finish();
-    }
-}
-
-
 // filter based upon the notebook string the user specified.  This is for the "all"
 // filter and not the "any".
 void FilterEngine::filterSearchStringTodoAll(QString string) {
@@ -1585,8 +1316,6 @@ void FilterEngine::filterSearchStringReminderOrderAll(QString string) {
 
 
 
-
-
 void FilterEngine::filterSearchStringDateAll(QString string) {
     QLOG_TRACE_IN();
     int separator = string.indexOf(":")+1;
@@ -1628,8 +1357,6 @@ void FilterEngine::filterSearchStringDateAll(QString string) {
 
 
 
-
-
 QDateTime FilterEngine::calculateDateTime(QString string) {
     QLOG_TRACE_IN();
     QDateTime tam;  // datetime - midnight today
@@ -1714,45 +1441,21 @@ QDateTime FilterEngine::calculateDateTime(QString string) {
 
 
 
-
-
 // Filter based upon the words the user specified (as opposed to the notebook, tags ...)
-// this is for the "any" filter (the default), not the default of all
-void FilterEngine::filterSearchStringAny(QStringList list) {
+// this is for the "any" filter (the default), not the default of all.
+// The terms the query doesn't compile add their notes to anylidsfilter,
+// which the query then ORs with its own terms.
+void FilterEngine::filterSearchStringAny(SearchQuery &query) {
     QLOG_TRACE_IN();
-    // Filter out the records
-    NSqlQuery sql(global.db), sqlnegative(global.db);
-    NSqlQuery resSql(global.db), resSqlNegative(global.db);
-
+    NSqlQuery sql(global.db);
     sql.exec("create table if not exists anylidsfilter (lid int);");
     sql.exec("delete from anylidsfilter");
+    sql.finish();
 
-    sql.exec("create table if not exists anylidsfilterRes (lid int);");
-    sql.exec("delete from anylidsfilterRes");
-
-    sql.prepare("insert into anylidsfilter (lid) select lid from SearchIndex where weight>=:weight and source='text' and content match :word");
-    resSql.prepare("insert into anylidsfilterRes (lid) select lid from SearchIndex where source='recognition' and weight>=:weight and content match :word");
-
-    sqlnegative.prepare("insert into anylidsfilter (lid) select lid from SearchIndex where lid not in (select lid from searchindex where source='text' and weight>=:weight and content match :word)");
-    resSqlNegative.prepare("insert into anylidsfilterRes (lid) select lid from SearchIndex where lid not in (select lid from searchindex where source='recognition' and weight>=:weight and content match :word)");
-
-    sql.bindValue(":weight", global.getMinimumRecognitionWeight());
-    sqlnegative.bindValue(":weight", global.getMinimumRecognitionWeight());
-
-    resSql.bindValue(":weight", global.getMinimumRecognitionWeight());
-    resSqlNegative.bindValue(":weight", global.getMinimumRecognitionWeight());
-
-    // We start at the second entry because the first is "any:"
-    for (qint32 i=1; i<list.size(); i++) {
-        QString string = list[i];
-        string.remove(QChar('"'));
+    for (qint32 i=0; i<query.others.size(); i++) {
+        QString string = query.others[i];
 
-        // If we have a notebook search request
-        if (string.startsWith("notebook:", Qt::CaseInsensitive) ||
-                string.startsWith("-notebook:", Qt::CaseInsensitive)) {
-            filterSearchStringNotebookAny(string);
-        }
-        else if (string.startsWith("todo:", Qt::CaseInsensitive) ||
+        if (string.startsWith("todo:", Qt::CaseInsensitive) ||
                 string.startsWith("-todo:", Qt::CaseInsensitive)) {
             filterSearchStringTodoAny(string);
         }
@@ -1768,14 +1471,6 @@ void FilterEngine::filterSearchStringAny(QStringList list) {
                 string.startsWith("-reminderDoneTime:", Qt::CaseInsensitive)) {
             filterSearchStringReminderDoneTimeAny(string);
         }
-        else if (string.startsWith("tag:", Qt::CaseInsensitive) ||
-                string.startsWith("-tag:", Qt::CaseInsensitive)) {
-            filterSearchStringTagAny(string);
-        }
-        else if (string.startsWith("intitle:", Qt::CaseInsensitive) ||
-                string.startsWith("-intitle:", Qt::CaseInsensitive)) {
-            filterSearchStringIntitleAny(string);
-        }
         else if (string.startsWith("resource:", Qt::CaseInsensitive) ||
                 string.startsWith("-resource:", Qt::CaseInsensitive)) {
             filterSearchStringResourceAny(string);
@@ -1820,74 +1515,13 @@ void FilterEngine::filterSearchStringAny(QStringList list) {
                 string.startsWith("-subjectdate", Qt::CaseInsensitive)) {
             filterSearchStringDateAny(string);
         }
-        else { // Filter not found
-            if (string.startsWith("-")) {
-                string = string.remove(0,1);
-                sqlnegative.bindValue(":word", string.trimmed()+"*");
-                sqlnegative.exec();
-                resSqlNegative.bindValue(":word", string.trimmed()+"*");
-                resSqlNegative.exec();
-            } else {
-                sql.bindValue(":word", string.trimmed()+"*");
-                sql.exec();
-                resSql.bindValue(":word", string.trimmed()+"*");
-                resSql.exec();
-            }
-        }
     }
 
-    // At this point we have two tables. One has resource LIDs and the other note LIDs.  We need to
-    // map the resource LIDs to note LIDs for the filter;
-    sql.prepare("insert into anylidsfilter (lid) select a.data from datastore a where a.key=:key and lid in (select lid from anylidsfilterRes)");
-    sql.bindValue(":key", RESOURCE_NOTE_LID);
-    sql.exec();
-    sql.exec("delete from filter where lid not in (select lid from anylidsfilter)");
-    sql.finish();
+    runSearchQuery(query, !query.others.isEmpty());
 }
 
 
 
-// filter based upon the notebook string the user specified.  This is for the "any"
-// filter and not the default
-void FilterEngine::filterSearchStringNotebookAny(QString string) {
-    QLOG_TRACE_IN();
-
-    if (!string.startsWith("-")) {
-        string.remove(0,9);
-        if (string == "")
-            string = "*";
-        // Filter out the records
-        NSqlQuery notebookSql(global.db);
-        if (not string.contains("*"))
-            notebookSql.prepare("insert into anylidsfilter (lid) select lid from NoteTable where notebook=:notebook");
-        else {
-            notebookSql.prepare("insert into anylidsfilter (lid) select lid from NoteTable where notebook like :notebook");
-            string.replace("*", "%");
-        }
-        notebookSql.bindValue(":notebook", string);
-        notebookSql.exec();
-        notebookSql.finish();
-    } else {
-        string.remove(0,10);
-        if (string == "")
-            string = "*";
-        // Filter out the records
-        NSqlQuery notebookSql(global.db);
-        if (not string.contains("*"))
-            notebookSql.prepare("insert into anylidsfilter (lid) select lid from NoteTable where notebook <> :notebook");
-        else {
-            notebookSql.prepare("insert into anylidsfilter (lid) select lid from NoteTable where notebook not like :notebook");
-            string.replace("*", "%");
-        }
-        notebookSql.bindValue(":notebook", string);
-        notebookSql.exec();
-        notebookSql.finish();
-    }
-}
-
-
-
-
 // filter based upon the notebook string the user specified.  This is for the "any:"
 // filter and not the default
 void FilterEngine::filterSearchStringTodoAny(QString string) {
@@ -1939,9 +1573,6 @@ void FilterEngine::filterSearchStringTodoAny(QString string) {
 
 
 
-
-
-
 // filter based upon the reminder: string the user specified.  This is for the "any:"
 // filter and not the default
 void FilterEngine::filterSearchStringReminderOrderAny(QString string) {
@@ -1985,93 +1616,6 @@ void FilterEngine::filterSearchStringReminderOrderAny(QString string) {
 
 
 
-
-// filter based upon the tag string the user specified.  This is for the "any:"
-// filter and not the default
-void FilterEngine::filterSearchStringTagAny(QString string) {
-    QLOG_TRACE_IN();
-    if (!string.startsWith("-")) {
-        string.remove(0,4);
-        if (string == "")
-            string = "*";
-        // Filter out the records
-        NSqlQuery tagSql(global.db);
-        if (not string.contains("*"))
-            tagSql.prepare("insert into anylidsfilter (lid) select lid from datastore where key=:notetagkey and data in (select lid from DataStore where data=:tagname and key=:tagnamekey)");
-        else {
-            tagSql.prepare("insert into anylidsfilter (lid) select lid from datastore where key=:notetagkey and data in (select lid from DataStore where data like :tagname and key=:tagnamekey)");
-            string = string.replace("*", "%");
-        }
-        tagSql.bindValue(":tagname", string);
-        tagSql.bindValue(":tagnamekey", TAG_NAME);
-        tagSql.bindValue(":notetagkey", NOTE_TAG_LID);
-
-        tagSql.exec();
-        tagSql.finish();
-    } else {
-        string.remove(0,5);
-        if (string == "")
-            string = "*";
-        // Filter out the records
-        NSqlQuery tagSql(global.db);
-        if (not string.contains("*"))
-            tagSql.prepare("insert into anylidsfilter (lid) select lid from datastore where lid not in (select lid from datastore where key=:notetagkey and data in (select lid from DataStore where data=:tagname and key=:tagnamekey))");
-        else {
-            tagSql.prepare("insert into anylidsfilter (lid) select lid from datastore where lid not in (select lid from datastore where key=:notetagkey and data in (select lid from DataStore where data like :tagname and key=:tagnamekey))");
-            string = string.replace("*", "%");
-        }
-        tagSql.bindValue(":tagname", string);
-        tagSql.bindValue(":tagnamekey", TAG_NAME);
-        tagSql.bindValue(":notetagkey", NOTE_TAG_LID);
-        tagSql.exec();
-        tagSql.finish();
-    }
-}
-
-
-
-// filter based upon the title string the user specified.  This is for the "any"
-// filter and not the default.
-void FilterEngine::filterSearchStringIntitleAny(QString string) {
-    QLOG_TRACE_IN();
-    if (!string.startsWith("-")) {
-        int pos = string.indexOf(":")+1;
-        string = string.mid(pos);
-        if (string == "")
-            string = "*";
-        // Filter out the records
-        NSqlQuery tagSql(global.db);
-        string = string.replace("*", "%");
-        if (not string.contains("%"))
-            string = QString("%") +string +QString("%");
-        tagSql.prepare("insert into anylidsfilter (lid) select lid from datastore where key=:key and data like :title");
-        tagSql.bindValue(":key", NOTE_TITLE);
-        tagSql.bindValue(":title", string);
-
-        tagSql.exec();
-        tagSql.finish();
-    } else {
-        int pos = string.indexOf(":")+1;
-        string = string.mid(pos);
-        if (string == "")
-            string = "*";
-        // Filter out the records
-        NSqlQuery tagSql(global.db);
-        string = string.replace("*", "%");
-        if (not string.contains("%"))
-            string = QString("%") +string +QString("%");
-        tagSql.prepare("insert into anylidsfilter (lid) select lid from datastore where lid not in (select lid from datastore where key=:key and data like :title)");
-        tagSql.bindValue(":key", NOTE_TITLE);
-        tagSql.bindValue(":title", string);
-
-        tagSql.exec();
-        tagSql.finish();
-    }
-}
-
-
-
-
 // filter based upon the mime type the user specified.  This is for the "any:"
 // filter and not the default
 void FilterEngine::filterSearchStringResourceAny(QString string) {
@@ -2115,7 +1659,6 @@ void FilterEngine::filterSearchStringResourceAny(QString string) {
 
 
 
-
 // filter based upon the note coordinates the user specified.  This is for the "all"
 // filter and not the "any".
 void FilterEngine::filterSearchStringCoordinatesAny(QString string, int key) {
@@ -2150,7 +1693,6 @@ void FilterEngine::filterSearchStringCoordinatesAny(QString string, int key) {
 
 
 
-
 // filter based upon the note author the user specified.  This is for the "any"
 // filter and not the default
 void FilterEngine::filterSearchStringAuthorAny(QString string) {
@@ -2193,7 +1735,6 @@ void FilterEngine::filterSearchStringAuthorAny(QString string) {
 
 
 
-
 void FilterEngine::filterSearchStringDateAny(QString string) {
     QLOG_TRACE_IN();
     int separator = string.indexOf(":")+1;
@@ -2235,9 +1776,6 @@ void FilterEngine::filterSearchStringDateAny(QString string) {
 
 
 
-
-
-
 // filter based upon the note source the user specified.  This is for the "any"
 // filter and not the default.
 void FilterEngine::filterSearchStringSourceAny(QString string) {
@@ -2279,7 +1817,6 @@ void FilterEngine::filterSearchStringSourceAny(QString string) {
 
 
 
-
 // filter based upon the note source the user specified.  This is for the "any"
 // filter and not the default.
 void FilterEngine::filterSearchStringSourceApplicationAny(QString string) {
@@ -2322,8 +1859,6 @@ void FilterEngine::filterSearchStringSourceApplicationAny(QString string) {
 
 
 
-
-
 // filter based upon the note source the user specified.  This is for the "any"
 // filter and not the default.
 void FilterEngine::filterSearchStringContentClassAny(QString string) {
@@ -2415,92 +1950,87 @@ void FilterEngine::filterSearchStringResourceRecognitionTypeAny(QString string)
 // in knowing what to highlight in a PDF.
 bool FilterEngine::resourceContains(qint32 resourceLid, QString searchString, QStringList *returnHits) {
     QLOG_TRACE_IN();
-
-    searchString = global.normalizeTermForSearchAndIndex(searchString);
-    
-    bool returnValue = false;
     if (returnHits != nullptr)
-        returnHits->empty();
+        returnHits->clear();
+    QList<ResourceHit> hits;
+    if (!resourceHits(resourceLid, searchString, hits, returnHits == nullptr))
+        return false;
+    for (int i=0; returnHits != nullptr && i<hits.size(); i++) {
+        if (!returnHits->contains(hits[i].text, Qt::CaseInsensitive))
+            returnHits->append(hits[i].text);
+    }
+    return true;
+}
+
+
+// The hits of every positive word & substring of the search in one
+// statement.  With firstOnly, the search stops at the first row found.
+bool FilterEngine::resourceHits(qint32 resourceLid, QString searchString, QList<ResourceHit> &hits, bool firstOnly) {
+    static MetricHistogram *latency = Metrics::instance().histogram("filter.resourceHits");
+    MetricsTimer timer(latency);
+    hits.clear();
+
+    QStringList tokens;
+    splitSearchTerms(tokens, global.normalizeTermForSearchAndIndex(searchString));
+    ResourceHits lookup(tokens, global.getMinimumRecognitionWeight());
+    if (lookup.isEmpty())
+        return false;
+
+    ResourceTable resourceTable(global.db);
+    QList<qint32> pageOffsets;
+    if (!firstOnly)
+        resourceTable.getPdfPages(pageOffsets, resourceLid);
+
     NSqlQuery query(global.db);
-    NSqlQuery query2(global.db);
-    query.prepare("select lid from SearchIndex where lid=:resourceLid and weight>=:weight and content match :word");
-    query2.prepare("select lid from SearchIndex where lid=:resourceLid and weight>=:weight and content like :word");
-    QStringList terms;
-    splitSearchTerms(terms, searchString);
-    for (int i=0; i<terms.size(); i++) {
-
-        // ignore special search terms
-        if (!searchString.startsWith("notebook:", Qt::CaseInsensitive) &&
-                !searchString.startsWith("-notebook:", Qt::CaseInsensitive) &&
-                !searchString.startsWith("stack:", Qt::CaseInsensitive) &&
-                !searchString.startsWith("-stack:", Qt::CaseInsensitive) &&
-                !searchString.startsWith("todo:", Qt::CaseInsensitive) &&
-                !searchString.startsWith("-todo:", Qt::CaseInsensitive) &&
-                !searchString.startsWith("tag:", Qt::CaseInsensitive) &&
-                !searchString.startsWith("-tag:", Qt::CaseInsensitive) &&
-                !searchString.startsWith("intitle:", Qt::CaseInsensitive) &&
-                !searchString.startsWith("-intitle:", Qt::CaseInsensitive) &&
-                !searchString.startsWith("resource:", Qt::CaseInsensitive) &&
-                !searchString.startsWith("-resource:", Qt::CaseInsensitive) &&
-                !searchString.startsWith("longitude:", Qt::CaseInsensitive) &&
-                !searchString.startsWith("-longitude:", Qt::CaseInsensitive) &&
-                !searchString.startsWith("latitude:", Qt::CaseInsensitive) &&
-                !searchString.startsWith("-latitude:", Qt::CaseInsensitive) &&
-                !searchString.startsWith("altitude:", Qt::CaseInsensitive) &&
-                !searchString.startsWith("-altitude:", Qt::CaseInsensitive) &&
-                !searchString.startsWith("author:", Qt::CaseInsensitive) &&
-                !searchString.startsWith("-author:", Qt::CaseInsensitive) &&
-                !searchString.startsWith("source:", Qt::CaseInsensitive) &&
-                !searchString.startsWith("-source:", Qt::CaseInsensitive) &&
-                !searchString.startsWith("sourceapplication:", Qt::CaseInsensitive) &&
-                !searchString.startsWith("-sourceapplication:", Qt::CaseInsensitive) &&
-                !searchString.startsWith("contentclass:", Qt::CaseInsensitive) &&
-                !searchString.startsWith("-contentclass:", Qt::CaseInsensitive) &&
-                !searchString.startsWith("recotype:", Qt::CaseInsensitive) &&
-                !searchString.startsWith("-recotype:", Qt::CaseInsensitive) &&
-                !searchString.startsWith("placename:", Qt::CaseInsensitive) &&
-                !searchString.startsWith("-placename:", Qt::CaseInsensitive) &&
-                !searchString.startsWith("created:", Qt::CaseInsensitive) &&
-                !searchString.startsWith("-created:", Qt::CaseInsensitive) &&
-                !searchString.startsWith("updated:", Qt::CaseInsensitive) &&
-                !searchString.startsWith("-updated:", Qt::CaseInsensitive) &&
-                !searchString.startsWith("subjectdate:", Qt::CaseInsensitive) &&
-                !searchString.startsWith("-subjectdate:", Qt::CaseInsensitive)) {
-            QString term = terms[i];
-            if (term.endsWith("*"))
-                term.chop(1);
-            if (term.startsWith("*")) {
-                term = term.mid(1);
-                query2.bindValue(":resourceLid", resourceLid);
-                query2.bindValue(":weight", global.getMinimumRecognitionWeight());
-                query2.bindValue(":word", "%"+term+"%");
-                query2.exec();
-                if (query2.next()) {
-                    returnValue = true;
-                    if (returnHits != nullptr)
-                        returnHits->append(term);
-                    else
-                        return true;
-                }
-            } else {
-                query.bindValue(":resourceLid", resourceLid);
-                query.bindValue(":weight", global.getMinimumRecognitionWeight());
-                query.bindValue(":word", term);
-                query.exec();
-                if (query.next()) {
-                    returnValue = true;
-                    if (returnHits != nullptr)
-                        returnHits->append(term);
-                    else
-                        return true;
-                }
-            }
-        }
+    query.prepare(lookup.sql());
+    lookup.bindValues(query, resourceLid);
+    if (!query.exec()) {
+        QLOG_ERROR() << "Resource search failed: " << query.lastError();
+        return false;
     }
-    return returnValue;
+    bool found = false;
+    while (query.next()) {
+        found = true;
+        if (firstOnly)
+            break;
+        lookup.addRow(query.value(0).toInt(), query.value(2).toString(),
+                      query.value(1).toString() == "attachment" ? pageOffsets : QList<qint32>());
+    }
+    query.finish();
+    hits = lookup.hits;
+    return found;
 }
 
 
+// The best snippet of each note, from its text or its resources.  Notes
+// without one get an empty snippet so they aren't looked up again.
+void FilterEngine::noteSnippets(const QList<qint32> &noteLids, QString searchString, QHash<qint32, QString> &snippets) {
+    static MetricHistogram *latency = Metrics::instance().histogram("filter.noteSnippets");
+    MetricsTimer timer(latency);
+    for (int i=0; i<noteLids.size(); i++)
+        snippets.insert(noteLids[i], "");
+
+    QStringList tokens;
+    splitSearchTerms(tokens, global.normalizeTermForSearchAndIndex(searchString));
+    NoteSnippets lookup(tokens, global.getMinimumRecognitionWeight());
+    if (lookup.isEmpty() || noteLids.isEmpty())
+        return;
+
+    NSqlQuery query(global.db);
+    query.prepare(lookup.sql(noteLids.size()));
+    lookup.bindValues(query, noteLids);
+    if (!query.exec()) {
+        QLOG_ERROR() << "Snippet search failed: " << query.lastError();
+        return;
+    }
+    while (query.next()) {
+        qint32 lid = query.value(0).toInt();
+        if (snippets.value(lid) == "")
+            snippets.insert(lid, query.value(1).toString().simplified());
+    }
+    query.finish();
+}
+
 
 
 // Filter based on reminder time
@@ -21,7 +21,29 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #define FILTERENGINE_H
 
 #include <QObject>
+#include <QCache>
 #include "filtercriteria.h"
+#include "searchquery.h"
+#include "resourcehits.h"
+#include "notesnippets.h"
+#include "src/sql/dataversion.h"
+
+// Notes kept by the result cache, over all the cached filters
+#define FILTER_CACHE_SIZE 500000
+
+// Rows inserted per statement when a cached result is put back in the filter table
+#define FILTER_INSERT_ROWS 500
+
+
+// Contents of the filter table after a filter ran
+class FilterResult
+{
+public:
+    QList<qint32> lids;
+    QList<double> relevance;
+    QList<bool> hits;
+    qint64 version;         // DataVersion the result was found at
+};
 
 class FilterEngine : public QObject
 {
@@ -35,9 +57,8 @@ private:
     void filterTrash(FilterCriteria *criteria);
     void filterAttributes(FilterCriteria *criteria);
     void filterSearchString(FilterCriteria *criteria);
-    void filterSearchStringAll(QStringList list);
-    void splitSearchTerms(QStringList &list, QString search);
-    void filterSearchStringNotebookAll(QString string);
+    void runSearchQuery(SearchQuery &query, bool otherLids);
+    void filterSearchStringAll(SearchQuery &query);
     //    void filterSearchTodoAll(QStringList list);
     void filterSearchStringTodoAll(QString string);
     void filterSearchStringReminderOrderAll(QString string);
@@ -45,8 +66,6 @@ private:
     void filterSearchStringReminderDoneTimeAny(QString string);
     void filterSearchStringReminderTimeAll(QString string);
     void filterSearchStringReminderTimeAny(QString string);
-    void filterSearchStringTagAll(QString string);
-    void filterSearchStringIntitleAll(QString searchStr);
     void filterSearchStringResourceAll(QString string);
     void filterSearchStringCoordinatesAll(QString string, int key);
     void filterSearchStringAuthorAll(QString string);
@@ -58,12 +77,9 @@ private:
     QDateTime calculateDateTime(QString string);
     void filterSearchStringDateAll(QString string);
 
-    void filterSearchStringAny(QStringList list);
-    void filterSearchStringNotebookAny(QString string);
+    void filterSearchStringAny(SearchQuery &query);
     void filterSearchStringTodoAny(QString string);
     void filterSearchStringReminderOrderAny(QString string);
-    void filterSearchStringTagAny(QString string);
-    void filterSearchStringIntitleAny(QString string);
     void filterSearchStringResourceAny(QString string);
     void filterSearchStringCoordinatesAny(QString string, int key);
     void filterSearchStringAuthorAny(QString string);
@@ -74,10 +90,25 @@ private:
     void filterSearchStringResourceRecognitionTypeAny(QString string);
     bool anyFlagSet;
 
+    static QCache<QString, FilterResult> cache;     // by cacheKey()
+    static DataVersion dataVersion;
+    void runFilters(FilterCriteria *criteria);
+    QString cacheKey(FilterCriteria *criteria);
+    void restoreResult(const FilterResult &result);
+
 public:
     explicit FilterEngine(QObject *parent = 0);
     void filter(FilterCriteria *newCriteria = nullptr, QList<qint32> *results = nullptr);
     bool resourceContains(qint32 resourceLid, QString searchString, QStringList *returnHits);
+    bool resourceHits(qint32 resourceLid, QString searchString, QList<ResourceHit> &hits, bool firstOnly = false);
+    void noteSnippets(const QList<qint32> &noteLids, QString searchString, QHash<qint32, QString> &snippets);
+    static void splitSearchTerms(QStringList &list, QString search);
+
+    // Select of the notes the filter would keep before any search string is
+    // applied.  Only the notebook, tags & trash are looked at (what a search
+    // keeps of the criteria).  It reads nothing, so it is cheap to build on
+    // the GUI thread and can run on any connection.
+    static QString searchBaseSql(FilterCriteria *criteria);
     
 signals:
     
@@ -0,0 +1,68 @@
+/*********************************************************************************
+NixNote - An open-source client for the Evernote service.
+Copyright (C) 2013 Randy Baumgarte
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+***********************************************************************************/
+
+#include "notesnippets.h"
+#include "src/sql/resourcetable.h"
+
+
+NoteSnippets::NoteSnippets(const QStringList &tokens, qint32 minimumWeight) {
+    this->minimumWeight = minimumWeight;
+    words = ResourceHits::wordsExpression(SearchQuery(tokens, minimumWeight));
+}
+
+
+bool NoteSnippets::isEmpty() const {
+    return words == "";
+}
+
+
+// The index rows of the notes & of their resources are searched in one
+// statement, so a note found through an attachment gets its snippet too.
+// The lid column of SearchIndex isn't indexed, so the rows are found through
+// SearchIndexRows & only they are matched.  The cross joins keep SQLite from
+// running the match over the whole index first.
+QString NoteSnippets::sql(qint32 count) const {
+    QStringList values;
+    for (int i=0; i<count; i++)
+        values.append("(:note" + QString::number(i) + ")");
+    return "with notes(lid) as (values " + values.join(",") + "), "
+            "rows(note, lid) as (select lid, lid from notes union all "
+            "select d.data, d.lid from DataStore d where d.key=" + QString::number(RESOURCE_NOTE_LID) +
+            " and d.data in (select lid from notes)) "
+            "select r.note, snippet(SearchIndex, 3, :open, :close, :ellipsis, " + QString::number(SNIPPET_TOKENS) + ") "
+            "from rows r cross join SearchIndexRows i on i.lid=r.lid cross join SearchIndex s on s.rowid=i.row "
+            "where SearchIndex match :words and s.weight>=:weight order by rank";
+}
+
+
+void NoteSnippets::bindValues(QSqlQuery &query, const QList<qint32> &noteLids) const {
+    for (int i=0; i<noteLids.size(); i++)
+        query.bindValue(":note" + QString::number(i), noteLids[i]);
+    query.bindValue(":open", QString(HIT_OPEN));
+    query.bindValue(":close", QString(HIT_CLOSE));
+    query.bindValue(":ellipsis", QString(QChar(0x2026)));
+    query.bindValue(":words", words);
+    query.bindValue(":weight", minimumWeight);
+}
+
+
+QString NoteSnippets::plainText(const QString &snippet) {
+    QString text = snippet;
+    return text.remove(HIT_OPEN).remove(HIT_CLOSE);
+}
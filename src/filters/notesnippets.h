@@ -0,0 +1,63 @@
+/*********************************************************************************
+NixNote - An open-source client for the Evernote service.
+Copyright (C) 2013 Randy Baumgarte
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+***********************************************************************************/
+
+
+//****************************************************
+//*  Snippets of the note list.  For the notes of the
+//*  rows in view, the text around the positive words
+//*  of the search is taken from the index by FTS5's
+//*  snippet(), from the note text or one of its
+//*  resources, whichever ranks best.  The words are
+//*  marked with HIT_OPEN & HIT_CLOSE.
+//*****************************************************
+
+#ifndef NOTESNIPPETS_H
+#define NOTESNIPPETS_H
+
+#include <QString>
+#include <QStringList>
+#include <QList>
+#include <QSqlQuery>
+
+#include "resourcehits.h"
+
+// Tokens of text in a snippet
+#define SNIPPET_TOKENS 16
+
+
+class NoteSnippets
+{
+private:
+    QString words;          // FTS5 expression of the words, empty when there are none
+    qint32 minimumWeight;
+
+public:
+    NoteSnippets(const QStringList &tokens, qint32 minimumWeight);
+    bool isEmpty() const;
+
+    // Select the note lid & a snippet of each index row matching the words,
+    // best first, for count notes.
+    QString sql(qint32 count) const;
+    void bindValues(QSqlQuery &query, const QList<qint32> &noteLids) const;
+
+    // The snippet without the marks
+    static QString plainText(const QString &snippet);
+};
+
+#endif // NOTESNIPPETS_H
@@ -0,0 +1,131 @@
+/*********************************************************************************
+NixNote - An open-source client for the Evernote service.
+Copyright (C) 2013 Randy Baumgarte
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+***********************************************************************************/
+
+#include "resourcehits.h"
+
+#include <QRegularExpression>
+#include <algorithm>
+
+
+ResourceHits::ResourceHits(const QStringList &tokens, qint32 minimumWeight) {
+    this->minimumWeight = minimumWeight;
+    SearchQuery query(tokens, minimumWeight);
+    for (int i=0; i<query.terms.size(); i++) {
+        const SearchTerm &term = query.terms[i];
+        if (!term.negative && term.type == SearchTerm::Substring)
+            substrings.append(term);
+    }
+    words = wordsExpression(query);
+}
+
+
+QString ResourceHits::wordsExpression(const SearchQuery &query) {
+    QStringList expressions;
+    for (int i=0; i<query.terms.size(); i++) {
+        const SearchTerm &term = query.terms[i];
+        if (!term.negative && term.type == SearchTerm::Word)
+            expressions.append("(" + term.match + ")");
+    }
+    return expressions.join(" OR ");
+}
+
+
+bool ResourceHits::isEmpty() const {
+    return words == "" && substrings.isEmpty();
+}
+
+
+// The lid column of SearchIndex isn't indexed, so the rows of the
+// resource are found through SearchIndexRows.
+QString ResourceHits::sql() const {
+    QString rows = "rowid in (select row from SearchIndexRows where lid=:lid)";
+    QStringList selects;
+    if (words != "")
+        selects.append("select 0, source, highlight(SearchIndex, 3, :open, :close) from SearchIndex "
+                       "where " + rows + " and weight>=:weight and SearchIndex match :words");
+    for (int i=0; i<substrings.size(); i++) {
+        QString n = QString::number(i+1);
+        QString select = "select " + n + ", source, content from SearchIndex where " + rows + " and weight>=:weight "
+                "and content like :like" + n + " escape '/'";
+        if (substrings[i].match != "")
+            select += " and rowid in (select rowid from SearchIndexTrigram where SearchIndexTrigram match :trigram" + n + ")";
+        selects.append(select);
+    }
+    return selects.join(" union all ");
+}
+
+
+void ResourceHits::bindValues(QSqlQuery &query, qint32 resourceLid) const {
+    query.bindValue(":lid", resourceLid);
+    query.bindValue(":weight", minimumWeight);
+    if (words != "") {
+        query.bindValue(":open", QString(HIT_OPEN));
+        query.bindValue(":close", QString(HIT_CLOSE));
+        query.bindValue(":words", words);
+    }
+    for (int i=0; i<substrings.size(); i++) {
+        QString n = QString::number(i+1);
+        query.bindValue(":like" + n, substrings[i].like);
+        if (substrings[i].match != "")
+            query.bindValue(":trigram" + n, substrings[i].match);
+    }
+}
+
+
+// Offsets are counted in the text without the highlight marks.  A
+// substring is matched the way LIKE did, its * standing for any text.
+void ResourceHits::addRow(qint32 term, const QString &text, const QList<qint32> &pageOffsets) {
+    QList<QPair<qint32, QString> > found;
+    if (term == 0) {
+        qint32 removed = 0;
+        for (int start = text.indexOf(HIT_OPEN); start >= 0; start = text.indexOf(HIT_OPEN, start + 1)) {
+            int end = text.indexOf(HIT_CLOSE, start);
+            if (end < 0)
+                break;
+            found.append(qMakePair(start - removed, text.mid(start + 1, end - start - 1)));
+            removed += 2;
+        }
+    } else if (term <= substrings.size()) {
+        QStringList parts = substrings[term-1].text.split("*", QString::SkipEmptyParts);
+        for (int i=0; i<parts.size(); i++)
+            parts[i] = QRegularExpression::escape(parts[i]);
+        QRegularExpression pattern(parts.join(".*?"), QRegularExpression::CaseInsensitiveOption);
+        QRegularExpressionMatchIterator i = pattern.globalMatch(text);
+        while (i.hasNext()) {
+            QRegularExpressionMatch match = i.next();
+            if (match.capturedLength() > 0)
+                found.append(qMakePair(match.capturedStart(), match.captured()));
+        }
+    }
+
+    for (int i=0; i<found.size(); i++) {
+        ResourceHit hit;
+        hit.page = page(pageOffsets, found[i].first);
+        hit.offset = found[i].first - (hit.page < 0 ? 0 : pageOffsets[hit.page]);
+        hit.text = found[i].second;
+        hits.append(hit);
+    }
+}
+
+
+qint32 ResourceHits::page(const QList<qint32> &pageOffsets, qint32 offset) {
+    if (pageOffsets.isEmpty())
+        return -1;
+    return qMax(0, static_cast<qint32>(std::upper_bound(pageOffsets.begin(), pageOffsets.end(), offset) - pageOffsets.begin()) - 1);
+}
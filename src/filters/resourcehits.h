@@ -0,0 +1,84 @@
+/*********************************************************************************
+NixNote - An open-source client for the Evernote service.
+Copyright (C) 2013 Randy Baumgarte
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+***********************************************************************************/
+
+
+//****************************************************
+//*  Where the terms of a search are found in the text
+//*  of one resource.  The positive words & substrings
+//*  of the search are looked up in one statement:
+//*  the words in one FTS5 expression, highlighted so
+//*  their offsets can be read back, and each substring
+//*  through the trigram index.  PDFs keep the offset
+//*  where each page starts in their text, so a hit
+//*  is also given its page.
+//*****************************************************
+
+#ifndef RESOURCEHITS_H
+#define RESOURCEHITS_H
+
+#include <QString>
+#include <QStringList>
+#include <QList>
+#include <QSqlQuery>
+
+#include "searchquery.h"
+
+// Marks around the words FTS5 found.  They can't be in indexed text.
+#define HIT_OPEN QChar(1)
+#define HIT_CLOSE QChar(2)
+
+
+class ResourceHit
+{
+public:
+    qint32 page;            // -1 when the text isn't split in pages
+    qint32 offset;          // in the text of the page
+    QString text;           // the text which matched
+};
+
+
+class ResourceHits
+{
+private:
+    QList<SearchTerm> substrings;
+    QString words;          // FTS5 expression of the words, empty when there are none
+    qint32 minimumWeight;
+
+public:
+    ResourceHits(const QStringList &tokens, qint32 minimumWeight);
+    bool isEmpty() const;
+
+    // Select the term (0 for the words, 1.. for the substrings), the source
+    // and the text of each row of the resource with a hit.  The text of the
+    // words row is highlighted.
+    QString sql() const;
+    void bindValues(QSqlQuery &query, qint32 resourceLid) const;
+
+    // Add the hits of a row read from sql().  The page offsets only apply
+    // to the text of the attachment itself.
+    void addRow(qint32 term, const QString &text, const QList<qint32> &pageOffsets);
+    QList<ResourceHit> hits;
+
+    static qint32 page(const QList<qint32> &pageOffsets, qint32 offset);
+
+    // The positive words of the query OR'ed in one FTS5 expression
+    static QString wordsExpression(const SearchQuery &query);
+};
+
+#endif // RESOURCEHITS_H
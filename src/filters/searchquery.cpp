@@ -0,0 +1,377 @@
+/*********************************************************************************
+NixNote - An open-source client for the Evernote service.
+Copyright (C) 2013 Randy Baumgarte
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+***********************************************************************************/
+
+#include "searchquery.h"
+#include "src/sql/notetable.h"
+#include "src/sql/resourcetable.h"
+#include "src/sql/tagtable.h"
+
+#include <algorithm>
+
+// Search prefixes, in the order FilterEngine tests them
+static const char *searchPrefixes[] = {
+    "notebook:", "stack:", "todo:", "reminderOrder:", "reminderTime:", "reminderDoneTime:",
+    "tag:", "intitle:", "resource:", "longitude:", "latitude:", "altitude:", "author:",
+    "source:", "sourceapplication:", "contentclass:", "recotype:", "placename:",
+    "created:", "updated:", "subjectdate:"
+};
+
+
+// Multiplier of an index row, by its source & recognition weight
+static QString sourceWeight() {
+    return QString("(case source when 'recognition' then %1 when 'attachment' then %2 else %3 end) * weight / 100.0")
+            .arg(SEARCH_WEIGHT_RECOGNITION).arg(SEARCH_WEIGHT_ATTACHMENT).arg(SEARCH_WEIGHT_TEXT);
+}
+
+
+// LIKE pattern for a term with * wildcards.  Everything else is literal.
+static QString likePattern(QString term, bool leading, bool trailing) {
+    term.replace("/", "//");
+    term.replace("%", "/%");
+    term.replace("_", "/_");
+    term.replace("*", "%");
+    if (leading && !term.startsWith("%"))
+        term = "%" + term;
+    if (trailing && !term.endsWith("%"))
+        term = term + "%";
+    return term;
+}
+
+
+
+// Rough cost of evaluating a term: lookups in the DataStore indexes first,
+// then FTS queries, and scans of the whole index last.
+qint32 SearchTerm::cost() const {
+    switch (type) {
+    case Notebook:
+        return 1;
+    case Tag:
+        return 2;
+    case Word:
+        return 3;
+    case Intitle:
+        return 4;
+    case Substring:
+        return match == "" ? 9 : 5;
+    }
+    return 9;
+}
+
+
+QString SearchTerm::toString() const {
+    static const char *names[] = { "notebook", "tag", "intitle", "word", "substring" };
+    QString result = QString(negative ? "not " : "") + names[type] + " '" + text + "'";
+    if (match != "")
+        result += " match " + match;
+    if (like != "")
+        result += " like " + like;
+    return result;
+}
+
+
+
+
+SearchQuery::SearchQuery(const QStringList &tokens, qint32 minimumWeight) {
+    this->minimumWeight = minimumWeight;
+    table = "filter";
+    any = !tokens.isEmpty() && tokens[0].startsWith("any:", Qt::CaseInsensitive);
+
+    for (int i = any ? 1 : 0; i<tokens.size(); i++) {
+        QString token = tokens[i];
+        token.remove(QChar('"'));
+        if (token.trimmed() == "")
+            continue;
+
+        SearchTerm term;
+        term.negative = token.startsWith("-") && token.length() > 1;
+        QString body = term.negative ? token.mid(1) : token;
+
+        if (body.startsWith("notebook:", Qt::CaseInsensitive)) {
+            term.type = SearchTerm::Notebook;
+            term.text = body.mid(9);
+        } else if (body.startsWith("tag:", Qt::CaseInsensitive)) {
+            term.type = SearchTerm::Tag;
+            term.text = body.mid(4);
+        } else if (body.startsWith("intitle:", Qt::CaseInsensitive)) {
+            term.type = SearchTerm::Intitle;
+            term.text = body.mid(8);
+        } else if (isPrefixed(body)) {
+            others.append(token);
+            continue;
+        } else if (body.startsWith("*") || body.contains("_") || body.contains("-")) {
+            // The word index can't find these, they go to the trigram index
+            term.type = SearchTerm::Substring;
+            term.text = body;
+        } else {
+            term.type = SearchTerm::Word;
+            term.text = body;
+        }
+
+        switch (term.type) {
+        case SearchTerm::Notebook:
+        case SearchTerm::Tag:
+            if (term.text == "")
+                term.text = "*";
+            if (term.text.contains("*"))
+                term.like = likePattern(term.text, false, false);
+            break;
+        case SearchTerm::Intitle:
+            if (term.text == "")
+                term.text = "*";
+            term.like = likePattern(term.text, true, true);
+            break;
+        case SearchTerm::Substring:
+            term.match = substringExpression(term.text);
+            term.like = likePattern(term.text, true, true);
+            break;
+        case SearchTerm::Word:
+            term.match = wordExpression(term.text);
+            if (!term.negative)
+                relevanceTerms.append(term.text);
+            break;
+        }
+        terms.append(term);
+    }
+}
+
+
+bool SearchQuery::isPrefixed(const QString &term) {
+    for (size_t i=0; i<sizeof(searchPrefixes)/sizeof(searchPrefixes[0]); i++) {
+        if (term.startsWith(QLatin1String(searchPrefixes[i]), Qt::CaseInsensitive))
+            return true;
+    }
+    return false;
+}
+
+
+// Only positive word & substring terms are narrowed by a longer text: a
+// longer prefix or substring matches less, where a longer notebook or tag
+// name matches something else.  A word which becomes a substring (by
+// typing "-" or "_") can match text the shorter word didn't.
+bool SearchQuery::narrows(const QStringList &previous, const QStringList &tokens) {
+    if (previous.isEmpty() || tokens.size() < previous.size())
+        return false;
+    if (previous[0].startsWith("any:", Qt::CaseInsensitive) || tokens[0].startsWith("any:", Qt::CaseInsensitive))
+        return false;
+    int last = previous.size() - 1;
+    for (int i=0; i<last; i++) {
+        if (tokens[i] != previous[i])
+            return false;
+    }
+    const QString &before = previous[last];
+    const QString &after = tokens[last];
+    if (after == before)
+        return true;
+    if (!after.startsWith(before) || before.startsWith("-") || isPrefixed(before) || isPrefixed(after))
+        return false;
+    bool substring = before.startsWith("*") || before.contains("_") || before.contains("-");
+    return substring == (after.startsWith("*") || after.contains("_") || after.contains("-"));
+}
+
+
+// A note matches a word when its text or one of its resources does, so
+// positive words can only share a MATCH when they are OR'ed ("any:").  Leaving
+// out the notes which match any of several negative words is the same as
+// leaving out the notes which match their OR, so those are merged otherwise.
+void SearchQuery::optimize() {
+    int merged = -1;
+    for (int i=0; i<terms.size(); i++) {
+        if (terms[i].type != SearchTerm::Word || terms[i].negative == any)
+            continue;
+        if (merged < 0) {
+            merged = i;
+            terms[i].match = "(" + terms[i].match + ")";
+            continue;
+        }
+        terms[merged].text += " " + terms[i].text;
+        terms[merged].match += " OR (" + terms[i].match + ")";
+        terms.removeAt(i--);
+    }
+
+    std::stable_sort(terms.begin(), terms.end(), [](const SearchTerm &t1, const SearchTerm &t2) {
+        return t1.cost() < t2.cost();
+    });
+}
+
+
+QString SearchQuery::bind(const QVariant &value) {
+    QString name = ":p" + QString::number(binds.size());
+    binds.append(qMakePair(name, value));
+    return name;
+}
+
+
+QString SearchQuery::tagSelect(const QString &condition) {
+    return "select lid from DataStore where key=" + bind(NOTE_TAG_LID) +
+            " and data in (select lid from DataStore where key=" + bind(TAG_NAME) + " and " + condition + ")";
+}
+
+
+// Index terms are looked up once in a common table expression, which is
+// then mapped from resources to their notes.  Words are scored by BM25
+// (negated, FTS5 returns lower values for better matches); substrings
+// can't be, the trigram index doesn't hold the text they match.
+QString SearchQuery::predicate(const SearchTerm &term, QStringList &with) {
+    QString result;
+    switch (term.type) {
+    case SearchTerm::Notebook:
+        if (term.like == "")
+            result = "f.lid in (select lid from NoteTable where notebook=" + bind(term.text) + ")";
+        else
+            result = "f.lid in (select lid from NoteTable where notebook like " + bind(term.like) + " escape '/')";
+        break;
+    case SearchTerm::Tag:
+        if (term.like == "")
+            result = "f.lid in (" + tagSelect("data=" + bind(term.text)) + ")";
+        else
+            result = "f.lid in (" + tagSelect("data like " + bind(term.like) + " escape '/'") + ")";
+        break;
+    case SearchTerm::Intitle:
+        result = "f.lid in (select lid from DataStore where key=" + bind(NOTE_TITLE) +
+                " and data like " + bind(term.like) + " escape '/')";
+        break;
+    case SearchTerm::Word:
+    case SearchTerm::Substring: {
+        QString hits = "h" + QString::number(with.size());
+        QString notes = "n" + QString::number(with.size());
+        QString select;
+        if (term.type == SearchTerm::Word)
+            select = "select lid, -bm25(SearchIndex) * " + sourceWeight() + " as score from SearchIndex where weight>=" +
+                    bind(minimumWeight) + " and content match " + bind(term.match);
+        else {
+            select = "select lid, " + sourceWeight() + " as score from SearchIndex where weight>=" + bind(minimumWeight);
+            if (term.match != "")
+                select += " and rowid in (select rowid from SearchIndexTrigram where SearchIndexTrigram match " +
+                        bind(term.match) + ")";
+            select += " and content like " + bind(term.like) + " escape '/'";
+        }
+        with.append(hits + " as (" + select + ")");
+        with.append(notes + " as (select lid, score from " + hits + " union all select d.data, h.score from DataStore d, " +
+                    hits + " h where d.key=" + bind(RESOURCE_NOTE_LID) + " and d.lid=h.lid)");
+        if (!term.negative)
+            scored.append(notes);
+        result = "f.lid in (select lid from " + notes + ")";
+        break;
+    }
+    }
+    return term.negative ? "not " + result : result;
+}
+
+
+QString SearchQuery::sql(bool otherLids) {
+    binds.clear();
+    scored.clear();
+    QStringList with, predicates;
+    for (int i=0; i<terms.size(); i++)
+        predicates.append(predicate(terms[i], with));
+    if (any && otherLids)
+        predicates.append("f.lid in (select lid from anylidsfilter)");
+
+    // A positive word in the title or a tag boosts the score, and marks
+    // the note as a hit on its own
+    auto inTitle = [this](const QString &term) {
+        return "(f.lid in (select lid from DataStore where key=" + bind(NOTE_TITLE) +
+                " and data like " + bind(likePattern(term, true, true)) + " escape '/'))";
+    };
+    auto inTag = [this](const QString &term) {
+        return "(f.lid in (" + tagSelect("data like " + bind(likePattern(term, false, true)) + " escape '/'") + "))";
+    };
+    QString relevance = "f.relevance";
+    QStringList hits;
+    if (!scored.isEmpty())
+        relevance += " + coalesce(s.score, 0)";
+    for (int i=0; i<relevanceTerms.size(); i++) {
+        relevance += QString(" + %1*").arg(SEARCH_BOOST_TITLE) + inTitle(relevanceTerms[i]);
+        relevance += QString(" + %1*").arg(SEARCH_BOOST_TAG) + inTag(relevanceTerms[i]);
+        hits.append(inTitle(relevanceTerms[i]));
+        hits.append(inTag(relevanceTerms[i]));
+    }
+    relevance += QString(" + %1*").arg(SEARCH_BOOST_IMPORTANT) + "(f.lid in (" +
+            tagSelect("data like " + bind("important%")) + "))";
+    QString hit = hits.isEmpty() ? QString("0") : "(" + hits.join(" or ") + ")";
+
+    // Scores of a note summed over its index rows & terms.  The cast gives
+    // the lid integer affinity so SQLite can index the join.
+    QString scores;
+    if (!scored.isEmpty()) {
+        QStringList selects;
+        for (int i=0; i<scored.size(); i++)
+            selects.append("select lid, score from " + scored[i]);
+        scores = " left join (select cast(lid as integer) as lid, sum(score) as score from (" +
+                selects.join(" union all ") + ") group by 1) s on s.lid=f.lid";
+    }
+
+    QString result;
+    if (!with.isEmpty())
+        result = "with " + with.join(", ") + " ";
+    result += "select f.lid, " + relevance + " as relevance, " + hit + " as hit from " + table + " f" + scores;
+    if (any)
+        result += " where " + (predicates.isEmpty() ? QString("0") : predicates.join(" or "));
+    else if (!predicates.isEmpty())
+        result += " where " + predicates.join(" and ");
+    return result;
+}
+
+
+void SearchQuery::bindValues(QSqlQuery &query) const {
+    for (int i=0; i<binds.size(); i++)
+        query.bindValue(binds[i].first, binds[i].second);
+}
+
+
+QString SearchQuery::toString() const {
+    QString result = any ? "any" : "all";
+    for (int i=0; i<terms.size(); i++)
+        result += "\n  " + terms[i].toString();
+    for (int i=0; i<others.size(); i++)
+        result += "\n  other '" + others[i] + "'";
+    return result;
+}
+
+
+QStringList SearchQuery::explain(QSqlDatabase db, bool otherLids) {
+    QStringList plan;
+    QSqlQuery query(db);
+    query.prepare("explain query plan " + sql(otherLids));
+    bindValues(query);
+    query.exec();
+    while (query.next())
+        plan.append(query.value(0).toString() + " " + query.value(1).toString() + " " + query.value(3).toString());
+    return plan;
+}
+
+
+QString SearchQuery::wordExpression(QString term, bool prefix) {
+    term = term.trimmed();
+    while (term.endsWith("*"))
+        term.chop(1);
+    term.replace("\"", "\"\"");
+    return "\"" + term + "\"" + (prefix ? " *" : "");
+}
+
+
+QString SearchQuery::substringExpression(const QString &pattern) {
+    QStringList parts = pattern.split("*", QString::SkipEmptyParts);
+    QStringList phrases;
+    for (int i=0; i<parts.size(); i++) {
+        if (parts[i].length() >= 3)
+            phrases.append("\"" + QString(parts[i]).replace("\"", "\"\"") + "\"");
+    }
+    return phrases.join(" AND ");
+}
@@ -0,0 +1,122 @@
+/*********************************************************************************
+NixNote - An open-source client for the Evernote service.
+Copyright (C) 2013 Randy Baumgarte
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+***********************************************************************************/
+
+
+//****************************************************
+//*  Compiles the terms of a search string into one
+//*  statement over the filter table.  The terms are
+//*  parsed into predicates, cheap & selective ones are
+//*  moved first, FTS terms which can share a MATCH are
+//*  merged, and the relevance (the BM25 score of the
+//*  index rows plus title & tag boosts) is computed
+//*  in the same SELECT instead of extra UPDATE
+//*  passes.  Prefixes not compiled here (dates, todo,
+//*  reminders & note attributes) are left to
+//*  FilterEngine.
+//*****************************************************
+
+#ifndef SEARCHQUERY_H
+#define SEARCHQUERY_H
+
+#include <QString>
+#include <QStringList>
+#include <QList>
+#include <QPair>
+#include <QVariant>
+#include <QSqlDatabase>
+#include <QSqlQuery>
+
+// BM25 multipliers by the source of the index row.  Titles are part of
+// the note text, so they are boosted separately.
+#define SEARCH_WEIGHT_TEXT 1.0
+#define SEARCH_WEIGHT_ATTACHMENT 0.75
+#define SEARCH_WEIGHT_RECOGNITION 0.5
+
+// Added to the score for each positive word found in the title or a tag
+// of the note, and for notes with an "important" tag.
+#define SEARCH_BOOST_TITLE 2.0
+#define SEARCH_BOOST_TAG 1.0
+#define SEARCH_BOOST_IMPORTANT 3.0
+
+
+class SearchTerm
+{
+public:
+    enum Type { Notebook, Tag, Intitle, Word, Substring };
+
+    Type type;
+    bool negative;
+    QString text;       // the term without "-" and prefix
+    QString match;      // FTS5 expression, trigram expression for a substring (may be empty)
+    QString like;       // LIKE pattern, '/' is the escape character
+
+    qint32 cost() const;
+    QString toString() const;
+};
+
+
+class SearchQuery
+{
+private:
+    qint32 minimumWeight;
+    QList<QPair<QString, QVariant> > binds;
+    QStringList relevanceTerms;         // positive words, boosted when found in the title or a tag
+    QStringList scored;                 // CTEs of the positive index terms, with their scores
+
+    QString bind(const QVariant &value);
+    QString predicate(const SearchTerm &term, QStringList &with);
+    QString tagSelect(const QString &pattern);
+
+public:
+    SearchQuery(const QStringList &tokens, qint32 minimumWeight);
+
+    bool any;                   // "any:" was given, terms are OR'ed
+    QList<SearchTerm> terms;
+    QStringList others;         // terms left to FilterEngine
+    QString table;              // notes searched (lid & relevance columns), the filter table by default
+
+    void optimize();
+
+    // Select lid, relevance & hit (a positive word is in the title or a
+    // tag, shown in bold) of the rows of the filter table which match.
+    // With otherLids, the lids of the "any" table filled by FilterEngine
+    // for the other terms also match.
+    QString sql(bool otherLids = false);
+    void bindValues(QSqlQuery &query) const;
+    QString toString() const;
+    QStringList explain(QSqlDatabase db, bool otherLids = false);
+
+    static bool isPrefixed(const QString &term);
+
+    // True when every note matching the tokens also matches the previous
+    // tokens, so the search can run over the previous results.  That is
+    // the case when terms were added or the last term only got longer.
+    static bool narrows(const QStringList &previous, const QStringList &tokens);
+
+    // FTS5 expression for a word search.  The term is quoted so
+    // punctuation in it is not read as query syntax.
+    static QString wordExpression(QString term, bool prefix = true);
+
+    // Trigram expression for a pattern with * wildcards.  Parts shorter than
+    // a trigram can't be looked up, so the expression can match more than the
+    // pattern and is empty when no part is long enough.
+    static QString substringExpression(const QString &pattern);
+};
+
+#endif // SEARCHQUERY_H
@@ -0,0 +1,59 @@
+/*********************************************************************************
+NixNote - An open-source client for the Evernote service.
+Copyright (C) 2013 Randy Baumgarte
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+***********************************************************************************/
+
+#include "tagfilter.h"
+#include "src/sql/notetable.h"
+#include "src/sql/tagtable.h"
+
+#include <algorithm>
+
+
+TagFilter::TagFilter(const QList<qint32> &tags, bool any, bool children) {
+    this->tags = tags;
+    std::sort(this->tags.begin(), this->tags.end());
+    this->tags.erase(std::unique(this->tags.begin(), this->tags.end()), this->tags.end());
+    this->any = any;
+    this->children = children;
+}
+
+
+bool TagFilter::isEmpty() const {
+    return tags.isEmpty();
+}
+
+
+// Each selected tag is the root of the tags it selects.  A note matches
+// "all" when it has a tag under every root.  The union (rather than union
+// all) stops the recursion if the tag parents ever form a loop.
+QString TagFilter::sql() const {
+    QStringList roots;
+    for (int i=0; i<tags.size(); i++)
+        roots.append(QString("(%1,%1)").arg(tags[i]));
+    QString result = "with recursive selected(tag, root) as (values " + roots.join(",");
+    if (children)
+        result += " union select c.lid, s.root from DataStore c, selected s where c.key="
+                + QString::number(TAG_PARENT_LID) + " and c.data=s.tag";
+    result += ") ";
+
+    if (any)
+        return result + "select lid from DataStore where key=" + QString::number(NOTE_TAG_LID)
+                + " and data in (select tag from selected)";
+    return result + "select n.lid from DataStore n, selected s where n.key=" + QString::number(NOTE_TAG_LID)
+            + " and n.data=s.tag group by n.lid having count(distinct s.root)=" + QString::number(tags.size());
+}
@@ -0,0 +1,51 @@
+/*********************************************************************************
+NixNote - An open-source client for the Evernote service.
+Copyright (C) 2013 Randy Baumgarte
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+***********************************************************************************/
+
+
+//****************************************************
+//*  Finds the notes carrying a selection of tags in
+//*  one statement.  The selected tags (and, when
+//*  asked, all the tags under them) are listed in a
+//*  recursive common table expression, and the notes
+//*  are matched against it with an IN for any of the
+//*  tags or grouped & counted for all of them.
+//*****************************************************
+
+#ifndef TAGFILTER_H
+#define TAGFILTER_H
+
+#include <QString>
+#include <QList>
+
+class TagFilter
+{
+private:
+    QList<qint32> tags;
+    bool any;
+    bool children;
+
+public:
+    // any: notes with any of the tags rather than all of them
+    // children: a tag also selects the tags under it
+    TagFilter(const QList<qint32> &tags, bool any, bool children);
+    bool isEmpty() const;
+    QString sql() const;        // select of the matching note lids
+};
+
+#endif // TAGFILTER_H
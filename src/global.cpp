@@ -83,6 +83,8 @@ Global::Global() {
     this->forceWebFonts = false;
     this->indexPDFLocally = true;
     this->indexRunner = nullptr;
+    this->browserRunner = nullptr;
+    this->thumbnailer = nullptr;
     this->isFullscreen = false;
     this->indexNoteCountPause = -1;
     this->maxIndexInterval = 500;
@@ -519,6 +521,37 @@ bool Global::getTagSelectionOr() {
 }
 
 
+// Selecting a tag also selects the tags under it
+void Global::setTagSelectionChildren(bool value) {
+    settings->beginGroup(INI_GROUP_SEARCH);
+    settings->setValue("tagSelectionChildren", value);
+    settings->endGroup();
+}
+
+
+bool Global::getTagSelectionChildren() {
+    settings->beginGroup(INI_GROUP_SEARCH);
+    bool value = settings->value("tagSelectionChildren", false).toBool();
+    settings->endGroup();
+    return value;
+}
+
+
+// Search while the search text is typed
+void Global::setLiveSearch(bool value) {
+    settings->beginGroup(INI_GROUP_SEARCH);
+    settings->setValue("liveSearch", value);
+    settings->endGroup();
+}
+
+bool Global::getLiveSearch() {
+    settings->beginGroup(INI_GROUP_SEARCH);
+    bool value = settings->value("liveSearch", false).toBool();
+    settings->endGroup();
+    return value;
+}
+
+
 void Global::setIndexPDFLocally(bool value) {
     settings->beginGroup(INI_GROUP_SEARCH);
     settings->setValue("indexPDFLocally", value);
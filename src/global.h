@@ -86,9 +86,12 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 // internal column used for relevance search; value is generated during search
 #define NOTE_TABLE_SEARCH_RELEVANCE_POSITION 26
 
+// snippet of the text around the search words; not in NoteTableV, generated for the rows in view
+#define NOTE_TABLE_SNIPPET_POSITION 27
+
 
 // count of columns in the table (=> must be last column no. plus 1)
-#define NOTE_TABLE_COLUMN_COUNT 27
+#define NOTE_TABLE_COLUMN_COUNT 28
 
 
 #define MOUSE_MIDDLE_CLICK_NEW_TAB 0
@@ -100,6 +103,8 @@ using namespace std;
 // Forward declare future classes
 class DatabaseConnection;
 class IndexRunner;
+class BrowserRunner;
+class Thumbnailer;
 
 #define SET_MESSAGE_TIMEOUT_SHORT 1000
 #define SET_MESSAGE_TIMEOUT_LONGER 15000
@@ -171,6 +176,7 @@ class IndexRunner;
 #define INI_GROUP_PROXY "Proxy"
 #define INI_GROUP_EMAIL "Email"
 #define INI_GROUP_PRINTER "Printer"
+#define INI_GROUP_BACKUP "Backup"
 #define QLOG_ASSERT(expr) if (expr) {} else { QLOG_FATAL() << "Assertion failed: " #expr; exit(16);}
 
 class Global : public QObject {
@@ -345,10 +351,14 @@ public:
     void setClearSearchOnNotebook(bool value);
     void setClearTagsOnSearch(bool value);
     void setTagSelectionOr(bool value);
+    void setTagSelectionChildren(bool value);
     bool getClearNotebookOnSearch();
     bool getClearSearchOnNotebook();
     bool getClearTagsOnSearch();
     bool getTagSelectionOr();
+    bool getTagSelectionChildren();
+    void setLiveSearch(bool value);
+    bool getLiveSearch();
     bool disableImageHighlight();
 
 
@@ -416,11 +426,13 @@ public:
     void saveSettingForceSearchLowerCase(bool value) const;
 
     IndexRunner *indexRunner;                                    // Pointer to index thread
+    BrowserRunner *browserRunner;                                // Pointer to the shared note save thread
 
     int minimumThumbnailInterval;                               // Minimum time to scan for thumbnails
     int maximumThumbnailInterval;                               // Maximum time to scan for thumbnails
     bool disableThumbnails;                                     // Disable thumbnail generation
     int batchThumbnailCount;                                    // Maximum number of thumbails to generate per batch
+    Thumbnailer *thumbnailer;                                   // Shared offscreen thumbnail generator
 
     int getAutoSaveInterval();                                  // Time (in seconds) between auto-saving of notes.
     void setAutoSaveInterval(int value);                                 // Save auto save interval
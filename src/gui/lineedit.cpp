@@ -37,6 +37,10 @@ extern Global global;
 
      connect(this, SIGNAL(returnPressed()), this, SLOT(buildSelection()));
      connect(this, SIGNAL(textChanged(QString)), this, SLOT(textChanged(QString)));
+
+     liveSearchTimer.setSingleShot(true);
+     liveSearchTimer.setInterval(LIVE_SEARCH_DELAY);
+     connect(&liveSearchTimer, SIGNAL(timeout()), this, SLOT(liveSearchTimeout()));
  }
 
 
@@ -49,6 +53,7 @@ extern Global global;
  //*************************************************************
  void LineEdit::buildSelection() {
      QLOG_TRACE() << "Inside LineEdit::buildSelection()";
+     liveSearchTimer.stop();
      savedText = text().trimmed();
 
      // First, find out if we're already viewing history.  If we are we
@@ -65,12 +70,7 @@ extern Global global;
      global.filterPosition++;
 
      newFilter->setSearchString(text());
-     if (!global.getClearNotebookOnSearch() && oldFilter->isNotebookSet())
-         newFilter->setNotebook(*oldFilter->getNotebook());
-     if (!global.getClearTagsOnSearch() && oldFilter->isTagsSet()) {
-         QList<QTreeWidgetItem*> items = oldFilter->getTags();
-         newFilter->setTags(items);
-     }
+     copyCriteria(oldFilter, newFilter);
      newFilter->resetTags=true;
      newFilter->resetNotebook=true;
      newFilter->resetAttribute = true;
@@ -111,10 +111,29 @@ extern Global global;
 
 
 
+// The notebook & tags of the current criteria which a search keeps
+void LineEdit::copyCriteria(FilterCriteria *oldFilter, FilterCriteria *newFilter) {
+    if (!global.getClearNotebookOnSearch() && oldFilter->isNotebookSet())
+        newFilter->setNotebook(*oldFilter->getNotebook());
+    if (!global.getClearTagsOnSearch() && oldFilter->isTagsSet()) {
+        QList<QTreeWidgetItem*> items = oldFilter->getTags();
+        newFilter->setTags(items);
+    }
+}
+
+
 void LineEdit::textChanged(QString text) {
     if ((text == defaultText || text == "") && savedText != "") {
         buildSelection();
+        return;
     }
+    if (text.trimmed() != "" && global.getLiveSearch())
+        liveSearchTimer.start();
+}
+
+
+void LineEdit::liveSearchTimeout() {
+    emit liveSearchRequested(text());
 }
 
 
@@ -11,8 +11,13 @@
  #define LINEEDIT_H
 
  #include <QLineEdit>
+ #include <QTimer>
 
  class QToolButton;
+ class FilterCriteria;
+
+ // Typing pause before a live search is run (ms)
+ #define LIVE_SEARCH_DELAY 200
 
  class LineEdit : public QLineEdit
  {
@@ -23,12 +28,14 @@
      QString defaultText;
      QString activeColor;
      QString inactiveColor;
+     QTimer liveSearchTimer;
 
  public:
      LineEdit(QWidget *parent = 0);
      void updateSelection();
      bool isSet();
      void setFocus(Qt::FocusReason reason);
+     void copyCriteria(FilterCriteria *oldFilter, FilterCriteria *newFilter);
 
  protected:
      virtual void focusInEvent(QFocusEvent *e);
@@ -36,9 +43,11 @@
  private slots:
      void buildSelection();
      void textChanged(QString text);
+     void liveSearchTimeout();
 
  signals:
      void updateSelectionRequested();
+     void liveSearchRequested(QString text);
  };
 
  #endif // LINEEDIT_H
@@ -101,12 +101,10 @@ NBrowserWindow::NBrowserWindow(QWidget *parent) :
     this->uuid = uuid.createUuid().toString().replace("{", "").replace("}", "");
     QLOG_DEBUG() << "Creating NBrowserWindow uuid: " << this->uuid;
 
-    browserThread = new QThread();
-    connect(browserThread, SIGNAL(started()), this, SLOT(browserThreadStarted()));
-    browserRunner = new BrowserRunner(0);
-    connect(this, SIGNAL(requestNoteContentUpdate(qint32, QString, bool)), browserRunner,
-            SLOT(updateNoteContent(qint32, QString, bool)));
-    browserThread->start();
+    // Saves go through the shared save thread (if enabled)
+    if (global.browserRunner != nullptr)
+        connect(this, SIGNAL(requestNoteContentUpdate(qint32, QString, bool)), global.browserRunner,
+                SLOT(updateNoteContent(qint32, QString, bool)));
 
 
     //    this->setStyleSheet("margins:0px;");
@@ -249,7 +247,7 @@ NBrowserWindow::NBrowserWindow(QWidget *parent) :
     printPreviewPage = new QTextEdit();
     printPreviewPage->setVisible(false);
 
-    hammer = new Thumbnailer(global.db);
+    hammer = global.thumbnailer;
     lid = -1;
 
     //Setup shortcuts for context menu
@@ -320,14 +318,6 @@ NBrowserWindow::NBrowserWindow(QWidget *parent) :
 
 // Destructor
 NBrowserWindow::~NBrowserWindow() {
-    browserThread->quit();
-    while (!browserRunner->isIdle);
-}
-
-
-// Browser helper thread is ready
-void NBrowserWindow::browserThreadStarted() {
-    browserRunner->moveToThread(browserThread);
 }
 
 
@@ -636,8 +626,9 @@ void NBrowserWindow::setContent(qint32 lid) {
     }
 
     QLOG_DEBUG() << "Checking thumbnail, lid=" << this->lid;
-    if (!global.disableThumbnails && !noteTable.thumbnailExists(this->lid)) {
-        hammer->capturePage(this->lid, this->editor->page());
+    if (!global.disableThumbnails && hammer != nullptr && !noteTable.thumbnailExists(this->lid)) {
+        hammer->requestThumbnail(this->lid, content,
+                                 Thumbnailer::contentHash(n.content.isSet() ? n.content.ref() : QString()));
     }
     this->setEditorStyle();
 
@@ -864,17 +855,17 @@ void NBrowserWindow::saveNoteContent() {
         }
 
         QLOG_DEBUG() << "Updating note content";
-        if (!global.multiThreadSaveEnabled) {
+        if (!global.multiThreadSaveEnabled || global.browserRunner == nullptr) {
             NoteTable table(global.db);
             table.updateNoteContent(lid, formatter.getContent());
         } else
                 emit requestNoteContentUpdate(lid, formatter.getContent(), true);
         editor->isDirty = false;
 
-        if (!global.disableThumbnails) {
-            QLOG_DEBUG() << "Beginning thumbnail";
-            hammer->capturePage(this->lid, this->editor->page());
-            QLOG_DEBUG() << "Thumbnail completed";
+        if (!global.disableThumbnails && hammer != nullptr) {
+            QLOG_DEBUG() << "Queueing thumbnail";
+            hammer->requestThumbnail(this->lid, contents.toUtf8(),
+                                     Thumbnailer::contentHash(formatter.getContent()));
         }
 
         NoteCache *cache = global.cache[lid];
@@ -2832,9 +2823,8 @@ void NBrowserWindow::prepareEmailMessage(MimeMessage *message, QString note) {
 
     // Add all the images
     for (int i = 0; i < images.size(); i++) {
-        MimeReference mimeRef;
         QString localFile = images[i];
-        QString mime = mimeRef.getMimeFromFileName(localFile);
+        QString mime = MimeReference::getMimeFromFileName(localFile);
         MimeInlineFile *file = new MimeInlineFile(new QFile(localFile));
         QString lidFile = localFile.mid(localFile.lastIndexOf(QDir::separator()) + 1);
         qint32 lid = lidFile.mid(0, lidFile.lastIndexOf(".")).toInt();
@@ -2853,9 +2843,8 @@ void NBrowserWindow::prepareEmailMessage(MimeMessage *message, QString note) {
 
     // Add all the attachments
     for (int i = 0; i < attachments.size(); i++) {
-        MimeReference mimeRef;
         QString localFile = attachments[i];
-        QString mime = mimeRef.getMimeFromFileName(localFile);
+        QString mime = MimeReference::getMimeFromFileName(localFile);
         MimeInlineFile *file = new MimeInlineFile(new QFile(localFile));
         QString lidFile = localFile.mid(localFile.lastIndexOf(QDir::separator()) + 1);
         qint32 lid = lidFile.mid(0, lidFile.lastIndexOf(".")).toInt();
@@ -3209,12 +3198,11 @@ void NBrowserWindow::attachFileSelected(QString filename) {
     QString script_start = "document.execCommand('insertHTML', false, '";
     QString script_end = "');";
 
-    MimeReference mimeRef;
     QString extension = filename;
     int endPos = filename.lastIndexOf(".");
     if (endPos != -1)
         extension = extension.mid(endPos);
-    QString mime = mimeRef.getMimeFromExtension(extension);
+    QString mime = MimeReference::getMimeFromExtension(extension);
     Resource newRes;
     bool attachment = true;
     if (mime == "application/pdf" || mime.startsWith("image/"))
@@ -76,8 +76,6 @@ class NBrowserWindow : public QWidget
 {
     Q_OBJECT
 private:
-    QThread *browserThread;
-    BrowserRunner *browserRunner;
     void setupToolBar();
     QTimer *sourceEditorTimer;
     bool insertHyperlink;
@@ -366,7 +364,6 @@ private slots:
     void newTagAdded(qint32);
     void focusCheck();
     void saveTimeCheck();
-    void browserThreadStarted();
     void repositionAfterSourceEdit(bool);
     void correctFontTagAttr();
 };
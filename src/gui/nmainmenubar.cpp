@@ -482,6 +482,12 @@ void NMainMenuBar::setupToolsMenu() {
     toolsMenu->addAction(reindexDatabaseAction);
     reindexDatabaseAction->setVisible(global.enableIndexing);
 
+    rebuildThumbnailsAction = new QAction(tr("Rebuild &thumbnails"), this);
+    rebuildThumbnailsAction->setToolTip(tr("Regenerate the thumbnails of all notes"));
+    setupShortcut(rebuildThumbnailsAction, QString("Tools_Database_Rebuild_Thumbnails"));
+    connect(rebuildThumbnailsAction, SIGNAL(triggered()), parent, SLOT(rebuildThumbnails()));
+    toolsMenu->addAction(rebuildThumbnailsAction);
+
     databaseStatusDialogAction = new QAction(tr("&Database status"), this);
     databaseStatusDialogAction->setToolTip(tr("Database Status"));
     setupShortcut(databaseStatusDialogAction, QString("Tools_Database_Status"));
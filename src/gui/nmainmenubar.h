@@ -66,6 +66,7 @@ public:
     QAction *disconnectAction;
     QAction *databaseStatusDialogAction;
     QAction *reindexDatabaseAction;
+    QAction *rebuildThumbnailsAction;
     QAction *restoreDatabaseAction;
     QAction *backupDatabaseAction;
     QAction *exportNoteAction;
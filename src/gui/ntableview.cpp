@@ -91,10 +91,12 @@ NTableView::NTableView(QWidget *parent) :
     QLOG_TRACE() << "Setting up table delegates";
     dateDelegate = new DateDelegate();
     blankNumber = new NumberDelegate(NumberDelegate::BlankNumber);
+    scoreNumber = new NumberDelegate(NumberDelegate::ScoreNumber);
     kbNumber = new NumberDelegate(NumberDelegate::KBNumber);
     trueFalseDelegate = new TrueFalseDelegate();
     thumbnailDelegate = new ImageDelegate();
     reminderOrderDelegate = new ReminderOrderDelegate();
+    snippetDelegate = new SnippetDelegate();
     this->setItemDelegateForColumn(NOTE_TABLE_DATE_CREATED_POSITION, dateDelegate);
     this->setItemDelegateForColumn(NOTE_TABLE_DATE_SUBJECT_POSITION, dateDelegate);
     this->setItemDelegateForColumn(NOTE_TABLE_DATE_UPDATED_POSITION, dateDelegate);
@@ -111,7 +113,8 @@ NTableView::NTableView(QWidget *parent) :
     this->setItemDelegateForColumn(NOTE_TABLE_PINNED_POSITION, trueFalseDelegate);
     this->setItemDelegateForColumn(NOTE_TABLE_REMINDER_ORDER_POSITION, reminderOrderDelegate);
     this->setItemDelegateForColumn(NOTE_TABLE_THUMBNAIL_POSITION, thumbnailDelegate);
-    this->setItemDelegateForColumn(NOTE_TABLE_SEARCH_RELEVANCE_POSITION, blankNumber);
+    this->setItemDelegateForColumn(NOTE_TABLE_SEARCH_RELEVANCE_POSITION, scoreNumber);
+    this->setItemDelegateForColumn(NOTE_TABLE_SNIPPET_POSITION, snippetDelegate);
 
     QLOG_TRACE() << "Setting up column headers";
     global.settings->beginGroup(INI_GROUP_DEBUGGING);
@@ -128,6 +131,7 @@ NTableView::NTableView(QWidget *parent) :
     this->setColumnHidden(NOTE_TABLE_SOURCE_APPLICATION_POSITION, true);
     this->setColumnHidden(NOTE_TABLE_PINNED_POSITION, true);
     this->setColumnHidden(NOTE_TABLE_COLOR_POSITION, true);
+    this->setColumnHidden(NOTE_TABLE_SNIPPET_POSITION, true);
 
     blockSignals(true);
     if (!isColumnHidden(NOTE_TABLE_DATE_CREATED_POSITION))
@@ -164,6 +168,8 @@ NTableView::NTableView(QWidget *parent) :
         tableViewHeader->thumbnailAction->setChecked(true);
     if (!isColumnHidden(NOTE_TABLE_SEARCH_RELEVANCE_POSITION))
         tableViewHeader->relevanceAction->setChecked(true);
+    if (!isColumnHidden(NOTE_TABLE_SNIPPET_POSITION))
+        tableViewHeader->snippetAction->setChecked(true);
     if (!isColumnHidden(NOTE_TABLE_TAGS_POSITION))
         tableViewHeader->tagsAction->setChecked(true);
     if (!isColumnHidden(NOTE_TABLE_REMINDER_TIME_POSITION))
@@ -203,6 +209,7 @@ NTableView::NTableView(QWidget *parent) :
     this->model()->setHeaderData(NOTE_TABLE_SIZE_POSITION, Qt::Horizontal, QObject::tr("Size"));
     this->model()->setHeaderData(NOTE_TABLE_THUMBNAIL_POSITION, Qt::Horizontal, QObject::tr("Thumbnail"));
     this->model()->setHeaderData(NOTE_TABLE_SEARCH_RELEVANCE_POSITION, Qt::Horizontal, QObject::tr("Relevance"));
+    this->model()->setHeaderData(NOTE_TABLE_SNIPPET_POSITION, Qt::Horizontal, QObject::tr("Snippet"));
     this->model()->setHeaderData(NOTE_TABLE_PINNED_POSITION, Qt::Horizontal, QObject::tr("Pinned"));
 
     contextMenu = new QMenu(this);
@@ -366,7 +373,9 @@ NTableView::NTableView(QWidget *parent) :
 NTableView::~NTableView() {
     delete dateDelegate;
     delete blankNumber;
+    delete scoreNumber;
     delete kbNumber;
+    delete snippetDelegate;
     delete this->tableViewHeader;
     delete this->noteModel;
     delete this->proxy;
@@ -1030,6 +1039,9 @@ void NTableView::saveColumnsVisible() {
     value = isColumnHidden(NOTE_TABLE_SEARCH_RELEVANCE_POSITION);
     global.settings->setValue("relevance", value);
 
+    value = isColumnHidden(NOTE_TABLE_SNIPPET_POSITION);
+    global.settings->setValue("snippet", value);
+
     value = isColumnHidden(NOTE_TABLE_SOURCE_APPLICATION_POSITION);
     global.settings->setValue("sourceApplication", value);
 
@@ -1140,6 +1152,10 @@ void NTableView::setColumnsVisible() {
     tableViewHeader->relevanceAction->setChecked(!value);
     setColumnHidden(NOTE_TABLE_SEARCH_RELEVANCE_POSITION, value);
 
+    value = global.settings->value("snippet", true).toBool();
+    tableViewHeader->snippetAction->setChecked(!value);
+    setColumnHidden(NOTE_TABLE_SNIPPET_POSITION, value);
+
     value = global.settings->value("reminderTime", true).toBool();
     tableViewHeader->reminderTimeAction->setChecked(!value);
     setColumnHidden(NOTE_TABLE_REMINDER_TIME_POSITION, value);
@@ -1231,6 +1247,10 @@ void NTableView::repositionColumns() {
     to = global.getColumnPosition("noteTableRelevancePosition");
     if (to >= 0) horizontalHeader()->moveSection(from, to);
 
+    from = horizontalHeader()->visualIndex(NOTE_TABLE_SNIPPET_POSITION);
+    to = global.getColumnPosition("noteTableSnippetPosition");
+    if (to >= 0) horizontalHeader()->moveSection(from, to);
+
     from = horizontalHeader()->visualIndex(NOTE_TABLE_SOURCE_APPLICATION_POSITION);
     to = global.getColumnPosition("noteTableSourceApplicationPosition");
     if (to >= 0) horizontalHeader()->moveSection(from, to);
@@ -1337,6 +1357,9 @@ void NTableView::resizeColumns() {
     width = global.getColumnWidth("noteTableRelevancePosition");
     if (width > 0) setColumnWidth(NOTE_TABLE_SEARCH_RELEVANCE_POSITION, width);
 
+    width = global.getColumnWidth("noteTableSnippetPosition");
+    if (width > 0) setColumnWidth(NOTE_TABLE_SNIPPET_POSITION, width);
+
     width = global.getColumnWidth("noteTableReminderTimePosition");
     if (width > 0) setColumnWidth(NOTE_TABLE_REMINDER_TIME_POSITION, width);
 
@@ -30,6 +30,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #include "truefalsedelegate.h"
 #include "src/filters/notesortfilterproxymodel.h"
 #include "src/gui/imagedelegate.h"
+#include "src/gui/snippetdelegate.h"
 
 class NTableViewHeader;
 
@@ -41,12 +42,14 @@ private:
     //unsigned int filterPosition;
     DateDelegate *dateDelegate;
     NumberDelegate *blankNumber;
+    NumberDelegate *scoreNumber;
 
     // size kb/Mb..
     NumberDelegate *kbNumber;
     TrueFalseDelegate *trueFalseDelegate;
     ImageDelegate *thumbnailDelegate;
     ReminderOrderDelegate *reminderOrderDelegate;
+    SnippetDelegate *snippetDelegate;
     QModelIndex dragStartIndex;
     NoteModel *noteModel;
     void copyNoteLinkInternal(bool createInAppLink);
@@ -49,6 +49,7 @@ public:
     QAction *sizeAction;
     QAction *thumbnailAction;
     QAction *relevanceAction;
+    QAction *snippetAction;
     QAction *reminderTimeAction;
     QAction *reminderOrderAction;
     QAction *reminderTimeDoneAction;
@@ -83,6 +84,7 @@ public slots:
     void sizeChecked(bool);
     void thumbnailChecked(bool);
     void relevanceChecked(bool);
+    void snippetChecked(bool);
     void reminderTimeChecked(bool);
     void reminderTimeDoneChecked(bool);
     void reminderOrderChecked(bool);
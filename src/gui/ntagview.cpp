@@ -719,26 +719,27 @@ void NTagView::mergeRequested() {
 
     qint32 lid = items[0]->data(NAME_POSITION, Qt::UserRole).toInt();
     NoteTable ntable(global.db);
-    QList<qint32> notes;
-    for (int j=1; j<items.size(); j++) {
-        ntable.findNotesByTag(notes, items[j]->data(NAME_POSITION, Qt::UserRole).toInt());
-        for (int i=0; i<notes.size(); i++) {
-            if (!ntable.hasTag(notes[i], lid)) {
-                ntable.addTag(notes[i], lid, true);
-                QString tagString = ntable.getNoteListTags(notes[i]);
-                emit(updateNoteList(notes[i], NOTE_TABLE_TAGS_POSITION, tagString));
-//                qint64 dt = QDateTime::currentMSecsSinceEpoch();
-//                ntable.updateDate(notes[i],  dt, NOTE_UPDATED_DATE, true);
-//                emit(updateNoteList(notes[i], NOTE_TABLE_DATE_UPDATED_POSITION, dt));
-            }
-        }
-    }
+    QList<qint32> sourceTags;
+    for (int j=1; j<items.size(); j++)
+        sourceTags.append(items[j]->data(NAME_POSITION, Qt::UserRole).toInt());
+
+    // Tag the notes and drop the old tags in bulk, then rebuild the display
+    // column of the merged notes once and send it to the note list.
+    QList<qint32> merged;
+    for (int i=0; i<sourceTags.size(); i++)
+        ntable.findNotesByTag(merged, sourceTags[i]);
+    merged = merged.toSet().toList();
+    ntable.mergeTags(lid, sourceTags, true, false);
+    TagTable table(global.db);
+    for (int i=0; i<sourceTags.size(); i++)
+        table.deleteTag(sourceTags[i], false);
+    QHash<qint32, QString> tagStrings = ntable.rebuildNoteListTagsForNotes(merged);
+    for (QHash<qint32, QString>::iterator i=tagStrings.begin(); i!=tagStrings.end(); ++i)
+        emit(updateNoteList(i.key(), NOTE_TABLE_TAGS_POSITION, i.value()));
 
-    // Now delete the old tags.
+    // Now remove the old tags from the tree.
     for (int i=1; i<items.size(); i++) {
         qint32 lid = items[i]->data(NAME_POSITION, Qt::UserRole).toInt();
-        TagTable table(global.db);
-        table.deleteTag(lid);
 
         // Now remove it in the datastore
         NTagViewItem *ptr = dataStore.take(items[i]->data(NAME_POSITION, Qt::UserRole).toInt());
@@ -24,6 +24,8 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #include "src/sql/notetable.h"
 #include "src/gui/ntrashviewdelegate.h"
 #include <QMessageBox>
+#include <QThreadPool>
+#include "src/threads/fileremover.h"
 
 extern Global global;
 
@@ -252,21 +254,35 @@ void NTrashTree::expungeAll() {
     NoteTable ntable(global.db);
     QList<qint32> lids;
     ntable.getAllDeleted(lids);
-    for (int i=0; i<lids.size(); i++) {
-
-        Note n;
-        ntable.get(n,lids[i],false,false);
-        ntable.expunge(lids[i]);
-        delete global.cache[lids[i]];
-        global.cache.remove(lids[i]);
+    if (lids.isEmpty())
+        return;
 
-        // Check to see if the note is synchronized.  If so, we
-        // need to keep it to let Evernote to delete it.
-        if (n.updateSequenceNum.isSet() && n.updateSequenceNum>0) {
-            ntable.addToDeleteQueue(lids[i],n);
-        }
+    // Remove the notes from the database in one go.  Synchronized notes are
+    // queued so Evernote deletes them too.  The files are removed afterwards
+    // on a pool thread.
+    global.setMessage(tr("Emptying trash: deleting %1 notes").arg(lids.size()), 0);
+    QStringList files;
+    ntable.expunge(lids, files, true);
+    for (int i=0; i<lids.size(); i++) {
+        delete global.cache.take(lids[i]);
     }
     emit(updateSelectionRequested());
+
+    FileRemover *remover = new FileRemover(files);
+    connect(remover, SIGNAL(progress(qint32,qint32)), this, SLOT(expungeFilesProgress(qint32,qint32)));
+    connect(remover, SIGNAL(finished(qint32)), this, SLOT(expungeFilesFinished(qint32)));
+    connect(remover, SIGNAL(finished(qint32)), remover, SLOT(deleteLater()));
+    QThreadPool::globalInstance()->start(remover);
+}
+
+
+void NTrashTree::expungeFilesProgress(qint32 done, qint32 total) {
+    global.setMessage(tr("Emptying trash: checked %1 of %2 files").arg(done).arg(total), 0);
+}
+
+
+void NTrashTree::expungeFilesFinished(qint32 removed) {
+    global.setMessage(tr("Trash emptied, %1 files removed").arg(removed));
 }
 
 
@@ -57,6 +57,8 @@ private slots:
     void buildSelection();
     void restoreAll();
     void expungeAll();
+    void expungeFilesProgress(qint32 done, qint32 total);
+    void expungeFilesFinished(qint32 removed);
     
 };
 
@@ -30,6 +30,13 @@ QString NumberDelegate::displayText(const QVariant &value, const QLocale &locale
     if (value.toLongLong() == 0 && fmt == BlankNumber)
         return "";
 
+    // Search scores are fractional, blank when the note wasn't ranked
+    if (fmt == ScoreNumber) {
+        if (value.toDouble() <= 0)
+            return "";
+        return QString::number(value.toDouble(), 'f', 2);
+    }
+
     // If we should format in kb/mb
     if (fmt == KBNumber) {
        QString f = " B";
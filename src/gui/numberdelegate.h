@@ -28,6 +28,7 @@ public:
     enum Format {
         KBNumber,
         BlankNumber,
+        ScoreNumber,
         ZeroNumber
     };
     Format fmt;
@@ -53,14 +53,27 @@ PopplerViewer::PopplerViewer(const QString &mimeType, const QString &reslid, QWi
 
     totalPages = doc->numPages();
 
+    // Open on the first page with a hit.  PDFs indexed before the page
+    // offsets were kept are searched page by page.
     FilterCriteria *criteria = global.getCurrentCriteria();
-    searchHits.empty();
+    searchHits.clear();
     QList<QRectF> searchLocations;
     if (criteria->isSearchStringSet() && criteria->getSearchString() != "") {
         FilterEngine engine;
-        if (engine.resourceContains(lid, criteria->getSearchString(), &searchHits)) {
+        QList<ResourceHit> hits;
+        if (engine.resourceHits(lid, criteria->getSearchString(), hits)) {
             pageLabel->setStyleSheet("QLabel { background-color : yellow; }");
-            findNextPage(searchHits, &searchLocations);
+            int firstPage = -1;
+            for (int i = 0; i < hits.size(); i++) {
+                if (!searchHits.contains(hits[i].text, Qt::CaseInsensitive))
+                    searchHits.append(hits[i].text);
+                if (hits[i].page >= 0 && (firstPage < 0 || hits[i].page < firstPage))
+                    firstPage = hits[i].page;
+            }
+            if (firstPage >= 0 && firstPage < totalPages)
+                currentPage = firstPage;
+            else
+                findNextPage(searchHits, &searchLocations);
         }
     }
 
@@ -102,11 +115,8 @@ PopplerViewer::PopplerViewer(const QString &mimeType, const QString &reslid, QWi
 
     connect(pageRight, SIGNAL(clicked()), this, SLOT(pageRightPressed()));
     connect(pageLeft, SIGNAL(clicked()), this, SLOT(pageLeftPressed()));
-    if (totalPages == 1) {
-        pageRight->setEnabled(false);
-    }
-    if (currentPage == 1)
-        pageLeft->setEnabled(false);
+    pageRight->setEnabled(currentPage + 1 < totalPages);
+    pageLeft->setEnabled(currentPage > 0);
 }
 
 
@@ -0,0 +1,79 @@
+/*********************************************************************************
+NixNote - An open-source client for the Evernote service.
+Copyright (C) 2013 Randy Baumgarte
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+***********************************************************************************/
+
+#include "snippetdelegate.h"
+#include "src/filters/notesnippets.h"
+#include <QPainter>
+#include <QApplication>
+
+SnippetDelegate::SnippetDelegate()
+{
+}
+
+
+
+QString SnippetDelegate::displayText(const QVariant &value, const QLocale &locale) const {
+    Q_UNUSED(locale); // suppress unused variable
+    return NoteSnippets::plainText(value.toString());
+}
+
+
+
+void SnippetDelegate::paint(QPainter *painter, const QStyleOptionViewItem &option, const QModelIndex &index) const
+{
+    QStyleOptionViewItem options = option;
+    initStyleOption(&options, index);
+    QString snippet = index.data().toString();
+
+    // Background & selection, without the text
+    options.text = "";
+    const QWidget *widget = options.widget;
+    QStyle *style = widget != nullptr ? widget->style() : QApplication::style();
+    style->drawControl(QStyle::CE_ItemViewItem, &options, painter, widget);
+    if (snippet == "")
+        return;
+
+    QRect rect = style->subElementRect(QStyle::SE_ItemViewItemText, &options, widget);
+    painter->save();
+    painter->setClipRect(rect);
+    if (options.state & QStyle::State_Selected)
+        painter->setPen(options.palette.color(QPalette::HighlightedText));
+    else
+        painter->setPen(options.palette.color(QPalette::Text));
+
+    QFont bold = options.font;
+    bold.setBold(true);
+    bool marked = false;
+    int x = rect.left();
+    int start = 0;
+    for (int i=0; i<=snippet.size() && x < rect.right(); i++) {
+        if (i < snippet.size() && snippet[i] != HIT_OPEN && snippet[i] != HIT_CLOSE)
+            continue;
+        QString part = snippet.mid(start, i - start);
+        const QFont &font = marked ? bold : options.font;
+        painter->setFont(font);
+        painter->drawText(QRect(x, rect.top(), rect.right() - x, rect.height()),
+                          Qt::AlignLeft | Qt::AlignVCenter | Qt::TextSingleLine, part);
+        x += QFontMetrics(font).width(part);
+        if (i < snippet.size())
+            marked = (snippet[i] == HIT_OPEN);
+        start = i + 1;
+    }
+    painter->restore();
+}
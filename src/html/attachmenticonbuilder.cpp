@@ -22,11 +22,20 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #include <QIcon>
 #include <QFileInfo>
 #include <QFile>
+#include <QDir>
 #include <QFileIconProvider>
 #include <QPainter>
+#include <QCryptographicHash>
+#include <QDateTime>
 
 extern Global global;
 
+QMutex AttachmentIconBuilder::cacheMutex;
+QCache<QString, QString> AttachmentIconBuilder::cache(ATTACHMENT_ICON_CACHE_SIZE);
+// Start due, so whatever earlier sessions left is checked once
+qint32 AttachmentIconBuilder::written = ATTACHMENT_ICON_PRUNE_INTERVAL;
+
+
 AttachmentIconBuilder::AttachmentIconBuilder(QObject *parent) :
     QObject(parent)
 {
@@ -35,23 +44,43 @@ AttachmentIconBuilder::AttachmentIconBuilder(QObject *parent) :
 
 
 QString AttachmentIconBuilder::buildIcon(qint32 lid, QString fileName) {
+    Q_UNUSED(lid);
+    return buildIcon(fileName, QFileInfo(fileName).fileName(), false);
+}
+
+
+
+// Build the icon shown for an attachment: the file type icon, the name
+// and the size of the file in a box.  The png written is shared by every
+// attachment with the same key.
+QString AttachmentIconBuilder::buildIcon(QString fileName, QString displayName, bool highlight) {
+    QFont font = global.getGuiFont(QFont());
+    QString size = sizeText(fileName);
+    QString key = cacheKey(fileName, displayName, size, highlight, font);
+
+    QMutexLocker locker(&cacheMutex);
+    QString *cached = cache.object(key);
+    if (cached != nullptr)
+        return *cached;
+    QString tmpFile = cacheDirPath() + QString(QCryptographicHash::hash(key.toUtf8(), QCryptographicHash::Md5).toHex()) + ".png";
+    if (QFile::exists(tmpFile)) {
+        touch(tmpFile);
+        cache.insert(key, new QString(tmpFile));
+        return tmpFile;
+    }
+
     // First get the icon for this type of file
     QIcon icon;
     QFileInfo info(fileName);
     QFileIconProvider provider;
     icon = provider.icon(info);
 
-    // Build a string name for the display
-    QString displayName = info.fileName();
-
     // Setup the painter
     QPainter p;
+    QPen fontPen;
+    fontPen.setColor(QColor(global.getEditorFontColor()));
 
     // Setup the font
-    QFont font;
-    if (global.defaultGuiFontSize > 0)
-       font.setPointSize (global.defaultGuiFontSize);
-    font.setFamily("Arial");
     QFontMetrics fm(font);
     int width =  fm.width(displayName);
     if (width < 40)  // steup a minimum width
@@ -62,15 +91,36 @@ QString AttachmentIconBuilder::buildIcon(qint32 lid, QString fileName) {
     QPoint textPoint(40,15);
     QPoint sizePoint(40,29);
     QPixmap pixmap(width,37);
-    pixmap.fill(QColor(global.getEditorBackgroundColor()));
+    if (highlight)
+        pixmap.fill(Qt::yellow);
+    else
+        pixmap.fill(QColor(global.getEditorBackgroundColor()));
 
     p.begin(&pixmap);
+    p.setPen(fontPen);
     p.setFont(font);
     p.drawPixmap(QPoint(3,3), icon.pixmap(QSize(30,40)));
 
     // Write out the attributes of the file
     p.drawText(textPoint, displayName);
+    p.drawText(sizePoint, size);
+    p.drawRect(0,0,width-1,37-1);   // Draw a rectangle around the image.
+    p.end();
+
+    // Now that it is drawn, we write it out to the cache directory
+    QDir().mkpath(cacheDirPath());
+    if (++written >= ATTACHMENT_ICON_PRUNE_INTERVAL)
+        prune();
+    pixmap.save(tmpFile, "png");
+    cache.insert(key, new QString(tmpFile));
+    return tmpFile;
+}
 
+
+
+// The size as it is printed on the icon.  Files are bucketed by the
+// printed value, so a file that grows a little keeps its icon.
+QString AttachmentIconBuilder::sizeText(QString fileName) {
     QString unit = QString(tr("Bytes"));
     qint64 size = QFileInfo(fileName).size();
     if (size > 1024) {
@@ -81,15 +131,64 @@ QString AttachmentIconBuilder::buildIcon(qint32 lid, QString fileName) {
         size = size/1024;
         unit= QString("MB");
     }
-    QPen pen;
-    pen.setColor(global.getEditorFontColor());
-    p.drawText(sizePoint, QString::number(size).trimmed() +" " +unit);
-    p.drawRect(0,0,width-1,37-1);   // Draw a rectangle around the image.
-    p.end();
+    return QString::number(size).trimmed() +" " +unit;
+}
 
-    // Now that it is drawn, we write it out to a temporary file
-    QString tmpFile = global.fileManager.getTmpDirPath(QString::number(lid) + QString("_icon.png"));
-    tmpFile = tmpFile.replace("\\", "/");
-    pixmap.save(tmpFile, "png");
-    return tmpFile;
+
+
+QString AttachmentIconBuilder::cacheKey(QString fileName, QString displayName, QString sizeText, bool highlight, const QFont &font) {
+    QStringList key;
+    key << QFileInfo(fileName).suffix().toLower()
+        << displayName
+        << sizeText
+        << (highlight ? "highlight" : global.getEditorBackgroundColor())
+        << global.getEditorFontColor()
+        << font.toString()
+        << QIcon::themeName();
+    return key.join("\n");
+}
+
+
+
+QString AttachmentIconBuilder::cacheDirPath() {
+    return global.fileManager.getTmpDirPath("attachmenticons/").replace("\\", "/");
+}
+
+
+
+void AttachmentIconBuilder::clearCache() {
+    QMutexLocker locker(&cacheMutex);
+    cache.clear();
+    QDir(cacheDirPath()).removeRecursively();
+}
+
+
+
+// Files are dated when they are used, so the dates on disk give the
+// order for pruning.  Icons in the memory cache were dated when they got
+// there.
+void AttachmentIconBuilder::touch(const QString &file) {
+#if QT_VERSION >= QT_VERSION_CHECK(5, 10, 0)
+    QFile f(file);
+    if (f.open(QIODevice::Append))
+        f.setFileTime(QDateTime::currentDateTime(), QFileDevice::FileModificationTime);
+#else
+    Q_UNUSED(file);
+#endif
+}
+
+
+
+// Icons are only added to the disk cache, so every so many new icons the
+// least recently used are dropped once there are too many.  The memory
+// cache may point to them, so it goes too.  Called with cacheMutex held.
+void AttachmentIconBuilder::prune() {
+    written = 0;
+    QDir dir(cacheDirPath());
+    QFileInfoList files = dir.entryInfoList(QStringList() << "*.png", QDir::Files, QDir::Time);
+    if (files.size() <= ATTACHMENT_ICON_DISK_LIMIT)
+        return;
+    for (int i=ATTACHMENT_ICON_DISK_LIMIT; i<files.size(); i++)
+        QFile::remove(files[i].absoluteFilePath());
+    cache.clear();
 }
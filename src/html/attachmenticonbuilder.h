@@ -21,14 +21,44 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #define ATTACHMENTICONBUILDER_H
 
 #include <QObject>
+#include <QCache>
+#include <QMutex>
+#include <QFont>
 
+// Rendered icons kept in memory.  Icons are also kept on disk, so evicted
+// entries only cost a file check.
+#define ATTACHMENT_ICON_CACHE_SIZE 500
+
+// Icons kept on disk.  The least recently used are removed past this.
+#define ATTACHMENT_ICON_DISK_LIMIT 2000
+
+// Icons written between two checks of the disk cache
+#define ATTACHMENT_ICON_PRUNE_INTERVAL 200
+
+// Rendered icons are cached by everything that goes into the picture
+// (file type, display name, size, colors & font), so an icon is painted
+// once per unique key rather than every time a note is opened.
 class AttachmentIconBuilder : public QObject
 {
     Q_OBJECT
+private:
+    static QMutex cacheMutex;
+    static QCache<QString, QString> cache;      // key -> png file
+    static qint32 written;                      // icons written since the last prune
+
+    static void touch(const QString &file);
+    static void prune();
+
+    QString cacheKey(QString fileName, QString displayName, QString sizeText, bool highlight, const QFont &font);
+    QString sizeText(QString fileName);
+
 public:
     explicit AttachmentIconBuilder(QObject *parent = 0);
     QString buildIcon(qint32 lid, QString fileName);
-    
+    QString buildIcon(QString fileName, QString displayName, bool highlight);
+    static QString cacheDirPath();
+    static void clearCache();               // The theme changed
+
 signals:
     
 public slots:
@@ -33,6 +33,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #include "src/utilities/encrypt.h"
 #include "src/logger/qslog.h"
 #include "src/utilities/NixnoteStringUtils.h"
+#include "src/utilities/metrics.h"
 
 #ifdef Q_OS_MACOS
 #include <tidy.h>
@@ -361,7 +362,8 @@ void EnmlFormatter::removeHtmlCommentsInclContent() {
  * Take the WebKit HTML and transform it into ENML
  * */
 void EnmlFormatter::rebuildNoteEnml() {
-    qint64 timeStart = QDateTime::currentMSecsSinceEpoch();
+    static MetricHistogram *latency = Metrics::instance().histogram("render.noteEnml");
+    MetricsTimer timer(latency);
     QLOG_INFO() << ENML_MODULE_LOGPREFIX "===== rebuilding note ENML";
     QLOG_DEBUG_FILE("fmt-html-input.html", getContent());
 
@@ -436,8 +438,7 @@ void EnmlFormatter::rebuildNoteEnml() {
 
 
     QLOG_DEBUG_FILE("fmt-enml-final.xml", getContent());
-    qint64 timeEnd = QDateTime::currentMSecsSinceEpoch();
-    QLOG_INFO() << ENML_MODULE_LOGPREFIX "===== finished rebuilding note ENML in " << (timeEnd - timeStart) << " ms";
+    QLOG_INFO() << ENML_MODULE_LOGPREFIX "===== finished rebuilding note ENML in " << timer.elapsed() << " ms";
 }
 
 void EnmlFormatter::recursiveTreeCleanup(QWebElement &elementRoot, int level) {
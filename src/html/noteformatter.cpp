@@ -18,7 +18,6 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 ***********************************************************************************/
 
 #include <QFileSystemModel>
-#include <QFileIconProvider>
 #include <poppler-qt5.h>
 #include <QIcon>
 #include <QList>
@@ -34,7 +33,9 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #include "src/filters/filterengine.h"
 #include "src/utilities/mimereference.h"
 #include "enmlformatter.h"
+#include "attachmenticonbuilder.h"
 #include "src/utilities/NixnoteStringUtils.h"
+#include "src/utilities/metrics.h"
 
 using namespace std;
 
@@ -137,6 +138,8 @@ QString NoteFormatter::enmlToNoteHTML(QString enml) {
 /* Take the ENML note and transform it into HTML that WebKit will
   not complain about */
 QByteArray NoteFormatter::rebuildNoteHTML() {
+    static MetricHistogram *latency = Metrics::instance().histogram("render.noteHtml");
+    MetricsTimer timer(latency);
     bool haveGuid = note.guid.isSet();
     QString guid = haveGuid ? note.guid.ref() : "unknown";
 
@@ -486,7 +489,6 @@ void NoteFormatter::modifyImageTags(QWebElement &enMedia, QString &hash) {
         Resource r = resourceMap[resLid];
         QLOG_TRACE() << "resource retrieved";
 
-        MimeReference ref;
         QString filename;
         ResourceAttributes attributes;
         if (r.attributes.isSet()) {
@@ -505,7 +507,7 @@ void NoteFormatter::modifyImageTags(QWebElement &enMedia, QString &hash) {
 
 
 
-        QString type = ref.getExtensionFromMime(mimetype, filename);
+        QString type = MimeReference::getExtensionFromMime(mimetype, filename);
         QLOG_DEBUG() << "htmlfmt: image tag - getting resource hash=" << hash << ", lid=" << resLid << ", type="
                      << type << ", mimetype=" << mimetype;
 
@@ -639,14 +641,13 @@ void NoteFormatter::modifyApplicationTags(QWebElement &enmedia, QString &hash, Q
         }
 
         QString fileDetails = "";
-        MimeReference ref;
         ResourceAttributes attributes;
         if (r.attributes.isSet()) {
             attributes = r.attributes;
         }
 
         if (attributes.fileName.isSet()) {
-            fileDetails = ref.getExtensionFromMime(r.mime, fileDetails);
+            fileDetails = MimeReference::getExtensionFromMime(r.mime, fileDetails);
         }
 
         enmedia.setAttribute("href", QString("nnres:") + global.fileManager.getDbaDirPath() + QString::number(resLid)
@@ -679,7 +680,7 @@ void NoteFormatter::modifyApplicationTags(QWebElement &enmedia, QString &hash, Q
         if (r.mime.isSet()) {
             mime = r.mime;
         }
-        fileExt = ref.getExtensionFromMime(mime, fn);
+        fileExt = MimeReference::getExtensionFromMime(mime, fn);
 
         QString icon = findIcon(resLid, r, fileExt);
         newText.setAttribute("src", "file:///" + icon);
@@ -708,10 +709,6 @@ QString NoteFormatter::findIcon(qint32 lid, Resource r, QString fileExt) {
     }
 
     QString fileName = global.fileManager.getDbaDirPath() + QString::number(lid) + fileExt;
-    QIcon icon;
-    QFileInfo info(fileName);
-    QFileIconProvider provider;
-    icon = provider.icon(info);
 
     // Build a string name for the display
     QString displayName;
@@ -723,56 +720,8 @@ QString NoteFormatter::findIcon(qint32 lid, Resource r, QString fileExt) {
     else
         displayName = fileExt.toUpper() + " " + QString(tr("File"));
 
-    // Setup the painter
-    QPainter p;
-
-    // Setup the font
-    QFont font; // =p.font() ;
-    global.getGuiFont(font);
-    QPen fontPen;
-    fontPen.setColor(QColor(global.getEditorFontColor()));
-//    font.setFamily("Arial");
-    QFontMetrics fm(font);
-    int width = fm.width(displayName);
-    if (width < 40)  // steup a minimum width
-        width = 40;
-    width = width + 50;  // Add 10 px for padding & 40 for the icon
-
-    // Start drawing a new pixmap for  the image in the note
-    QPoint textPoint(40, 15);
-    QPoint sizePoint(40, 29);
-    QPixmap pixmap(width, 37);
-    if (resourceHighlight) {
-        pixmap.fill(Qt::yellow);
-    } else
-        pixmap.fill(QColor(global.getEditorBackgroundColor()));
-
-    p.begin(&pixmap);
-    p.setPen(fontPen);
-    p.setFont(font);
-    p.drawPixmap(QPoint(3, 3), icon.pixmap(QSize(30, 40)));
-
-    // Write out the attributes of the file
-    p.drawText(textPoint, displayName);
-
-    QString unit = QString(tr("Bytes"));
-    qint64 size = QFileInfo(fileName).size();
-    if (size > 1024) {
-        size = size / 1024;
-        unit = QString(tr("KB"));
-    }
-    if (size > 1024) {
-        size = size / 1024;
-        unit = QString("MB");
-    }
-
-    p.drawText(sizePoint, QString::number(size).trimmed() + " " + unit);
-    p.drawRect(0, 0, width - 1, 37 - 1);   // Draw a rectangle around the image.
-    p.end();
-
-    // Now that it is drawn, we write it out to a temporary file
-    QString tmpFile = global.fileManager.getTmpDirPath(QString::number(lid) + QString("_icon.png"));
-    pixmap.save(tmpFile, "png");
+    AttachmentIconBuilder builder;
+    QString tmpFile = builder.buildIcon(fileName, displayName, resourceHighlight);
     return tmpFile;
     QLOG_TRACE_OUT();
 }
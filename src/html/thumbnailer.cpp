@@ -24,41 +24,275 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #include <QtSql>
 #include <QTextDocument>
 #include <QPainter>
+#include <QCryptographicHash>
 #include "src/global.h"
 #include "src/sql/notetable.h"
+#include "src/html/noteformatter.h"
 
 extern Global global;
 
+// Size of the generated thumbnail (in pixels) and the zoom used to render it
+#define THUMBNAIL_SIZE 300
+#define THUMBNAIL_ZOOM 3
+
+// Delay before a freshly queued request is rendered.  Lets rapid successive
+// saves of the same note collapse into a single render.
+#define THUMBNAIL_QUEUE_DELAY 1000
+
+
+
+ThumbnailEncoder::ThumbnailEncoder(QObject *receiver, qint32 lid, QImage image, QString filename, QByteArray contentHash) {
+    this->receiver = receiver;
+    this->lid = lid;
+    this->image = image;
+    this->filename = filename;
+    this->contentHash = contentHash;
+}
+
+
+// Runs on the encoder pool.  Only the file is written here, the DB update
+// is posted back to the thumbnailer's thread.
+void ThumbnailEncoder::run() {
+    if (!image.save(filename, "PNG")) {
+        QLOG_ERROR() << "Unable to save thumbnail " << filename;
+        return;
+    }
+    QMetaObject::invokeMethod(receiver, "thumbnailEncoded", Qt::QueuedConnection,
+                              Q_ARG(qint32, lid), Q_ARG(QString, filename), Q_ARG(QByteArray, contentHash));
+}
+
+
+
+
 /* Generic constructor. */
 Thumbnailer::Thumbnailer(DatabaseConnection *db)
 {
     this->db = db;
+    page = nullptr;
+    rendering = false;
+    batchRemaining = 0;
+    batchRendered = 0;
+    totalRendered = 0;
+    totalRenderMs = 0;
+    totalSkipped = 0;
+
+    // PNG encoding is cheap compared to rendering, one worker keeps up easily
+    // and keeps the disk writes sequential.
+    encoderPool.setMaxThreadCount(1);
+
+    batchTimer.setSingleShot(true);
+    connect(&batchTimer, SIGNAL(timeout()), this, SLOT(processBatch()));
 }
 
 Thumbnailer::~Thumbnailer() {
+    batchTimer.stop();
+    encoderPool.waitForDone();
+    delete page;
+}
+
+
+// The offscreen page is only created once the first thumbnail is needed.
+void Thumbnailer::setupPage() {
+    if (page != nullptr)
+        return;
+    page = new QWebPage(this);
+    page->settings()->setAttribute(QWebSettings::JavascriptEnabled, false);
+    page->settings()->setAttribute(QWebSettings::PluginsEnabled, false);
+    page->mainFrame()->setScrollBarPolicy(Qt::Horizontal, Qt::ScrollBarAlwaysOff);
+    page->mainFrame()->setScrollBarPolicy(Qt::Vertical, Qt::ScrollBarAlwaysOff);
+    page->mainFrame()->setZoomFactor(THUMBNAIL_ZOOM);
+    page->setViewportSize(QSize(THUMBNAIL_SIZE, THUMBNAIL_SIZE));
+    connect(page, SIGNAL(loadFinished(bool)), this, SLOT(pageLoaded(bool)));
+}
+
+
+// Hash used to decide if an existing thumbnail is still valid.
+QByteArray Thumbnailer::contentHash(const QString &enml) {
+    return QCryptographicHash::hash(enml.toUtf8(), QCryptographicHash::Md5).toHex();
+}
+
+
+// Queue a note for a thumbnail.  If the html is already available (i.e. the note
+// is open in an editor) it is reused, otherwise the note is formatted when its
+// turn comes.
+void Thumbnailer::requestThumbnail(qint32 lid, QByteArray html, QByteArray contentHash) {
+    if (global.disableThumbnails || lid <= 0)
+        return;
+
+    // A newer version of a note already in the queue replaces the old request
+    bool queued = pending.contains(lid);
+    ThumbnailRequest &request = pending[lid];
+    request.lid = lid;
+    request.html = html;
+    request.contentHash = contentHash;
+    if (queued)
+        return;
+    queue.enqueue(lid);
+
+    if (!rendering && !batchTimer.isActive())
+        batchTimer.start(THUMBNAIL_QUEUE_DELAY);
+}
+
+
+// Queue a list of notes (used for backfilling notes without thumbnails)
+void Thumbnailer::requestThumbnail(QList<qint32> lids) {
+    for (int i=0; i<lids.size(); i++)
+        requestThumbnail(lids[i]);
 }
 
 
-void Thumbnailer::capturePage(qint32 lid, QWebPage *page) {
-    qreal zoomFactor = page->mainFrame()->zoomFactor();
-    QSize viewportSize = page->viewportSize();
+// Forget the hash of a note so the next request always re-renders it.  An
+// empty hash never matches, even if the thumbnail on disk has a stored hash.
+void Thumbnailer::invalidate(qint32 lid) {
+    lastHash.insert(lid, QByteArray());
+}
+
 
-    page->mainFrame()->setZoomFactor(3);
-    page->setViewportSize(QSize(300,300));
+qint32 Thumbnailer::getQueueSize() {
+    return queue.size() + (rendering ? 1 : 0);
+}
 
-    QImage pix(QSize(300,300), QImage::Format_ARGB32);
-    QPainter painter;
-    painter.begin(&pix);
-    QRegion region = QRegion(0, 0, 300, 300);
-    page->mainFrame()->render(&painter, region);
-    painter.end();
-    QString filename = global.fileManager.getThumbnailDirPath() + QString::number(lid) +".png";
-    pix.save(filename);
 
-    page->mainFrame()->setZoomFactor(zoomFactor);
-    page->setViewportSize(viewportSize);
+double Thumbnailer::getThroughput() {
+    if (totalRenderMs <= 0)
+        return 0.0;
+    return static_cast<double>(totalRendered) * 1000.0 / static_cast<double>(totalRenderMs);
+}
 
+
+// Check if the thumbnail on disk was built from the same content
+bool Thumbnailer::isCurrent(qint32 lid, const QByteArray &contentHash) {
+    if (contentHash.isEmpty())
+        return false;
+
+    NoteTable ntable(db);
+    if (!ntable.thumbnailExists(lid)) {
+        lastHash.remove(lid);
+        return false;
+    }
+    if (!lastHash.contains(lid))
+        lastHash.insert(lid, ntable.getThumbnailHash(lid));
+    return lastHash.value(lid) == contentHash;
+}
+
+
+// Format a note which isn't open in an editor.
+QByteArray Thumbnailer::formatNote(qint32 lid, QByteArray &contentHash) {
     NoteTable ntable(db);
-    ntable.setThumbnail(lid, filename);
+    Note n;
+    if (!ntable.get(n, lid, false, false))
+        return QByteArray();
+
+    QString content = n.content.isSet() ? n.content.ref() : QString();
+    contentHash = Thumbnailer::contentHash(content);
+    if (isCurrent(lid, contentHash))
+        return QByteArray();
+
+    NoteFormatter formatter;
+    formatter.thumbnail = true;
+    formatter.setNote(n, global.pdfPreview);
+    return formatter.rebuildNoteHTML();
 }
 
+
+// Timer expired.  Start rendering the next batch.
+void Thumbnailer::processBatch() {
+    if (rendering)
+        return;
+    if (queue.isEmpty() || global.disableThumbnails) {
+        queue.clear();
+        pending.clear();
+        return;
+    }
+
+    setupPage();
+    batchRemaining = qMax(global.batchThumbnailCount, 1);
+    batchRendered = 0;
+    batchClock.start();
+    renderNext();
+}
+
+
+// Load the next request of the current batch into the offscreen page.
+// Rendering continues in pageLoaded() once WebKit is done.
+void Thumbnailer::renderNext() {
+    while (batchRemaining > 0 && !queue.isEmpty()) {
+        current = pending.take(queue.dequeue());
+
+        if (current.html.isEmpty())
+            current.html = formatNote(current.lid, current.contentHash);
+        else if (isCurrent(current.lid, current.contentHash))
+            current.html.clear();
+
+        // Already current, so it mustn't be backfilled again either
+        if (current.html.isEmpty()) {
+            NoteTable ntable(db);
+            ntable.setThumbnailNeeded(current.lid, false);
+            totalSkipped++;
+            continue;
+        }
+
+        rendering = true;
+        batchRemaining--;
+        page->mainFrame()->setContent(current.html);
+        return;
+    }
+    finishBatch();
+}
+
+
+// The offscreen page finished loading.  Paint it and send it to the encoder.
+void Thumbnailer::pageLoaded(bool ok) {
+    if (!rendering)
+        return;
+
+    if (ok) {
+        QImage pix(QSize(THUMBNAIL_SIZE, THUMBNAIL_SIZE), QImage::Format_ARGB32);
+        pix.fill(Qt::white);
+        QPainter painter;
+        painter.begin(&pix);
+        QRegion region = QRegion(0, 0, THUMBNAIL_SIZE, THUMBNAIL_SIZE);
+        page->mainFrame()->render(&painter, region);
+        painter.end();
+
+        QString filename = global.fileManager.getThumbnailDirPath() + QString::number(current.lid) + ".png";
+        encoderPool.start(new ThumbnailEncoder(this, current.lid, pix, filename, current.contentHash));
+        batchRendered++;
+    } else {
+        QLOG_DEBUG() << "Unable to render thumbnail for lid=" << current.lid;
+    }
+
+    rendering = false;
+    current.html.clear();
+    renderNext();
+}
+
+
+// Log the batch statistics and schedule the next batch (if any)
+void Thumbnailer::finishBatch() {
+    rendering = false;
+    qint64 elapsed = batchClock.elapsed();
+    if (batchRendered > 0) {
+        totalRendered += batchRendered;
+        totalRenderMs += elapsed;
+        QLOG_DEBUG() << "Thumbnail batch: " << batchRendered << " rendered in " << elapsed
+                     << " ms, queued=" << queue.size() << ", skipped (unchanged)=" << totalSkipped
+                     << ", average=" << QString::number(getThroughput(), 'f', 2) << " thumbnails/sec";
+    }
+
+    // Free the last page's memory while idle
+    if (queue.isEmpty()) {
+        page->mainFrame()->setContent(QByteArray());
+        return;
+    }
+    batchTimer.start(qMax(global.minimumThumbnailInterval, 0) * 1000);
+}
+
+
+// The encoder finished writing a thumbnail file.
+void Thumbnailer::thumbnailEncoded(qint32 lid, QString filename, QByteArray contentHash) {
+    NoteTable ntable(db);
+    ntable.setThumbnail(lid, filename, contentHash);
+    lastHash.insert(lid, contentHash);
+    emit(thumbnailReady(lid, filename));
+}
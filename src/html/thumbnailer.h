@@ -24,6 +24,14 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #include <QtWebKit>
 #include <QObject>
 #include <QSqlDatabase>
+#include <QWebPage>
+#include <QTimer>
+#include <QQueue>
+#include <QHash>
+#include <QImage>
+#include <QRunnable>
+#include <QThreadPool>
+#include <QElapsedTimer>
 
 #include "src/sql/databaseconnection.h"
 
@@ -34,15 +42,84 @@ using namespace qevercloud;
 using namespace std;
 
 
+// A single note waiting for its thumbnail to be rendered.
+class ThumbnailRequest
+{
+public:
+    qint32 lid;
+    QByteArray html;          // already formatted page; empty means "format from the DB"
+    QByteArray contentHash;   // MD5 of the note ENML the thumbnail is built from
+};
+
+
+// Encodes a rendered thumbnail to PNG outside of the GUI thread.
+class ThumbnailEncoder : public QRunnable
+{
+private:
+    QObject *receiver;
+    qint32 lid;
+    QImage image;
+    QString filename;
+    QByteArray contentHash;
+
+public:
+    ThumbnailEncoder(QObject *receiver, qint32 lid, QImage image, QString filename, QByteArray contentHash);
+    void run();
+};
+
+
+// Offscreen thumbnail pipeline.  Requests are queued, rendered in batches of
+// global.batchThumbnailCount on a private QWebPage (never the live editor page)
+// and then handed to a worker thread for the PNG encoding.  Notes whose content
+// hash matches the one the current thumbnail was built from are skipped.
 class Thumbnailer : public QObject
 {
+    Q_OBJECT
+
 private:
     DatabaseConnection *db;
+    QWebPage *page;
+    QTimer batchTimer;
+    QQueue<qint32> queue;                       // lids in the order they were requested
+    QHash<qint32, ThumbnailRequest> pending;    // lid -> latest request for it
+    QHash<qint32, QByteArray> lastHash;   // lid -> content hash of the existing thumbnail
+    QThreadPool encoderPool;
+    ThumbnailRequest current;
+    bool rendering;
+    qint32 batchRemaining;
+
+    // throughput statistics
+    QElapsedTimer batchClock;
+    qint32 batchRendered;
+    qint64 totalRendered;
+    qint64 totalRenderMs;
+    qint64 totalSkipped;
+
+    void setupPage();
+    bool isCurrent(qint32 lid, const QByteArray &contentHash);
+    void renderNext();
+    void finishBatch();
+    QByteArray formatNote(qint32 lid, QByteArray &contentHash);
 
 public:
     Thumbnailer(DatabaseConnection *db);
     ~Thumbnailer();
-    void capturePage(qint32 lid, QWebPage *page);
+    void requestThumbnail(qint32 lid, QByteArray html = QByteArray(), QByteArray contentHash = QByteArray());
+    void requestThumbnail(QList<qint32> lids);
+    void invalidate(qint32 lid);
+    qint32 getQueueSize();
+    double getThroughput();           // thumbnails per second, averaged over everything rendered so far
+    static QByteArray contentHash(const QString &enml);
+
+signals:
+    void thumbnailReady(qint32 lid, QString filename);
+
+private slots:
+    void processBatch();
+    void pageLoaded(bool ok);
+
+public slots:
+    void thumbnailEncoded(qint32 lid, QString filename, QByteArray contentHash);
 };
 
 #endif // THUMBNAILER_H
@@ -73,18 +73,13 @@ namespace QsLogging {
 
     class LoggerImpl {
     public:
-        LoggerImpl() :
-            level(InfoLevel) {
-
-        }
-
-        QMutex logMutex;
-        Level level;
+        QMutex logMutex;       // serializes destinations which aren't thread safe
         DestinationList destList;
     };
 
     Logger::Logger() :
-        d(new LoggerImpl) {
+        d(new LoggerImpl),
+        level(InfoLevel) {
         this->filenameCounter = 0;
         this->displayTimestamp = true;
     }
@@ -99,11 +94,15 @@ namespace QsLogging {
     }
 
     void Logger::setLoggingLevel(Level newLevel) {
-        d->level = newLevel;
+        level = newLevel;
     }
 
-    Level Logger::loggingLevel() const {
-        return d->level;
+    void Logger::flush() {
+        for (DestinationList::iterator it = d->destList.begin(),
+                 endIt = d->destList.end(); it != endIt; ++it) {
+            if (*it)
+                (*it)->flush();
+        }
     }
 
     // creates the complete log message and passes it to the logger
@@ -116,8 +115,10 @@ namespace QsLogging {
         }
         completeMessage.append(buffer);
 
-        QMutexLocker lock(&logger.d->logMutex);
         logger.write(completeMessage);
+        // Nothing may be left in a queue if we are about to die
+        if (level == FatalLevel)
+            logger.flush();
     }
 
     Logger::Helper::~Helper() {
@@ -140,7 +141,12 @@ namespace QsLogging {
                 assert(!"null log destination");
                 continue;
             }
-            (*it)->write(message);
+            if ((*it)->isThreadSafe()) {
+                (*it)->write(message);
+            } else {
+                QMutexLocker lock(&d->logMutex);
+                (*it)->write(message);
+            }
         }
     }
 
@@ -56,8 +56,12 @@ namespace QsLogging {
         //! Logging at a level < 'newLevel' will be ignored
         void setLoggingLevel(Level newLevel);
 
-        //! The default level is INFO
-        Level loggingLevel() const;
+        //! The default level is INFO.  Inline as it is checked by every log macro
+        //! before any formatting is done.
+        Level loggingLevel() const { return level; }
+
+        //! Blocks until all destinations have written everything logged so far
+        void flush();
 
         void writeToFile(const QString &logid, const QString &message);
 
@@ -95,6 +99,7 @@ namespace QsLogging {
         void write(const QString &message);
 
         LoggerImpl *d;
+        Level level;
 
         // used with writeToFile
         int filenameCounter;
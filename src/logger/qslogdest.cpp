@@ -28,34 +28,286 @@
 #include <QFile>
 #include <QTextStream>
 #include <QString>
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QList>
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
 
 namespace QsLogging
 {
 
+//! Bounded multi producer / single consumer queue (D. Vyukov's algorithm).
+//! Producers never take a lock, every slot carries a sequence number telling
+//! whether it is free for the current lap or holds a message.
+class LogRingBuffer
+{
+public:
+   explicit LogRingBuffer(size_t capacity);
+   ~LogRingBuffer();
+
+   bool tryPush(const QString& message);
+   bool tryPop(QString& message);
+   size_t pushed() const { return mEnqueuePos.load(std::memory_order_acquire); }
+   size_t popped() const { return mDequeuePos.load(std::memory_order_acquire); }
+   size_t capacity() const { return mMask + 1; }
+
+private:
+   struct Slot
+   {
+      std::atomic<size_t> sequence;
+      QString message;
+   };
+
+   Slot* mSlots;
+   size_t mMask;
+   std::atomic<size_t> mEnqueuePos;
+   std::atomic<size_t> mDequeuePos;
+};
+
+LogRingBuffer::LogRingBuffer(size_t capacity)
+{
+   // capacity must be a power of two
+   size_t size = 2;
+   while (size < capacity)
+      size <<= 1;
+   mSlots = new Slot[size];
+   mMask = size - 1;
+   for (size_t i = 0; i < size; ++i)
+      mSlots[i].sequence.store(i, std::memory_order_relaxed);
+   mEnqueuePos.store(0, std::memory_order_relaxed);
+   mDequeuePos.store(0, std::memory_order_relaxed);
+}
+
+LogRingBuffer::~LogRingBuffer()
+{
+   delete[] mSlots;
+}
+
+bool LogRingBuffer::tryPush(const QString& message)
+{
+   size_t pos = mEnqueuePos.load(std::memory_order_relaxed);
+   Slot* slot;
+   for (;;) {
+      slot = &mSlots[pos & mMask];
+      size_t seq = slot->sequence.load(std::memory_order_acquire);
+      std::ptrdiff_t diff = static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(pos);
+      if (diff == 0) {
+         if (mEnqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+            break;
+      } else if (diff < 0) {
+         return false; // full
+      } else {
+         pos = mEnqueuePos.load(std::memory_order_relaxed);
+      }
+   }
+   slot->message = message;
+   slot->sequence.store(pos + 1, std::memory_order_release);
+   return true;
+}
+
+bool LogRingBuffer::tryPop(QString& message)
+{
+   size_t pos = mDequeuePos.load(std::memory_order_relaxed);
+   Slot* slot = &mSlots[pos & mMask];
+   size_t seq = slot->sequence.load(std::memory_order_acquire);
+   if (seq != pos + 1)
+      return false; // empty (or the producer hasn't finished the slot yet)
+   message.swap(slot->message);
+   slot->message.clear();
+   slot->sequence.store(pos + mMask + 1, std::memory_order_release);
+   mDequeuePos.store(pos + 1, std::memory_order_release);
+   return true;
+}
+
+
+class FileDestination;
+
+//! background thread writing the queued messages of a FileDestination
+class FileFlusher : public QThread
+{
+public:
+   explicit FileFlusher(FileDestination* destination) : mDestination(destination) {}
+
+protected:
+   virtual void run();
+
+private:
+   FileDestination* mDestination;
+};
+
+
 //! file message sink
 class FileDestination : public Destination
 {
 public:
-   FileDestination(const QString& filePath);
+   FileDestination(const QString& filePath, qint64 maxFileSize, int maxBackups);
+   virtual ~FileDestination();
    virtual void write(const QString& message);
+   virtual void flush();
+   virtual bool isThreadSafe() const { return true; }
 
 private:
+   friend class FileFlusher;
+
+   void open();
+   void rotate();
+   void writeBatch();
+   void wakeFlusher();
+
    QFile mFile;
-   QTextStream mOutputStream;
+   QString mFilePath;
+   qint64 mMaxFileSize;
+   int mMaxBackups;
+
+   LogRingBuffer mQueue;
+   std::atomic<size_t> mWritten;   // messages popped *and* flushed to the file
+   FileFlusher mFlusher;
+   std::atomic<bool> mRunning;
+   QMutex mWakeMutex;          // only used to sleep/wake the flusher, never by producers on the fast path
+   QWaitCondition mWakeCondition;
 };
 
+// Messages queued before the writer is forced awake
+static const size_t kQueueCapacity = 16384;
+static const size_t kWakeThreshold = kQueueCapacity / 2;
+// Maximum time a message waits in the queue
+static const unsigned long kFlushIntervalMs = 200;
+
+
+// Live file destinations.  Most exits go through exit(), which skips the
+// destructors of main()'s locals, so queued messages are drained from an
+// atexit() handler instead.
+static QMutex sLiveDestinationsMutex;
+static QList<FileDestination*> sLiveDestinations;
+static bool sAtExitRegistered = false;
+
+static void flushLiveDestinations()
+{
+   QMutexLocker lock(&sLiveDestinationsMutex);
+   for (int i = 0; i < sLiveDestinations.size(); ++i)
+      sLiveDestinations[i]->flush();
+}
+
+
+void FileFlusher::run()
+{
+   while (mDestination->mRunning.load(std::memory_order_acquire)) {
+      mDestination->mWakeMutex.lock();
+      if (mDestination->mQueue.pushed() == mDestination->mQueue.popped())
+         mDestination->mWakeCondition.wait(&mDestination->mWakeMutex, kFlushIntervalMs);
+      mDestination->mWakeMutex.unlock();
+      mDestination->writeBatch();
+   }
+   mDestination->writeBatch();
+}
+
+
+FileDestination::FileDestination(const QString& filePath, qint64 maxFileSize, int maxBackups) :
+   mFilePath(filePath),
+   mMaxFileSize(maxFileSize),
+   mMaxBackups(maxBackups),
+   mQueue(kQueueCapacity),
+   mWritten(0),
+   mFlusher(this)
+{
+   open();
+   mRunning.store(true, std::memory_order_release);
+   mFlusher.start(QThread::LowPriority);
+
+   QMutexLocker lock(&sLiveDestinationsMutex);
+   sLiveDestinations.append(this);
+   if (!sAtExitRegistered) {
+      std::atexit(flushLiveDestinations);
+      sAtExitRegistered = true;
+   }
+}
 
-FileDestination::FileDestination(const QString& filePath)
+FileDestination::~FileDestination()
 {
-   mFile.setFileName(filePath);
+   {
+      QMutexLocker lock(&sLiveDestinationsMutex);
+      sLiveDestinations.removeAll(this);
+   }
+   mRunning.store(false, std::memory_order_release);
+   wakeFlusher();
+   mFlusher.wait();
+   mFile.close();
+}
+
+void FileDestination::open()
+{
+   mFile.setFileName(mFilePath);
    mFile.open(QFile::WriteOnly | QFile::Text); //fixme: should throw on failure
-   mOutputStream.setDevice(&mFile);
 }
 
+// Queue a message.  Only blocks (yielding) if the writer has fallen a full buffer behind.
 void FileDestination::write(const QString& message)
 {
-   mOutputStream << message << endl;
-   mOutputStream.flush();
+   while (!mQueue.tryPush(message)) {
+      wakeFlusher();
+      QThread::yieldCurrentThread();
+   }
+   if (mQueue.pushed() - mQueue.popped() >= kWakeThreshold)
+      wakeFlusher();
+}
+
+void FileDestination::wakeFlusher()
+{
+   mWakeMutex.lock();
+   mWakeCondition.wakeOne();
+   mWakeMutex.unlock();
+}
+
+// Wait until everything queued so far has been written
+void FileDestination::flush()
+{
+   if (!mFlusher.isRunning() || QThread::currentThread() == &mFlusher) {
+      writeBatch();
+      return;
+   }
+   size_t target = mQueue.pushed();
+   while (mWritten.load(std::memory_order_acquire) < target && mFlusher.isRunning()) {
+      wakeFlusher();
+      QThread::msleep(1);
+   }
+}
+
+// Drain the queue with a single write() call
+void FileDestination::writeBatch()
+{
+   QByteArray batch;
+   QString message;
+   size_t count = 0;
+   while (mQueue.tryPop(message)) {
+      batch.append(message.toUtf8());
+      batch.append('\n');
+      ++count;
+   }
+   if (batch.isEmpty())
+      return;
+
+   mFile.write(batch);
+   mFile.flush();
+   // popped() moves before the write, flush() waits on this instead
+   mWritten.fetch_add(count, std::memory_order_release);
+   if (mMaxFileSize > 0 && mFile.size() >= mMaxFileSize)
+      rotate();
+}
+
+// messages.log -> messages.log.1 -> ... -> messages.log.<maxBackups>
+void FileDestination::rotate()
+{
+   mFile.close();
+   if (mMaxBackups > 0) {
+      QFile::remove(mFilePath + "." + QString::number(mMaxBackups));
+      for (int i = mMaxBackups - 1; i >= 1; --i)
+         QFile::rename(mFilePath + "." + QString::number(i), mFilePath + "." + QString::number(i + 1));
+      QFile::rename(mFilePath, mFilePath + ".1");
+   }
+   open();
 }
 
 //! debugger sink
@@ -70,9 +322,9 @@ void DebugOutputDestination::write(const QString& message)
    QsDebugOutput::output(message);
 }
 
-DestinationPtr DestinationFactory::MakeFileDestination(const QString& filePath)
+DestinationPtr DestinationFactory::MakeFileDestination(const QString& filePath, qint64 maxFileSize, int maxBackups)
 {
-   return DestinationPtr(new FileDestination(filePath));
+   return DestinationPtr(new FileDestination(filePath, maxFileSize, maxBackups));
 }
 
 DestinationPtr DestinationFactory::MakeDebugOutputDestination()
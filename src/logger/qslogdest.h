@@ -27,6 +27,7 @@
 #define QSLOGDEST_H
 
 #include <memory>
+#include <QtGlobal>
 class QString;
 
 namespace QsLogging
@@ -37,6 +38,10 @@ class Destination
 public:
    virtual ~Destination(){}
    virtual void write(const QString& message) = 0;
+   //! Blocks until all messages written so far have reached their target.
+   virtual void flush() {}
+   //! Thread safe destinations are written to without holding the logger mutex.
+   virtual bool isThreadSafe() const { return false; }
 };
 
 #if __cplusplus < 201103L
@@ -50,7 +55,11 @@ typedef std::unique_ptr<Destination> DestinationPtr;
 class DestinationFactory
 {
 public:
-   static DestinationPtr MakeFileDestination(const QString& filePath);
+   //! The file destination is asynchronous: messages are queued in a lock free
+   //! ring buffer and written in batches by a background thread. If maxFileSize
+   //! is > 0 the file is rotated once it grows past it, keeping maxBackups old
+   //! files (filePath.1 is the newest).
+   static DestinationPtr MakeFileDestination(const QString& filePath, qint64 maxFileSize = 0, int maxBackups = 3);
    static DestinationPtr MakeDebugOutputDestination();
 };
 
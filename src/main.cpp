@@ -294,8 +294,12 @@ int main(int argc, char *argv[]) {
 
     // activate logging in file
     QString logPath = global.fileManager.getMainLogFileName();
+    global.settings->beginGroup(INI_GROUP_DEBUGGING);
+    qint64 logMaxSize = global.settings->value("logMaxSizeMB", 0).toLongLong() * 1024 * 1024;
+    int logMaxBackups = global.settings->value("logMaxBackups", 3).toInt();
+    global.settings->endGroup();
     QsLogging::DestinationPtr fileDestination(
-            QsLogging::DestinationFactory::MakeFileDestination(logPath));
+            QsLogging::DestinationFactory::MakeFileDestination(logPath, logMaxSize, logMaxBackups));
     logger.addDestination(fileDestination.get());
 
     // from now on logging goes also to log file (up to here only to terminal)
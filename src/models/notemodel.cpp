@@ -21,6 +21,8 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #include "src/logger/qslog.h"
 #include "src/global.h"
 #include "src/sql/nsqlquery.h"
+#include "src/filters/filterengine.h"
+#include "src/filters/notesnippets.h"
 
 #include <QString>
 #include <QSqlDatabase>
@@ -185,6 +187,14 @@ QVariant NoteModel::data(const QModelIndex &index, int role) const {
     int column = index.column();
     //QLOG_DEBUG() << "Request for note data at row=" << row << " col=" << column << " role=" << role;
 
+    // snippet - computed only when the column is shown, for the rows in view
+    if (column == NOTE_TABLE_SNIPPET_POSITION) {
+        if (role == Qt::DisplayRole)
+            return snippet(index);
+        if (role == Qt::ToolTipRole)
+            return NoteSnippets::plainText(snippet(index).toString());
+    }
+
     // title compound - later this can be made configurable; and we can also adjust painting
     if ((role == Qt::DisplayRole) && (column == NOTE_TABLE_TITLE_POSITION)) {
         bool isDirty = index.sibling(row, NOTE_TABLE_IS_DIRTY_POSITION).data(Qt::DisplayRole).toBool();
@@ -195,8 +205,8 @@ QVariant NoteModel::data(const QModelIndex &index, int role) const {
         }
     }
     if ((role == Qt::FontRole) && (column == NOTE_TABLE_TITLE_POSITION)) {
-        int relevance = index.sibling(row, NOTE_TABLE_SEARCH_RELEVANCE_POSITION).data(Qt::DisplayRole).toInt();
-        if (relevance > 0) {
+        qint32 lid = index.sibling(row, NOTE_TABLE_LID_POSITION).data(Qt::DisplayRole).toInt();
+        if (searchHits.contains(lid)) {
             QFont font;
             font.setBold(true);
             return font;
@@ -228,6 +238,43 @@ QVariant NoteModel::data(const QModelIndex &index, int role) const {
 
 bool NoteModel::select() {
     QLOG_DEBUG() << "Performing NoteModel select " << selectStatement();
+    snippets.clear();
+    searchHits.clear();
+    NSqlQuery sql(global.db);
+    sql.exec("select lid from filter where hit");
+    while (sql.next())
+        searchHits.insert(sql.value(0).toInt());
+    sql.finish();
     return QSqlTableModel::select();
 }
 
+
+// The snippets of the rows around the one asked for are looked up in one
+// query, so scrolling costs a query per SNIPPET_BATCH rows.
+QVariant NoteModel::snippet(const QModelIndex &index) const {
+    if (global.filterPosition < 0 || global.filterPosition >= global.filterCriteria.size())
+        return QVariant();
+    FilterCriteria *criteria = global.getCurrentCriteria();
+    if (!criteria->isSearchStringSet() || criteria->getSearchString() == "")
+        return QVariant();
+    if (criteria->getSearchString() != snippetSearch) {
+        snippets.clear();
+        snippetSearch = criteria->getSearchString();
+    }
+
+    qint32 lid = sourceData(this->index(index.row(), NOTE_TABLE_LID_POSITION), Qt::DisplayRole).toInt();
+    if (!snippets.contains(lid)) {
+        QList<qint32> lids;
+        int first = qMax(0, index.row() - SNIPPET_BATCH/2);
+        int last = qMin(rowCount(), first + SNIPPET_BATCH);
+        for (int row=first; row<last; row++) {
+            qint32 rowLid = sourceData(this->index(row, NOTE_TABLE_LID_POSITION), Qt::DisplayRole).toInt();
+            if (!snippets.contains(rowLid))
+                lids.append(rowLid);
+        }
+        FilterEngine engine;
+        engine.noteSnippets(lids, snippetSearch, snippets);
+    }
+    return snippets.value(lid);
+}
+
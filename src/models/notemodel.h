@@ -21,12 +21,22 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #define NOTEMODEL_H
 
 #include <QSqlTableModel>
+#include <QHash>
+#include <QSet>
 #include "src/sql/databaseconnection.h"
 
+// Rows around the one asked for whose snippets are looked up together
+#define SNIPPET_BATCH 50
+
 class NoteModel : public QSqlTableModel
 {
     Q_OBJECT
 private:
+    mutable QHash<qint32, QString> snippets;    // by note lid, until the next select
+    mutable QString snippetSearch;              // search string of the snippets
+    QSet<qint32> searchHits;                    // notes with a search word in the title or a tag, shown in bold
+    QVariant snippet(const QModelIndex &index) const;
+
 public:
     explicit NoteModel(QObject *parent = 0);
     ~NoteModel();
@@ -30,6 +30,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #include "src/dialog/faderdialog.h"
 #include "src/dialog/shortcutdialog.h"
 #include "src/utilities/noteindexer.h"
+#include "src/sql/searchindextable.h"
 
 #include <QApplication>
 #include <QThread>
@@ -89,6 +90,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #include "src/xml/importenex.h"
 #include "src/xml/exportdata.h"
 #include "src/dialog/aboutdialog.h"
+#include "src/utilities/metrics.h"
 
 #include "src/qevercloud/QEverCloud/headers/QEverCloud.h"
 #include "src/qevercloud/QEverCloud/headers/QEverCloudOAuth.h"
@@ -144,6 +146,16 @@ NixNote::NixNote(QWidget *parent) : QMainWindow(parent) {
     counterThread.start(QThread::LowestPriority);
     syncThread.start(QThread::LowPriority);
     indexThread.start(QThread::LowestPriority);
+    // The save thread must be available before the first editor window is built,
+    // so it is moved right away rather than waiting for the started() signal.
+    browserRunner.moveToThread(&browserThread);
+    global.browserRunner = &browserRunner;
+    browserThread.start(QThread::NormalPriority);
+    qRegisterMetaType< QList<qint32> >("QList<qint32>");
+    qRegisterMetaType< QList<double> >("QList<double>");
+    qRegisterMetaType< QList<bool> >("QList<bool>");
+    searchRunner.moveToThread(&searchThread);
+    searchThread.start(QThread::LowPriority);
     this->thread()->setPriority(QThread::HighestPriority);
 
     heartbeatTimer.setInterval(1000);
@@ -151,6 +163,16 @@ NixNote::NixNote(QWidget *parent) : QMainWindow(parent) {
     connect(&heartbeatTimer, SIGNAL(timeout()), this, SLOT(heartbeatTimerTriggered()));
     heartbeatTimer.start();
 
+    // Periodic metrics snapshot.  An interval of 0 disables it.
+    global.settings->beginGroup(INI_GROUP_DEBUGGING);
+    int metricsInterval = global.settings->value("metricsSnapshotMinutes", 10).toInt();
+    global.settings->endGroup();
+    if (metricsInterval > 0) {
+        metricsTimer.setInterval(metricsInterval * 60 * 1000);
+        connect(&metricsTimer, SIGNAL(timeout()), this, SLOT(writeMetricsSnapshot()));
+        metricsTimer.start();
+    }
+
     this->setFont(global.getGuiFont(this->font()));
 
     db = new DatabaseConnection(NN_DB_CONNECTION_NAME);  // Startup the database
@@ -174,6 +196,10 @@ NixNote::NixNote(QWidget *parent) : QMainWindow(parent) {
     connect(this, SIGNAL(syncRequested()), &syncRunner, SLOT(synchronize()));
     connect(&syncRunner, SIGNAL(setMessage(QString, int)), this, SLOT(setMessage(QString, int)));
 
+    // Setup the thumbnail generator.  It is shared by all editor windows.
+    hammer = new Thumbnailer(global.db);
+    global.thumbnailer = hammer;
+
     QLOG_DEBUG() << "Setting up GUI";
     global.filterPosition = 0;
     this->setupGui();
@@ -188,24 +214,34 @@ NixNote::NixNote(QWidget *parent) : QMainWindow(parent) {
     connect(attributeTree, SIGNAL(updateSelectionRequested()), this, SLOT(updateSelectionCriteria()));
     connect(trashTree, SIGNAL(updateSelectionRequested()), this, SLOT(updateSelectionCriteria()));
     connect(searchText, SIGNAL(updateSelectionRequested()), this, SLOT(updateSelectionCriteria()));
+    connect(searchText, SIGNAL(liveSearchRequested(QString)), this, SLOT(liveSearchRequested(QString)));
+    connect(this, SIGNAL(liveSearchBase(QString)), &searchRunner, SLOT(setBase(QString)));
+    connect(this, SIGNAL(liveSearch(qint32, QString)), &searchRunner, SLOT(search(qint32, QString)));
+    connect(&searchRunner, SIGNAL(results(qint32, QList<qint32>, QList<double>, QList<bool>)),
+            this, SLOT(liveSearchResults(qint32, QList<qint32>, QList<double>, QList<bool>)));
     connect(global.resourceWatcher, SIGNAL(fileChanged(QString)), this, SLOT(resourceExternallyUpdated(QString)));
 
     finalSync = false;
+    liveSearchBaseSet = false;
+    liveSearchShown = 0;
 
 
     // Setup reminders
     global.reminderManager = new ReminderManager();
     connect(global.reminderManager, SIGNAL(showMessage(QString, QString, int)), this,
             SLOT(showMessage(QString, QString, int)));
-    global.reminderManager->reloadTimers();
 
+    // Reminders which came due while we were not running are shown by the
+    // first check unless they are to be skipped.
     global.settings->beginGroup(INI_GROUP_APPEARANCE);
     bool showMissed = global.settings->value("showMissedReminders", false).toBool();
     global.settings->endGroup();
-    if (showMissed)
-        QTimer::singleShot(5000, global.reminderManager, SLOT(timerPop()));
-    else
+    if (!showMissed)
         global.setLastReminderTime(QDateTime::currentMSecsSinceEpoch());
+    global.reminderManager->reloadTimers();
+
+    // Catch up on thumbnails for notes synced or imported in an earlier session
+    QTimer::singleShot(10000, this, SLOT(backfillThumbnails()));
 
 
     // Check for Java and verify encryption works
@@ -254,9 +290,15 @@ NixNote::~NixNote() {
     syncThread.quit();
     indexThread.quit();
     counterThread.quit();
+    searchRunner.cancel();
+    searchThread.quit();
     while (!syncThread.isFinished());
     while (!indexThread.isFinished());
     while (!counterThread.isFinished());
+    while (!searchThread.isFinished());
+
+    global.thumbnailer = nullptr;
+    delete hammer;
 
     // Cleanup any temporary files
     if (global.purgeTemporaryFilesOnShutdown) {
@@ -607,6 +649,7 @@ void NixNote::setupGui() {
 
     QLOG_DEBUG() << "Setting up more connections for tab windows & threads";
     connect(&syncRunner, SIGNAL(syncComplete()), this, SLOT(notifySyncComplete()));
+    connect(&syncRunner, SIGNAL(syncComplete()), this, SLOT(backfillThumbnails()));
 
     // connect so we refresh the note list and counts whenever a note has changed
     connect(tabWindow, SIGNAL(noteUpdated(qint32)), noteTableView, SLOT(refreshData()));
@@ -1181,11 +1224,18 @@ void NixNote::saveOnExit() {
     QLOG_DEBUG() << "saveOnExit: Saving contents";
     saveContents();
 
+    QLOG_DEBUG() << "saveOnExit: Writing pending note saves";
+    QMetaObject::invokeMethod(&browserRunner, "flush", Qt::BlockingQueuedConnection);
+
     QLOG_DEBUG() << "saveOnExit: Shutting down threads";
     indexRunner.keepRunning = false;
     counterRunner.keepRunning = false;
+    browserRunner.keepRunning = false;
     QCoreApplication::processEvents();
 
+    metricsTimer.stop();
+    writeMetricsSnapshot();
+
     QLOG_DEBUG() << "Saving window states";
     ConfigStore config(global.db);
     config.saveSetting(CONFIG_STORE_WINDOW_STATE, saveState());
@@ -1404,6 +1454,8 @@ void NixNote::saveNoteColumnPositions() {
     global.setColumnPosition("noteTableThumbnailPosition", position);
     position = noteTableView->horizontalHeader()->visualIndex(NOTE_TABLE_SEARCH_RELEVANCE_POSITION);
     global.setColumnPosition("noteTableRelevancePosition", position);
+    position = noteTableView->horizontalHeader()->visualIndex(NOTE_TABLE_SNIPPET_POSITION);
+    global.setColumnPosition("noteTableSnippetPosition", position);
 }
 
 
@@ -1460,6 +1512,8 @@ void NixNote::saveNoteColumnWidths() {
     global.setColumnWidth("noteTableThumbnailPosition", width);
     width = noteTableView->columnWidth(NOTE_TABLE_SEARCH_RELEVANCE_POSITION);
     global.setColumnWidth("noteTableRelevancePosition", width);
+    width = noteTableView->columnWidth(NOTE_TABLE_SNIPPET_POSITION);
+    global.setColumnWidth("noteTableSnippetPosition", width);
 }
 
 
@@ -1684,16 +1738,11 @@ void NixNote::updateSelectionCriteria(bool afterSync) {
 
     tabWindow->currentBrowser()->saveNoteContent();
 
-    // Invalidate the cache
-    QDir dir(global.fileManager.getTmpDirPath());
-    QFileInfoList files = dir.entryInfoList();
+    // Drop any live search, the next one starts from the new criteria
+    searchRunner.cancel();
+    liveSearchBaseSet = false;
 
-    for (int i = 0; i < files.size(); i++) {
-        if (files[i].fileName().endsWith("_icon.png")) {
-            QFile file(files[i].absoluteFilePath());
-            file.remove();
-        }
-    }
+    // Invalidate the cache
     QList<qint32> keys = global.cache.keys();
     for (int i = 0; i < keys.size(); i++) {
         global.cache.remove(keys[i]);
@@ -1767,6 +1816,53 @@ void NixNote::updateSelectionCriteria(bool afterSync) {
 }
 
 
+//*****************************************************
+//* Search while the search text is typed.  The search
+//* runs over the notes the search box would search
+//* (see LineEdit::buildSelection), which the search
+//* runner selects once for each round of typing.
+//*****************************************************
+void NixNote::liveSearchRequested(QString text) {
+    if (!liveSearchBaseSet) {
+        FilterCriteria criteria;
+        searchText->copyCriteria(global.getCurrentCriteria(), &criteria);
+        emit liveSearchBase(FilterEngine::searchBaseSql(&criteria));
+        liveSearchBaseSet = true;
+    }
+    emit liveSearch(searchRunner.request(), text);
+}
+
+
+//*****************************************************
+//* Show the results of a live search.  The first page
+//* replaces the note list, the rest is added to it.
+//*****************************************************
+void NixNote::liveSearchResults(qint32 id, QList<qint32> lids, QList<double> relevance, QList<bool> hits) {
+    if (id != searchRunner.latestId())
+        return;
+    bool firstPage = id != liveSearchShown;
+    liveSearchShown = id;
+
+    NSqlQuery sql(global.db);
+    sql.exec("begin");
+    if (firstPage)
+        sql.exec("delete from filter");
+    sql.prepare("insert into filter (lid, relevance, hit) values (:lid, :relevance, :hit)");
+    for (int i=0; i<lids.size(); i++) {
+        sql.bindValue(":lid", lids[i]);
+        sql.bindValue(":relevance", relevance[i]);
+        sql.bindValue(":hit", hits[i]);
+        sql.exec();
+    }
+    sql.exec("commit");
+    sql.finish();
+
+    noteTableView->refreshData();
+    if (firstPage)
+        noteTableView->scrollToTop();
+}
+
+
 //******************************************************************
 //* Check if the notebook selected is read-only.  With
 //* read-only notes the editor and a lot of actions are disabled.
@@ -1848,7 +1944,7 @@ void NixNote::exportNotes(bool exportAllNotes) {
     else
         directory = saveLastPath;
 
-    QFileDialog fd(0, caption, directory, tr(APP_NNEX_APP_NAME " Export (*.nnex);;All Files (*.*)"));
+    QFileDialog fd(0, caption, directory, tr(APP_NNEX_APP_NAME " Export (*.nnex);;Compressed " APP_NNEX_APP_NAME " Export (*.nnex.gz);;All Files (*.*)"));
     fd.setFileMode(QFileDialog::AnyFile);
     fd.setConfirmOverwrite(true);
     fd.setAcceptMode(QFileDialog::AcceptSave);
@@ -1868,8 +1964,11 @@ void NixNote::exportNotes(bool exportAllNotes) {
 
     setMessage(tr("Performing export"));
 
-    if (!fileNames[0].endsWith(".nnex")) {
-        fileNames[0].append(".nnex");
+    if (!fileNames[0].endsWith(".nnex") && !fileNames[0].endsWith(".nnex.gz")) {
+        if (fd.selectedNameFilter().contains("*.nnex.gz"))
+            fileNames[0].append(".nnex.gz");
+        else
+            fileNames[0].append(".nnex");
     }
     noteReader.backupData(fileNames[0]);
 
@@ -1919,10 +2018,10 @@ void NixNote::importNotes(bool fullRestore) {
 
     if (fullRestore) {
         caption = tr("Import all notes");
-        filter = tr(APP_NNEX_APP_NAME " Export (*.nnex);;All Files (*.*)");
+        filter = tr(APP_NNEX_APP_NAME " Export (*.nnex *.nnex.gz);;All Files (*.*)");
     } else {
         caption = tr("Import notes");
-        filter = tr(APP_NNEX_APP_NAME " Export (*.nnex);;Evernote Export (*.enex);;All Files (*.*)");
+        filter = tr(APP_NNEX_APP_NAME " Export (*.nnex *.nnex.gz);;Evernote Export (*.enex);;All Files (*.*)");
     }
 
     if (saveLastPath == "")
@@ -1950,9 +2049,12 @@ void NixNote::importNotes(bool fullRestore) {
 
     setMessage(tr("Importing notes"));
 
-    if (fileNames[0].endsWith(".nnex") || fullRestore) {
+    if (fileNames[0].endsWith(".nnex") || fileNames[0].endsWith(".nnex.gz") || fullRestore) {
         ImportData noteReader(fullRestore);
-        noteReader.import(fileNames[0]);
+        if (fullRestore)
+            noteReader.importChain(fileNames[0]);
+        else
+            noteReader.import(fileNames[0]);
 
         if (noteReader.lastError != 0) {
             setMessage(noteReader.getErrorMessage());
@@ -2619,6 +2721,23 @@ void NixNote::findReplaceAllInNotePressed() {
 //* This queries the shared memory segment at occasional
 //* intervals.  This is useful for cross-program communication.
 //**************************************************************
+// Write the current performance metrics to the logs directory.  Values
+// that are only known here (queue depths) are sampled first.
+void NixNote::writeMetricsSnapshot() {
+    Metrics &metrics = Metrics::instance();
+    metrics.gauge("browser.saveQueueDepth")->set(browserRunner.getQueueDepth());
+    metrics.gauge("browser.saveMaxLatencyMs")->set(browserRunner.getMaxLatency());
+    if (hammer != nullptr)
+        metrics.gauge("thumbnail.queueSize")->set(hammer->getQueueSize());
+
+    QJsonObject info;
+    info["version"] = global.fileManager.getProgramVersion();
+    QString filename = global.fileManager.getMetricsFileName();
+    if (!metrics.writeSnapshot(filename, info))
+        QLOG_WARN() << "Unable to write metrics snapshot " << filename;
+}
+
+
 void NixNote::heartbeatTimerTriggered() {
     QByteArray data = global.sharedMemory->read();
 
@@ -2716,6 +2835,20 @@ void NixNote::heartbeatTimerTriggered() {
         alter.unwrap(xml);
         alter.alterNote();
         updateSelectionCriteria();
+    } else if (data.startsWith("DUMP_METRICS:")) {
+        QLOG_INFO() << "DUMP_METRICS requested by shared memory segment.";
+        QString returnUuid = QString(data.mid(13).constData()).trimmed();
+        writeMetricsSnapshot();
+        QFile file(global.fileManager.getMetricsFileName());
+        if (!file.open(QIODevice::ReadOnly))
+            return;
+        QByteArray reply = file.readAll();
+        file.close();
+        CrossMemoryMapper responseMapper(returnUuid);
+        if (!responseMapper.attach())
+            return;
+        responseMapper.write(reply);
+        responseMapper.detach();
     } else if (data.startsWith("READ_NOTE:")) {
         QLOG_INFO() << "READ_NOTE requested by shared memory segment.";
         QString xml = data.mid(10);
@@ -3186,6 +3319,9 @@ void NixNote::reindexDatabase() {
     if (response != QMessageBox::Yes)
         return;
 
+    // Forget what was indexed, so nothing is skipped as unchanged
+    SearchIndexTable searchIndex(global.db);
+    searchIndex.clearHashes();
     NoteTable ntable(global.db);
     ResourceTable rtable(global.db);
     rtable.reindexAllResources();
@@ -3195,6 +3331,36 @@ void NixNote::reindexDatabase() {
 }
 
 
+// Regenerate every thumbnail, even the ones built from the current content
+void NixNote::rebuildThumbnails() {
+    if (global.disableThumbnails || hammer == nullptr)
+        return;
+
+    NoteTable ntable(global.db);
+    ntable.rebuildAllThumbnails();
+    QList<qint32> lids;
+    ntable.getThumbnailsNeeded(lids);
+    for (int i=0; i<lids.size(); i++)
+        hammer->invalidate(lids[i]);
+    hammer->requestThumbnail(lids);
+
+    setMessage(tr("Thumbnails will be rebuilt."));
+}
+
+
+// Queue the notes which were added or changed outside of an editor (i.e. by a
+// sync or an import) and still have no current thumbnail.
+void NixNote::backfillThumbnails() {
+    if (global.disableThumbnails || hammer == nullptr)
+        return;
+
+    NoteTable ntable(global.db);
+    QList<qint32> lids;
+    ntable.getThumbnailsNeeded(lids);
+    hammer->requestThumbnail(lids);
+}
+
+
 // Open/Close selected notebooks
 void NixNote::openCloseNotebooks() {
     CloseNotebookDialog dialog;
@@ -3210,12 +3376,14 @@ void NixNote::openCloseNotebooks() {
 void NixNote::reindexCurrentNote() {
     tabWindow->currentBrowser()->saveNoteContent();
 
-    NoteIndexer indexer(global.db);
-    indexer.indexNote(tabWindow->currentBrowser()->lid);
-
     ResourceTable rtable(global.db);
     QList<qint32> rlids;
     rtable.getResourceList(rlids, tabWindow->currentBrowser()->lid);
+    SearchIndexTable searchIndex(global.db);
+    searchIndex.clearHashes(QList<qint32>(rlids) << tabWindow->currentBrowser()->lid);
+
+    NoteIndexer indexer(global.db);
+    indexer.indexNote(tabWindow->currentBrowser()->lid);
     for (int i = 0; i < rlids.size(); i++) {
         indexer.indexResource(rlids[i]);
     }
@@ -3408,6 +3576,7 @@ void NixNote::reloadIcons() {
             global.settings->remove("themeName");
         global.settings->endGroup();
         global.loadTheme(global.resourceList, global.colorList, newThemeName);
+        AttachmentIconBuilder::clearCache();
     }
 
     const auto wIcon = QIcon(global.getIconResource(":windowIcon"));
@@ -51,6 +51,8 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #include "src/gui/ntrashtree.h"
 #include "src/dialog/accountdialog.h"
 #include "src/threads/counterrunner.h"
+#include "src/threads/browserrunner.h"
+#include "src/threads/searchrunner.h"
 #include "src/html/thumbnailer.h"
 #include "src/reminders/remindermanager.h"
 
@@ -68,6 +70,7 @@ class NixNote;
 class SyncRunner;
 class IndexRunner;
 class CounterRunner;
+class BrowserRunner;
 class NTabWidget;
 class Thumbnailer;
 class NTableView;
@@ -104,6 +107,8 @@ private:
     QVBoxLayout *topRightLayout;
     NAttributeTree *attributeTree;
     bool finalSync;
+    bool liveSearchBaseSet;     // the search runner has the notes to search for this round of typing
+    qint32 liveSearchShown;     // id of the live search in the filter table
     QSystemTrayIcon *trayIcon;
     QString saveLastPath;   // Last path viewed in the restore dialog
     FileWatcherManager *importManager;
@@ -141,6 +146,9 @@ private:
 
     // Timer to check shared memory for other instance commands
     QTimer heartbeatTimer;
+
+    // Timer to write the periodic performance metrics snapshot
+    QTimer metricsTimer;
     QNetworkAccessManager *networkManager;
     QSplashScreen *splashScreen;
     QString clientId;
@@ -196,8 +204,12 @@ public:
     QThread syncThread;
     QThread indexThread;
     QThread counterThread;
+    QThread browserThread;
+    QThread searchThread;
     IndexRunner indexRunner;
     CounterRunner counterRunner;
+    BrowserRunner browserRunner;
+    SearchRunner searchRunner;
     void closeEvent(QCloseEvent *event);
     //bool notify(QObject* receiver, QEvent* event);
     bool event(QEvent *event);
@@ -264,6 +276,7 @@ public slots:
     void findReplaceWindowHidden();
     void checkReadOnlyNotebook();
     void heartbeatTimerTriggered();
+    void writeMetricsSnapshot();
     void notesRestored(QList<qint32>);
     void emailNote();
     void printNote();
@@ -279,6 +292,8 @@ public slots:
     void viewNoteListNarrow();
     void resourceExternallyUpdated(QString resource);
     void reindexDatabase();
+    void rebuildThumbnails();
+    void backfillThumbnails();
     void noteSynchronized(qint32 lid, bool value);
     void indexThreadStarted();
     void syncThreadStarted();
@@ -304,10 +319,14 @@ public slots:
     void onExportAsPdf();
     void saveOnExit();
     void onTrayActivated(QSystemTrayIcon::ActivationReason reason);
+    void liveSearchRequested(QString text);
+    void liveSearchResults(qint32 id, QList<qint32> lids, QList<double> relevance, QList<bool> hits);
 
 signals:
     void syncRequested();
     void updateCounts();
+    void liveSearchBase(QString select);
+    void liveSearch(qint32 id, QString searchString);
 
 
 };
@@ -51,27 +51,39 @@ void StringUtilsPrivate::removeDiacritics(QString & str) const
     str = str.normalized(QString::NormalizationForm_KD);
     //QNTRACE(QStringLiteral("str after normalizing by KD form: ") << str);
 
-    for(int i = 0; i < str.length(); ++i)
+    // Built in one pass: combining marks (all above the table) are dropped
+    // and the letters of the table are replaced by a lookup of their code.
+    QString result;
+    result.reserve(str.length());
+    const QChar * data = str.constData();
+    for(int i = 0, length = str.length(); i < length; ++i)
     {
-        QChar currentCharacter = str[i];
+        QChar currentCharacter = data[i];
+        ushort code = currentCharacter.unicode();
+        if (code < DiacriticTableSize)
+        {
+            int diacriticIndex = m_diacriticIndex[code];
+            if (diacriticIndex < 0) {
+                result.append(currentCharacter);
+            }
+            else {
+                result.append(m_noDiacriticLetters[diacriticIndex]);
+            }
+            continue;
+        }
+
         QChar::Category category = currentCharacter.category();
         if ( (category == QChar::Mark_NonSpacing) ||
              (category == QChar::Mark_SpacingCombining) ||
              (category == QChar::Mark_Enclosing) )
         {
-            str.remove(i, 1);
-            continue;
-        }
-
-        int diacriticIndex = m_diacriticLetters.indexOf(currentCharacter);
-        if (diacriticIndex < 0) {
             continue;
         }
 
-        const QString & replacement = m_noDiacriticLetters[diacriticIndex];
-        str.replace(i, 1, replacement);
+        result.append(currentCharacter);
     }
 
+    str = result;
     //QNTRACE(QStringLiteral("str after removing diacritics: ") << str);
 }
 
@@ -102,6 +114,13 @@ void StringUtilsPrivate::initialize()
                          << QStringLiteral("o") << QStringLiteral("o") << QStringLiteral("o") << QStringLiteral("u")
                          << QStringLiteral("u") << QStringLiteral("u") << QStringLiteral("u") << QStringLiteral("y")
                          << QStringLiteral("y");
+
+    for(int i = 0; i < DiacriticTableSize; ++i) {
+        m_diacriticIndex[i] = -1;
+    }
+    for(int i = 0; i < m_diacriticLetters.size(); ++i) {
+        m_diacriticIndex[m_diacriticLetters[i].unicode()] = static_cast<qint8>(i);
+    }
 }
 
 } // namespace quentier
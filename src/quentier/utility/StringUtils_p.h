@@ -38,8 +38,14 @@ private:
     void initialize();
 
 private:
+    // All letters of m_diacriticLetters are below this code
+    enum { DiacriticTableSize = 0x180 };
+
     QString     m_diacriticLetters;
     QStringList m_noDiacriticLetters;
+
+    // Index in m_noDiacriticLetters by character code, -1 if kept as is
+    qint8       m_diacriticIndex[DiacriticTableSize];
 };
 
 } // namespace quentier
@@ -19,44 +19,14 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 
 
 #include "reminderevent.h"
-#include "src/global.h"
 
-#include <QDateTime>
-
-ReminderEvent::ReminderEvent(QObject *parent) :
-    QObject(parent)
-{
-    timer.setSingleShot(true);
-}
-
-
-bool ReminderEvent::setTimer(qint32 lid, QDateTime time) {
-    this->lid = lid;
-    this->time = time.currentMSecsSinceEpoch();
-    QDateTime now = QDateTime::currentDateTime();
-    int interval = (now.secsTo(time)+1)*1000;
-    if (interval>0) {
-        timer.stop();
-        timer.start(interval);
-        return true;
-    }
-    return false;
+ReminderEvent::ReminderEvent() {
+    lid = 0;
+    time = 0;
 }
 
 
-
-bool ReminderEvent::setTimer(qint32 lid, qlonglong time) {
+ReminderEvent::ReminderEvent(qint32 lid, qlonglong time) {
     this->lid = lid;
     this->time = time;
-    QDateTime now = QDateTime::currentDateTime();
-    qlonglong interval = time - now.currentMSecsSinceEpoch();
-    if (interval>0) {
-        timer.start(interval);
-        return true;
-    }
-    return false;
-}
-
-void ReminderEvent::stopTimer() {
-    timer.stop();
 }
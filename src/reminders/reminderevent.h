@@ -20,26 +20,17 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #ifndef REMINDEREVENT_H
 #define REMINDEREVENT_H
 
-#include <QObject>
-#include <QTimer>
-#include <QDateTime>
+#include <QtGlobal>
 
-class ReminderEvent : public QObject
+// A reminder waiting to fire.  These are kept in the ReminderManager's heap,
+// ordered by time; they no longer own a timer.
+class ReminderEvent
 {
-    Q_OBJECT
 public:
-    explicit ReminderEvent(QObject *parent = 0);
+    ReminderEvent();
+    ReminderEvent(qint32 lid, qlonglong time);
     qint32 lid;
-    QTimer timer;
-    qlonglong time;
-    bool setTimer(qint32 lid, QDateTime time);
-    bool setTimer(qint32 lid, qlonglong time);
-    void stopTimer();
-    
-signals:
-    
-public slots:
-    
+    qlonglong time;     // msecs since the epoch
 };
 
 #endif // REMINDEREVENT_H
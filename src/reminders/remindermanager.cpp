@@ -24,31 +24,124 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 
 extern Global global;
 
+// Longest single wait.  QTimer takes an int, so reminders further away
+// than this are reached in steps.
+#define REMINDER_MAX_INTERVAL (24*60*60*1000)
+
 ReminderManager::ReminderManager(QObject *parent) :
     QObject(parent)
 {
+    timer.setSingleShot(true);
+    connect(&timer, SIGNAL(timeout()), this, SLOT(timerPop()));
 }
 
 
-void ReminderManager::reloadTimers() {
-    for (int i=reminders.size()-1; i>=0; i--) {
-        delete reminders[i];
+void ReminderManager::swapEntries(int i, int j) {
+    ReminderEvent temp = heap[i];
+    heap[i] = heap[j];
+    heap[j] = temp;
+    position.insert(heap[i].lid, i);
+    position.insert(heap[j].lid, j);
+}
+
+
+void ReminderManager::siftUp(int i) {
+    while (i > 0) {
+        int parent = (i-1)/2;
+        if (heap[parent].time <= heap[i].time)
+            return;
+        swapEntries(i, parent);
+        i = parent;
+    }
+}
+
+
+void ReminderManager::siftDown(int i) {
+    int size = heap.size();
+    while (true) {
+        int smallest = i;
+        int left = 2*i+1;
+        int right = left+1;
+        if (left < size && heap[left].time < heap[smallest].time)
+            smallest = left;
+        if (right < size && heap[right].time < heap[smallest].time)
+            smallest = right;
+        if (smallest == i)
+            return;
+        swapEntries(i, smallest);
+        i = smallest;
+    }
+}
+
+
+// Add a reminder or move an existing one to a new time
+void ReminderManager::push(qint32 lid, qlonglong time) {
+    if (position.contains(lid)) {
+        int i = position[lid];
+        qlonglong old = heap[i].time;
+        heap[i].time = time;
+        if (time < old)
+            siftUp(i);
+        else
+            siftDown(i);
+        return;
+    }
+    heap.append(ReminderEvent(lid, time));
+    position.insert(lid, heap.size()-1);
+    siftUp(heap.size()-1);
+}
+
+
+void ReminderManager::removeAt(int i) {
+    int last = heap.size()-1;
+    position.remove(heap[i].lid);
+    if (i != last) {
+        heap[i] = heap[last];
+        position.insert(heap[i].lid, i);
+    }
+    heap.removeLast();
+    if (i < heap.size()) {
+        siftDown(i);
+        siftUp(i);
     }
+}
+
 
-    ReminderEvent *event = new ReminderEvent();
-    connect(&event->timer, SIGNAL(timeout()), this, SLOT(timerPop()));
+// Arm the timer for the earliest reminder.  If it is already due the timer
+// fires right away and checkReminders() decides (by the last reminder time)
+// whether it is shown or dropped as missed.
+void ReminderManager::armTimer() {
+    timer.stop();
+    if (heap.isEmpty())
+        return;
+    qlonglong interval = heap[0].time - QDateTime::currentMSecsSinceEpoch();
+    if (interval < 0)
+        interval = 0;
+    timer.start(static_cast<int>(qMin(interval, static_cast<qlonglong>(REMINDER_MAX_INTERVAL))));
+}
+
+
+void ReminderManager::reloadTimers() {
+    heap.clear();
+    position.clear();
 
     NoteTable ntable(global.db);
     QList< QPair<qint32, qlonglong>* > notes;
     ntable.getAllReminders(&notes);
 
-    for (int i=notes.size() -1; i>=0; i--) {
-        ReminderEvent *event = new ReminderEvent();
-        event->lid = notes[i]->first;
-        connect(&event->timer, SIGNAL(timeout()), this, SLOT(timerPop()));
-        event->setTimer(notes[i]->first, notes[i]->second);
-        reminders.append(event);
+    // Build the heap bottom up, O(n)
+    heap.reserve(notes.size());
+    for (int i=0; i<notes.size(); i++) {
+        if (!position.contains(notes[i]->first)) {
+            position.insert(notes[i]->first, heap.size());
+            heap.append(ReminderEvent(notes[i]->first, notes[i]->second));
+        }
+        delete notes[i];
     }
+    for (int i=heap.size()/2-1; i>=0; i--)
+        siftDown(i);
+
+    armTimer();
 }
 
 
@@ -60,54 +153,36 @@ void ReminderManager::timerPop() {
 void ReminderManager::checkReminders() {
     QString msg;
     NoteTable ntable(global.db);
-    QDateTime now = QDateTime::currentDateTime();
-    for (int i=reminders.size()-1; i>=0; i--) {
-        Note note;
-        ReminderEvent *event;
-        event = reminders[i];
-        if (event->time > global.getLastReminderTime() ||
-                global.getLastReminderTime() == 0) {
-            if (event->time <= now.currentMSecsSinceEpoch()) {
-              ntable.get(note, event->lid, false, false);
-              QString title = note.title;
-              msg = msg+title+"\n";
-              delete reminders[i];
-              reminders.removeAt(i);
-            }
-        } else {
-            if (event->time < global.getLastReminderTime()) {
-                delete reminders[i];
-                reminders.removeAt(i);
-            }
-        }
+    qlonglong now = QDateTime::currentMSecsSinceEpoch();
+    qlonglong lastReminderTime = global.getLastReminderTime();
+
+    // Everything at the top of the heap which is due either fires now or
+    // was already shown before the last check.
+    while (!heap.isEmpty() && heap[0].time <= now) {
+        ReminderEvent event = heap[0];
+        removeAt(0);
+        if (event.time > lastReminderTime || lastReminderTime == 0)
+            msg = msg+ntable.getTitle(event.lid)+"\n";
     }
     if (msg.trimmed() != "")
         emit showMessage(tr("Reminders Due"), msg, 10000);
-    global.setLastReminderTime(now.currentMSecsSinceEpoch());
+    global.setLastReminderTime(now);
+    armTimer();
 }
 
 
 
 void ReminderManager::updateReminder(qint32 lid, QDateTime time) {
-    for (int i=0; i<reminders.size(); i++) {
-        if (reminders[i]->lid == lid) {
-            reminders[i]->setTimer(lid, time);
-            return;
-        }
-    }
-    ReminderEvent *event = new ReminderEvent();
-    event->lid = lid;
-    connect(&event->timer, SIGNAL(timeout()), this, SLOT(timerPop()));
-    event->setTimer(lid, time);
-    reminders.append(event);
+    push(lid, time.toMSecsSinceEpoch());
+    armTimer();
 }
 
 
 void ReminderManager::remove(qint32 lid) {
-    for (int i=reminders.size()-1; i>=0; i--) {
-        if (reminders[i]->lid == lid) {
-            delete reminders[i];
-            reminders.removeAt(i);
-        }
-    }
+    if (!position.contains(lid))
+        return;
+    bool wasFirst = position[lid] == 0;
+    removeAt(position[lid]);
+    if (wasFirst)
+        armTimer();
 }
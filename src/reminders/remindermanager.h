@@ -21,16 +21,31 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #define REMINDERMANAGER_H
 
 #include <QObject>
-#include <QList>
+#include <QVector>
+#include <QHash>
+#include <QTimer>
+#include <QDateTime>
 #include <QSystemTrayIcon>
 
 #include "reminderevent.h"
 
+// Keeps every pending reminder in a binary min-heap keyed by time.  A single
+// timer is armed for the earliest deadline; adding, moving or removing a
+// reminder is O(log n).
 class ReminderManager : public QObject
 {
     Q_OBJECT
 private:
-    QList<ReminderEvent*> reminders;
+    QVector<ReminderEvent> heap;
+    QHash<qint32, int> position;      // lid -> index in the heap
+    QTimer timer;
+
+    void swapEntries(int i, int j);
+    void siftUp(int i);
+    void siftDown(int i);
+    void push(qint32 lid, qlonglong time);
+    void removeAt(int i);
+    void armTimer();
 
 public:
     explicit ReminderManager(QObject *parent = 0);
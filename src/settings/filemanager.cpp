@@ -208,6 +208,11 @@ void FileManager::setupUserDirectories(int accountId) {
     thumbnailDir.setPath(dbDirPath + "t" + NN_DB_DIR_PREFIX + "a");
     createDirOrCheckWriteable(thumbnailDir);
     thumbnailDirPath = slashTerminatePath(thumbnailDir.path());
+
+    // text extracted from attachments, see ExtractedTextCache
+    textCacheDir.setPath(dbDirPath + "x" + NN_DB_DIR_PREFIX + "a");
+    createDirOrCheckWriteable(textCacheDir);
+    textCacheDirPath = slashTerminatePath(textCacheDir.path());
 }
 
 
@@ -401,6 +406,10 @@ QString FileManager::getThumbnailDirPathSpecialChar(QString relativePath) {
     return thumbnailDirPath + toPlatformPathSeparator(relativePath).replace("#", "%23");
 }
 
+QString FileManager::getTextCacheDirPath(QString relativePath) {
+    return textCacheDirPath + toPlatformPathSeparator(relativePath);
+}
+
 QString FileManager::getTranslateFilePath(QString relativePath) {
     return translateDirPath + toPlatformPathSeparator(relativePath);
 }
@@ -69,6 +69,9 @@ private:
     QString thumbnailDirPath;
     QDir thumbnailDir;
 
+    QString textCacheDirPath;
+    QDir textCacheDir;
+
     QString translateDirPath;
     QDir translateDir;
 
@@ -108,6 +111,7 @@ public:
     QString getThumbnailDirPath();
     QString getThumbnailDirPath(QString relativePath);
     QString getThumbnailDirPathSpecialChar(QString relativePath);
+    QString getTextCacheDirPath(QString relativePath);
     QDir getImageDirFile(QString relativePath);
     QString getImageDirPath(QString relativePath);
     QDir getJavaDirFile(QString relativePath);
@@ -129,6 +133,7 @@ public:
     void setupFileAttachmentLogging();
     void deleteTopLevelFiles(QDir dir, bool exitOnFail);
     QString getMainLogFileName() const { return this->getLogsDirPath("") + "messages.log"; }
+    QString getMetricsFileName() const { return this->getLogsDirPath("") + "metrics.json"; }
     QString getLibraryDirPath();
 };
 
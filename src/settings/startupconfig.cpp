@@ -161,6 +161,11 @@ void StartupConfig::printHelp() {
         + QString("  backup <options>                     Backup the NixNote database.\n")
         + QString("     backup options:\n")
         + QString("          --output=<filename>          Output filename.\n")
+        + QString("          --incremental                Only write the notes changed since the last backup.\n")
+        + QString("          --base=<filename>            Backup the incremental backup is based on (default: the last one).\n")
+        + QString("  verifyBackup <options>               Check a backup chain (full + incrementals) against the database.\n")
+        + QString("     verifyBackup options:\n")
+        + QString("          --input=<filename>           Last backup of the chain.\n")
         + QString("  export <options>                     Export notes from NixNote.\n")
         + QString("     export options:\n")
         + QString("          --id=\"<note_ids>\"            Space separated list of note IDs to extract.\n")
@@ -192,6 +197,9 @@ void StartupConfig::printHelp() {
         + QString("          --url=<id>                   In-app or external URL for the Note to open.\n")
         + QString("          --newNote                    Create a new note.\n")
         + QString("          --newExternalNote            Create a new note in an external window.\n")
+        + QString("  dumpMetrics                          Print performance metrics (also --dump-metrics).  If NixNote\n")
+        + QString("                                       is running its live values are shown, otherwise the last\n")
+        + QString("                                       snapshot from the logs directory.\n")
         + QString("  Examples:\n\n")
         + QString("     To start NixNote using a secondary account.\n")
         + QString("     " NN_APP_NAME " --accountId=2\n\n")
@@ -398,6 +406,14 @@ int StartupConfig::init(int argc, char *argv[], bool &guiAvailable) {
             activateCommand(STARTUP_SQLEXEC, true);
             guiAvailable = false;
         }
+        if (parm.startsWith("verifyBackup")) {
+            activateCommand(STARTUP_VERIFYBACKUP, true);
+            guiAvailable = false;
+        }
+        if (parm == "dumpMetrics" || parm == "--dump-metrics") {
+            activateCommand(STARTUP_DUMPMETRICS, true);
+            guiAvailable = false;
+        }
         if (parm.startsWith("signalGui")) {
             activateCommand(STARTUP_SIGNALGUI, true);
             if (signalGui == nullptr) {
@@ -543,6 +559,19 @@ int StartupConfig::init(int argc, char *argv[], bool &guiAvailable) {
                 parm = parm.mid(9);
                 exportNotes->outputFile = parm;
             }
+            if (parm == "--incremental") {
+                exportNotes->incremental = true;
+            }
+            if (parm.startsWith("--base=", Qt::CaseSensitive)) {
+                parm = parm.mid(7);
+                exportNotes->baseFile = parm;
+            }
+        }
+        if (command->at(STARTUP_VERIFYBACKUP)) {
+            if (parm.startsWith("--input=", Qt::CaseSensitive)) {
+                parm = parm.mid(8);
+                verifyBackupFile = parm;
+            }
         }
         if (command->at(STARTUP_READNOTE)) {
             if (parm.startsWith("--id=", Qt::CaseSensitive)) {
@@ -780,5 +809,13 @@ bool StartupConfig::signalOtherGui() {
     return command->at(STARTUP_SIGNALGUI);
 }
 
+bool StartupConfig::dumpMetrics() {
+    return command->at(STARTUP_DUMPMETRICS);
+}
+
+bool StartupConfig::verifyBackup() {
+    return command->at(STARTUP_VERIFYBACKUP);
+}
+
 
 
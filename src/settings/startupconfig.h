@@ -54,7 +54,9 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #define STARTUP_APPENDNOTE 15
 #define STARTUP_SQLEXEC 16
 #define STARTUP_SIGNALGUI 17
-#define STARTUP_OPTION_COUNT 18
+#define STARTUP_DUMPMETRICS 18
+#define STARTUP_VERIFYBACKUP 19
+#define STARTUP_OPTION_COUNT 20
 
 class StartupConfig
 {
@@ -118,7 +120,10 @@ public:
     bool closeNotebook();
     bool import();
     bool signalOtherGui();
+    bool dumpMetrics();
+    bool verifyBackup();
     QString sqlString;
+    QString verifyBackupFile;
     QStringList notebookList;
 
     int init(int argc, char *argv[], bool &guiAvailable);
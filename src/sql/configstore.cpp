@@ -25,6 +25,9 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 
 extern Global global;
 
+QMutex ConfigStore::lidMutex;
+QHash<QString, LidBlock> ConfigStore::lidBlocks;
+
 //**********************
 // Generic constructor.
 //**********************
@@ -96,14 +99,36 @@ void ConfigStore::initTable() {
 
 
 //*******************************************************************
-// Every time we add a new object, we call this to get its unique
-// local ID.  This number never changes
+// Reserve count lids in the DB and return them as a block.  The
+// counter is moved past the whole range before any of it is used, so
+// a crash can only leave a gap, never hand out the same lid twice.
+// This is called without lidMutex: the DB serializes the counter and
+// NSqlQuery may wait a long time for a writer which itself needs a lid.
+// An empty block (next == 0) means nothing could be reserved.
 //*******************************************************************
-qint32 ConfigStore::incrementLidCounter() {
+LidBlock ConfigStore::reserveBlock(qint32 count) {
+    LidBlock block;
     db->lockForWrite();
-
     NSqlQuery sql(db);
-    // Prepare the SQL statement & fetch the row
+
+    // The update and select must not be undone by a caller's rollback
+    // while the lids stay in our block.  If we are already inside
+    // somebody else's transaction only the single lid is taken.
+    bool transaction = db->conn.transaction();
+    if (!transaction)
+        count = 1;
+
+    sql.prepare("Update ConfigStore set value=value+:count where key=:key");
+    sql.bindValue(":count", count);
+    sql.bindValue(":key", CONFIG_STORE_LID);
+    if (!sql.exec()) {
+        QLOG_ERROR() << "Error updating sequence number: " << sql.lastError();
+        sql.finish();
+        if (transaction)
+            db->conn.rollback();
+        db->unlock();
+        return block;
+    }
     sql.prepare("Select value from ConfigStore where key=:key");
     sql.bindValue(":key", CONFIG_STORE_LID);
     if (!sql.exec()) {
@@ -112,25 +137,77 @@ qint32 ConfigStore::incrementLidCounter() {
     if (!sql.next()) {
         QLOG_ERROR() << "Fetch from ConfigStore failure: LID NOT FOUND!!!";
     } else {
-        // Now that we have the next lid, increment the number & save it
-        qint32 sequence = QVariant(sql.value(0)).toInt();
-        sequence++;
-        db->lockForWrite();
-        sql.prepare("Update ConfigStore set value=:lid where key=:key;");
-        sql.bindValue(":lid",sequence);
-        sql.bindValue(":key", CONFIG_STORE_LID);
-        if (!sql.exec()) {
-            QLOG_ERROR() << "Error updating sequence number: " << sql.lastError();
-        }
-        sql.finish();
-        db->unlock();
-
-        // Return the next lid to the caller
-        return sequence;
+        block.last = QVariant(sql.value(0)).toInt();
+        block.next = block.last - count + 1;
     }
     sql.finish();
+    if (transaction && !db->conn.commit()) {
+        QLOG_ERROR() << "Commit of LID reservation failed: " << db->conn.lastError();
+        db->conn.rollback();
+        block = LidBlock();
+    }
     db->unlock();
-    return -1;
+    return block;
+}
+
+
+// Keep whichever of the shared block & a newly reserved one has more
+// lids left.  Another thread may have reserved a block at the same
+// time; the lids of the one dropped are only a gap.  lidMutex must be held.
+void ConfigStore::installBlock(const LidBlock &block) {
+    LidBlock &current = lidBlocks[db->conn.databaseName()];
+    if (block.remaining() > current.remaining())
+        current = block;
+}
+
+
+//*******************************************************************
+// Every time we add a new object, we call this to get its unique
+// local ID.  This number never changes.  Lids are taken from a
+// block reserved in the DB, which is only touched once per
+// LID_BLOCK_SIZE objects.
+//*******************************************************************
+qint32 ConfigStore::incrementLidCounter() {
+    {
+        QMutexLocker locker(&lidMutex);
+        LidBlock &block = lidBlocks[db->conn.databaseName()];
+        if (block.remaining() > 0)
+            return block.next++;
+    }
+
+    LidBlock reserved = reserveBlock(LID_BLOCK_SIZE);
+    if (reserved.remaining() <= 0)
+        return -1;
+    qint32 lid = reserved.next++;
+    QMutexLocker locker(&lidMutex);
+    installBlock(reserved);
+    return lid;
+}
+
+
+//*******************************************************************
+// Used by the bulk paths (import, sync) before they start their own
+// transaction: makes sure the next count lids can be handed out
+// without touching the counter and come from one contiguous range.
+// Whatever is left of the current block is skipped if it is too small.
+//*******************************************************************
+void ConfigStore::reserveLids(qint32 count) {
+    if (count <= 0)
+        return;
+    {
+        QMutexLocker locker(&lidMutex);
+        if (lidBlocks[db->conn.databaseName()].remaining() >= count)
+            return;
+    }
+
+    // Inside a transaction only a single lid can be taken.  Everything
+    // will still work, but one counter update per object again.
+    LidBlock reserved = reserveBlock(qMax(count, LID_BLOCK_SIZE));
+    if (reserved.remaining() < count)
+        QLOG_WARN() << "Only " << reserved.remaining() << " of " << count
+                    << " lids reserved; reserveLids() must be called before the transaction starts";
+    QMutexLocker locker(&lidMutex);
+    installBlock(reserved);
 }
 
 
@@ -21,6 +21,8 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #define CONFIGSTORE_H
 
 #include <QtSql>
+#include <QMutex>
+#include <QHash>
 #include "src/sql/databaseconnection.h"
 
 //*************************************
@@ -34,8 +36,22 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #define CONFIG_STORE_WINDOW_GEOMETRY 1 // The window geometry between runs
 #define CONFIG_STORE_WINDOW_STATE 2 // The window state between runs
 
+// Number of lids reserved from the ConfigStore counter at a time
+#define LID_BLOCK_SIZE 1000
+
 class DatabaseConnection;
 
+// Range of lids already reserved in the DB but not handed out yet
+class LidBlock
+{
+public:
+    LidBlock() : next(0), last(-1) {}
+    qint32 next;
+    qint32 last;
+    qint32 remaining() const { return next > 0 ? last - next + 1 : 0; }
+};
+
+
 // Class used to access & update the table
 class ConfigStore
 {
@@ -43,6 +59,13 @@ private:
     void initTable();           // Initialize a new table
     DatabaseConnection *db;           // DB connection
 
+    // Lids are handed out from blocks shared by every connection of the
+    // process (keyed by database file).
+    static QMutex lidMutex;
+    static QHash<QString, LidBlock> lidBlocks;
+    LidBlock reserveBlock(qint32 count);
+    void installBlock(const LidBlock &block);
+
 public:
     ConfigStore(DatabaseConnection *conn);  // Generic constructor
 
@@ -52,6 +75,7 @@ public:
     // DB Write Functions
     void createTable();               // SQL to create the table
     qint32 incrementLidCounter();     // Get the next LID number
+    void reserveLids(qint32 count);   // Make sure the next count lids come from one contiguous range
     void saveSetting(int key, QByteArray);        // Save a setting
 };
 
@@ -23,6 +23,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #include "src/sql/nsqlquery.h"
 #include "resourcetable.h"
 #include "src/sql/databaseupgrade.h"
+#include "src/sql/searchindextable.h"
 
 
 extern Global global;
@@ -45,8 +46,13 @@ DatabaseConnection::DatabaseConnection(QString connection)
         exit(16);
     }
 
-    if (connection == NN_DB_CONNECTION_NAME)
+    if (connection == NN_DB_CONNECTION_NAME) {
         global.db = this;
+        if (!SearchIndexTable::isSupported(conn)) {
+            QLOG_FATAL() << "SQLite must be built with FTS5 and the trigram tokenizer (SQLite 3.34 or later).";
+            exit(16);
+        }
+    }
     QLOG_TRACE() << "Preparing tables";
     // Start preparing the tables
     configStore = new ConfigStore(this);
@@ -66,6 +72,18 @@ DatabaseConnection::DatabaseConnection(QString connection)
             QLOG_DEBUG() << tempTable.value(0).toString();
         }
 
+        // Outbound change queue, see NoteTable::queueSync()
+        tempTable.exec("create table if not exists SyncQueue (lid integer, type integer, operation integer, "
+                       "notebookLid integer, notebookClass integer, primary key (type, lid))");
+
+        // Hash of what each lid & source of the search index was indexed from, see SearchIndexTable::replace()
+        tempTable.exec("create table if not exists SearchIndexHash (lid integer, source text, hash text, "
+                       "primary key (lid, source))");
+
+        // Rows of the search index by lid & source, see SearchIndexTable::remove()
+        tempTable.exec("create table if not exists SearchIndexRows (row integer primary key, lid integer, source text)");
+        tempTable.exec("create index if not exists SearchIndexRows_Lid on SearchIndexRows (lid, source)");
+
         int value = global.getDatabaseVersion();
         if (value < 2){
             QLOG_DEBUG() << "*****************";
@@ -73,7 +91,30 @@ DatabaseConnection::DatabaseConnection(QString connection)
             DatabaseUpgrade dbu;
             dbu.fixSql();
         }
-        global.setDatabaseVersion(2);
+        if (value < 3) {
+            QLOG_DEBUG() << "Building sync queue";
+            DatabaseUpgrade dbu;
+            dbu.buildSyncQueue();
+        }
+        if (value < 4) {
+            QLOG_INFO() << "Moving search index to FTS5";
+            DatabaseUpgrade dbu;
+            if (!dbu.upgradeSearchIndex()) {
+                QLOG_FATAL() << "Search index upgrade failed.";
+                exit(16);
+            }
+        }
+        if (value < 5) {
+            QLOG_INFO() << "Removing attachment text indexed under notes";
+            DatabaseUpgrade dbu;
+            dbu.removeNoteAttachmentIndex();
+        }
+        if (value < 6) {
+            QLOG_INFO() << "Listing search index rows by lid";
+            DatabaseUpgrade dbu;
+            dbu.buildSearchIndexRows();
+        }
+        global.setDatabaseVersion(6);
 
         // Get username to use for default notes.  This needs to be done after
         // the database is started because we set it by default to the usertable
@@ -82,17 +123,22 @@ DatabaseConnection::DatabaseConnection(QString connection)
 
     }
 
-    QLOG_TRACE() << "Re-creating filter table";
-    tempTable.exec("drop table if exists filter");
-    tempTable.exec("create table filter (lid integer, relevance integer)");
-    // index could be useful as we do joins on table display
-    // may also slow down search
-    // so maybe reevaluate this
-    tempTable.exec("create index Filter_Lid_Index on filter (lid)");
-
-    QLOG_TRACE() << "Adding to filter table";
-    tempTable.exec("insert into filter (lid,relevance) select distinct lid,0 from NoteTable");
-    QLOG_TRACE() << "Addition complete";
+    // The filter table holds what the note list shows, so only the main
+    // connection resets it.  Connections opened later by other threads
+    // would otherwise empty the list.
+    if (connection == NN_DB_CONNECTION_NAME) {
+        QLOG_TRACE() << "Re-creating filter table";
+        tempTable.exec("drop table if exists filter");
+        tempTable.exec("create table filter (lid integer, relevance real, hit integer default 0)");
+        // index could be useful as we do joins on table display
+        // may also slow down search
+        // so maybe reevaluate this
+        tempTable.exec("create index Filter_Lid_Index on filter (lid)");
+
+        QLOG_TRACE() << "Adding to filter table";
+        tempTable.exec("insert into filter (lid,relevance) select distinct lid,0 from NoteTable");
+        QLOG_TRACE() << "Addition complete";
+    }
     tempTable.finish();
 
 
@@ -8,6 +8,7 @@
 #include "src/sql/linkednotebooktable.h"
 #include "src/sql/sharednotebooktable.h"
 #include "src/sql/nsqlquery.h"
+#include "src/sql/searchindextable.h"
 #include "src/global.h"
 
 
@@ -81,3 +82,89 @@ void DatabaseUpgrade::fixSql(bool toQt5) {
         trueQuery.exec();
     }
 }
+
+
+
+void DatabaseUpgrade::buildSyncQueue() {
+    NoteTable noteTable(global.db);
+    noteTable.queueAllDirty();
+}
+
+
+
+// The rows are copied over as they are, so nothing has to be re-indexed.
+// Recognition weights were sometimes stored as text, which compares above
+// any number, so they are made integers on the way.
+bool DatabaseUpgrade::upgradeSearchIndex() {
+    NSqlQuery sql(global.db);
+    sql.exec("select sql from sqlite_master where name='SearchIndex'");
+    bool fts4 = sql.next() && sql.value(0).toString().contains("fts4", Qt::CaseInsensitive);
+    sql.finish();
+    if (!fts4)
+        return true;
+
+    // The old table is only dropped once everything was copied
+    bool transaction = global.db->conn.transaction();
+    bool copied = sql.exec("alter table SearchIndex rename to SearchIndexFts4")
+            && SearchIndexTable::createTables(global.db)
+            && sql.exec("insert into SearchIndex (rowid, lid, weight, source, content) "
+                        "select rowid, lid, cast(weight as integer), source, content from SearchIndexFts4")
+            && sql.exec("insert into SearchIndexTrigram (rowid, content) select rowid, content from SearchIndex");
+    if (!copied || !sql.exec("drop table SearchIndexFts4")) {
+        QLOG_ERROR() << "Copying the search index failed: " << sql.lastError();
+        if (transaction)
+            global.db->conn.rollback();
+        return false;
+    }
+    if (transaction)
+        global.db->conn.commit();
+    sql.exec("insert into SearchIndex (SearchIndex) values ('optimize')");
+    return true;
+}
+
+
+
+// PDF, office and recognition text used to be indexed under the lid of the
+// note.  It is indexed under the resource now, so those rows would never be
+// replaced.  They are dropped and the resources of their notes indexed again.
+// Office documents converted with soffice were indexed as 'attachment' rows
+// too, so they are covered & converted again under their resource, through
+// the extracted text cache when the same data was converted before.
+void DatabaseUpgrade::removeNoteAttachmentIndex() {
+    NSqlQuery sql(global.db);
+    bool transaction = global.db->conn.transaction();
+    sql.prepare("create temp table StaleIndex as select rowid as row, lid, content from SearchIndex "
+                "where source in ('attachment', 'recognition') and lid in (select lid from DataStore where key=:key)");
+    sql.bindValue(":key", NOTE_GUID);
+    sql.exec();
+    sql.exec("insert into SearchIndexTrigram (SearchIndexTrigram, rowid, content) "
+             "select 'delete', row, content from StaleIndex");
+    sql.exec("delete from SearchIndex where rowid in (select row from StaleIndex)");
+    sql.exec("delete from SearchIndexRows where row in (select row from StaleIndex)");
+    sql.exec("delete from SearchIndexHash where source in ('attachment', 'recognition') "
+             "and lid in (select lid from StaleIndex)");
+
+    sql.prepare("insert into DataStore (lid, key, data) select lid, :indexKey, 1 from DataStore "
+                "where key=:noteLid and data in (select lid from StaleIndex) "
+                "and lid not in (select lid from DataStore where key=:indexKey2)");
+    sql.bindValue(":indexKey", RESOURCE_INDEX_NEEDED);
+    sql.bindValue(":noteLid", RESOURCE_NOTE_LID);
+    sql.bindValue(":indexKey2", RESOURCE_INDEX_NEEDED);
+    sql.exec();
+    QLOG_INFO() << sql.numRowsAffected() << " resources to index again";
+    sql.exec("drop table StaleIndex");
+    if (transaction)
+        global.db->conn.commit();
+}
+
+
+
+// Rows indexed before SearchIndexRows existed
+void DatabaseUpgrade::buildSearchIndexRows() {
+    NSqlQuery sql(global.db);
+    bool transaction = global.db->conn.transaction();
+    sql.exec("delete from SearchIndexRows");
+    sql.exec("insert into SearchIndexRows (row, lid, source) select rowid, lid, source from SearchIndex");
+    if (transaction)
+        global.db->conn.commit();
+}
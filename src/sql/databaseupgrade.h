@@ -9,6 +9,10 @@ class DatabaseUpgrade : public QObject
 public:
     explicit DatabaseUpgrade(QObject *parent = 0);
     void fixSql(bool toQt5=true);
+    void buildSyncQueue();          // Queue the notes which were dirty before the queue existed
+    bool upgradeSearchIndex();      // Move the FTS4 search index to FTS5 and build the trigram index
+    void removeNoteAttachmentIndex();   // Drop attachment & recognition text indexed under note lids
+    void buildSearchIndexRows();    // List the existing search index rows by lid & source
 
 signals:
 
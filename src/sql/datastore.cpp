@@ -28,6 +28,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #include "notebooktable.h"
 #include "src/global.h"
 #include "src/sql/nsqlquery.h"
+#include "src/sql/searchindextable.h"
 
 extern Global global;
 
@@ -88,10 +89,11 @@ void DataStore::createTable() {
         QLOG_ERROR() << "Creation of NotebookModel table failed: " << sql.lastError();
     }
 
-    if (!sql.exec("Create virtual table SearchIndex using fts4 (lid int, weight int, source text, content text)")) {
-        QLOG_ERROR() << "Creation of SearchIndex table failed: " << sql.lastError();
-    }
     sql.finish();
+    if (!SearchIndexTable::createTables(db)) {
+        QLOG_FATAL() << "Creation of the search index failed.";
+        exit(16);
+    }
     db->unlock();
     Notebook notebook;
     NotebookTable table(db);
@@ -0,0 +1,55 @@
+/*********************************************************************************
+NixNote - An open-source client for the Evernote service.
+Copyright (C) 2013 Randy Baumgarte
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+***********************************************************************************/
+
+#include "dataversion.h"
+#include <QSqlQuery>
+
+
+DataVersion::DataVersion() {
+    version = 0;
+    dataVersion = -1;
+    changes = -1;
+}
+
+
+qint64 DataVersion::value(QSqlDatabase &db, const QString &sql) {
+    QSqlQuery query(db);
+    if (!query.exec(sql) || !query.next())
+        return -1;
+    return query.value(0).toLongLong();
+}
+
+
+qint64 DataVersion::current(QSqlDatabase &db) {
+    qint64 d = value(db, "pragma data_version");
+    qint64 c = value(db, "select total_changes()");
+    if (d != dataVersion || c != changes || d < 0 || c < 0) {
+        version++;
+        dataVersion = d;
+        changes = c;
+    }
+    return version;
+}
+
+
+// Only total_changes() is read again.  A commit by another connection
+// since current() still changes the version on the next call.
+void DataVersion::settle(QSqlDatabase &db) {
+    changes = value(db, "select total_changes()");
+}
@@ -0,0 +1,49 @@
+/*********************************************************************************
+NixNote - An open-source client for the Evernote service.
+Copyright (C) 2013 Randy Baumgarte
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+***********************************************************************************/
+
+
+//****************************************************
+//*  Counts the changes to the database which may
+//*  change the result of a filter.  Commits of the
+//*  other connections are seen through the
+//*  data_version pragma & the writes of this one
+//*  through total_changes().
+//*****************************************************
+
+#ifndef DATAVERSION_H
+#define DATAVERSION_H
+
+#include <QSqlDatabase>
+
+class DataVersion
+{
+private:
+    qint64 version;
+    qint64 dataVersion;     // last data_version seen
+    qint64 changes;         // last total_changes() seen
+
+    static qint64 value(QSqlDatabase &db, const QString &sql);
+
+public:
+    DataVersion();
+    qint64 current(QSqlDatabase &db);   // bumped if anything was written since the last call
+    void settle(QSqlDatabase &db);      // the writes of this connection since current() don't count
+};
+
+#endif // DATAVERSION_H
@@ -23,10 +23,15 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #include "notebooktable.h"
 #include "linkednotebooktable.h"
 #include "src/sql/nsqlquery.h"
+#include "src/sql/searchindextable.h"
 #include "tagtable.h"
 #include "src/global.h"
 #include "src/utilities/noteindexer.h"
 #include "src/utilities/NixnoteStringUtils.h"
+#include "src/utilities/metrics.h"
+#include "src/threads/fileremover.h"
+#include "src/utilities/mimereference.h"
+#include "src/utilities/extractedtextcache.h"
 
 #include <QSqlTableModel>
 #include <QtXml>
@@ -136,6 +141,23 @@ QString NoteTable::getGuid(qint32 lid) {
 }
 
 
+// Given a note's lid, return the title.  Only the note list column is
+// read, so this is much cheaper than a full get().
+QString NoteTable::getTitle(qint32 lid) {
+    NSqlQuery query(db);
+    QString retval = "";
+    db->lockForRead();
+    query.prepare("select title from NoteTable where lid=:lid");
+    query.bindValue(":lid", lid);
+    query.exec();
+    if (query.next())
+        retval = query.value(0).toString();
+    query.finish();
+    db->unlock();
+    return retval;
+}
+
+
 // Given a note's GUID, we return the LID
 qint32 NoteTable::getLid(string guid) {
     QString s(QString::fromStdString(guid));
@@ -493,6 +515,10 @@ qint32 NoteTable::add(qint32 l, const Note &t, bool isDirty, qint32 account) {
     db->unlock();
 
     updateNoteList(lid, t, isDirty, account);
+    if (isDirty)
+        queueSync(lid);
+    else
+        dequeueSync(lid);
 
     // Experimental index helper
     if (global.enableIndexing) {
@@ -773,6 +799,8 @@ bool NoteTable::updateNotebookName(qint32 lid, QString name) {
 
 // Return a note structure given the LID
 bool NoteTable::get(Note &note, qint32 lid, bool loadResources, bool loadBinary) {
+    static MetricHistogram *latency = Metrics::instance().histogram("notetable.get");
+    MetricsTimer timer(latency);
 
     NSqlQuery query(db);
     db->lockForRead();
@@ -798,7 +826,7 @@ bool NoteTable::get(Note &note, qint32 lid, bool loadResources, bool loadBinary)
                 note.active = query.value(1).toBool();
                 break;
             case (NOTE_DELETED_DATE):
-                note.active = query.value(1).toLongLong();
+                note.deleted = query.value(1).toLongLong();
                 break;
             case (NOTE_ATTRIBUTE_SOURCE_URL):
                 na.sourceURL = query.value(1).toString();
@@ -1422,29 +1450,22 @@ bool NoteTable::hasTag(qint32 noteLid, qint32 tagLid) {
 
 
 void NoteTable::rebuildNoteListTags(qint32 lid) {
-    // update the note list
+    // update the note list.  The tag names are read with a single join
+    // rather than loading every tag.
     QStringList tagNames;
-    TagTable tagTable(db);
     NSqlQuery query(db);
     db->lockForWrite();
-    query.prepare("select data from DataStore where lid=:lid and key=:key");
+    query.prepare("select data from DataStore where key=:nameKey and lid in "
+                  "(select data from DataStore where lid=:lid and key=:key)");
+    query.bindValue(":nameKey", TAG_NAME);
     query.bindValue(":lid", lid);
     query.bindValue(":key", NOTE_TAG_LID);
     query.exec();
     while (query.next()) {
-        qint32 tagLid = query.value(0).toInt();
-        Tag t;
-        tagTable.get(t, tagLid);
-        if (t.name.isSet())
-            tagNames.append(t.name);
+        tagNames.append(query.value(0).toString());
     }
     qSort(tagNames.begin(), tagNames.end(), caseInsensitiveLessThan);
-    QString tagCol;
-    for (qint32 i=0; i<tagNames.size(); i++) {
-        tagCol = tagCol + tagNames[i];
-        if (i<tagNames.size()-1)
-            tagCol=tagCol+", ";
-    }
+    QString tagCol = tagNames.join(", ");
     query.prepare("update NoteTable set tags=:tags where lid=:lid");
     query.bindValue(":tags", tagCol);
     query.bindValue(":lid", lid);
@@ -1455,6 +1476,147 @@ void NoteTable::rebuildNoteListTags(qint32 lid) {
 
 
 
+// Recompute the note list tag column for a set of notes (after a tag rename,
+// merge or delete).  All tag names are read once into a map and the notes'
+// tags in a few chunked queries, then the column is written in a single
+// transaction, instead of one query per note and tag.  Returns lid -> new
+// column value.
+QHash<qint32, QString> NoteTable::rebuildNoteListTagsForNotes(const QList<qint32> &noteLids) {
+    QHash<qint32, QString> retval;
+    if (noteLids.isEmpty())
+        return retval;
+
+    NSqlQuery query(db);
+    db->lockForWrite();
+
+    QHash<qint32, QString> tagNames;
+    query.prepare("select lid, data from DataStore where key=:key");
+    query.bindValue(":key", TAG_NAME);
+    query.exec();
+    while (query.next())
+        tagNames.insert(query.value(0).toInt(), query.value(1).toString());
+
+    // Every note gets an entry, even if it has no tags left
+    QHash<qint32, QStringList> noteTags;
+    noteTags.reserve(noteLids.size());
+    for (int i=0; i<noteLids.size(); i++)
+        noteTags.insert(noteLids[i], QStringList());
+
+    // The lids are inlined, so keep each statement to a reasonable length
+    const int chunkSize = 500;
+    for (int start=0; start<noteLids.size(); start+=chunkSize) {
+        QStringList inList;
+        for (int i=start; i<noteLids.size() && i<start+chunkSize; i++)
+            inList.append(QString::number(noteLids[i]));
+        query.prepare("select lid, data from DataStore where key=:key and lid in (" + inList.join(",") + ")");
+        query.bindValue(":key", NOTE_TAG_LID);
+        query.exec();
+        while (query.next()) {
+            QString name = tagNames.value(query.value(1).toInt());
+            if (name != "")
+                noteTags[query.value(0).toInt()].append(name);
+        }
+    }
+
+    bool transaction = db->conn.transaction();
+    query.prepare("update NoteTable set tags=:tags where lid=:lid");
+    for (QHash<qint32, QStringList>::iterator i=noteTags.begin(); i!=noteTags.end(); ++i) {
+        qSort(i.value().begin(), i.value().end(), caseInsensitiveLessThan);
+        QString tagCol = i.value().join(", ");
+        query.bindValue(":tags", tagCol);
+        query.bindValue(":lid", i.key());
+        query.exec();
+        retval.insert(i.key(), tagCol);
+    }
+    if (transaction)
+        db->conn.commit();
+    query.finish();
+    db->unlock();
+    return retval;
+}
+
+
+// Recompute the note list tag column of every note carrying one of the given tags.
+QHash<qint32, QString> NoteTable::rebuildNoteListTagsForTags(const QList<qint32> &tagLids) {
+    QList<qint32> noteLids;
+    for (int i=0; i<tagLids.size(); i++)
+        findNotesByTag(noteLids, tagLids[i]);
+    noteLids = noteLids.toSet().toList();
+    return rebuildNoteListTagsForNotes(noteLids);
+}
+
+
+// Remove a tag from every note with one statement and rebuild their display
+// column (unless the caller does that itself for a larger set of notes).
+// Returns the notes which carried the tag.
+QList<qint32> NoteTable::removeTagFromAllNotes(qint32 tagLid, bool rebuildNoteList) {
+    QList<qint32> noteLids;
+    findNotesByTag(noteLids, tagLid);
+    if (noteLids.isEmpty())
+        return noteLids;
+
+    NSqlQuery query(db);
+    db->lockForWrite();
+    query.prepare("delete from DataStore where key=:key and data=:tag");
+    query.bindValue(":key", NOTE_TAG_LID);
+    query.bindValue(":tag", tagLid);
+    query.exec();
+    query.finish();
+    db->unlock();
+
+    if (rebuildNoteList)
+        rebuildNoteListTagsForNotes(noteLids);
+    return noteLids;
+}
+
+
+// Add a tag to every note which carries one of the source tags (used when
+// tags are merged).  The inserts are done with one statement; the display
+// column is rebuilt through the bulk path above.  Returns the notes changed.
+QList<qint32> NoteTable::mergeTags(qint32 tagLid, const QList<qint32> &sourceTags, bool isDirty, bool rebuildNoteList) {
+    QList<qint32> lids;
+    if (sourceTags.isEmpty())
+        return lids;
+    QStringList inList;
+    for (int i=0; i<sourceTags.size(); i++)
+        inList.append(QString::number(sourceTags[i]));
+
+    NSqlQuery query(db);
+    db->lockForWrite();
+    bool transaction = db->conn.transaction();
+    query.prepare("select distinct lid from DataStore where key=:key and data in (" + inList.join(",") + ") "
+                  "and lid not in (select lid from DataStore where key=:key2 and data=:tag)");
+    query.bindValue(":key", NOTE_TAG_LID);
+    query.bindValue(":key2", NOTE_TAG_LID);
+    query.bindValue(":tag", tagLid);
+    query.exec();
+    while (query.next())
+        lids.append(query.value(0).toInt());
+
+    query.prepare("insert into DataStore (lid, key, data) values (:lid, :key, :data)");
+    for (int i=0; i<lids.size(); i++) {
+        query.bindValue(":lid", lids[i]);
+        query.bindValue(":key", NOTE_TAG_LID);
+        query.bindValue(":data", tagLid);
+        query.exec();
+    }
+    query.finish();
+
+    if (isDirty) {
+        for (int i=0; i<lids.size(); i++)
+            setDirty(lids[i], true, false);
+    }
+    if (transaction)
+        db->conn.commit();
+    db->unlock();
+
+    if (rebuildNoteList)
+        rebuildNoteListTagsForNotes(lids);
+    return lids;
+}
+
+
+
 QString NoteTable::getNoteListTags(qint32 lid) {
     db->lockForRead();
     QString retval = "";
@@ -1476,6 +1638,7 @@ void NoteTable::setDirty(qint32 lid, bool dirty, bool setDateUpdated) {
         return;
 
     db->lockForWrite();
+    bool transaction = db->conn.transaction();
     NSqlQuery query(db);
 
     // If it is setting it as dirty, we need to update the
@@ -1499,10 +1662,19 @@ void NoteTable::setDirty(qint32 lid, bool dirty, bool setDateUpdated) {
         query.exec();
     }
 
+    // The queue entry is refreshed even if the note was already dirty,
+    // since it may have been moved to another notebook or to the trash.
+    if (dirty)
+        queueSync(lid);
+    else
+        dequeueSync(lid);
+
     // If it is already set to the value, then we don't
     // need to do anything more.
     if (isDirty(lid) == dirty) {
         query.finish();
+        if (transaction)
+            db->conn.commit();
         db->unlock();
         return;
     }
@@ -1526,10 +1698,14 @@ void NoteTable::setDirty(qint32 lid, bool dirty, bool setDateUpdated) {
         query.bindValue(":data", dirty);
         query.exec();
         query.finish();
+        if (transaction)
+            db->conn.commit();
         db->unlock();
         setIndexNeeded(lid, true);
     } else {
         query.finish();
+        if (transaction)
+            db->conn.commit();
         db->unlock();
     }
 }
@@ -1595,7 +1771,7 @@ void NoteTable::deleteNote(qint32 lid, bool isDirty=true) {
         query.bindValue(":key", NOTE_ISDIRTY);
         query.bindValue(":data", true);
         query.exec();
-
+        queueSync(lid);
     }
     query.finish();
     db->unlock();
@@ -1642,7 +1818,7 @@ void NoteTable::restoreNote(qint32 lid, bool isDirty=true) {
         query.bindValue(":key", NOTE_ISDIRTY);
         query.bindValue(":data", true);
         query.exec();
-
+        queueSync(lid);
     }
     query.finish();
     db->unlock();
@@ -1670,34 +1846,146 @@ qint32 NoteTable::getAllDeleted(QList<qint32> &lids) {
 
 
 void NoteTable::expunge(qint32 lid) {
-    // Expunge the thumbnail
-    QString thumbnail = global.fileManager.getThumbnailDirPath() + QString::number(lid) + ".png";
-    QFile f(thumbnail);
-    if (f.exists()) {
-        QDir d;
-        d.remove(thumbnail);
-    }
+    QList<qint32> lids;
+    lids.append(lid);
+    QStringList files;
+    expunge(lids, files, false);
+    FileRemover::removeInBackground(files);
+}
+
+
+// Comma separated list of lids[start .. start+count) for an "in (...)" clause
+static QString lidList(const QList<qint32> &lids, int start, int count) {
+    QStringList values;
+    for (int i=start; i<lids.size() && i<start+count; i++)
+        values.append(QString::number(lids[i]));
+    return values.join(",");
+}
+
+
+// Permanently remove a set of notes and their resources.  Everything is done
+// in one transaction with set based statements over chunks of lids.  The
+// files belonging to the notes (resource files & thumbnails) are not touched;
+// their names are appended to "files" so the caller can delete them with a
+// FileRemover, normally on a background thread, once the transaction the
+// rows were deleted in is committed.  Resource files are named from their
+// mime type & file name, the way ResourceTable saves them.  The text
+// extracted from an attachment is shared by every resource with the same
+// data, so its file is only listed with the last of them.  If
+// queueSyncedDeletes is set, notes known to Evernote are added to the delete
+// queue so the next sync removes them there too.
+qint32 NoteTable::expunge(const QList<qint32> &lids, QStringList &files, bool queueSyncedDeletes) {
+    if (lids.isEmpty())
+        return 0;
+    const int chunkSize = 500;
+    QString dbaDir = global.fileManager.getDbaDirPath();
+    QString thumbnailDir = global.fileManager.getThumbnailDirPath();
+    ExtractedTextCache textCache(global.fileManager.getTextCacheDirPath(""));
+
+    NSqlQuery query(db);
+    SearchIndexTable searchIndex(db);
+    db->lockForWrite();
+    bool transaction = db->conn.transaction();
 
-    Note note;
-    this->get(note, lid, true, false);
-    ResourceTable resTable(db);
-    QList<Resource> resources;
-    if (note.resources.isSet())
-        resources = note.resources;
-    for (int i=0; i<resources.size(); i++) {
-        resTable.expunge(resources[i].guid);
+    QHash<qint32, QString> notebookGuids;
+    if (queueSyncedDeletes) {
+        query.prepare("select lid, data from DataStore where key=:key");
+        query.bindValue(":key", NOTEBOOK_GUID);
+        query.exec();
+        while (query.next())
+            notebookGuids.insert(query.value(0).toInt(), query.value(1).toString());
+    }
+
+    for (int start=0; start<lids.size(); start+=chunkSize) {
+        QString noteList = lidList(lids, start, chunkSize);
+
+        // Resources of these notes and the names of their files
+        QList<qint32> resLids;
+        query.exec("select lid from DataStore where key=" + QString::number(RESOURCE_NOTE_LID) +
+                   " and data in (" + noteList + ")");
+        while (query.next())
+            resLids.append(query.value(0).toInt());
+
+        for (int resStart=0; resStart<resLids.size(); resStart+=chunkSize) {
+            QString resList = lidList(resLids, resStart, chunkSize);
+            QHash<qint32, QString> mimes, fileNames;
+            query.exec("select lid, key, data from DataStore where key in (" + QString::number(RESOURCE_MIME) + "," +
+                       QString::number(RESOURCE_FILENAME) + ") and lid in (" + resList + ")");
+            while (query.next()) {
+                if (query.value(1).toInt() == RESOURCE_MIME)
+                    mimes.insert(query.value(0).toInt(), query.value(2).toString());
+                else
+                    fileNames.insert(query.value(0).toInt(), query.value(2).toString());
+            }
+            for (int i=resStart; i<resLids.size() && i<resStart+chunkSize; i++) {
+                QString num = QString::number(resLids[i]);
+                QString ext = MimeReference::getExtensionFromMime(mimes.value(resLids[i]), fileNames.value(resLids[i]));
+                files.append(dbaDir + num + ext);
+                if (ext != ".png")
+                    files.append(dbaDir + num + ".png");     // an ink note image
+                files.append(thumbnailDir + num + ".png");
+            }
+            QString hashKey = QString::number(RESOURCE_DATA_HASH);
+            query.exec("select distinct data from DataStore where key=" + hashKey + " and lid in (" + resList + ") "
+                       "and data not in (select data from DataStore where key=" + hashKey + " and lid not in (" + resList + "))");
+            while (query.next())
+                files.append(textCache.fileName(QByteArray::fromHex(query.value(0).toByteArray())));
+            query.exec("delete from DataStore where lid in (" + resList + ")");
+        }
+
+        // Remember what Evernote needs to be told before the rows are gone
+        QList< QPair<qint32, QPair<QString, QString> > > pending;
+        if (queueSyncedDeletes) {
+            QHash<qint32, qint32> usn, notebook;
+            QHash<qint32, QString> guid;
+            query.exec("select lid, key, data from DataStore where key in (" +
+                       QString::number(NOTE_GUID) + "," + QString::number(NOTE_NOTEBOOK_LID) + "," +
+                       QString::number(NOTE_UPDATE_SEQUENCE_NUMBER) + ") and lid in (" + noteList + ")");
+            while (query.next()) {
+                qint32 lid = query.value(0).toInt();
+                qint32 key = query.value(1).toInt();
+                if (key == NOTE_GUID)
+                    guid.insert(lid, query.value(2).toString());
+                else if (key == NOTE_NOTEBOOK_LID)
+                    notebook.insert(lid, query.value(2).toInt());
+                else
+                    usn.insert(lid, query.value(2).toInt());
+            }
+            for (QHash<qint32, qint32>::iterator i=usn.begin(); i!=usn.end(); ++i) {
+                if (i.value() > 0)
+                    pending.append(qMakePair(i.key(), qMakePair(guid.value(i.key()),
+                                                                notebookGuids.value(notebook.value(i.key())))));
+            }
+        }
+
+        query.exec("delete from DataStore where lid in (" + noteList + ")");
+        query.exec("delete from NoteTable where lid in (" + noteList + ")");
+        searchIndex.remove(lids.mid(start, chunkSize));
+        searchIndex.remove(resLids);
+        query.exec("delete from SyncQueue where lid in (" + noteList + ")");
+
+        query.prepare("insert into DataStore (lid, key, data) values (:lid, :key, :data)");
+        for (int i=0; i<pending.size(); i++) {
+            query.bindValue(":lid", pending[i].first);
+            query.bindValue(":key", NOTE_DELETE_PENDING_GUID);
+            query.bindValue(":data", pending[i].second.first);
+            query.exec();
+            query.bindValue(":lid", pending[i].first);
+            query.bindValue(":key", NOTE_DELETE_PENDING_NOTEBOOK);
+            query.bindValue(":data", pending[i].second.second);
+            query.exec();
+        }
+
+        for (int i=start; i<lids.size() && i<start+chunkSize; i++)
+            files.append(thumbnailDir + QString::number(lids[i]) + ".png");
     }
 
-    NSqlQuery query(db);
-    db->lockForWrite();
-    query.prepare("delete from DataStore where lid=:lid");
-    query.bindValue(":lid", lid);
-    query.exec();
-    query.prepare("delete from NoteTable where lid=:lid");
-    query.bindValue(":lid", lid);
-    query.exec();
+    if (transaction)
+        db->conn.commit();
     query.finish();
     db->unlock();
+    QLOG_DEBUG() << "Bulk expunge of " << lids.size() << " notes complete, " << files.size() << " files to remove";
+    return lids.size();
 }
 
 
@@ -1826,7 +2114,37 @@ qint32 NoteTable::findNotesByNotebook(QList<qint32> &notes, string guid) {
 }
 
 
+// Determine the todo & encryption flags of a note in a single pass over the content
+void NoteTable::getContentFlags(const QString &content, bool &hasEncrypt, bool &hasTodoCompleted, bool &hasTodoUncompleted) {
+    hasEncrypt = false;
+    hasTodoCompleted = false;
+    hasTodoUncompleted = false;
+
+    int pos = content.indexOf("<en-");
+    while (pos >= 0 && !(hasEncrypt && hasTodoCompleted && hasTodoUncompleted)) {
+        QStringRef tag = content.midRef(pos+4, 5);
+        if (tag == QLatin1String("crypt")) {
+            hasEncrypt = true;
+        } else if (tag.startsWith(QLatin1String("todo"))) {
+            int tagEnd = content.indexOf('>', pos);
+            QStringRef attributes = content.midRef(pos, tagEnd < 0 ? -1 : tagEnd-pos);
+            if (attributes.contains(QLatin1String("checked=\"true\"")))
+                hasTodoCompleted = true;
+            else
+                hasTodoUncompleted = true;
+        }
+        pos = content.indexOf("<en-", pos+4);
+    }
+}
+
+
+
+// Update the content of a note.  The caller is responsible for any transaction
+// wrapping multiple saves (see BrowserRunner).
 void NoteTable::updateNoteContent(qint32 lid, QString content, bool isDirty) {
+    bool hasEncrypt, hasTodoCompleted, hasTodoUncompleted;
+    getContentFlags(content, hasEncrypt, hasTodoCompleted, hasTodoUncompleted);
+
     db->lockForWrite();
 
     NSqlQuery query(db);
@@ -1837,99 +2155,72 @@ void NoteTable::updateNoteContent(qint32 lid, QString content, bool isDirty) {
     query.bindValue(":key", NOTE_CONTENT);
     query.exec();
 
-    // Update the note size
-    query.prepare("Delete from datastore where lid=:lid and key=:key");
+    // Clear the values derived from the content & re-add them below.
+    query.prepare("delete from datastore where lid=:lid and key in (:lengthKey, :completedKey, :uncompletedKey, :encryptKey, :indexKey)");
     query.bindValue(":lid", lid);
-    query.bindValue(":key", NOTE_CONTENT_LENGTH);
+    query.bindValue(":lengthKey", NOTE_CONTENT_LENGTH);
+    query.bindValue(":completedKey", NOTE_HAS_TODO_COMPLETED);
+    query.bindValue(":uncompletedKey", NOTE_HAS_TODO_UNCOMPLETED);
+    query.bindValue(":encryptKey", NOTE_HAS_ENCRYPT);
+    query.bindValue(":indexKey", NOTE_INDEX_NEEDED);
     query.exec();
-    query.prepare("Insert into datastore (lid, key, data) values (:lid, :key, :content)");
+
+    query.prepare("insert into datastore (lid, key, data) values (:lid, :key, :data)");
     query.bindValue(":lid", lid);
     query.bindValue(":key", NOTE_CONTENT_LENGTH);
-    query.bindValue(":content", content.length());
+    query.bindValue(":data", content.length());
     query.exec();
 
-    // Make sure we don't have a todo
-    NSqlQuery query2(db);
-    query2.prepare("Update NoteTable set hasTodo=0 where lid=:lid");
-    query2.bindValue(":lid", lid);
-    query2.exec();
-    query2.prepare("delete from datastore where lid=:lid and (key=:key1 or key=:key2)");
-    query2.bindValue(":lid", lid);
-    query2.bindValue(":key1", NOTE_HAS_TODO_COMPLETED);
-    query2.bindValue(":key2", NOTE_HAS_TODO_UNCOMPLETED);
-    query2.exec();
-
-    query2.prepare("Update NoteTable set hasEncryption=0 where lid=:lid");
-    query2.bindValue(":lid", lid);
-    query2.exec();
-    query2.prepare("delete from datastore where lid=:lid and key=:key");
-    query2.bindValue(":lid", lid);
-    query2.bindValue(":key", NOTE_HAS_ENCRYPT);
-    query2.exec();
-
-
-    if (content.contains("<en-todo")) {
-        QLOG_DEBUG() << content;
-        query.prepare("insert into datastore (lid, key, data) values (:lid, :key, 1)");
-        // If we have a todo that is checked, then it is completed.
-
-        if (content.contains("<en-todo checked=\"true\"")) {
-            query.bindValue(":lid", lid);
-            query.bindValue(":key", NOTE_HAS_TODO_COMPLETED);
-            query.exec();
-        }
-
-        // If we have a todo that is not checked, but still have a todo, then it must be uncoompleted.
-        if (content.contains("<en-todo checked=\"false\"") || content.contains("<en-todo/>")) {
-            query.bindValue(":lid", lid);
-            query.bindValue(":key", NOTE_HAS_TODO_UNCOMPLETED);
-            query.exec();
-        }
-        NSqlQuery query2(db);
-        query2.prepare("Update NoteTable set hasTodo=:value where lid=:lid");
-        query2.bindValue(":lid", lid);
-        query2.bindValue(":value", 1);
-        query2.exec();
+    if (hasTodoCompleted) {
+        query.bindValue(":lid", lid);
+        query.bindValue(":key", NOTE_HAS_TODO_COMPLETED);
+        query.bindValue(":data", 1);
+        query.exec();
     }
-
-    if (content.contains("<en-crypt")) {
-        query.prepare("insert into datastore (lid, key, data) values (:lid, :key, 1)");
-        if (content.contains("<en-todo checked=\"true\"")) {
-            query.bindValue(":lid", lid);
-            query.bindValue(":key", NOTE_HAS_TODO_COMPLETED);
-            query.exec();
-        }
-        NSqlQuery query2(db);
-        query2.prepare("Update NoteTable set hasEncryption=:value where lid=:lid");
-        query2.bindValue(":lid", lid);
-        query2.bindValue(":value", 1);
-        query2.exec();
+    if (hasTodoUncompleted) {
+        query.bindValue(":lid", lid);
+        query.bindValue(":key", NOTE_HAS_TODO_UNCOMPLETED);
+        query.bindValue(":data", 1);
+        query.exec();
+    }
+    if (hasEncrypt) {
+        query.bindValue(":lid", lid);
+        query.bindValue(":key", NOTE_HAS_ENCRYPT);
+        query.bindValue(":data", 1);
+        query.exec();
     }
-
-    query.prepare("update datastore set data=1 where lid=:lid and key=:key");
-    query.bindValue(":lid", lid);
-    query.bindValue(":key", NOTE_INDEX_NEEDED);
-    query.exec();
-    query.finish();
     if (global.enableIndexing) {
-        query.prepare("insert into datastore (lid, key, data) values (:lid, :key, 1)");
         query.bindValue(":lid", lid);
         query.bindValue(":key", NOTE_INDEX_NEEDED);
-        query.bindValue(":data", true);
+        query.bindValue(":data", 1);
         query.exec();
-    } else {
-        NoteIndexer indexer(db);
-        indexer.indexNote(lid);
     }
 
-    qlonglong totalsize = this->getSize(lid);
-    NSqlQuery query3(db);
-    query3.prepare("Update notetable set size=:size where lid=:lid");
-    query3.bindValue(":size", totalsize);
-    query3.bindValue(":lid", lid);
-    query3.exec();
+    // The note size is the content plus the size of all its resources
+    query.prepare("Select sum(data) from DataStore where key=:key and lid in (select lid from datastore where key=:key2 and data=:lid)");
+    query.bindValue(":key", RESOURCE_DATA_SIZE);
+    query.bindValue(":key2", RESOURCE_NOTE_LID);
+    query.bindValue(":lid", lid);
+    query.exec();
+    qlonglong totalsize = content.length();
+    if (query.next())
+        totalsize = totalsize + query.value(0).toLongLong();
+
+    query.prepare("Update NoteTable set hasTodo=:hasTodo, hasEncryption=:hasEncryption, size=:size where lid=:lid");
+    query.bindValue(":hasTodo", hasTodoCompleted || hasTodoUncompleted);
+    query.bindValue(":hasEncryption", hasEncrypt);
+    query.bindValue(":size", totalsize);
+    query.bindValue(":lid", lid);
+    query.exec();
+    query.finish();
 
     db->unlock();
+
+    if (!global.enableIndexing) {
+        NoteIndexer indexer(db);
+        indexer.indexNote(lid);
+    }
+
     setDirty(lid, isDirty);
 }
 
@@ -2130,6 +2421,86 @@ qint32 NoteTable::getAllDirty(QList<qint32> &lids, qint32 linkedNotebookLid) {
 
 
 
+// Add or refresh the queue entries of the notes matching a condition on
+// n.lid.  The operation & notebook classification are worked out in SQL
+// from the note's notebook, trash state & update sequence number.
+void NoteTable::queueSync(const QString &condition) {
+    NSqlQuery query(db);
+    db->lockForWrite();
+    query.exec("insert or replace into SyncQueue (lid, type, operation, notebookLid, notebookClass) "
+               "select n.lid, " + QString::number(SYNCQUEUE_NOTE) + ", "
+               "case when exists (select 1 from DataStore b where b.lid=n.data and b.key=" + QString::number(NOTEBOOK_IS_LOCAL) + " and b.data=1) "
+               "       and exists (select 1 from DataStore u where u.lid=n.lid and u.key=" + QString::number(NOTE_UPDATE_SEQUENCE_NUMBER) + " and u.data>0) "
+               "     then " + QString::number(SYNCQUEUE_EXPUNGE_REMOTE) + " "
+               "     when exists (select 1 from DataStore a where a.lid=n.lid and a.key=" + QString::number(NOTE_ACTIVE) + " and a.data=0) "
+               "     then " + QString::number(SYNCQUEUE_DELETE) + " "
+               "     else " + QString::number(SYNCQUEUE_UPDATE) + " end, "
+               "n.data, "
+               "case when exists (select 1 from DataStore l where l.lid=n.data and l.key=" + QString::number(LINKEDNOTEBOOK_SHARE_NAME) + ") "
+               "     then " + QString::number(SYNCQUEUE_LINKED) + " "
+               "     when exists (select 1 from DataStore b where b.lid=n.data and b.key=" + QString::number(NOTEBOOK_IS_LOCAL) + " and b.data=1) "
+               "     then " + QString::number(SYNCQUEUE_LOCAL) + " "
+               "     else " + QString::number(SYNCQUEUE_PERSONAL) + " end "
+               "from DataStore n where n.key=" + QString::number(NOTE_NOTEBOOK_LID) + " and " + condition);
+    query.finish();
+    db->unlock();
+}
+
+
+
+void NoteTable::queueSync(qint32 lid) {
+    queueSync("n.lid=" + QString::number(lid));
+}
+
+
+
+void NoteTable::dequeueSync(qint32 lid) {
+    NSqlQuery query(db);
+    db->lockForWrite();
+    query.prepare("delete from SyncQueue where lid=:lid and type=:type");
+    query.bindValue(":lid", lid);
+    query.bindValue(":type", SYNCQUEUE_NOTE);
+    query.exec();
+    query.finish();
+    db->unlock();
+}
+
+
+
+// Used when the queue is created on an existing database
+void NoteTable::queueAllDirty() {
+    NSqlQuery query(db);
+    db->lockForWrite();
+    query.exec("delete from SyncQueue where type=" + QString::number(SYNCQUEUE_NOTE));
+    query.finish();
+    db->unlock();
+    queueSync("n.lid in (select lid from DataStore where key=" + QString::number(NOTE_ISDIRTY) + " and data=1)");
+}
+
+
+
+// Get everything waiting to be uploaded
+qint32 NoteTable::getSyncQueue(QList<SyncQueueEntry> &entries) {
+    NSqlQuery query(db);
+    db->lockForRead();
+    entries.clear();
+    query.exec("select lid, type, operation, notebookLid, notebookClass from SyncQueue order by lid");
+    while (query.next()) {
+        SyncQueueEntry entry;
+        entry.lid = query.value(0).toInt();
+        entry.type = query.value(1).toInt();
+        entry.operation = query.value(2).toInt();
+        entry.notebookLid = query.value(3).toInt();
+        entry.notebookClass = query.value(4).toInt();
+        entries.append(entry);
+    }
+    query.finish();
+    db->unlock();
+    return entries.size();
+}
+
+
+
 // Get the notebook lid for a note
 qint32 NoteTable::getNotebookLid(qint32 noteLid) {
     qint32 retval = 0;
@@ -2201,17 +2572,25 @@ void NoteTable::updateEnmediaHash(qint32 lid, QByteArray oldHash, QByteArray new
 
 
 
-void NoteTable::setThumbnail(qint32 lid, QString filename) {
+void NoteTable::setThumbnail(qint32 lid, QString filename, QByteArray contentHash) {
     NSqlQuery query(db);
     db->lockForWrite();
     query.prepare("Update notetable set thumbnail=:thumbnail where lid=:lid");
     query.bindValue(":thumbnail", filename);
     query.bindValue(":lid", lid);
     query.exec();
-    query.prepare("Delete from datastore where lid=:lid and key=:key");
+    query.prepare("Delete from datastore where lid=:lid and (key=:key or key=:hashKey)");
     query.bindValue(":lid", lid);
     query.bindValue(":key", NOTE_THUMBNAIL_NEEDED);
+    query.bindValue(":hashKey", NOTE_THUMBNAIL_HASH);
     query.exec();
+    if (!contentHash.isEmpty()) {
+        query.prepare("Insert into DataStore (lid, key, data) values (:lid, :key, :data)");
+        query.bindValue(":lid", lid);
+        query.bindValue(":key", NOTE_THUMBNAIL_HASH);
+        query.bindValue(":data", QString(contentHash));
+        query.exec();
+    }
     query.finish();
     db->unlock();
 }
@@ -2233,6 +2612,22 @@ void NoteTable::reindexAllNotes() {
 }
 
 
+void NoteTable::rebuildAllThumbnails() {
+    NSqlQuery query(db);
+    db->lockForWrite();
+    query.prepare("delete from datastore where key=:thumbnailKey");
+    query.bindValue(":thumbnailKey", NOTE_THUMBNAIL_NEEDED);
+    query.exec();
+
+    query.prepare("insert into datastore (lid, key, data) select lid, :thumbnailKey, 1 from datastore where key=:key;");
+    query.bindValue(":thumbnailKey", NOTE_THUMBNAIL_NEEDED);
+    query.bindValue(":key", NOTE_GUID);
+    query.exec();
+    query.finish();
+    db->unlock();
+}
+
+
 void NoteTable::resetGeography(qint32 lid, bool isDirty) {
     NSqlQuery query(db);
     db->lockForWrite();
@@ -2373,6 +2768,21 @@ qint32 NoteTable::getNextThumbnailNeeded() {
 
 
 
+void NoteTable::getThumbnailsNeeded(QList<qint32> &lids) {
+    NSqlQuery query(db);
+    db->lockForRead();
+    query.prepare("select lid from datastore where data=1 and key=:key;");
+    query.bindValue(":key", NOTE_THUMBNAIL_NEEDED);
+    query.exec();
+    while (query.next()) {
+        lids.append(query.value(0).toInt());
+    }
+    query.finish();
+    db->unlock();
+}
+
+
+
 qint32 NoteTable::getThumbnailsNeededCount() {
     //qint32 retval = 0;
     //NSqlQuery query(db);
@@ -2404,6 +2814,23 @@ bool NoteTable::thumbnailExists(qint32 lid) {
     return f.exists();
 }
 
+// Get the content hash the existing thumbnail was generated from
+QByteArray NoteTable::getThumbnailHash(qint32 lid) {
+    QByteArray retval;
+    NSqlQuery query(db);
+    db->lockForRead();
+    query.prepare("select data from DataStore where lid=:lid and key=:key");
+    query.bindValue(":lid", lid);
+    query.bindValue(":key", NOTE_THUMBNAIL_HASH);
+    query.exec();
+    if (query.next()) {
+        retval = query.value(0).toString().toLatin1();
+    }
+    query.finish();
+    db->unlock();
+    return retval;
+}
+
 void NoteTable::setReminderCompleted(qint32 lid, bool completed) {
     NSqlQuery query(db);
     db->lockForWrite();
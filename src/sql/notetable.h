@@ -81,19 +81,46 @@ using namespace qevercloud;
 #define NOTE_DELETE_PENDING_GUID               5500
 #define NOTE_DELETE_PENDING_NOTEBOOK           5501
 
+#define NOTE_THUMBNAIL_HASH                    5994
 #define NOTE_TITLE_COLOR                       5995
 #define NOTE_ISPINNED                          5996
 #define NOTE_THUMBNAIL_NEEDED                  5997
 #define NOTE_EXPUNGED_FROM_TRASH               5998
 #define NOTE_INDEX_NEEDED                      5999
 
+
+// Outbound change queue (the SyncQueue table).  Every dirty note has an
+// entry, kept up to date by setDirty() and friends, so the uploader can read
+// what needs to be sent in one query instead of classifying each note.
+#define SYNCQUEUE_NOTE                          1       // object type
+
+#define SYNCQUEUE_UPDATE                        0       // operation: upload the note
+#define SYNCQUEUE_DELETE                        1       // operation: note is in the trash
+#define SYNCQUEUE_EXPUNGE_REMOTE                2       // operation: synced note moved to a local notebook
+
+#define SYNCQUEUE_PERSONAL                      0       // notebook: in the user's account
+#define SYNCQUEUE_LOCAL                         1       // notebook: never synchronized
+#define SYNCQUEUE_LINKED                        2       // notebook: linked (shared) notebook
+
 using namespace std;
 
+
+class SyncQueueEntry
+{
+public:
+    qint32 lid;
+    qint32 type;
+    qint32 operation;
+    qint32 notebookLid;
+    qint32 notebookClass;
+};
+
 class NoteTable
 {
 
 private:
     DatabaseConnection *db;
+    void queueSync(const QString &condition);
 
 public:
 
@@ -103,6 +130,7 @@ public:
     qint32 getLid(string guid);                              // Given a guid, return the lid
     qint32 getLidFromUrl(QString noteUrl);                   // Given a URL, return the lid
     QString getGuid(int lid);                                // given a lid, get the guid
+    QString getTitle(qint32 lid);                            // given a lid, get the title (note list column only)
     bool get(Note &note, qint32 lid, bool loadResources, bool loadBinary);           // Get a note given a lid
     bool get(Note &note, QString guid, bool loadResources, bool loadBinary);         // get a note given a guid
     bool get(Note &note, string guid,bool loadResources, bool loadBinary);           // get a note given a guid
@@ -138,9 +166,11 @@ public:
     bool isThumbnailNeeded(string guid);                     // see if a thumbnail is needed
     bool isIndexNeeded(qint32 lid);                          // see if an index is needed
     qint32 getNextThumbnailNeeded();                         // get any note that needs a thumbnail
+    void getThumbnailsNeeded(QList<qint32> &lids);           // get every note that needs a thumbnail
     void getAllReminders(QList< QPair<qint32, qlonglong>* > *reminders);  // Get all notes with un-completed reminders
     qint32 getThumbnailsNeededCount();                       // Get a count of all notes in need of a thumbnail
     bool thumbnailExists(qint32 lid);
+    QByteArray getThumbnailHash(qint32 lid);                 // Get the content hash the current thumbnail was built from
     void getAll(QList<qint32> &lids);                        // Get all note lids
     void getAllPinned(QList<QPair<qint32, QString> > &lids); // Get all notes that are pinned
     void getRecentlyUpdated(QList< QPair< qint32, QString > > &lids);    // Get any notes recently updated (used for the icon in the toolbar).
@@ -152,12 +182,13 @@ public:
     qint32 addStub(QString noteGuid);                                   // Add a stub.  Used if a resource appears before the owning note
     void setTitleColor(qint32 lid, QString color);                      // Set the color of the title in the note list
     void reindexAllNotes();                                             // Reindex all notes
+    void rebuildAllThumbnails();                                        // Flag every note as needing a thumbnail
     void resetGeography(qint32 lid, bool isDirty);                      // clear geography of note
     void setGeography(qint32 lid, double longitude, double latitude, double altitude, bool isDirty);    // Set the note location
     void setThumbnailNeeded(qint32 lid, bool value);                    // Set if a thumbnail is needed?
     void setThumbnailNeeded(QString guid, bool value);                  // Set if a thumbail is needed
     void setThumbnailNeeded(string guid, bool value);                   // see if a thumbnail is needed
-    void setThumbnail(qint32 lid, QString filename);                    // set the file containing the thumbnail
+    void setThumbnail(qint32 lid, QString filename, QByteArray contentHash=QByteArray());   // set the file containing the thumbnail
     qint32 duplicateNote(qint32 oldLid, bool keepCreatedDate=false);    // Duplicate an existing note
     void setUpdateSequenceNumber(qint32 lid, qint32 usn);               // set the update sequence number
     void updateNoteContent(qint32 lid, QString content, bool isDirty=true);   // Update the content of a note
@@ -175,9 +206,14 @@ public:
     void removeTag(qint32 noteLid, qint32 tag, bool isDirty);            // Remove a tag from a note
     void addTag(qint32 lid, qint32 tag, bool isDirty);                   // Add a tag to a note
     void rebuildNoteListTags(qint32 lid);                                // Update the note's tags in the display table
+    QHash<qint32, QString> rebuildNoteListTagsForNotes(const QList<qint32> &noteLids);  // Bulk update of the notes' tags in the display table
+    QHash<qint32, QString> rebuildNoteListTagsForTags(const QList<qint32> &tagLids);    // Bulk update for all notes carrying these tags
+    QList<qint32> mergeTags(qint32 tagLid, const QList<qint32> &sourceTags, bool isDirty, bool rebuildNoteList=true);  // Add tagLid to every note carrying a source tag
+    QList<qint32> removeTagFromAllNotes(qint32 tagLid, bool rebuildNoteList=true);  // Remove a tag from every note
     void deleteNote(qint32 lid, bool isDirty);                           // mark a note for deletion
     void restoreNote(qint32 lid, bool isDirty);                          // unmark a note for deletion
-    void expunge(qint32 lid);                                            // expunge a note permanently
+    void expunge(qint32 lid);                                            // expunge a note permanently, files are removed in the background
+    qint32 expunge(const QList<qint32> &lids, QStringList &files, bool queueSyncedDeletes);  // bulk expunge; returns the files to remove
     void expunge(QString guid);                                          // expunge a note permanently
     void expunge(string guid);                                           // expunge a note permanently
     void pinNote(string guid, bool value);                               // pin the current note
@@ -194,7 +230,13 @@ public:
     void getAllDeleteQueue(QStringList &guids, QString notebookGuid="");   // Get the list of notes we need to let Evernote to delete
     void expungeFromDeleteQueue(qint32 lid);                              // Expunge from the delete pending queue
     void expungeFromDeleteQueue(QString guid);                            // Expunge from the delete pending queue
+    void queueSync(qint32 lid);                                           // Queue (or re-classify) a dirty note for upload
+    void dequeueSync(qint32 lid);                                         // Remove a note from the upload queue
+    void queueAllDirty();                                                 // Rebuild the upload queue from the dirty flags
+    qint32 getSyncQueue(QList<SyncQueueEntry> &entries);                  // Everything waiting to be uploaded
     qlonglong getSize(qint32 lid);                                          // get the total size of the note
+    static void getContentFlags(const QString &content, bool &hasEncrypt,
+                                bool &hasTodoCompleted, bool &hasTodoUncompleted);  // Scan the content for todos & encryption
 };
 
 
@@ -23,6 +23,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #include <QSqlError>
 
 #include "src/global.h"
+#include "src/utilities/metrics.h"
 
 // Windows Check
 #ifndef _WIN32
@@ -74,6 +75,9 @@ QString getLastExecutedQuery(const QSqlQuery& query)
 
 // Generic exec().  A prepare should have been done already
 bool NSqlQuery::exec() {
+    static MetricHistogram *latency = Metrics::instance().histogram("sql.exec");
+    static MetricCounter *lockRetries = Metrics::instance().counter("sql.lockRetries");
+    MetricsTimer timer(latency);
     bool indexPauseSave;
     bool indexRestoreNeeded = false;
     //QLOG_DEBUG() << "Sending SQL:" << getLastExecutedQuery(*this);
@@ -86,6 +90,7 @@ bool NSqlQuery::exec() {
         }
         if (lastError().number() != DATABASE_LOCKED)
             return false;
+        lockRetries->increment();
         if (i>DEBUG_TRIGGER) {
             QLOG_ERROR() << "DB Locked:  Retry #" << i;
         }
@@ -117,6 +122,9 @@ bool NSqlQuery::exec() {
 
 // Execute a SQL statement
 bool NSqlQuery::exec(const QString &query) {
+    static MetricHistogram *latency = Metrics::instance().histogram("sql.exec");
+    static MetricCounter *lockRetries = Metrics::instance().counter("sql.lockRetries");
+    MetricsTimer timer(latency);
     bool indexPauseSave;
     bool indexRestoreNeeded = false;
     //QLOG_DEBUG() << "Sending SQL:" << query;
@@ -129,6 +137,7 @@ bool NSqlQuery::exec(const QString &query) {
         }
         if (lastError().number() != DATABASE_LOCKED)
             return false;
+        lockRetries->increment();
 
         if (i == INDEX_PAUSE_TRIGGER && this->db->getConnectionName() != "indexrunner") {
             QLOG_DEBUG() << "Pausing indexrunner due to db lock";
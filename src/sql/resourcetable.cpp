@@ -24,6 +24,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #include "src/utilities/mimereference.h"
 #include "src/sql/nsqlquery.h"
 #include "src/utilities/noteindexer.h"
+#include "src/utilities/extractedtextcache.h"
 
 #include <QSqlTableModel>
 
@@ -186,14 +187,13 @@ bool ResourceTable::get(Resource &resource, qint32 lid, bool withBinary) {
     // Now read the binary data from the disk
     if (withBinary) {
         QString mimetype = resource.mime;
-        MimeReference ref;
         QString filename;
         ResourceAttributes attributes;
         if (resource.attributes.isSet())
             attributes = resource.attributes;
         if (attributes.fileName.isSet())
             filename = attributes.fileName;
-        QString fileExt = ref.getExtensionFromMime(mimetype, filename);
+        QString fileExt = MimeReference::getExtensionFromMime(mimetype, filename);
         QFile tfile(global.fileManager.getDbaDirPath() + QString::number(lid) + fileExt);
         tfile.open(QIODevice::ReadOnly);
         QByteArray b = tfile.readAll();
@@ -486,13 +486,12 @@ qint32 ResourceTable::add(qint32 l, Resource &t, bool isDirty, int noteLid) {
             QString mimetype = t.mime;
 
             QString filename;
-            MimeReference ref;
             ResourceAttributes attributes;
             if (t.attributes.isSet())
                 attributes = t.attributes;
             if (attributes.fileName.isSet())
                 filename = attributes.fileName;
-            QString fileExt = ref.getExtensionFromMime(mimetype, filename);
+            QString fileExt = MimeReference::getExtensionFromMime(mimetype, filename);
             QLOG_DEBUG() << "Resource mime=" << mimetype << ", fileExt=" << fileExt;
 
             QString tfileName(global.fileManager.getDbaDirPath() + QString::number(lid) + fileExt);
@@ -794,6 +793,49 @@ bool ResourceTable::getInkNote(QByteArray &value, qint32 lid) {
 }
 
 
+// Offsets are kept as one comma separated list
+bool ResourceTable::getPdfPages(QList<qint32> &offsets, qint32 lid) {
+    offsets.clear();
+    NSqlQuery query(db);
+    db->lockForRead();
+    query.prepare("Select data from DataStore where lid=:lid and key=:key");
+    query.bindValue(":lid", lid);
+    query.bindValue(":key", RESOURCE_PDF_PAGES);
+    query.exec();
+    if (query.next()) {
+        QStringList values = query.value(0).toString().split(",", QString::SkipEmptyParts);
+        for (int i=0; i<values.size(); i++)
+            offsets.append(values[i].toInt());
+    }
+    query.finish();
+    db->unlock();
+    return !offsets.isEmpty();
+}
+
+
+void ResourceTable::setPdfPages(qint32 lid, const QList<qint32> &offsets) {
+    QStringList values;
+    for (int i=0; i<offsets.size(); i++)
+        values.append(QString::number(offsets[i]));
+
+    NSqlQuery query(db);
+    db->lockForWrite();
+    query.prepare("Delete from DataStore where lid=:lid and key=:key");
+    query.bindValue(":lid", lid);
+    query.bindValue(":key", RESOURCE_PDF_PAGES);
+    query.exec();
+    if (!values.isEmpty()) {
+        query.prepare("Insert into DataStore (lid, key, data) values (:lid, :key, :data)");
+        query.bindValue(":lid", lid);
+        query.bindValue(":key", RESOURCE_PDF_PAGES);
+        query.bindValue(":data", values.join(","));
+        query.exec();
+    }
+    query.finish();
+    db->unlock();
+}
+
+
 // Set/unset the index needed flag
 void ResourceTable::setIndexNeeded(qint32 lid, bool indexNeeded) {
     NSqlQuery query(db);
@@ -812,8 +854,10 @@ void ResourceTable::setIndexNeeded(qint32 lid, bool indexNeeded) {
     }
     query.finish();
 
-    NoteIndexer indexer(db);
-    indexer.indexResource(lid);
+    if (indexNeeded) {
+        NoteIndexer indexer(db);
+        indexer.indexResource(lid);
+    }
 
     db->unlock();
 }
@@ -868,11 +912,30 @@ void ResourceTable::expunge(qint32 lid) {
     }
     NSqlQuery query(db);
     db->lockForWrite();
+    query.prepare("select data from DataStore where lid=:lid and key=:key");
+    query.bindValue(":lid", lid);
+    query.bindValue(":key", RESOURCE_DATA_HASH);
+    query.exec();
+    QByteArray hash;
+    if (query.next())
+        hash = query.value(0).toByteArray();
     query.prepare("delete from DataStore where lid=:lid");
     query.bindValue(":lid", lid);
     query.exec();
+
+    // The extracted text is kept while another resource has the same data
+    bool shared = false;
+    if (!hash.isEmpty()) {
+        query.prepare("select lid from DataStore where key=:key and data=:hash limit 1");
+        query.bindValue(":key", RESOURCE_DATA_HASH);
+        query.bindValue(":hash", hash);
+        query.exec();
+        shared = query.next();
+    }
     query.finish();
     db->unlock();
+    if (!hash.isEmpty() && !shared)
+        QFile::remove(ExtractedTextCache(global.fileManager.getTextCacheDirPath("")).fileName(QByteArray::fromHex(hash)));
 
     // Delete the physical files (resource)
     QDir myDir(global.fileManager.getDbaDirPath());
@@ -1176,32 +1239,10 @@ void ResourceTable::getAllResources(QList<Resource> &list, qint32 noteLid, bool
         if (withBinary && fullLoad) {
             Resource *r = i.value();
             qint32 lid = i.key();
-            QString mimetype = r->mime;
-            MimeReference ref;
-            QString filename;
-            ResourceAttributes attributes;
-            if (r->attributes.isSet())
-                attributes = r->attributes;
-            if (attributes.fileName.isSet())
-                filename = attributes.fileName;
-            QString fileExt = ref.getExtensionFromMime(mimetype, filename);
-
-            QString tfileName(global.fileManager.getDbaDirPath() + QString::number(lid) + fileExt);
+            QString tfileName = getDataFilePath(lid, *r);
             QFile tfile(tfileName);
-            QLOG_DEBUG() << "getAllResources lid=" << lid << ", fileExt=" << fileExt << ", tfileName=" << tfileName;
-
-            if (!tfile.open(QIODevice::ReadOnly)) {
-                QDir dir(global.fileManager.getDbaDirPath());
-                QStringList filterList;
-                filterList.append(QString::number(lid) + ".*");
-                QStringList list = dir.entryList(filterList, QDir::Files);
-                if (list.size() > 0) {
-                    QString fileName(global.fileManager.getDbaDirPath() + list[0]);
-                    tfile.setFileName(fileName);
-                    QLOG_DEBUG() << "getAllResources fileName=" << fileName;
-                    tfile.open(QIODevice::ReadOnly);
-                }
-            }
+            QLOG_DEBUG() << "getAllResources lid=" << lid << ", tfileName=" << tfileName;
+            tfile.open(QIODevice::ReadOnly);
             QByteArray b = tfile.readAll();
             Data d;
             if (r->data.isSet())
@@ -1214,3 +1255,44 @@ void ResourceTable::getAllResources(QList<Resource> &list, qint32 noteLid, bool
     }
     QLOG_DEBUG() << "getAllResources: done";
 }
+
+
+
+// Move a file holding the body of a resource (written outside of add(),
+// e.g. while it was being decoded) to where add() would have saved it.
+bool ResourceTable::adoptDataFile(qint32 lid, const Resource &resource, const QString &file) {
+    QString mimetype = resource.mime;
+    QString filename;
+    if (resource.attributes.isSet() && resource.attributes.ref().fileName.isSet())
+        filename = resource.attributes.ref().fileName;
+    QString fileExt = MimeReference::getExtensionFromMime(mimetype, filename);
+
+    QString tfileName(global.fileManager.getDbaDirPath() + QString::number(lid) + fileExt);
+    QFile::remove(tfileName);
+    return QFile::rename(file, tfileName);
+}
+
+
+
+// Return the file in the dba directory holding the body of a resource.
+// Normally the name comes from the mime type, but files written with a
+// different extension are found by lid.
+QString ResourceTable::getDataFilePath(qint32 lid, const Resource &resource) {
+    QString mimetype = resource.mime;
+    QString filename;
+    if (resource.attributes.isSet() && resource.attributes.ref().fileName.isSet())
+        filename = resource.attributes.ref().fileName;
+    QString fileExt = MimeReference::getExtensionFromMime(mimetype, filename);
+
+    QString tfileName(global.fileManager.getDbaDirPath() + QString::number(lid) + fileExt);
+    if (QFile::exists(tfileName))
+        return tfileName;
+
+    QDir dir(global.fileManager.getDbaDirPath());
+    QStringList filterList;
+    filterList.append(QString::number(lid) + ".*");
+    QStringList list = dir.entryList(filterList, QDir::Files);
+    if (list.size() > 0)
+        return global.fileManager.getDbaDirPath() + list[0];
+    return tfileName;
+}
@@ -61,6 +61,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #define RESOURCE_TIMESTAMP               6028
 #define RESOURCE_INKNOTE                 6029
 
+#define RESOURCE_PDF_PAGES               6998
 #define RESOURCE_INDEX_NEEDED            6999
 
 using namespace std;
@@ -92,6 +93,7 @@ public:
     bool getResourceRecognition(Resource &resource, qint32 lid); // Get a resource's recognition data
     qint32 getLidByHashHex(QString noteGuid, QString hash);      // Get a lid by the resource's hash value
     bool getInkNote(QByteArray &value, qint32 lid);              // Get an inknote
+    bool getPdfPages(QList<qint32> &offsets, qint32 lid);        // Where each page starts in the indexed text of a PDF
     qint32 getIndexNeeded(QList<qint32> &lids);                  // Get a list of all resources needing indexing
     bool getResourceList(QList<qint32> &resourceList, qint32 noteLid);  // Get resources for a note
     qint32 getCount();                                           // count of all resources
@@ -102,13 +104,16 @@ public:
     void getResourceMap(QHash<QString, qint32> &map, QHash<qint32, Resource> &resourceMap, string guid);     // Get a resource's MAP data
     void getResourceMap(QHash<QString, qint32> &map, QHash<qint32, Resource> &resourceMap, QString guid);    // Get a resource's MAP data
     void getAllResources(QList<Resource> &list, qint32 noteLid, bool fullLoad, bool withBinary);  // Get all resources for a note
+    QString getDataFilePath(qint32 lid, const Resource &resource);     // File in dba holding the resource body
 
     // DB Write Functions
     void updateGuid(qint32 lid, Guid &guid);                     // Update a resource's guid
     void sync(Resource &resource);                               // Sync a resource with a new record
     void sync(qint32 lid, Resource &resource);                   // Sync a resource with a new record
     qint32 add(qint32 lid, Resource &t, bool isDirty, int noteLid=0);    // Add a new resource
+    bool adoptDataFile(qint32 lid, const Resource &resource, const QString &file);  // Move in a body written elsewhere in dba
     void setIndexNeeded(qint32 lid, bool indexNeeded);           // flag if a resource needs reindexing
+    void setPdfPages(qint32 lid, const QList<qint32> &offsets);  // Save where each page starts in the indexed text
     void expunge(int lid);                                       // erase a resource
     void expunge(QString guid);                                  // erase a resource
     void updateResourceHash(qint32 lid, QByteArray newhash);     // Update a resource's hash value
@@ -0,0 +1,228 @@
+/*********************************************************************************
+NixNote - An open-source client for the Evernote service.
+Copyright (C) 2013 Randy Baumgarte
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+***********************************************************************************/
+
+#include "searchindextable.h"
+#include "src/sql/nsqlquery.h"
+#include "src/global.h"
+
+#include <QStringList>
+#include <QCryptographicHash>
+
+
+SearchIndexTable::SearchIndexTable(DatabaseConnection *db)
+{
+    this->db = db;
+}
+
+
+bool SearchIndexTable::createTables(DatabaseConnection *db) {
+    return createTables(db->conn);
+}
+
+
+bool SearchIndexTable::createTables(QSqlDatabase conn) {
+    QSqlQuery sql(conn);
+    if (!sql.exec("Create virtual table SearchIndex using fts5 (lid unindexed, weight unindexed, source unindexed, "
+                  "content, tokenize='unicode61 remove_diacritics 2')")) {
+        QLOG_ERROR() << "Creation of SearchIndex table failed: " << sql.lastError();
+        return false;
+    }
+    if (!sql.exec("Create virtual table SearchIndexTrigram using fts5 (content, content='', tokenize='trigram')")) {
+        QLOG_ERROR() << "Creation of SearchIndexTrigram table failed: " << sql.lastError();
+        return false;
+    }
+    return true;
+}
+
+
+// FTS5 and its trigram tokenizer (SQLite 3.34) are optional parts of SQLite
+// and the search index can't work without them.
+bool SearchIndexTable::isSupported(QSqlDatabase conn) {
+    QSqlQuery sql(conn);
+    if (!sql.exec("Create virtual table temp.SearchIndexCheck using fts5 (content, tokenize='trigram')")) {
+        QLOG_ERROR() << "FTS5 trigram check failed: " << sql.lastError();
+        return false;
+    }
+    sql.exec("Drop table temp.SearchIndexCheck");
+    return true;
+}
+
+
+void SearchIndexTable::add(qint32 lid, qint32 weight, const QString &source, const QString &content) {
+    NSqlQuery sql(db);
+    sql.prepare("Insert into SearchIndex (lid, weight, source, content) values (:lid, :weight, :source, :content)");
+    sql.bindValue(":lid", lid);
+    sql.bindValue(":weight", weight);
+    sql.bindValue(":source", source);
+    sql.bindValue(":content", content);
+    if (!sql.exec())
+        return;
+    QVariant rowid = sql.lastInsertId();
+
+    sql.prepare("Insert into SearchIndexTrigram (rowid, content) values (:rowid, :content)");
+    sql.bindValue(":rowid", rowid);
+    sql.bindValue(":content", content);
+    sql.exec();
+
+    sql.prepare("Insert into SearchIndexRows (row, lid, source) values (:rowid, :lid, :source)");
+    sql.bindValue(":rowid", rowid);
+    sql.bindValue(":lid", lid);
+    sql.bindValue(":source", source);
+    sql.exec();
+}
+
+
+// A contentless FTS5 table can only forget a row when it is given the
+// exact values it indexed, so they are read back from SearchIndex first.
+// The lid & source columns of SearchIndex can't be searched without a full
+// scan, so the rows are found through SearchIndexRows.
+void SearchIndexTable::remove(qint32 lid) {
+    NSqlQuery sql(db);
+    sql.prepare("Insert into SearchIndexTrigram (SearchIndexTrigram, rowid, content) "
+                "select 'delete', rowid, content from SearchIndex where rowid in "
+                "(select row from SearchIndexRows where lid=:lid)");
+    sql.bindValue(":lid", lid);
+    sql.exec();
+    sql.prepare("Delete from SearchIndex where rowid in (select row from SearchIndexRows where lid=:lid)");
+    sql.bindValue(":lid", lid);
+    sql.exec();
+    sql.prepare("Delete from SearchIndexRows where lid=:lid");
+    sql.bindValue(":lid", lid);
+    sql.exec();
+    sql.prepare("Delete from SearchIndexHash where lid=:lid");
+    sql.bindValue(":lid", lid);
+    sql.exec();
+}
+
+
+void SearchIndexTable::remove(qint32 lid, const QString &source) {
+    NSqlQuery sql(db);
+    sql.prepare("Insert into SearchIndexTrigram (SearchIndexTrigram, rowid, content) "
+                "select 'delete', rowid, content from SearchIndex where rowid in "
+                "(select row from SearchIndexRows where lid=:lid and source=:source)");
+    sql.bindValue(":lid", lid);
+    sql.bindValue(":source", source);
+    sql.exec();
+    sql.prepare("Delete from SearchIndex where rowid in "
+                "(select row from SearchIndexRows where lid=:lid and source=:source)");
+    sql.bindValue(":lid", lid);
+    sql.bindValue(":source", source);
+    sql.exec();
+    sql.prepare("Delete from SearchIndexRows where lid=:lid and source=:source");
+    sql.bindValue(":lid", lid);
+    sql.bindValue(":source", source);
+    sql.exec();
+    sql.prepare("Delete from SearchIndexHash where lid=:lid and source=:source");
+    sql.bindValue(":lid", lid);
+    sql.bindValue(":source", source);
+    sql.exec();
+}
+
+
+void SearchIndexTable::remove(const QList<qint32> &lids) {
+    if (lids.isEmpty())
+        return;
+    QStringList values;
+    for (int i=0; i<lids.size(); i++)
+        values.append(QString::number(lids[i]));
+    QString rows = "(select row from SearchIndexRows where lid in (" + values.join(",") + "))";
+
+    NSqlQuery sql(db);
+    sql.exec("Insert into SearchIndexTrigram (SearchIndexTrigram, rowid, content) "
+             "select 'delete', rowid, content from SearchIndex where rowid in " + rows);
+    sql.exec("Delete from SearchIndex where rowid in " + rows);
+    sql.exec("Delete from SearchIndexRows where lid in (" + values.join(",") + ")");
+    sql.exec("Delete from SearchIndexHash where lid in (" + values.join(",") + ")");
+}
+
+
+bool SearchIndexTable::replace(qint32 lid, const QString &source, const QString &hash, const QList<SearchIndexRow> &rows) {
+    if (hash != "" && getHash(lid, source) == hash)
+        return false;
+
+    remove(lid, source);
+    for (int i=0; i<rows.size(); i++)
+        add(lid, rows[i].first, source, rows[i].second);
+    if (hash == "")
+        return true;
+
+    NSqlQuery sql(db);
+    sql.prepare("Insert into SearchIndexHash (lid, source, hash) values (:lid, :source, :hash)");
+    sql.bindValue(":lid", lid);
+    sql.bindValue(":source", source);
+    sql.bindValue(":hash", hash);
+    sql.exec();
+    return true;
+}
+
+
+QString SearchIndexTable::getHash(qint32 lid, const QString &source) {
+    NSqlQuery sql(db);
+    sql.prepare("Select hash from SearchIndexHash where lid=:lid and source=:source");
+    sql.bindValue(":lid", lid);
+    sql.bindValue(":source", source);
+    sql.exec();
+    QString hash = "";
+    if (sql.next())
+        hash = sql.value(0).toString();
+    sql.finish();
+    return hash;
+}
+
+
+// Forget what was indexed, so the next replace() rewrites the rows
+void SearchIndexTable::clearHashes() {
+    NSqlQuery sql(db);
+    sql.exec("Delete from SearchIndexHash");
+}
+
+
+void SearchIndexTable::clearHashes(const QList<qint32> &lids) {
+    if (lids.isEmpty())
+        return;
+    QStringList values;
+    for (int i=0; i<lids.size(); i++)
+        values.append(QString::number(lids[i]));
+
+    NSqlQuery sql(db);
+    sql.exec("Delete from SearchIndexHash where lid in (" + values.join(",") + ")");
+}
+
+
+QString SearchIndexTable::contentHash(const QList<SearchIndexRow> &rows) {
+    QByteArray data;
+    for (int i=0; i<rows.size(); i++) {
+        data.append(QByteArray::number(rows[i].first));
+        data.append('\0');
+        data.append(rows[i].second.toUtf8());
+        data.append('\0');
+    }
+    return contentHash(data);
+}
+
+
+// The settings which change how text is normalized are part of the hash,
+// so content indexed before they changed isn't current anymore.
+QString SearchIndexTable::contentHash(const QByteArray &data) {
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    hash.addData(data);
+    hash.addData(global.isForceSearchLowerCase() ? "l" : "-");
+    hash.addData(global.isForceSearchWithoutDiacritics() ? "d" : "-");
+    return QString(hash.result().toHex());
+}
@@ -0,0 +1,74 @@
+/*********************************************************************************
+NixNote - An open-source client for the Evernote service.
+Copyright (C) 2013 Randy Baumgarte
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+***********************************************************************************/
+
+#ifndef SEARCHINDEXTABLE_H
+#define SEARCHINDEXTABLE_H
+
+#include <QString>
+#include <QList>
+#include <QPair>
+#include <QByteArray>
+#include <QSqlDatabase>
+#include "src/sql/databaseconnection.h"
+
+// A row of the index: weight & content
+typedef QPair<qint32, QString> SearchIndexRow;
+
+
+// Read/Write the full text index.  SearchIndex is an FTS5 table using the
+// unicode61 tokenizer for word searches.  SearchIndexTrigram is a contentless
+// FTS5 trigram index over the same rows (same rowid) used for substring
+// searches, which the word index can't answer.  Every write goes through
+// here so the two stay in step.  Callers handle locking & transactions.
+//
+// SearchIndexHash keeps the hash of what the rows of each lid & source were
+// indexed from, so replace() can leave unchanged content alone.
+//
+// SearchIndexRows maps each lid & source to its rowids, since the unindexed
+// columns of SearchIndex can only be searched with a full scan.
+
+class SearchIndexTable
+{
+private:
+    DatabaseConnection *db;
+
+public:
+    SearchIndexTable(DatabaseConnection *db);
+
+    void add(qint32 lid, qint32 weight, const QString &source, const QString &content);
+    void remove(qint32 lid);
+    void remove(qint32 lid, const QString &source);
+    void remove(const QList<qint32> &lids);
+
+    // Replace the rows of a lid & source, unless they were indexed from
+    // content with the same hash.  An empty hash is never current.
+    // Returns false when the rows were left alone.
+    bool replace(qint32 lid, const QString &source, const QString &hash, const QList<SearchIndexRow> &rows);
+    QString getHash(qint32 lid, const QString &source);
+    void clearHashes();
+    void clearHashes(const QList<qint32> &lids);
+
+    static QString contentHash(const QList<SearchIndexRow> &rows);
+    static QString contentHash(const QByteArray &data);
+    static bool createTables(DatabaseConnection *db);
+    static bool createTables(QSqlDatabase conn);
+    static bool isSupported(QSqlDatabase conn);     // FTS5 with the trigram tokenizer
+};
+
+#endif // SEARCHINDEXTABLE_H
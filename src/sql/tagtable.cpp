@@ -217,11 +217,9 @@ void TagTable::update(Tag &tag, bool dirty=true) {
 
         // Now update the Note display list
         NoteTable noteTable(db);
-        QList<qint32> noteList;
-        noteTable.findNotesByTag(noteList, lid);
-        for (qint32 i=0; i<noteList.size(); i++) {
-            noteTable.rebuildNoteListTags(noteList[i]);
-        }
+        QList<qint32> tags;
+        tags.append(lid);
+        noteTable.rebuildNoteListTagsForTags(tags);
     }
 }
 
@@ -549,8 +547,9 @@ bool TagTable::getGuid(QString &guid, qint32 lid) {
 
 
 
-// Delete this tag
-void TagTable::deleteTag(qint32 lid) {
+// Delete this tag.  The note list column of its notes is left alone if the
+// caller rebuilds it anyway (i.e. after a merge).
+void TagTable::deleteTag(qint32 lid, bool rebuildNoteList) {
     if (!exists(lid))
         return;
 
@@ -595,24 +594,18 @@ void TagTable::deleteTag(qint32 lid) {
         db->unlock();
         setDirty(lid, true);
     } else {
-        expunge(lid);
+        expunge(lid, rebuildNoteList);
     }
     query.finish();
 
-    // Now, find all the notes with this tag and remove them.
-    QList<qint32> noteLids;
-    noteTable.findNotesByTag(noteLids, lid);
-    for (int j=0; j<noteLids.size(); j++) {
-        noteTable.removeTag(noteLids[j], lid, false);
-    }
+    // Now, remove the tag from all the notes with it.
+    noteTable.removeTagFromAllNotes(lid, rebuildNoteList);
 }
 
 
 
 // Erase a tag
-void TagTable::expunge(qint32 lid) {
-    QString tagGuid;
-    this->getGuid(tagGuid, lid);
+void TagTable::expunge(qint32 lid, bool rebuildNoteList) {
     NSqlQuery query(db);
     db->lockForWrite();
     query.prepare("delete from DataStore where lid=:lid");
@@ -622,10 +615,7 @@ void TagTable::expunge(qint32 lid) {
     db->unlock();
 
     NoteTable noteTable(db);
-    QList<int> notes;
-    noteTable.findNotesByTag(notes, tagGuid);
-    for (int i=0; i<notes.size(); i++)
-        noteTable.removeTag(notes[i], lid, false);
+    noteTable.removeTagFromAllNotes(lid, rebuildNoteList);
 }
 
 
@@ -85,8 +85,8 @@ public:
     void setDirty(QString guid, bool dirty);    // set the note dirty flag
     void setDirty(qint32 lid, bool dirty);      // set the note dirty flag
     void updateGuid(qint32 lid, Guid &guid);    // Update a tag's guid
-    void deleteTag(qint32 lid);                 // delete a tag
-    void expunge(qint32 lid);                   // really delete a tag
+    void deleteTag(qint32 lid, bool rebuildNoteList=true);  // delete a tag
+    void expunge(qint32 lid, bool rebuildNoteList=true);    // really delete a tag
     void expunge(QString guid);                 // really delete a tag
     void expunge(string guid);                  // really delete a tag
     qint32 sync(Tag &tag, qint32 account);      // Sync a tag with a new record
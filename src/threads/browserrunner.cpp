@@ -22,16 +22,28 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 
 
 #include "src/global.h"
-#include "src/utilities/nuuid.h"
 #include "src/utilities/noteindexer.h"
 #include "src/sql/notetable.h"
 
 extern Global global;
 
+// Time (in ms) saves are collected before they are written.  Repeated saves of
+// the same note within this window only write the newest content.
+#define SAVE_COALESCE_INTERVAL 300
+
 BrowserRunner::BrowserRunner(QObject *parent) : QObject(parent)
 {
     isIdle = true;
     init = false;
+    keepRunning = true;
+    db = nullptr;
+    flushTimer = nullptr;
+    totalSaves = 0;
+    totalCoalesced = 0;
+    totalBatches = 0;
+    lastLatency = 0;
+    maxLatency = 0;
+    totalLatency = 0;
 }
 
 
@@ -39,22 +51,116 @@ BrowserRunner::BrowserRunner(QObject *parent) : QObject(parent)
 void BrowserRunner::initialize() {
     init = true;
 
-    QLOG_DEBUG() << "Starting CounterRunner";
-    db = new DatabaseConnection("browserrunner-"+NUuid().create());
-    QLOG_DEBUG() << "CounterRunner initialization complete.";
+    QLOG_DEBUG() << "Starting BrowserRunner";
+    db = new DatabaseConnection("browserrunner");
+    flushTimer = new QTimer(this);
+    flushTimer->setSingleShot(true);
+    connect(flushTimer, SIGNAL(timeout()), this, SLOT(flush()));
+    clock.start();
+    QLOG_DEBUG() << "BrowserRunner initialization complete.";
 }
 
 
+// Queue a note save.  If the note is already waiting to be written only the
+// newest content is kept.
 void BrowserRunner::updateNoteContent(qint32 lid, QString content, bool isDirty) {
     isIdle = false;
 
     if (!init)
         initialize();
 
-    QLOG_DEBUG() << "Updating note content";
-    NoteTable table(db);
-    table.updateNoteContent(lid, content, isDirty);
+    if (pending.contains(lid)) {
+        PendingSave &save = pending[lid];
+        save.content = content;
+        save.isDirty = save.isDirty || isDirty;
+        save.versions++;
+        totalCoalesced++;
+    } else {
+        PendingSave save;
+        save.content = content;
+        save.isDirty = isDirty;
+        save.queuedAt = clock.elapsed();
+        save.versions = 1;
+        pending.insert(lid, save);
+        pendingOrder.append(lid);
+        queueDepth.fetchAndAddOrdered(1);
+    }
+
+    if (!flushTimer->isActive())
+        flushTimer->start(SAVE_COALESCE_INTERVAL);
+}
+
+
+// Write all queued saves in a single transaction.
+void BrowserRunner::flush() {
+    if (!init || pending.isEmpty()) {
+        isIdle = true;
+        return;
+    }
+    flushTimer->stop();
 
+    QElapsedTimer writeTime;
+    writeTime.start();
+    NoteTable table(db);
+    bool transaction = db->conn.transaction();
+    for (int i=0; i<pendingOrder.size(); i++) {
+        qint32 lid = pendingOrder[i];
+        const PendingSave &save = pending[lid];
+        table.updateNoteContent(lid, save.content, save.isDirty);
+    }
+    if (transaction && !db->conn.commit()) {
+        QLOG_ERROR() << "Unable to commit note saves: " << db->conn.lastError();
+        db->conn.rollback();
+    }
+
+    qint64 now = clock.elapsed();
+    qint32 versions = 0;
+    for (int i=0; i<pendingOrder.size(); i++) {
+        qint32 lid = pendingOrder[i];
+        const PendingSave &save = pending[lid];
+        qint64 latency = now - save.queuedAt;
+        lastLatency = latency;
+        totalLatency += latency;
+        maxLatency = qMax(maxLatency, latency);
+        versions += save.versions;
+        emit(noteContentSaved(lid));
+    }
+    totalSaves += pendingOrder.size();
+    totalBatches++;
+
+    QLOG_DEBUG() << "Note save batch: " << pendingOrder.size() << " notes (" << versions << " saves) written in "
+                 << writeTime.elapsed() << " ms, last latency=" << lastLatency << " ms, average latency="
+                 << getAverageLatency() << " ms, coalesced total=" << totalCoalesced;
+
+    queueDepth.fetchAndAddOrdered(-pendingOrder.size());
+    pending.clear();
+    pendingOrder.clear();
     isIdle = true;
 }
 
+
+int BrowserRunner::getQueueDepth() {
+    return queueDepth.load();
+}
+
+qint64 BrowserRunner::getLastLatency() {
+    return lastLatency;
+}
+
+qint64 BrowserRunner::getMaxLatency() {
+    return maxLatency;
+}
+
+qint64 BrowserRunner::getAverageLatency() {
+    if (totalSaves <= 0)
+        return 0;
+    return totalLatency / totalSaves;
+}
+
+qint64 BrowserRunner::getSaveCount() {
+    return totalSaves;
+}
+
+qint64 BrowserRunner::getCoalescedCount() {
+    return totalCoalesced;
+}
@@ -2,8 +2,28 @@
 #define BROWSERRUNNER_H
 
 #include <QObject>
+#include <QHash>
+#include <QList>
+#include <QTimer>
+#include <QAtomicInt>
+#include <QElapsedTimer>
 #include "src/sql/databaseconnection.h"
 
+
+// A note save waiting to be written.
+class PendingSave
+{
+public:
+    QString content;
+    bool isDirty;
+    qint64 queuedAt;      // msecs on the runner clock when the first (oldest) version was queued
+    qint32 versions;      // number of saves collapsed into this one
+};
+
+
+// Shared background save service.  All editor windows queue their note content here.
+// Saves of the same lid arriving before the next flush are coalesced and the whole
+// batch is written in one transaction on a single connection.
 class BrowserRunner : public QObject
 {
     Q_OBJECT
@@ -12,16 +32,39 @@ private:
     bool init;
     void initialize();
 
+    QHash<qint32, PendingSave> pending;
+    QList<qint32> pendingOrder;
+    QTimer *flushTimer;
+    QElapsedTimer clock;
+
+    // metrics
+    QAtomicInt queueDepth;
+    qint64 totalSaves;
+    qint64 totalCoalesced;
+    qint64 totalBatches;
+    qint64 lastLatency;
+    qint64 maxLatency;
+    qint64 totalLatency;
+
 public:
     explicit BrowserRunner(QObject *parent = 0);
 
     bool keepRunning;
     bool isIdle;
 
+    int getQueueDepth();               // Saves waiting to be written
+    qint64 getLastLatency();           // ms between the first queue & the commit of the last save
+    qint64 getMaxLatency();
+    qint64 getAverageLatency();
+    qint64 getSaveCount();             // Notes written
+    qint64 getCoalescedCount();        // Saves that were replaced by a newer version before being written
+
 signals:
+    void noteContentSaved(qint32 lid);
 
 public slots:
     void updateNoteContent(qint32 lid, QString content, bool isDirty);
+    void flush();
 };
 
 #endif // BROWSERRUNNER_H
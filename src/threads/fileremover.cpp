@@ -0,0 +1,59 @@
+/*********************************************************************************
+NixNote - An open-source client for the Evernote service.
+Copyright (C) 2013 Randy Baumgarte
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+***********************************************************************************/
+
+#include "fileremover.h"
+#include <QFile>
+#include <QThreadPool>
+
+// How often (in files) progress is reported
+#define FILE_REMOVER_PROGRESS_STEP 250
+
+
+FileRemover::FileRemover(QStringList files, QObject *parent) :
+    QObject(parent)
+{
+    this->files = files;
+
+    // The object is deleted through deleteLater() once finished() has
+    // been delivered, never by the pool (see removeInBackground()).
+    setAutoDelete(false);
+}
+
+
+void FileRemover::run() {
+    qint32 removed = 0;
+    qint32 total = files.size();
+    for (int i=0; i<total; i++) {
+        if (QFile::remove(files[i]))
+            removed++;
+        if ((i+1) % FILE_REMOVER_PROGRESS_STEP == 0)
+            emit(progress(i+1, total));
+    }
+    emit(progress(total, total));
+    emit(finished(removed));
+}
+
+
+void FileRemover::removeInBackground(const QStringList &files) {
+    if (files.isEmpty())
+        return;
+    FileRemover *remover = new FileRemover(files);
+    remover->setAutoDelete(true);
+    QThreadPool::globalInstance()->start(remover);
+}
@@ -0,0 +1,50 @@
+/*********************************************************************************
+NixNote - An open-source client for the Evernote service.
+Copyright (C) 2013 Randy Baumgarte
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+***********************************************************************************/
+
+#ifndef FILEREMOVER_H
+#define FILEREMOVER_H
+
+#include <QObject>
+#include <QRunnable>
+#include <QStringList>
+
+
+// Deletes a list of known files on a pool thread.  Used by the expunge
+// so that removing notes never scans a directory.  Files which do not
+// exist are simply skipped.
+class FileRemover : public QObject, public QRunnable
+{
+    Q_OBJECT
+private:
+    QStringList files;
+
+public:
+    explicit FileRemover(QStringList files, QObject *parent = 0);
+    void run();
+
+    // Remove the files on the global pool without waiting or reporting.
+    // Call it after the transaction that dropped their rows is committed.
+    static void removeInBackground(const QStringList &files);
+
+signals:
+    void progress(qint32 done, qint32 total);
+    void finished(qint32 removed);
+};
+
+#endif // FILEREMOVER_H
@@ -22,16 +22,14 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #include "src/sql/notetable.h"
 #include "src/sql/nsqlquery.h"
 #include "src/sql/resourcetable.h"
+#include "src/sql/searchindextable.h"
+#include "src/utilities/noteindexer.h"
+#include "src/utilities/extractedtextcache.h"
+#include "src/utilities/metrics.h"
 #include <QTextDocument>
 #include <QtXml>
-#if QT_VERSION < 0x050000
-#include <poppler-qt4.h>
-#else
-#include <poppler-qt5.h>
-#endif
 
 extern Global global;
-using namespace Poppler;
 
 
 
@@ -148,6 +146,8 @@ void IndexRunner::index() {
 
     countPause = global.indexResourceCountPause;
     finishedLids.clear();
+    NoteIndexer indexer(db);
+    indexer.cancelled = [this]() { return !keepRunning || pauseIndexing; };
     // Start indexing resources
     if (keepRunning && !pauseIndexing && resourceTable.getIndexNeeded(lids) > 0) {
         endMsgNeeded = true;
@@ -158,16 +158,15 @@ void IndexRunner::index() {
             Resource r;
             resourceTable.get(r, lids.at(i), false);
             qint32 noteLid = noteTable.getLid(r.noteGuid);
-            indexRecognition(noteLid, r);
+
+            // Recognition & PDFs, each only when what they're indexed from changed
+            if (!indexer.indexResource(lids.at(i)))
+                break;
             QString mime = "";
             if (r.mime.isSet())
                 mime = r.mime;
-            if (mime == "application/pdf")
-                indexPdf(noteLid, r);
-            else {
-                if (mime.startsWith("application", Qt::CaseInsensitive))
-                    indexAttachment(noteLid, r);
-            }
+            if (mime != "application/pdf" && mime.startsWith("application", Qt::CaseInsensitive))
+                indexAttachment(noteLid, r);
             finishedLids.append(lids[i]);
             if (countPause <=0) {
                 flushCache();
@@ -204,6 +203,8 @@ void IndexRunner::index() {
 
 // This indexes the actual note.
 void IndexRunner::indexNote(qint32 lid, Note &n) {
+    static MetricHistogram *latency = Metrics::instance().histogram("index.note");
+    MetricsTimer timer(latency);
     if (n.title.isSet()) {
         QLOG_DEBUG() << "Indexing note: " << n.title;
     }
@@ -260,119 +261,10 @@ void IndexRunner::indexNote(qint32 lid, Note &n) {
 
 
 
-// Index any resources
-void IndexRunner::indexRecognition(qint32 lid, Resource &r) {
-
-    if (!keepRunning || pauseIndexing) {
-        //indexTimer->start();
-        return;
-    }
-
-    // Add filename or source url to search index
-    if (r.attributes.isSet()) {
-        NSqlQuery sql(db);
-        ResourceAttributes a = r.attributes;
-        if (a.fileName.isSet()) {
-            sql.prepare("Insert into SearchIndex (lid, weight, source, content) values (:lid, :weight, :source, :content)");
-            sql.bindValue(":lid", lid);
-            sql.bindValue(":weight", 100);
-            sql.bindValue(":source", "recognition");
-            sql.bindValue(":content", QString(a.fileName));
-            sql.exec();
-        }
-        if (a.sourceURL.isSet()) {
-            sql.prepare("Insert into SearchIndex (lid, weight, source, content) values (:lid, :weight, :source, :content)");
-            sql.bindValue(":lid", lid);
-            sql.bindValue(":weight", 100);
-            sql.bindValue(":source", "recognition");
-            sql.bindValue(":content", QString(a.sourceURL));
-            sql.exec();
-        }
-    }
-
-
-    // Make sure we have something to look through.
-    Data recognition;
-    if (r.recognition.isSet())
-        recognition = r.recognition;
-    if (!recognition.body.isSet())
-        return;
-
-    QDomDocument doc;
-    QString emsg;
-    doc.setContent(recognition.body, &emsg);
-
-    // look for text tags
-    QDomNodeList anchors = doc.documentElement().elementsByTagName("t");
-#if QT_VERSION < 0x050000
-    for (unsigned int i=0; keepRunning && !pauseIndexing && i<anchors.length(); i++) {
-#else
-    for (int i=0; keepRunning && !pauseIndexing && i<anchors.length(); i++) {
-#endif
-        QApplication::processEvents();
-        QDomElement enmedia = anchors.at(i).toElement();
-        QString weight = enmedia.attribute("w");
-        QString text = enmedia.text();
-        if (text != "") {
-            IndexRecord *rec = new IndexRecord();
-            rec->weight = weight.toInt();
-            rec->lid = lid;
-            rec->content = text;
-            rec->source = "recognition";
-            if (indexHash->contains(lid)) {
-                delete indexHash->value(lid);
-                indexHash->remove(lid);
-            }
-            indexHash->insert(lid, rec);
-        }
-    }
-}
-
-
-// Index any PDFs that are attached.  Basically it turns the PDF into text and adds it the same
-// way as a note's body
-void IndexRunner::indexPdf(qint32 lid, Resource &r) {
-    if (!global.indexPDFLocally)
-        return;
-    if (!keepRunning || pauseIndexing) {
-        //indexTimer->start();
-        return;
-    }
-    ResourceTable rtable(db);
-    qint32 reslid = rtable.getLid(r.guid);
-    if (lid <= 0) {
-        //indexTimer->start();
-        return;
-    }
-    QString file = global.fileManager.getDbaDirPath() + QString::number(reslid) +".pdf";
-
-    QString text = "";
-    Poppler::Document *doc = Poppler::Document::load(file);
-    if (doc == nullptr || doc->isEncrypted() || doc->isLocked()) {
-        //indexTimer->start();
-        return;
-    }
-    for (int i=0; keepRunning && !pauseIndexing && i<doc->numPages(); i++) {
-        QRectF rect;
-        text = text + doc->page(i)->text(rect) + QString(" ");
-    }
-    IndexRecord *rec = new IndexRecord();
-    rec->content = text;
-    rec->source = "recognition";
-    rec->weight = 100;
-    rec->lid = lid;
-    if (indexHash->contains(lid)) {
-        delete indexHash->value(lid);
-        indexHash->remove(lid);
-    }
-    indexHash->insert(lid, rec);
-}
-
-
-
-
 // Index any files that are attached.
 void IndexRunner::indexAttachment(qint32 lid, Resource &r) {
+    static MetricHistogram *latency = Metrics::instance().histogram("index.attachment");
+    MetricsTimer timer(latency);
     if (!officeFound)
         return;
     QLOG_DEBUG() << "indexing attachment to note " << lid;
@@ -408,6 +300,32 @@ void IndexRunner::indexAttachment(qint32 lid, Resource &r) {
         extension != ".docm")
                 return;
 
+    // The attachment is only converted when its data changed, and the
+    // text is taken from the cache when the same file was converted before
+    SearchIndexTable searchIndex(db);
+    QByteArray bodyHash = NoteIndexer::bodyHash(r);
+    QString hash = bodyHash.isEmpty() ? QString("") : SearchIndexTable::contentHash(bodyHash);
+    if (hash != "" && searchIndex.getHash(reslid, "attachment") == hash)
+        return;
+    ExtractedTextCache cache(global.fileManager.getTextCacheDirPath(""));
+    QStringList pages;
+    if (!cache.get(bodyHash, pages)) {
+        if (!convertAttachment(lid, reslid, extension, pages))
+            return;
+        cache.put(bodyHash, pages);
+    }
+
+    QList<SearchIndexRow> rows;
+    rows.append(SearchIndexRow(100, global.normalizeTermForSearchAndIndex(pages.join(" "))));
+    db->lockForWrite();
+    QLOG_DEBUG() << "Adding note resource to index DB";
+    searchIndex.replace(reslid, "attachment", hash, rows);
+    db->unlock();
+}
+
+
+// Convert an attachment to text with soffice
+bool IndexRunner::convertAttachment(qint32 lid, qint32 reslid, const QString &extension, QStringList &pages) {
     QString file = global.fileManager.getDbaDirPath() + QString::number(reslid) +extension;
     QFile dataFile(file);
     if (!dataFile.exists()) {
@@ -441,36 +359,30 @@ void IndexRunner::indexAttachment(qint32 lid, Resource &r) {
     if (rc == 255) {
         QLOG_ERROR() << "soffice not found.  Disabling attachment indexing.";
         this->officeFound = false;
-        return;
+        return false;
     }
     QFile txtFile(outDir+QString::number(reslid) +".txt");
-    if (txtFile.open(QIODevice::ReadOnly)) {
-        QString text;
-        text = txtFile.readAll();
-        NSqlQuery sql(db);
-        db->lockForWrite();
-        sql.prepare("Insert into SearchIndex (lid, weight, source, content) values (:lid, :weight, 'recognition', :content)");
-        sql.bindValue(":lid", lid);
-        sql.bindValue(":weight", 100);
-
-        text = global.normalizeTermForSearchAndIndex(text);
-        sql.bindValue(":content", text);
-
-        QLOG_DEBUG() << "Adding note resource to index DB";
-        sql.exec();
-        db->unlock();
+    bool converted = txtFile.open(QIODevice::ReadOnly);
+    if (converted) {
+        pages.append(QString(txtFile.readAll()));
         txtFile.close();
     }
     QDir dir;
     dir.remove(outDir+QString::number(reslid) +".txt");
+    return converted;
 }
 
 
 void IndexRunner::flushCache() {
     if (indexHash->size() <= 0)
         return;
-    QDateTime start = QDateTime::currentDateTimeUtc();
+    static MetricHistogram *latency = Metrics::instance().histogram("index.flushCache");
+    static MetricCounter *records = Metrics::instance().counter("index.recordsWritten");
+    static MetricCounter *unchanged = Metrics::instance().counter("index.recordsUnchanged");
+    MetricsTimer timer(latency);
+    records->increment(indexHash->size());
     NSqlQuery sql(db);
+    SearchIndexTable searchIndex(db);
     db->lockForWrite();
     sql.exec("begin");
     QHash<qint32, IndexRecord*>::iterator i;
@@ -486,22 +398,12 @@ void IndexRunner::flushCache() {
         QString content = rec->content;
         delete rec;
 
-        // Delete any old content
-        sql.prepare("Delete from SearchIndex where lid=:lid and source=:source");
-        sql.bindValue(":lid", lid);
-        sql.bindValue(":source", source);
-        sql.exec();
-
-        // Add the new content.  it is basically a text version of the note with a weight of 100.
-        sql.prepare("Insert into SearchIndex (lid, weight, source, content) values (:lid, :weight, :source, :content)");
-        sql.bindValue(":lid", lid);
-        sql.bindValue(":weight", weight);
-        sql.bindValue(":source", source);
-
-        content = global.normalizeTermForSearchAndIndex(content);
-        sql.bindValue(":content", content);
-
-        sql.exec();
+        // Replace the old content, unless it didn't change.  It is basically a text
+        // version of the note with a weight of 100.
+        QList<SearchIndexRow> rows;
+        rows.append(SearchIndexRow(weight, global.normalizeTermForSearchAndIndex(content)));
+        if (!searchIndex.replace(lid, source, SearchIndexTable::contentHash(rows), rows))
+            unchanged->increment();
         commitCount--;
         if (commitCount <= 0) {
             sql.exec("commit");
@@ -513,11 +415,8 @@ void IndexRunner::flushCache() {
 
     sql.finish();
     db->unlock();
-    QDateTime finish = QDateTime::currentDateTimeUtc();
 
-    QLOG_DEBUG() << "Index Cache Flush Complete: " <<
-                    finish.toMSecsSinceEpoch() - start.toMSecsSinceEpoch()
-                    << " milliseconds.";
+    QLOG_DEBUG() << "Index Cache Flush Complete: " << timer.elapsed() << " milliseconds.";
 }
 
 
@@ -23,6 +23,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #include <QObject>
 #include <QThread>
 #include <QString>
+#include <QStringList>
 #include <QMap>
 #include <QHash>
 #include <QVector>
@@ -63,10 +64,9 @@ private:
     QTimer *indexTimer;
     QHash<qint32, IndexRecord*> *indexHash;
     bool init;
-    void indexRecognition(qint32 lid, Resource &r);
     void indexNote(qint32 lid, Note &n);
-    void indexPdf(qint32 lid, Resource &r);
     void indexAttachment(qint32 lid, Resource &r);
+    bool convertAttachment(qint32 lid, qint32 reslid, const QString &extension, QStringList &pages);
     QTextDocument *textDocument;
     DatabaseConnection *db;
     void flushCache();
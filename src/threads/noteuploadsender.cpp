@@ -0,0 +1,74 @@
+/*********************************************************************************
+NixNote - An open-source client for the Evernote service.
+Copyright (C) 2013 Randy Baumgarte
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+***********************************************************************************/
+
+#include "noteuploadsender.h"
+#include "src/sql/notetable.h"
+#include "src/global.h"
+
+extern Global global;
+
+
+NoteUploadSender::NoteUploadSender(DatabaseConnection *db, CommunicationManager *comm, QObject *parent) :
+    UploadSender(parent)
+{
+    this->db = db;
+    this->comm = comm;
+}
+
+
+void NoteUploadSender::send(qint32 lid) {
+    NoteTable noteTable(db);
+    Note note;
+    if (!noteTable.get(note, lid, true, true)) {
+        QLOG_ERROR() << "Cannot load note " << lid << " for upload";
+        emit finished(lid, 0, Failed);
+        return;
+    }
+    qint32 oldUsn = note.updateSequenceNum.isSet() ? note.updateSequenceNum.ref() : 0;
+    QString title = note.title.isSet() ? note.title.ref() : QString();
+
+    AsyncResult *result = comm->uploadNoteAsync(note);
+    connect(result, &AsyncResult::finished, this,
+            [this, lid, oldUsn, title](QVariant value, QSharedPointer<EverCloudExceptionData> exception) {
+        Note uploaded;
+        uploaded.title = title;
+        qint32 usn = comm->uploadNoteFinished(uploaded, value, exception);
+        if (usn == 0) {
+            if (title != "") {
+                QLOG_ERROR() << tr("Error uploading note:") + title;
+            } else {
+                QLOG_ERROR() << tr("Error uploading note with a missing title!");
+            }
+            // Problems with the note itself don't stop the other notes
+            CommunicationError::CommunicationErrorType type = comm->getLastErrorType();
+            bool noteProblem = type == CommunicationError::EDAMNotFoundException ||
+                    (type == CommunicationError::EDAMUserException &&
+                     comm->getLastErrorCode() != EDAMErrorCode::AUTH_EXPIRED);
+            emit finished(lid, 0, noteProblem ? Failed : Stop);
+            return;
+        }
+
+        NoteTable noteTable(db);
+        if (oldUsn == 0)
+            noteTable.updateGuid(lid, uploaded.guid);
+        noteTable.setUpdateSequenceNumber(lid, usn);
+        noteTable.setDirty(lid, false);
+        emit finished(lid, usn, Uploaded);
+    });
+}
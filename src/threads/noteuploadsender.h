@@ -0,0 +1,43 @@
+/*********************************************************************************
+NixNote - An open-source client for the Evernote service.
+Copyright (C) 2013 Randy Baumgarte
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+***********************************************************************************/
+
+#ifndef NOTEUPLOADSENDER_H
+#define NOTEUPLOADSENDER_H
+
+#include "uploadpipeline.h"
+#include "src/communication/communicationmanager.h"
+#include "src/sql/databaseconnection.h"
+
+
+// Uploads personal notes for the UploadPipeline.  The note is loaded with
+// its resource data just before it is sent and released once the request
+// is serialized, so only the notes in flight are held in memory.
+class NoteUploadSender : public UploadSender
+{
+    Q_OBJECT
+private:
+    DatabaseConnection *db;
+    CommunicationManager *comm;
+
+public:
+    NoteUploadSender(DatabaseConnection *db, CommunicationManager *comm, QObject *parent = 0);
+    void send(qint32 lid);
+};
+
+#endif // NOTEUPLOADSENDER_H
@@ -0,0 +1,154 @@
+/*********************************************************************************
+NixNote - An open-source client for the Evernote service.
+Copyright (C) 2013 Randy Baumgarte
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+***********************************************************************************/
+
+#include "searchrunner.h"
+#include "src/filters/filterengine.h"
+#include "src/filters/searchquery.h"
+#include "src/sql/nsqlquery.h"
+#include "src/utilities/metrics.h"
+
+extern Global global;
+
+SearchRunner::SearchRunner(QObject *parent) :
+    QObject(parent)
+{
+    init = false;
+    db = nullptr;
+}
+
+
+void SearchRunner::initialize() {
+    init = true;
+    QLOG_DEBUG() << "Starting SearchRunner";
+    db = new DatabaseConnection("searchrunner");
+    NSqlQuery sql(db);
+    sql.exec("create temp table if not exists liveBase (lid integer primary key, relevance real)");
+    sql.exec("create temp table if not exists liveResult (lid integer primary key, relevance real)");
+    sql.exec("create temp table if not exists liveMatch (lid integer, relevance real, hit integer)");
+    sql.finish();
+}
+
+
+qint32 SearchRunner::request() {
+    return latest.fetchAndAddOrdered(1) + 1;
+}
+
+
+void SearchRunner::cancel() {
+    latest.fetchAndAddOrdered(1);
+}
+
+
+qint32 SearchRunner::latestId() {
+    return latest.load();
+}
+
+
+bool SearchRunner::superseded(qint32 id) {
+    return id != latest.load();
+}
+
+
+// The notes the search runs over, given as a select of their lids (see
+// FilterEngine::searchBaseSql()).  Replacing them drops the previous
+// results, which were taken from the old base.
+void SearchRunner::setBase(QString select) {
+    if (!init)
+        initialize();
+    NSqlQuery sql(db);
+    sql.exec("begin");
+    sql.exec("delete from liveBase");
+    sql.exec("delete from liveResult");
+    if (!sql.exec("insert or ignore into liveBase (lid, relevance) select lid, 0 from (" + select + ")"))
+        QLOG_ERROR() << "Live search base failed: " << sql.lastError();
+    sql.exec("commit");
+    sql.finish();
+    previousTokens.clear();
+}
+
+
+// Searches queued behind a newer one return right away.  A statement
+// can't be interrupted through QtSql, so one in flight is only dropped
+// once it completes or while its results are read.
+void SearchRunner::search(qint32 id, QString searchString) {
+    static MetricHistogram *latency = Metrics::instance().histogram("search.live");
+    if (superseded(id))
+        return;
+    if (!init)
+        initialize();
+    MetricsTimer timer(latency);
+
+    QStringList tokens;
+    FilterEngine::splitSearchTerms(tokens, global.normalizeTermForSearchAndIndex(searchString));
+    SearchQuery query(tokens, global.getMinimumRecognitionWeight());
+    if (query.terms.isEmpty() || !query.others.isEmpty()) {
+        QLOG_DEBUG() << "Live search left to the search box: " << searchString;
+        return;
+    }
+    query.optimize();
+    bool narrowed = SearchQuery::narrows(previousTokens, tokens);
+    query.table = narrowed ? "liveResult" : "liveBase";
+
+    NSqlQuery sql(db);
+    sql.exec("delete from liveMatch");
+    sql.prepare("insert into liveMatch (lid, relevance, hit) " + query.sql());
+    query.bindValues(sql);
+    if (!sql.exec()) {
+        QLOG_ERROR() << "Live search failed: " << sql.lastError();
+        sql.finish();
+        return;
+    }
+    if (superseded(id)) {
+        sql.finish();
+        return;
+    }
+
+    // Keep the matching notes (without their score) for the next search
+    sql.exec("begin");
+    sql.exec("delete from liveResult");
+    sql.exec("insert into liveResult (lid, relevance) select lid, 0 from liveMatch");
+    sql.exec("commit");
+    previousTokens = tokens;
+
+    QList<qint32> lids;
+    QList<double> relevance;
+    QList<bool> hits;
+    bool firstPage = true;
+    sql.exec("select lid, relevance, hit from liveMatch order by relevance desc");
+    while (sql.next()) {
+        if (superseded(id)) {
+            sql.finish();
+            return;
+        }
+        lids.append(sql.value(0).toInt());
+        relevance.append(sql.value(1).toDouble());
+        hits.append(sql.value(2).toBool());
+        if (firstPage && lids.size() == LIVE_SEARCH_PAGE) {
+            emit results(id, lids, relevance, hits);
+            lids.clear();
+            relevance.clear();
+            hits.clear();
+            firstPage = false;
+        }
+    }
+    sql.finish();
+    QLOG_DEBUG() << "Live search " << (narrowed ? "narrowed" : "ran") << " in " << timer.elapsed() << " ms";
+    if (firstPage || !lids.isEmpty())
+        emit results(id, lids, relevance, hits);
+}
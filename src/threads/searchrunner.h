@@ -0,0 +1,76 @@
+/*********************************************************************************
+NixNote - An open-source client for the Evernote service.
+Copyright (C) 2013 Randy Baumgarte
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+***********************************************************************************/
+
+
+//****************************************************
+//*  Runs the text of the search box while it is being
+//*  typed.  Searches run on their own connection over
+//*  a snapshot of the notes the rest of the criteria
+//*  select.  A new search supersedes the one in flight,
+//*  which is dropped at its next check, and a search
+//*  which only narrows the previous one runs over the
+//*  previous results.  The best matches are sent
+//*  first so the note list can show them right away.
+//*****************************************************
+
+#ifndef SEARCHRUNNER_H
+#define SEARCHRUNNER_H
+
+#include <QObject>
+#include <QAtomicInt>
+#include <QStringList>
+#include <QList>
+
+#include "src/sql/databaseconnection.h"
+
+// Rows sent before the rest of the results
+#define LIVE_SEARCH_PAGE 50
+
+
+class SearchRunner : public QObject
+{
+    Q_OBJECT
+private:
+    DatabaseConnection *db;
+    bool init;
+    void initialize();
+
+    QAtomicInt latest;              // id of the newest search requested
+    QStringList previousTokens;     // search of the rows in liveResult, empty if none
+
+    bool superseded(qint32 id);
+
+public:
+    explicit SearchRunner(QObject *parent = 0);
+
+    // Called on the GUI thread.  Both supersede the search in flight,
+    // request() returns the id of the next search.
+    qint32 request();
+    void cancel();
+    qint32 latestId();
+
+signals:
+    void results(qint32 id, QList<qint32> lids, QList<double> relevance, QList<bool> hits);
+
+public slots:
+    void setBase(QString select);
+    void search(qint32 id, QString searchString);
+};
+
+#endif // SEARCHRUNNER_H
@@ -29,11 +29,14 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #include "src/sql/notetable.h"
 #include "src/sql/linkednotebooktable.h"
 #include "src/sql/resourcetable.h"
+#include "src/sql/configstore.h"
 #include "src/sql/sharednotebooktable.h"
 #include "src/nixnote.h"
 #include "src/communication/communicationmanager.h"
 #include "src/communication/communicationerror.h"
 #include "src/sql/nsqlquery.h"
+#include "src/utilities/metrics.h"
+#include "src/threads/noteuploadsender.h"
 
 extern Global global;
 
@@ -304,6 +307,37 @@ bool SyncRunner::syncRemoteToLocal(qint32 updateCount) {
 
 // Deal with the sync chunk returned
 void SyncRunner::processSyncChunk(SyncChunk &chunk, qint32 linkedNotebook) {
+    static MetricHistogram *latency = Metrics::instance().histogram("sync.processChunk");
+    static MetricCounter *chunks = Metrics::instance().counter("sync.chunks");
+    static MetricCounter *notes = Metrics::instance().counter("sync.notesReceived");
+    MetricsTimer timer(latency);
+    chunks->increment();
+    if (chunk.notes.isSet())
+        notes->increment(chunk.notes.ref().size());
+
+    // Reserve lids for everything new in the chunk so they are handed
+    // out without a counter update per object.
+    qint32 newObjects = 0;
+    if (chunk.notes.isSet()) {
+        newObjects += chunk.notes.ref().size();
+        for (int i=0; i<chunk.notes.ref().size(); i++) {
+            const Note &n = chunk.notes.ref().at(i);
+            if (n.resources.isSet())
+                newObjects += n.resources.ref().size();
+        }
+    }
+    if (chunk.resources.isSet())
+        newObjects += chunk.resources.ref().size();
+    if (chunk.notebooks.isSet())
+        newObjects += chunk.notebooks.ref().size();
+    if (chunk.tags.isSet())
+        newObjects += chunk.tags.ref().size();
+    if (chunk.searches.isSet())
+        newObjects += chunk.searches.ref().size();
+    if (chunk.linkedNotebooks.isSet())
+        newObjects += chunk.linkedNotebooks.ref().size();
+    ConfigStore cs(db);
+    cs.reserveLids(newObjects);
 
     // Now start processing the chunk
     if (chunk.expungedNotes.isSet())
@@ -791,21 +825,25 @@ qint32 SyncRunner::uploadLinkedNotes(qint32 notebookLid) {
     qint32 usn;
     qint32 maxUsn = 0;
     NoteTable noteTable(db);
-    QList<qint32> lids, validLids, deletedLids;
-    noteTable.getAllDirty(lids, notebookLid);
-
-    // Split the list into deleted and updated notes
-    for (int i = 0; i < lids.size(); i++) {
-        if (noteTable.isDeleted(lids[i]))
-            deletedLids.append(lids[i]);
+    QList<qint32> validLids, deletedLids;
+    QList<SyncQueueEntry> queue;
+    noteTable.getSyncQueue(queue);
+
+    // Split the queued notes of this notebook into deleted and updated notes
+    for (int i = 0; i < queue.size(); i++) {
+        const SyncQueueEntry &entry = queue[i];
+        if (entry.type != SYNCQUEUE_NOTE || entry.notebookLid != notebookLid)
+            continue;
+        if (entry.operation == SYNCQUEUE_DELETE)
+            deletedLids.append(entry.lid);
         else
-            validLids.append(lids[i]);
+            validLids.append(entry.lid);
     }
 
     // Start deleting notes
     for (int i = 0; i < deletedLids.size(); i++) {
         QString guid = noteTable.getGuid(deletedLids[i]);
-        noteTable.setDirty(lids[i], false);
+        noteTable.setDirty(deletedLids[i], false);
         usn = comm->deleteLinkedNote(guid);
         if (usn > maxUsn) {
             maxUsn = usn;
@@ -1101,44 +1139,51 @@ qint32 SyncRunner::uploadPersonalNotes() {
     QLOG_TRACE_IN();
     qint32 usn;
     qint32 maxUsn = 0;
-    NotebookTable notebookTable(db);
-    LinkedNotebookTable linkedNotebookTable(db);
     NoteTable noteTable(db);
-    QList<qint32> lids, validLids, deletedLids, movedLids;
+    UserTable userTable(db);
+    QList<qint32> validLids, deletedLids, movedLids;
+    QList<SyncQueueEntry> queue;
     QStringList deleteQueueGuids;
-    noteTable.getAllDirty(lids);
+    noteTable.getSyncQueue(queue);
 
     // Get all of the notes that were deleted, and then removed from the trash
     noteTable.getAllDeleteQueue(deleteQueueGuids);
 
 
-    // Get a list of all notes that are both dirty and in an account we own and isn't deleted
-    for (int i = 0; i < lids.size(); i++) {
-        qint32 notebookLid = noteTable.getNotebookLid(lids[i]);
-        if (!linkedNotebookTable.exists(notebookLid)) {
-            if (!notebookTable.isLocal(notebookLid)) {
-                if (noteTable.isDeleted(lids[i]))
-                    deletedLids.append(lids[i]);
-                else
-                    validLids.append(lids[i]);
-            } else {
-                // We have a note that is local.  Check if it was once
-                // synchronized.  If so, it was moved to a local notebook
-                // and now needs to be deleted on the remote end
-                Note n;
-                noteTable.get(n, lids[i], false, false);
-                if (n.updateSequenceNum.isSet() && n.updateSequenceNum > 0) {
-                    movedLids.append(lids[i]);
-                }
-            }
+    // The queue already knows which notes are in an account we own and
+    // whether they are deleted.  Notes in linked notebooks are uploaded
+    // by uploadLinkedNotes().
+    for (int i = 0; i < queue.size(); i++) {
+        const SyncQueueEntry &entry = queue[i];
+        if (entry.type != SYNCQUEUE_NOTE || entry.notebookClass == SYNCQUEUE_LINKED)
+            continue;
+        if (entry.operation == SYNCQUEUE_EXPUNGE_REMOTE) {
+            // We have a note that is local, but it was once
+            // synchronized.  It was moved to a local notebook
+            // and now needs to be deleted on the remote end
+            movedLids.append(entry.lid);
+        } else if (entry.notebookClass == SYNCQUEUE_PERSONAL) {
+            if (entry.operation == SYNCQUEUE_DELETE)
+                deletedLids.append(entry.lid);
+            else
+                validLids.append(entry.lid);
         }
     }
+    QLOG_DEBUG() << "Upload queue: " << validLids.size() << " notes, " << deletedLids.size()
+                 << " deleted, " << movedLids.size() << " moved to local notebooks";
+
+    // Every answer that extends the run of update sequence numbers we
+    // already know is saved, so if the upload is interrupted the next
+    // sync neither uploads nor downloads those notes again.
+    UsnCheckpoint checkpoint(userTable.getLastSyncNumber());
 
     // Start deleting notes
     for (int i = 0; i < deletedLids.size(); i++) {
         QString guid = noteTable.getGuid(deletedLids[i]);
-        noteTable.setDirty(lids[i], false);
+        noteTable.setDirty(deletedLids[i], false);
         usn = comm->deleteNote(guid);
+        if (checkpoint.add(usn))
+            userTable.updateLastSyncNumber(checkpoint.value());
         if (usn > maxUsn) {
             maxUsn = usn;
             noteTable.setUpdateSequenceNumber(deletedLids[i], usn);
@@ -1158,8 +1203,10 @@ qint32 SyncRunner::uploadPersonalNotes() {
         QString guid = noteTable.getGuid(movedLids[i]);
         noteTable.setDirty(movedLids[i], false);
         noteTable.updateGuid(movedLids[i], newGuid);
-        noteTable.setUpdateSequenceNumber(movedLids[0], 0);
+        noteTable.setUpdateSequenceNumber(movedLids[i], 0);
         usn = comm->deleteNote(guid);
+        if (checkpoint.add(usn))
+            userTable.updateLastSyncNumber(checkpoint.value());
         if (usn > maxUsn) {
             maxUsn = usn;
         }
@@ -1172,6 +1219,8 @@ qint32 SyncRunner::uploadPersonalNotes() {
     for (int i = 0; i < deleteQueueGuids.size(); i++) {
         QString guid = deleteQueueGuids[i];
         usn = comm->deleteNote(guid);
+        if (checkpoint.add(usn))
+            userTable.updateLastSyncNumber(checkpoint.value());
         if (usn > maxUsn) {
             maxUsn = usn;
         }
@@ -1179,37 +1228,27 @@ qint32 SyncRunner::uploadPersonalNotes() {
     }
 
 
-    // Start uploading notes
-    for (int i = 0; i < validLids.size(); i++) {
-        Note note;
-        noteTable.get(note, validLids[i], true, true);
-
-        qint32 oldUsn = 0;
-        if (note.updateSequenceNum.isSet())
-            oldUsn = note.updateSequenceNum;
-        usn = comm->uploadNote(note);
-        if (usn == 0) {
-            this->communicationErrorHandler();
-            if (note.title.isSet()) {
-                QLOG_ERROR() << tr("Error uploading note:") + note.title;
-            } else {
-                QLOG_ERROR() << tr("Error uploading note with a missing title!");
-            }
-            error = true;
-            //return maxUsn;
-        }
-        if (usn > maxUsn) {
-            maxUsn = usn;
-            if (oldUsn == 0)
-                noteTable.updateGuid(validLids[i], note.guid);
-            noteTable.setUpdateSequenceNumber(validLids[i], usn);
-            noteTable.setDirty(validLids[i], false);
-            if (!finalSync)
-                emit(noteSynchronized(validLids[i], false));
-        } else {
-            error = true;
-        }
+    // Start uploading notes.  Several requests are kept in flight.
+    NoteUploadSender sender(db, comm);
+    UploadPipeline pipeline(&sender, &checkpoint);
+    connect(&pipeline, &UploadPipeline::uploaded, this, [this](qint32 lid, qint32 usn) {
+        Q_UNUSED(usn);
+        if (!finalSync)
+            emit(noteSynchronized(lid, false));
+    });
+    connect(&pipeline, &UploadPipeline::checkpointChanged, this, [&userTable](qint32 usn) {
+        userTable.updateLastSyncNumber(usn);
+    });
+    QList<qint32> remaining = pipeline.run(validLids);
+    if (pipeline.maxUsn > maxUsn)
+        maxUsn = pipeline.maxUsn;
+    if (pipeline.failures > 0) {
+        this->communicationErrorHandler();
+        error = true;
     }
+    if (!remaining.isEmpty())
+        QLOG_INFO() << remaining.size() << " notes left to upload on the next sync";
+
     QLOG_TRACE_OUT();
     return maxUsn;
 }
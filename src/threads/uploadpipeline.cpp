@@ -0,0 +1,105 @@
+/*********************************************************************************
+NixNote - An open-source client for the Evernote service.
+Copyright (C) 2013 Randy Baumgarte
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+***********************************************************************************/
+
+#include "uploadpipeline.h"
+#include "src/logger/qslog.h"
+
+
+UsnCheckpoint::UsnCheckpoint(qint32 last) {
+    this->last = last;
+}
+
+
+bool UsnCheckpoint::add(qint32 usn) {
+    if (usn <= last)
+        return false;
+    if (usn != last+1) {
+        ahead.insert(usn);
+        return false;
+    }
+    last = usn;
+    while (ahead.remove(last+1))
+        last++;
+    return true;
+}
+
+
+
+
+UploadPipeline::UploadPipeline(UploadSender *sender, UsnCheckpoint *checkpoint, qint32 maxInFlight, QObject *parent) :
+    QObject(parent)
+{
+    this->sender = sender;
+    this->checkpoint = checkpoint;
+    this->maxInFlight = qMax(maxInFlight, 1);
+    inFlight = 0;
+    stopped = false;
+    maxUsn = 0;
+    failures = 0;
+    // Queued, so a sender answering from inside send() doesn't recurse
+    connect(sender, SIGNAL(finished(qint32,qint32,int)), this, SLOT(senderFinished(qint32,qint32,int)),
+            Qt::QueuedConnection);
+}
+
+
+QList<qint32> UploadPipeline::run(const QList<qint32> &lids) {
+    pending = lids;
+    stopped = false;
+    fill();
+    if (inFlight > 0)
+        loop.exec();
+    QList<qint32> remaining;
+    remaining.swap(pending);
+    return remaining;
+}
+
+
+// Start requests until the window is full
+void UploadPipeline::fill() {
+    while (!stopped && inFlight < maxInFlight && !pending.isEmpty()) {
+        qint32 lid = pending.takeFirst();
+        inFlight++;
+        sender->send(lid);
+    }
+}
+
+
+void UploadPipeline::senderFinished(qint32 lid, qint32 usn, int status) {
+    inFlight--;
+    if (status == UploadSender::Uploaded) {
+        if (usn > maxUsn)
+            maxUsn = usn;
+        emit uploaded(lid, usn);
+        if (checkpoint->add(usn))
+            emit checkpointChanged(checkpoint->value());
+    } else {
+        failures++;
+        if (status == UploadSender::Stop) {
+            // The note goes back to the front so a resumed run starts
+            // where this one stopped.
+            QLOG_WARN() << "Upload stopped at note " << lid << ", " << pending.size() << " notes left";
+            pending.prepend(lid);
+            stopped = true;
+        }
+    }
+
+    fill();
+    if (inFlight == 0 && loop.isRunning())
+        loop.quit();
+}
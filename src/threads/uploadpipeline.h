@@ -0,0 +1,113 @@
+/*********************************************************************************
+NixNote - An open-source client for the Evernote service.
+Copyright (C) 2013 Randy Baumgarte
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+***********************************************************************************/
+
+
+//****************************************************
+//*  Uploads a list of notes with a bounded number of
+//*  requests in flight.  Loading & serializing the
+//*  next note overlaps with the requests already on
+//*  the wire.  The pipeline itself only schedules;
+//*  the work is done by an UploadSender, which makes
+//*  it testable without a server.
+//*****************************************************
+
+#ifndef UPLOADPIPELINE_H
+#define UPLOADPIPELINE_H
+
+#include <QObject>
+#include <QList>
+#include <QSet>
+#include <QEventLoop>
+
+// Requests in flight at once
+#define UPLOAD_MAX_IN_FLIGHT 4
+
+
+// Tracks the highest update sequence number up to which the account has no
+// changes we have not seen.  Our own uploads are only known after the
+// server answers, possibly out of order, so the mark moves forward only
+// while the numbers are contiguous.  Saving it after every step means an
+// interrupted sync does not download the notes it already uploaded.
+class UsnCheckpoint
+{
+private:
+    qint32 last;
+    QSet<qint32> ahead;         // numbers seen past a gap
+
+public:
+    explicit UsnCheckpoint(qint32 last = 0);
+    bool add(qint32 usn);       // true if the mark moved
+    qint32 value() const { return last; }
+};
+
+
+// Does the actual work for one note: load it, serialize it and send it.
+// send() must not block; finished() is emitted once the server answered.
+class UploadSender : public QObject
+{
+    Q_OBJECT
+public:
+    enum Status {
+        Uploaded,       // usn is valid
+        Failed,         // this note was rejected, carry on with the others
+        Stop            // network, rate limit or server problem; stop the run
+    };
+
+    explicit UploadSender(QObject *parent = 0) : QObject(parent) {}
+    virtual void send(qint32 lid) = 0;
+
+signals:
+    void finished(qint32 lid, qint32 usn, int status);
+};
+
+
+class UploadPipeline : public QObject
+{
+    Q_OBJECT
+private:
+    UploadSender *sender;
+    UsnCheckpoint *checkpoint;
+    qint32 maxInFlight;
+    QList<qint32> pending;
+    qint32 inFlight;
+    bool stopped;
+    QEventLoop loop;
+
+    void fill();
+
+public:
+    UploadPipeline(UploadSender *sender, UsnCheckpoint *checkpoint, qint32 maxInFlight = UPLOAD_MAX_IN_FLIGHT, QObject *parent = 0);
+
+    // Upload the notes, in order of the list.  Blocks (running an event
+    // loop) until everything is sent or the run was stopped; the notes
+    // not yet sent are returned so the caller can leave them queued.
+    QList<qint32> run(const QList<qint32> &lids);
+
+    qint32 maxUsn;
+    qint32 failures;
+
+signals:
+    void uploaded(qint32 lid, qint32 usn);
+    void checkpointChanged(qint32 usn);
+
+private slots:
+    void senderFinished(qint32 lid, qint32 usn, int status);
+};
+
+#endif // UPLOADPIPELINE_H
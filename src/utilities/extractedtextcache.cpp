@@ -0,0 +1,75 @@
+/*********************************************************************************
+NixNote - An open-source client for the Evernote service.
+Copyright (C) 2013 Randy Baumgarte
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+***********************************************************************************/
+
+#include "extractedtextcache.h"
+#include "src/logger/qslog.h"
+
+#include <QFile>
+#include <QSaveFile>
+#include <QDataStream>
+
+
+ExtractedTextCache::ExtractedTextCache(const QString &dirPath) {
+    this->dirPath = dirPath;
+}
+
+
+QString ExtractedTextCache::fileName(const QByteArray &bodyHash) const {
+    return dirPath + QString(bodyHash.toHex()) + ".txt";
+}
+
+
+bool ExtractedTextCache::get(const QByteArray &bodyHash, QStringList &pages) const {
+    pages.clear();
+    if (bodyHash.isEmpty())
+        return false;
+    QFile file(fileName(bodyHash));
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+    QByteArray data = qUncompress(file.readAll());
+    file.close();
+    if (data.isEmpty())
+        return false;
+
+    QDataStream in(data);
+    in >> pages;
+    if (in.status() != QDataStream::Ok) {
+        pages.clear();
+        return false;
+    }
+    return true;
+}
+
+
+// Written to a temporary file first, so a reader never sees half of it
+void ExtractedTextCache::put(const QByteArray &bodyHash, const QStringList &pages) const {
+    if (bodyHash.isEmpty())
+        return;
+    QByteArray data;
+    QDataStream out(&data, QIODevice::WriteOnly);
+    out << pages;
+
+    QSaveFile file(fileName(bodyHash));
+    if (!file.open(QIODevice::WriteOnly)) {
+        QLOG_WARN() << "Unable to cache extracted text in " << file.fileName();
+        return;
+    }
+    file.write(qCompress(data));
+    file.commit();
+}
@@ -0,0 +1,43 @@
+/*********************************************************************************
+NixNote - An open-source client for the Evernote service.
+Copyright (C) 2013 Randy Baumgarte
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+***********************************************************************************/
+
+#ifndef EXTRACTEDTEXTCACHE_H
+#define EXTRACTEDTEXTCACHE_H
+
+#include <QString>
+#include <QStringList>
+#include <QByteArray>
+
+// Text extracted from attachments, kept on disk by the hash of the
+// attachment's data.  The same file attached to several notes, or
+// indexed again, is only extracted once.  The text is kept as it was
+// extracted, before it is normalized for the index.
+class ExtractedTextCache
+{
+private:
+    QString dirPath;
+
+public:
+    ExtractedTextCache(const QString &dirPath);
+    bool get(const QByteArray &bodyHash, QStringList &pages) const;
+    void put(const QByteArray &bodyHash, const QStringList &pages) const;
+    QString fileName(const QByteArray &bodyHash) const;     // where the text of bodyHash is kept
+};
+
+#endif // EXTRACTEDTEXTCACHE_H
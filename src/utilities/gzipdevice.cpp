@@ -0,0 +1,125 @@
+/*********************************************************************************
+NixNote - An open-source client for the Evernote service.
+Copyright (C) 2013 Randy Baumgarte
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+***********************************************************************************/
+
+#include "gzipdevice.h"
+#include <QFile>
+#include <QFileInfo>
+#include <climits>
+#include <zlib.h>
+
+// zlib's internal buffer.  The default (8k) makes for a lot of small
+// writes on large exports.
+#define GZIP_BUFFER_SIZE (256*1024)
+
+
+GzipDevice::GzipDevice(const QString &fileName, QObject *parent) : QIODevice(parent) {
+    this->fileName = fileName;
+    file = nullptr;
+    compressedSize = 0;
+}
+
+
+GzipDevice::~GzipDevice() {
+    close();
+}
+
+
+bool GzipDevice::isGzipFile(const QString &fileName) {
+    return fileName.endsWith(".gz", Qt::CaseInsensitive);
+}
+
+
+bool GzipDevice::open(OpenMode mode) {
+    if (file != nullptr || (mode & ReadWrite) == ReadWrite || (mode & Append))
+        return false;
+
+    QByteArray name = QFile::encodeName(fileName);
+    gzFile gz = gzopen(name.constData(), (mode & WriteOnly) ? "wb6" : "rb");
+    if (gz == nullptr) {
+        setErrorString(tr("Cannot open file."));
+        return false;
+    }
+    gzbuffer(gz, GZIP_BUFFER_SIZE);
+    file = gz;
+    compressedSize = QFileInfo(fileName).size();
+    return QIODevice::open(mode | Unbuffered);
+}
+
+
+void GzipDevice::close() {
+    if (file == nullptr)
+        return;
+    QIODevice::close();
+    if (gzclose(static_cast<gzFile>(file)) != Z_OK)
+        setErrorString(tr("Error closing compressed file."));
+    file = nullptr;
+}
+
+
+bool GzipDevice::isSequential() const {
+    return true;
+}
+
+
+bool GzipDevice::atEnd() const {
+    if (file == nullptr)
+        return true;
+    return gzeof(static_cast<gzFile>(file)) != 0 && QIODevice::atEnd();
+}
+
+
+qint64 GzipDevice::pos() const {
+    if (file == nullptr)
+        return 0;
+    return gzoffset(static_cast<gzFile>(file));
+}
+
+
+qint64 GzipDevice::size() const {
+    return compressedSize;
+}
+
+
+qint64 GzipDevice::readData(char *data, qint64 maxSize) {
+    if (file == nullptr)
+        return -1;
+    int len = gzread(static_cast<gzFile>(file), data, static_cast<unsigned>(qMin(maxSize, static_cast<qint64>(INT_MAX))));
+    if (len < 0) {
+        setErrorString(tr("Error reading compressed file."));
+        return -1;
+    }
+    return len;
+}
+
+
+qint64 GzipDevice::writeData(const char *data, qint64 maxSize) {
+    if (file == nullptr)
+        return -1;
+    qint64 written = 0;
+    while (written < maxSize) {
+        unsigned chunk = static_cast<unsigned>(qMin(maxSize - written, static_cast<qint64>(INT_MAX)));
+        int len = gzwrite(static_cast<gzFile>(file), data + written, chunk);
+        if (len <= 0) {
+            setErrorString(tr("Error writing compressed file."));
+            return written > 0 ? written : -1;
+        }
+        written += len;
+    }
+    return written;
+}
@@ -0,0 +1,57 @@
+/*********************************************************************************
+NixNote - An open-source client for the Evernote service.
+Copyright (C) 2013 Randy Baumgarte
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+***********************************************************************************/
+
+
+#ifndef GZIPDEVICE_H
+#define GZIPDEVICE_H
+
+#include <QIODevice>
+#include <QString>
+
+// Sequential device reading or writing a gzip file, so the XML readers &
+// writers can stream compressed exports without holding them in memory.
+class GzipDevice : public QIODevice
+{
+    Q_OBJECT
+private:
+    QString fileName;
+    void *file;             // gzFile, kept opaque so zlib.h stays out of the header
+    qint64 compressedSize;
+
+protected:
+    qint64 readData(char *data, qint64 maxSize);
+    qint64 writeData(const char *data, qint64 maxSize);
+
+public:
+    explicit GzipDevice(const QString &fileName, QObject *parent = 0);
+    ~GzipDevice();
+
+    static bool isGzipFile(const QString &fileName);   // by extension
+
+    bool open(OpenMode mode);
+    void close();
+    bool isSequential() const;
+    bool atEnd() const;
+
+    // Position & size in the compressed file, used for progress
+    qint64 pos() const;
+    qint64 size() const;
+};
+
+#endif // GZIPDEVICE_H
@@ -0,0 +1,217 @@
+/*********************************************************************************
+NixNote - An open-source client for the Evernote service.
+Copyright (C) 2013 Randy Baumgarte
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+***********************************************************************************/
+
+#include "metrics.h"
+#include <QMutexLocker>
+#include <QJsonDocument>
+#include <QSaveFile>
+#include <QDateTime>
+#include <cmath>
+
+
+MetricHistogram::MetricHistogram() {
+    for (int i=0; i<METRICS_HISTOGRAM_BUCKETS; i++)
+        buckets[i].store(0, std::memory_order_relaxed);
+    count.store(0, std::memory_order_relaxed);
+    sum.store(0, std::memory_order_relaxed);
+    max.store(0, std::memory_order_relaxed);
+}
+
+
+// Values below 4us get their own bucket, everything else is bucketed by
+// the position of the highest bit plus the next two bits.
+int MetricHistogram::bucketFor(qint64 micros) {
+    if (micros < 4)
+        return micros < 0 ? 0 : static_cast<int>(micros);
+    int msb = 0;
+    for (qint64 v = micros; v > 1; v >>= 1)
+        msb++;
+    int bucket = msb*4 + static_cast<int>((micros >> (msb-2)) & 3);
+    return bucket < METRICS_HISTOGRAM_BUCKETS ? bucket : METRICS_HISTOGRAM_BUCKETS-1;
+}
+
+
+qint64 MetricHistogram::bucketUpperBound(int bucket) {
+    int msb = bucket / 4;
+    if (msb < 2)
+        return bucket;
+    qint64 width = static_cast<qint64>(1) << (msb-2);
+    return ((4 + bucket%4) * width) + width - 1;
+}
+
+
+void MetricHistogram::record(qint64 micros) {
+    if (micros < 0)
+        micros = 0;
+    buckets[bucketFor(micros)].fetch_add(1, std::memory_order_relaxed);
+    count.fetch_add(1, std::memory_order_relaxed);
+    sum.fetch_add(micros, std::memory_order_relaxed);
+    qint64 current = max.load(std::memory_order_relaxed);
+    while (micros > current && !max.compare_exchange_weak(current, micros, std::memory_order_relaxed))
+        ;
+}
+
+
+qint64 MetricHistogram::percentile(double p) const {
+    qint64 counts[METRICS_HISTOGRAM_BUCKETS];
+    qint64 total = 0;
+    for (int i=0; i<METRICS_HISTOGRAM_BUCKETS; i++) {
+        counts[i] = buckets[i].load(std::memory_order_relaxed);
+        total += counts[i];
+    }
+    if (total == 0)
+        return 0;
+
+    qint64 rank = static_cast<qint64>(std::ceil(p * total));
+    if (rank < 1)
+        rank = 1;
+    qint64 seen = 0;
+    for (int i=0; i<METRICS_HISTOGRAM_BUCKETS; i++) {
+        seen += counts[i];
+        if (seen >= rank)
+            return qMin(bucketUpperBound(i), getMax());
+    }
+    return getMax();
+}
+
+
+QJsonObject MetricHistogram::toJson() const {
+    QJsonObject o;
+    qint64 n = getCount();
+    o["count"] = n;
+    o["sumUs"] = getSum();
+    o["meanUs"] = n > 0 ? getSum() / n : 0;
+    o["maxUs"] = getMax();
+    o["p50Us"] = percentile(0.50);
+    o["p95Us"] = percentile(0.95);
+    o["p99Us"] = percentile(0.99);
+    return o;
+}
+
+
+void MetricHistogram::reset() {
+    for (int i=0; i<METRICS_HISTOGRAM_BUCKETS; i++)
+        buckets[i].store(0, std::memory_order_relaxed);
+    count.store(0, std::memory_order_relaxed);
+    sum.store(0, std::memory_order_relaxed);
+    max.store(0, std::memory_order_relaxed);
+}
+
+
+
+
+Metrics::Metrics() {
+    uptime.start();
+}
+
+
+Metrics::~Metrics() {
+    qDeleteAll(counters);
+    qDeleteAll(gauges);
+    qDeleteAll(histograms);
+}
+
+
+// Intentionally never destroyed.  Worker threads may still record while
+// the program is shutting down.
+Metrics &Metrics::instance() {
+    static Metrics *metrics = new Metrics();
+    return *metrics;
+}
+
+
+MetricCounter *Metrics::counter(const QString &name) {
+    QMutexLocker locker(&mutex);
+    MetricCounter *c = counters.value(name, nullptr);
+    if (c == nullptr) {
+        c = new MetricCounter();
+        counters.insert(name, c);
+    }
+    return c;
+}
+
+
+MetricGauge *Metrics::gauge(const QString &name) {
+    QMutexLocker locker(&mutex);
+    MetricGauge *g = gauges.value(name, nullptr);
+    if (g == nullptr) {
+        g = new MetricGauge();
+        gauges.insert(name, g);
+    }
+    return g;
+}
+
+
+MetricHistogram *Metrics::histogram(const QString &name) {
+    QMutexLocker locker(&mutex);
+    MetricHistogram *h = histograms.value(name, nullptr);
+    if (h == nullptr) {
+        h = new MetricHistogram();
+        histograms.insert(name, h);
+    }
+    return h;
+}
+
+
+// Current value of every registered metric
+QJsonObject Metrics::snapshot() {
+    QMutexLocker locker(&mutex);
+    QJsonObject c, g, h;
+    for (auto i = counters.constBegin(); i != counters.constEnd(); ++i)
+        c[i.key()] = i.value()->get();
+    for (auto i = gauges.constBegin(); i != gauges.constEnd(); ++i)
+        g[i.key()] = i.value()->get();
+    for (auto i = histograms.constBegin(); i != histograms.constEnd(); ++i)
+        h[i.key()] = i.value()->toJson();
+
+    QJsonObject root;
+    root["timestamp"] = QDateTime::currentDateTimeUtc().toString(Qt::ISODate);
+    root["uptimeMs"] = uptime.elapsed();
+    root["counters"] = c;
+    root["gauges"] = g;
+    root["histograms"] = h;
+    return root;
+}
+
+
+// Write the snapshot (plus any caller supplied fields, e.g. the program
+// version) as JSON.  The file is replaced atomically.
+bool Metrics::writeSnapshot(const QString &filename, const QJsonObject &extra) {
+    QJsonObject root = snapshot();
+    for (auto i = extra.constBegin(); i != extra.constEnd(); ++i)
+        root[i.key()] = i.value();
+
+    QSaveFile file(filename);
+    if (!file.open(QIODevice::WriteOnly))
+        return false;
+    file.write(QJsonDocument(root).toJson(QJsonDocument::Indented));
+    return file.commit();
+}
+
+
+void Metrics::reset() {
+    QMutexLocker locker(&mutex);
+    for (auto i = counters.constBegin(); i != counters.constEnd(); ++i)
+        i.value()->reset();
+    for (auto i = gauges.constBegin(); i != gauges.constEnd(); ++i)
+        i.value()->reset();
+    for (auto i = histograms.constBegin(); i != histograms.constEnd(); ++i)
+        i.value()->reset();
+    uptime.restart();
+}
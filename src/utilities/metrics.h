@@ -0,0 +1,144 @@
+/*********************************************************************************
+NixNote - An open-source client for the Evernote service.
+Copyright (C) 2013 Randy Baumgarte
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+***********************************************************************************/
+
+
+//****************************************************
+//*  Lightweight performance metrics.  Counters,
+//*  gauges & latency histograms are registered by
+//*  name once and then updated lock free, so they
+//*  are cheap enough for the hot paths (SQL, filter,
+//*  note rendering...).  A snapshot can be taken as
+//*  JSON at any time.
+//*
+//*  Typical use:
+//*     static MetricHistogram *latency = Metrics::instance().histogram("sql.exec");
+//*     MetricsTimer timer(latency);
+//*****************************************************
+
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <QString>
+#include <QHash>
+#include <QMutex>
+#include <QElapsedTimer>
+#include <QJsonObject>
+#include <atomic>
+
+// Histogram buckets.  Every power of two (in microseconds) is split in four
+// sub-buckets, which covers 1us up to ~12 days with < 25% error on a percentile.
+#define METRICS_HISTOGRAM_BUCKETS 160
+
+
+// Monotonic event counter
+class MetricCounter
+{
+private:
+    std::atomic<qint64> value;
+
+public:
+    MetricCounter() : value(0) {}
+    void increment(qint64 by = 1) { value.fetch_add(by, std::memory_order_relaxed); }
+    qint64 get() const { return value.load(std::memory_order_relaxed); }
+    void reset() { value.store(0, std::memory_order_relaxed); }
+};
+
+
+// Last reported value of something (queue depth, cache size...)
+class MetricGauge
+{
+private:
+    std::atomic<qint64> value;
+
+public:
+    MetricGauge() : value(0) {}
+    void set(qint64 v) { value.store(v, std::memory_order_relaxed); }
+    void add(qint64 by) { value.fetch_add(by, std::memory_order_relaxed); }
+    qint64 get() const { return value.load(std::memory_order_relaxed); }
+    void reset() { value.store(0, std::memory_order_relaxed); }
+};
+
+
+// Log-linear latency histogram (microseconds)
+class MetricHistogram
+{
+private:
+    std::atomic<qint64> buckets[METRICS_HISTOGRAM_BUCKETS];
+    std::atomic<qint64> count;
+    std::atomic<qint64> sum;
+    std::atomic<qint64> max;
+
+    static int bucketFor(qint64 micros);
+    static qint64 bucketUpperBound(int bucket);
+
+public:
+    MetricHistogram();
+    void record(qint64 micros);
+    qint64 getCount() const { return count.load(std::memory_order_relaxed); }
+    qint64 getSum() const { return sum.load(std::memory_order_relaxed); }
+    qint64 getMax() const { return max.load(std::memory_order_relaxed); }
+    qint64 percentile(double p) const;          // p is 0.0 - 1.0; result in microseconds
+    QJsonObject toJson() const;
+    void reset();
+};
+
+
+// Records the lifetime of the object into a histogram
+class MetricsTimer
+{
+private:
+    MetricHistogram *histogram;
+    QElapsedTimer timer;
+
+public:
+    explicit MetricsTimer(MetricHistogram *histogram) : histogram(histogram) { timer.start(); }
+    ~MetricsTimer() { histogram->record(timer.nsecsElapsed() / 1000); }
+    qint64 elapsed() const { return timer.elapsed(); }   // milliseconds, for log messages
+};
+
+
+// Registry of all metrics.  Registered metrics are never deleted, so the
+// pointers handed out may be cached (normally in a function static).
+class Metrics
+{
+private:
+    QMutex mutex;
+    QHash<QString, MetricCounter*> counters;
+    QHash<QString, MetricGauge*> gauges;
+    QHash<QString, MetricHistogram*> histograms;
+    QElapsedTimer uptime;
+
+    Metrics();
+    ~Metrics();
+    Metrics(const Metrics &);
+    Metrics &operator=(const Metrics &);
+
+public:
+    static Metrics &instance();
+
+    MetricCounter *counter(const QString &name);
+    MetricGauge *gauge(const QString &name);
+    MetricHistogram *histogram(const QString &name);
+
+    QJsonObject snapshot();
+    bool writeSnapshot(const QString &filename, const QJsonObject &extra = QJsonObject());
+    void reset();
+};
+
+#endif // METRICS_H
@@ -19,704 +19,788 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 
 #include "mimereference.h"
 
+#include <QVector>
 
-MimeReference::MimeReference(QObject *parent) :
-    QObject(parent)
+#include <algorithm>
+#include <cstring>
+
+
+namespace {
+
+class MimeEntry
 {
-    table = new QHash<QString,QString>();
-    table->insert("application/vnd.hzn-3d-crossword",".x3d");
-    table->insert("video/3gpp",".3gp");
-    table->insert("video/3gpp2",".3g2");
-    table->insert("application/vnd.mseq",".mseq");
-    table->insert("application/vnd.3m.post-it-notes",".pwn");
-    table->insert("application/vnd.3gpp.pic-bw-large",".plb");
-    table->insert("application/vnd.3gpp.pic-bw-small",".psb");
-    table->insert("application/vnd.3gpp.pic-bw-var",".pvb");
-    table->insert("application/vnd.3gpp2.tcap",".tcap");
-    table->insert("application/x-7z-compressed",".7z");
-    table->insert("application/x-abiword",".abw");
-    table->insert("application/x-ace-compressed",".ace");
-    table->insert("application/vnd.americandynamics.acc",".acc");
-    table->insert("application/vnd.acucobol",".acu");
-    table->insert("application/vnd.acucorp",".atc");
-    table->insert("audio/adpcm",".adp");
-    table->insert("application/x-authorware-bin",".aab");
-    table->insert("application/x-authorware-map",".aam");
-    table->insert("application/x-authorware-seg",".aas");
-    table->insert("application/vnd.adobe.air-application-installer-package+zip",".air");
-    table->insert("application/x-shockwave-flash",".swf");
-    table->insert("application/vnd.adobe.fxp",".fxp");
-    table->insert("application/pdf",".pdf");
-    table->insert("application/vnd.cups-ppd",".ppd");
-    table->insert("application/x-director",".dir");
-    table->insert("application/vnd.adobe.xdp+xml",".xdp");
-    table->insert("application/vnd.adobe.xfdf",".xfdf");
-    table->insert("audio/x-aac",".aac");
-    table->insert("application/vnd.ahead.space",".ahead");
-    table->insert("application/vnd.airzip.filesecure.azf",".azf");
-    table->insert("application/vnd.airzip.filesecure.azs",".azs");
-    table->insert("application/vnd.amazon.ebook",".azw");
-    table->insert("application/vnd.amiga.ami",".ami");
-    table->insert("application/andrew-inset","N/A");
-    table->insert("application/vnd.android.package-archive",".apk");
-    table->insert("application/vnd.anser-web-certificate-issue-initiation",".cii");
-    table->insert("application/vnd.anser-web-funds-transfer-initiation",".fti");
-    table->insert("application/vnd.antix.game-component",".atx");
-    table->insert("application/vnd.apple.installer+xml",".mpkg");
-    table->insert("application/applixware",".aw");
-    table->insert("application/vnd.hhe.lesson-player",".les");
-    table->insert("application/vnd.aristanetworks.swi",".swi");
-    table->insert("text/x-asm",".s");
-    table->insert("application/atomcat+xml",".atomcat");
-    table->insert("application/atomsvc+xml",".atomsvc");
-    table->insert("application/atom+xml",".xml");
-    table->insert("application/pkix-attr-cert",".ac");
-    table->insert("audio/x-aiff",".aif");
-    table->insert("video/x-msvideo",".avi");
-    table->insert("application/vnd.audiograph",".aep");
-    table->insert("image/vnd.dxf",".dxf");
-    table->insert("model/vnd.dwf",".dwf");
-    table->insert("application/x-bcpio",".bcpio");
-    table->insert("application/octet-stream",".bin");
-    table->insert("image/bmp",".bmp");
-    table->insert("application/x-bittorrent",".torrent");
-    table->insert("application/vnd.rim.cod",".cod");
-    table->insert("application/vnd.blueice.multipass",".mpm");
-    table->insert("application/vnd.bmi",".bmi");
-    table->insert("application/x-sh",".sh");
-    table->insert("image/prs.btif",".btif");
-    table->insert("application/vnd.businessobjects",".rep");
-    table->insert("application/x-bzip",".bz");
-    table->insert("application/x-bzip2",".bz2");
-    table->insert("application/x-csh",".csh");
-    table->insert("text/x-c",".c");
-    table->insert("application/vnd.chemdraw+xml",".cdxml");
-    table->insert("text/css",".css");
-    table->insert("chemical/x-cdx",".cdx");
-    table->insert("chemical/x-cml",".cml");
-    table->insert("chemical/x-csml",".csml");
-    table->insert("application/vnd.contact.cmsg",".cdbcmsg");
-    table->insert("application/vnd.claymore",".cla");
-    table->insert("application/vnd.clonk.c4group",".c4g");
-    table->insert("image/vnd.dvb.subtitle",".sub");
-    table->insert("application/cdmi-capability",".cdmia");
-    table->insert("application/cdmi-container",".cdmic");
-    table->insert("application/cdmi-domain",".cdmid");
-    table->insert("application/cdmi-object",".cdmio");
-    table->insert("application/cdmi-queue",".cdmiq");
-    table->insert("application/vnd.cluetrust.cartomobile-config",".c11amc");
-    table->insert("application/vnd.cluetrust.cartomobile-config-pkg",".c11amz");
-    table->insert("image/x-cmu-raster",".ras");
-    table->insert("model/vnd.collada+xml",".dae");
-    table->insert("text/csv",".csv");
-    table->insert("application/mac-compactpro",".cpt");
-    table->insert("application/vnd.wap.wmlc",".wmlc");
-    table->insert("image/cgm",".cgm");
-    table->insert("x-conference/x-cooltalk",".ice");
-    table->insert("image/x-cmx",".cmx");
-    table->insert("application/vnd.xara",".xar");
-    table->insert("application/vnd.cosmocaller",".cmc");
-    table->insert("application/x-cpio",".cpio");
-    table->insert("application/vnd.crick.clicker",".clkx");
-    table->insert("application/vnd.crick.clicker.keyboard",".clkk");
-    table->insert("application/vnd.crick.clicker.palette",".clkp");
-    table->insert("application/vnd.crick.clicker.template",".clkt");
-    table->insert("application/vnd.crick.clicker.wordbank",".clkw");
-    table->insert("application/vnd.criticaltools.wbs+xml",".wbs");
-    table->insert("application/vnd.rig.cryptonote",".cryptonote");
-    table->insert("chemical/x-cif",".cif");
-    table->insert("chemical/x-cmdf",".cmdf");
-    table->insert("application/cu-seeme",".cu");
-    table->insert("application/prs.cww",".cww");
-    table->insert("text/vnd.curl",".curl");
-    table->insert("text/vnd.curl.dcurl",".dcurl");
-    table->insert("text/vnd.curl.mcurl",".mcurl");
-    table->insert("text/vnd.curl.scurl",".scurl");
-    table->insert("application/vnd.curl.car",".car");
-    table->insert("application/vnd.curl.pcurl",".pcurl");
-    table->insert("application/vnd.yellowriver-custom-menu",".cmp");
-    table->insert("application/dssc+der",".dssc");
-    table->insert("application/dssc+xml",".xdssc");
-    table->insert("application/x-debian-package",".deb");
-    table->insert("audio/vnd.dece.audio",".uva");
-    table->insert("image/vnd.dece.graphic",".uvi");
-    table->insert("video/vnd.dece.hd",".uvh");
-    table->insert("video/vnd.dece.mobile",".uvm");
-    table->insert("video/vnd.uvvu.mp4",".uvu");
-    table->insert("video/vnd.dece.pd",".uvp");
-    table->insert("video/vnd.dece.sd",".uvs");
-    table->insert("video/vnd.dece.video",".uvv");
-    table->insert("application/x-dvi",".dvi");
-    table->insert("application/vnd.fdsn.seed",".seed");
-    table->insert("application/x-dtbook+xml",".dtb");
-    table->insert("application/x-dtbresource+xml",".res");
-    table->insert("application/vnd.dvb.ait",".ait");
-    table->insert("application/vnd.dvb.service",".svc");
-    table->insert("audio/vnd.digital-winds",".eol");
-    table->insert("image/vnd.djvu",".djvu");
-    table->insert("application/xml-dtd",".dtd");
-    table->insert("application/vnd.dolby.mlp",".mlp");
-    table->insert("application/x-doom",".wad");
-    table->insert("application/vnd.dpgraph",".dpg");
-    table->insert("audio/vnd.dra",".dra");
-    table->insert("application/vnd.dreamfactory",".dfac");
-    table->insert("audio/vnd.dts",".dts");
-    table->insert("audio/vnd.dts.hd",".dtshd");
-    table->insert("image/vnd.dwg",".dwg");
-    table->insert("application/vnd.dynageo",".geo");
-    table->insert("application/ecmascript",".es");
-    table->insert("application/vnd.ecowin.chart",".mag");
-    table->insert("image/vnd.fujixerox.edmics-mmr",".mmr");
-    table->insert("image/vnd.fujixerox.edmics-rlc",".rlc");
-    table->insert("application/exi",".exi");
-    table->insert("application/vnd.proteus.magazine",".mgz");
-    table->insert("application/epub+zip",".epub");
-    table->insert("message/rfc822",".eml");
-    table->insert("application/vnd.enliven",".nml");
-    table->insert("application/vnd.is-xpr",".xpr");
-    table->insert("image/vnd.xiff",".xif");
-    table->insert("application/vnd.xfdl",".xfdl");
-    table->insert("application/emma+xml",".emma");
-    table->insert("application/vnd.ezpix-album",".ez2");
-    table->insert("application/vnd.ezpix-package",".ez3");
-    table->insert("image/vnd.fst",".fst");
-    table->insert("video/vnd.fvt",".fvt");
-    table->insert("image/vnd.fastbidsheet",".fbs");
-    table->insert("application/vnd.denovo.fcselayout-link",".fe_launch");
-    table->insert("video/x-f4v",".f4v");
-    table->insert("video/x-flv",".flv");
-    table->insert("image/vnd.fpx",".fpx");
-    table->insert("image/vnd.net-fpx",".npx");
-    table->insert("text/vnd.fmi.flexstor",".flx");
-    table->insert("video/x-fli",".fli");
-    table->insert("application/vnd.fluxtime.clip",".ftc");
-    table->insert("application/vnd.fdf",".fdf");
-    table->insert("text/x-fortran",".f");
-    table->insert("application/vnd.mif",".mif");
-    table->insert("application/vnd.framemaker",".fm");
-    table->insert("image/x-freehand",".fh");
-    table->insert("application/vnd.fsc.weblaunch",".fsc");
-    table->insert("application/vnd.frogans.fnc",".fnc");
-    table->insert("application/vnd.frogans.ltf",".ltf");
-    table->insert("application/vnd.fujixerox.ddd",".ddd");
-    table->insert("application/vnd.fujixerox.docuworks",".xdw");
-    table->insert("application/vnd.fujixerox.docuworks.binder",".xbd");
-    table->insert("application/vnd.fujitsu.oasys",".oas");
-    table->insert("application/vnd.fujitsu.oasys2",".oa2");
-    table->insert("application/vnd.fujitsu.oasys3",".oa3");
-    table->insert("application/vnd.fujitsu.oasysgp",".fg5");
-    table->insert("application/vnd.fujitsu.oasysprs",".bh2");
-    table->insert("application/x-futuresplash",".spl");
-    table->insert("application/vnd.fuzzysheet",".fzs");
-    table->insert("image/g3fax",".g3");
-    table->insert("application/vnd.gmx",".gmx");
-    table->insert("model/vnd.gtw",".gtw");
-    table->insert("application/vnd.genomatix.tuxedo",".txd");
-    table->insert("application/vnd.geogebra.file",".ggb");
-    table->insert("application/vnd.geogebra.tool",".ggt");
-    table->insert("model/vnd.gdl",".gdl");
-    table->insert("application/vnd.geometry-explorer",".gex");
-    table->insert("application/vnd.geonext",".gxt");
-    table->insert("application/vnd.geoplan",".g2w");
-    table->insert("application/vnd.geospace",".g3w");
-    table->insert("application/x-font-ghostscript",".gsf");
-    table->insert("application/x-font-bdf",".bdf");
-    table->insert("application/x-gtar",".gtar");
-    table->insert("application/x-texinfo",".texinfo");
-    table->insert("application/x-gnumeric",".gnumeric");
-    table->insert("application/vnd.google-earth.kml+xml",".kml");
-    table->insert("application/vnd.google-earth.kmz",".kmz");
-    table->insert("application/vnd.grafeq",".gqf");
-    table->insert("image/gif",".gif");
-    table->insert("text/vnd.graphviz",".gv");
-    table->insert("application/vnd.groove-account",".gac");
-    table->insert("application/vnd.groove-help",".ghf");
-    table->insert("application/vnd.groove-identity-message",".gim");
-    table->insert("application/vnd.groove-injector",".grv");
-    table->insert("application/vnd.groove-tool-message",".gtm");
-    table->insert("application/vnd.groove-tool-template",".tpl");
-    table->insert("application/vnd.groove-vcard",".vcg");
-    table->insert("video/h261",".h261");
-    table->insert("video/h263",".h263");
-    table->insert("video/h264",".h264");
-    table->insert("application/vnd.hp-hpid",".hpid");
-    table->insert("application/vnd.hp-hps",".hps");
-    table->insert("application/x-hdf",".hdf");
-    table->insert("audio/vnd.rip",".rip");
-    table->insert("application/vnd.hbci",".hbci");
-    table->insert("application/vnd.hp-jlyt",".jlt");
-    table->insert("application/vnd.hp-pcl",".pcl");
-    table->insert("application/vnd.hp-hpgl",".hpgl");
-    table->insert("application/vnd.yamaha.hv-script",".hvs");
-    table->insert("application/vnd.yamaha.hv-dic",".hvd");
-    table->insert("application/vnd.yamaha.hv-voice",".hvp");
-    table->insert("application/vnd.hydrostatix.sof-data",".sfd-hdstx");
-    table->insert("application/hyperstudio",".stk");
-    table->insert("application/vnd.hal+xml",".hal");
-    table->insert("text/html",".html");
-    table->insert("application/vnd.ibm.rights-management",".irm");
-    table->insert("application/vnd.ibm.secure-container",".sc");
-    table->insert("text/calendar",".ics");
-    table->insert("application/vnd.iccprofile",".icc");
-    table->insert("image/x-icon",".ico");
-    table->insert("application/vnd.igloader",".igl");
-    table->insert("image/ief",".ief");
-    table->insert("application/vnd.immervision-ivp",".ivp");
-    table->insert("application/vnd.immervision-ivu",".ivu");
-    table->insert("application/reginfo+xml",".rif");
-    table->insert("text/vnd.in3d.3dml",".3dml");
-    table->insert("text/vnd.in3d.spot",".spot");
-    table->insert("model/iges",".igs");
-    table->insert("application/vnd.intergeo",".i2g");
-    table->insert("application/vnd.cinderella",".cdy");
-    table->insert("application/vnd.intercon.formnet",".xpw");
-    table->insert("application/vnd.isac.fcs",".fcs");
-    table->insert("application/ipfix",".ipfix");
-    table->insert("application/pkix-cert",".cer");
-    table->insert("application/pkixcmp",".pki");
-    table->insert("application/pkix-crl",".crl");
-    table->insert("application/pkix-pkipath",".pkipath");
-    table->insert("application/vnd.insors.igm",".igm");
-    table->insert("application/vnd.ipunplugged.rcprofile",".rcprofile");
-    table->insert("application/vnd.irepository.package+xml",".irp");
-    table->insert("text/vnd.sun.j2me.app-descriptor",".jad");
-    table->insert("application/java-archive",".jar");
-    table->insert("application/java-vm",".class");
-    table->insert("application/x-java-jnlp-file",".jnlp");
-    table->insert("application/java-serialized-object",".ser");
-    table->insert("text/x-java-source",".java");
-    table->insert("application/javascript",".js");
-    table->insert("application/json",".json");
-    table->insert("application/vnd.joost.joda-archive",".joda");
-    table->insert("video/jpm",".jpm");
-    table->insert("image/jpeg",".jpg");
-    table->insert("application/vnd.kahootz",".ktz");
-    table->insert("application/vnd.chipnuts.karaoke-mmd",".mmd");
-    table->insert("application/vnd.kde.karbon",".karbon");
-    table->insert("application/vnd.kde.kchart",".chrt");
-    table->insert("application/vnd.kde.kformula",".kfo");
-    table->insert("application/vnd.kde.kivio",".flw");
-    table->insert("application/vnd.kde.kontour",".kon");
-    table->insert("application/vnd.kde.kpresenter",".kpr");
-    table->insert("application/vnd.kde.kspread",".ksp");
-    table->insert("application/vnd.kde.kword",".kwd");
-    table->insert("application/vnd.kenameaapp",".htke");
-    table->insert("application/vnd.kidspiration",".kia");
-    table->insert("application/vnd.kinar",".kne");
-    table->insert("application/vnd.kodak-descriptor",".sse");
-    table->insert("application/vnd.las.las+xml",".lasxml");
-    table->insert("application/x-latex",".latex");
-    table->insert("application/vnd.llamagraphics.life-balance.desktop",".lbd");
-    table->insert("application/vnd.llamagraphics.life-balance.exchange+xml",".lbe");
-    table->insert("application/vnd.jam",".jam");
-    table->insert("application/vnd.lotus-1-2-3","0.123");
-    table->insert("application/vnd.lotus-approach",".apr");
-    table->insert("application/vnd.lotus-freelance",".pre");
-    table->insert("application/vnd.lotus-notes",".nsf");
-    table->insert("application/vnd.lotus-organizer",".org");
-    table->insert("application/vnd.lotus-screencam",".scm");
-    table->insert("application/vnd.lotus-wordpro",".lwp");
-    table->insert("audio/vnd.lucent.voice",".lvp");
-    table->insert("audio/x-mpegurl",".m3u");
-    table->insert("video/x-m4v",".m4v");
-    table->insert("application/mac-binhex40",".hqx");
-    table->insert("application/vnd.macports.portpkg",".portpkg");
-    table->insert("application/vnd.osgeo.mapguide.package",".mgp");
-    table->insert("application/marc",".mrc");
-    table->insert("application/marcxml+xml",".mrcx");
-    table->insert("application/mxf",".mxf");
-    table->insert("application/vnd.wolfram.player",".nbp");
-    table->insert("application/mathematica",".ma");
-    table->insert("application/mathml+xml",".mathml");
-    table->insert("application/mbox",".mbox");
-    table->insert("application/vnd.medcalcdata",".mc1");
-    table->insert("application/mediaservercontrol+xml",".mscml");
-    table->insert("application/vnd.mediastation.cdkey",".cdkey");
-    table->insert("application/vnd.mfer",".mwf");
-    table->insert("application/vnd.mfmp",".mfm");
-    table->insert("model/mesh",".msh");
-    table->insert("application/mads+xml",".mads");
-    table->insert("application/mets+xml",".mets");
-    table->insert("application/mods+xml",".mods");
-    table->insert("application/metalink4+xml",".meta4");
-    table->insert("application/vnd.ms-powerpoint.template.macroenabled.12",".potm");
-    table->insert("application/vnd.ms-word.document.macroenabled.12",".docm");
-    table->insert("application/vnd.ms-word.template.macroenabled.12",".dotm");
-    table->insert("application/vnd.mcd",".mcd");
-    table->insert("application/vnd.micrografx.flo",".flo");
-    table->insert("application/vnd.micrografx.igx",".igx");
-    table->insert("application/vnd.eszigno3+xml",".es3");
-    table->insert("application/x-msaccess",".mdb");
-    table->insert("video/x-ms-asf",".asf");
-    table->insert("application/x-msdownload",".exe");
-    table->insert("application/vnd.ms-artgalry",".cil");
-    table->insert("application/vnd.ms-cab-compressed",".cab");
-    table->insert("application/vnd.ms-ims",".ims");
-    table->insert("application/x-ms-application",".application");
-    table->insert("application/x-msclip",".clp");
-    table->insert("image/vnd.ms-modi",".mdi");
-    table->insert("application/vnd.ms-fontobject",".eot");
-    table->insert("application/vnd.ms-excel",".xls");
-    table->insert("application/vnd.ms-excel.addin.macroenabled.12",".xlam");
-    table->insert("application/vnd.ms-excel.sheet.binary.macroenabled.12",".xlsb");
-    table->insert("application/vnd.ms-excel.template.macroenabled.12",".xltm");
-    table->insert("application/vnd.ms-excel.sheet.macroenabled.12",".xlsm");
-    table->insert("application/vnd.ms-htmlhelp",".chm");
-    table->insert("application/x-mscardfile",".crd");
-    table->insert("application/vnd.ms-lrm",".lrm");
-    table->insert("application/x-msmediaview",".mvb");
-    table->insert("application/x-msmoney",".mny");
-    table->insert("application/vnd.openxmlformats-officedocument.presentationml.presentation",".pptx");
-    table->insert("application/vnd.openxmlformats-officedocument.presentationml.slide",".sldx");
-    table->insert("application/vnd.openxmlformats-officedocument.presentationml.slideshow",".ppsx");
-    table->insert("application/vnd.openxmlformats-officedocument.presentationml.template",".potx");
-    table->insert("application/vnd.openxmlformats-officedocument.spreadsheetml.sheet",".xlsx");
-    table->insert("application/vnd.openxmlformats-officedocument.spreadsheetml.template",".xltx");
-    table->insert("application/vnd.openxmlformats-officedocument.wordprocessingml.document",".docx");
-    table->insert("application/vnd.openxmlformats-officedocument.wordprocessingml.template",".dotx");
-    table->insert("application/x-msbinder",".obd");
-    table->insert("application/vnd.ms-officetheme",".thmx");
-    table->insert("application/onenote",".onetoc");
-    table->insert("audio/vnd.ms-playready.media.pya",".pya");
-    table->insert("video/vnd.ms-playready.media.pyv",".pyv");
-    table->insert("application/vnd.ms-powerpoint",".ppt");
-    table->insert("application/vnd.ms-powerpoint.addin.macroenabled.12",".ppam");
-    table->insert("application/vnd.ms-powerpoint.slide.macroenabled.12",".sldm");
-    table->insert("application/vnd.ms-powerpoint.presentation.macroenabled.12",".pptm");
-    table->insert("application/vnd.ms-powerpoint.slideshow.macroenabled.12",".ppsm");
-    table->insert("application/vnd.ms-project",".mpp");
-    table->insert("application/x-mspublisher",".pub");
-    table->insert("application/x-msschedule",".scd");
-    table->insert("application/x-silverlight-app",".xap");
-    table->insert("application/vnd.ms-pki.stl",".stl");
-    table->insert("application/vnd.ms-pki.seccat",".cat");
-    table->insert("application/vnd.visio",".vsd");
-    table->insert("video/x-ms-wm",".wm");
-    table->insert("audio/x-ms-wma",".wma");
-    table->insert("audio/x-ms-wax",".wax");
-    table->insert("video/x-ms-wmx",".wmx");
-    table->insert("application/x-ms-wmd",".wmd");
-    table->insert("application/vnd.ms-wpl",".wpl");
-    table->insert("application/x-ms-wmz",".wmz");
-    table->insert("video/x-ms-wmv",".wmv");
-    table->insert("video/x-ms-wvx",".wvx");
-    table->insert("application/x-msmetafile",".wmf");
-    table->insert("application/x-msterminal",".trm");
-    table->insert("application/msword",".doc");
-    table->insert("application/x-mswrite",".wri");
-    table->insert("application/vnd.ms-works",".wps");
-    table->insert("application/x-ms-xbap",".xbap");
-    table->insert("application/vnd.ms-xpsdocument",".xps");
-    table->insert("audio/midi",".mid");
-    table->insert("application/vnd.ibm.minipay",".mpy");
-    table->insert("application/vnd.ibm.modcap",".afp");
-    table->insert("application/vnd.jcp.javame.midlet-rms",".rms");
-    table->insert("application/vnd.tmobile-livetv",".tmo");
-    table->insert("application/x-mobipocket-ebook",".prc");
-    table->insert("application/vnd.mobius.mbk",".mbk");
-    table->insert("application/vnd.mobius.dis",".dis");
-    table->insert("application/vnd.mobius.plc",".plc");
-    table->insert("application/vnd.mobius.mqy",".mqy");
-    table->insert("application/vnd.mobius.msl",".msl");
-    table->insert("application/vnd.mobius.txf",".txf");
-    table->insert("application/vnd.mobius.daf",".daf");
-    table->insert("text/vnd.fly",".fly");
-    table->insert("application/vnd.mophun.certificate",".mpc");
-    table->insert("application/vnd.mophun.application",".mpn");
-    table->insert("video/mj2",".mj2");
-    table->insert("audio/mpeg",".mpga");
-    table->insert("video/vnd.mpegurl",".mxu");
-    table->insert("video/mpeg",".mpeg");
-    table->insert("application/mp21",".m21");
-    table->insert("audio/mp4",".mp4a");
-    table->insert("video/mp4",".mp4");
-    table->insert("application/mp4",".mp4");
-    table->insert("application/vnd.apple.mpegurl",".m3u8");
-    table->insert("application/vnd.musician",".mus");
-    table->insert("application/vnd.muvee.style",".msty");
-    table->insert("application/xv+xml",".mxml");
-    table->insert("application/vnd.nokia.n-gage.data",".ngdat");
-    table->insert("application/vnd.nokia.n-gage.symbian.install",".n-gage");
-    table->insert("application/x-dtbncx+xml",".ncx");
-    table->insert("application/x-netcdf",".nc");
-    table->insert("application/vnd.neurolanguage.nlu",".nlu");
-    table->insert("application/vnd.dna",".dna");
-    table->insert("application/vnd.noblenet-directory",".nnd");
-    table->insert("application/vnd.noblenet-sealer",".nns");
-    table->insert("application/vnd.noblenet-web",".nnw");
-    table->insert("application/vnd.nokia.radio-preset",".rpst");
-    table->insert("application/vnd.nokia.radio-presets",".rpss");
-    table->insert("text/n3",".n3");
-    table->insert("application/vnd.novadigm.edm",".edm");
-    table->insert("application/vnd.novadigm.edx",".edx");
-    table->insert("application/vnd.novadigm.ext",".ext");
-    table->insert("application/vnd.flographit",".gph");
-    table->insert("audio/vnd.nuera.ecelp4800",".ecelp4800");
-    table->insert("audio/vnd.nuera.ecelp7470",".ecelp7470");
-    table->insert("audio/vnd.nuera.ecelp9600",".ecelp9600");
-    table->insert("application/oda",".oda");
-    table->insert("application/ogg",".ogx");
-    table->insert("audio/ogg",".oga");
-    table->insert("video/ogg",".ogv");
-    table->insert("application/vnd.oma.dd2+xml",".dd2");
-    table->insert("application/vnd.oasis.opendocument.text-web",".oth");
-    table->insert("application/oebps-package+xml",".opf");
-    table->insert("application/vnd.intu.qbo",".qbo");
-    table->insert("application/vnd.openofficeorg.extension",".oxt");
-    table->insert("application/vnd.yamaha.openscoreformat",".osf");
-    table->insert("audio/webm",".weba");
-    table->insert("video/webm",".webm");
-    table->insert("application/vnd.oasis.opendocument.chart",".odc");
-    table->insert("application/vnd.oasis.opendocument.chart-template",".otc");
-    table->insert("application/vnd.oasis.opendocument.database",".odb");
-    table->insert("application/vnd.oasis.opendocument.formula",".odf");
-    table->insert("application/vnd.oasis.opendocument.formula-template",".odft");
-    table->insert("application/vnd.oasis.opendocument.graphics",".odg");
-    table->insert("application/vnd.oasis.opendocument.graphics-template",".otg");
-    table->insert("application/vnd.oasis.opendocument.image",".odi");
-    table->insert("application/vnd.oasis.opendocument.image-template",".oti");
-    table->insert("application/vnd.oasis.opendocument.presentation",".odp");
-    table->insert("application/vnd.oasis.opendocument.presentation-template",".otp");
-    table->insert("application/vnd.oasis.opendocument.spreadsheet",".ods");
-    table->insert("application/vnd.oasis.opendocument.spreadsheet-template",".ots");
-    table->insert("application/vnd.oasis.opendocument.text",".odt");
-    table->insert("application/vnd.oasis.opendocument.text-master",".odm");
-    table->insert("application/vnd.oasis.opendocument.text-template",".ott");
-    table->insert("image/ktx",".ktx");
-    table->insert("application/vnd.sun.xml.calc",".sxc");
-    table->insert("application/vnd.sun.xml.calc.template",".stc");
-    table->insert("application/vnd.sun.xml.draw",".sxd");
-    table->insert("application/vnd.sun.xml.draw.template",".std");
-    table->insert("application/vnd.sun.xml.impress",".sxi");
-    table->insert("application/vnd.sun.xml.impress.template",".sti");
-    table->insert("application/vnd.sun.xml.math",".sxm");
-    table->insert("application/vnd.sun.xml.writer",".sxw");
-    table->insert("application/vnd.sun.xml.writer.global",".sxg");
-    table->insert("application/vnd.sun.xml.writer.template",".stw");
-    table->insert("application/x-font-otf",".otf");
-    table->insert("application/vnd.yamaha.openscoreformat.osfpvg+xml",".osfpvg");
-    table->insert("application/vnd.osgi.dp",".dp");
-    table->insert("application/vnd.palm",".pdb");
-    table->insert("text/x-pascal",".p");
-    table->insert("application/vnd.pawaafile",".paw");
-    table->insert("application/vnd.hp-pclxl",".pclxl");
-    table->insert("application/vnd.picsel",".efif");
-    table->insert("image/x-pcx",".pcx");
-    table->insert("image/vnd.adobe.photoshop",".psd");
-    table->insert("application/pics-rules",".prf");
-    table->insert("image/x-pict",".pic");
-    table->insert("application/x-chat",".chat");
-    table->insert("application/pkcs10",".p10");
-    table->insert("application/x-pkcs12",".p12");
-    table->insert("application/pkcs7-mime",".p7m");
-    table->insert("application/pkcs7-signature",".p7s");
-    table->insert("application/x-pkcs7-certreqresp",".p7r");
-    table->insert("application/x-pkcs7-certificates",".p7b");
-    table->insert("application/pkcs8",".p8");
-    table->insert("application/vnd.pocketlearn",".plf");
-    table->insert("image/x-portable-anymap",".pnm");
-    table->insert("image/x-portable-bitmap",".pbm");
-    table->insert("application/x-font-pcf",".pcf");
-    table->insert("application/font-tdpfr",".pfr");
-    table->insert("application/x-chess-pgn",".pgn");
-    table->insert("image/x-portable-graymap",".pgm");
-    table->insert("image/png",".png");
-    table->insert("image/x-portable-pixmap",".ppm");
-    table->insert("application/pskc+xml",".pskcxml");
-    table->insert("application/vnd.ctc-posml",".pml");
-    table->insert("application/postscript",".ai");
-    table->insert("application/x-font-type1",".pfa");
-    table->insert("application/vnd.powerbuilder6",".pbd");
-    table->insert("application/pgp-encrypted","");
-    table->insert("application/pgp-signature",".pgp");
-    table->insert("application/vnd.previewsystems.box",".box");
-    table->insert("application/vnd.pvi.ptid1",".ptid");
-    table->insert("application/pls+xml",".pls");
-    table->insert("application/vnd.pg.format",".str");
-    table->insert("application/vnd.pg.osasli",".ei6");
-    table->insert("text/prs.lines.tag",".dsc");
-    table->insert("application/x-font-linux-psf",".psf");
-    table->insert("application/vnd.publishare-delta-tree",".qps");
-    table->insert("application/vnd.pmi.widget",".wg");
-    table->insert("application/vnd.quark.quarkxpress",".qxd");
-    table->insert("application/vnd.epson.esf",".esf");
-    table->insert("application/vnd.epson.msf",".msf");
-    table->insert("application/vnd.epson.ssf",".ssf");
-    table->insert("application/vnd.epson.quickanime",".qam");
-    table->insert("application/vnd.intu.qfx",".qfx");
-    table->insert("video/quicktime",".qt");
-    table->insert("application/x-rar-compressed",".rar");
-    table->insert("audio/x-pn-realaudio",".ram");
-    table->insert("audio/x-pn-realaudio-plugin",".rmp");
-    table->insert("application/rsd+xml",".rsd");
-    table->insert("application/vnd.rn-realmedia",".rm");
-    table->insert("application/vnd.realvnc.bed",".bed");
-    table->insert("application/vnd.recordare.musicxml",".mxl");
-    table->insert("application/vnd.recordare.musicxml+xml",".musicxml");
-    table->insert("application/relax-ng-compact-syntax",".rnc");
-    table->insert("application/vnd.data-vision.rdz",".rdz");
-    table->insert("application/rdf+xml",".rdf");
-    table->insert("application/vnd.cloanto.rp9",".rp9");
-    table->insert("application/vnd.jisp",".jisp");
-    table->insert("application/rtf",".rtf");
-    table->insert("text/richtext",".rtx");
-    table->insert("application/vnd.route66.link66+xml",".link66");
-    table->insert("application/rss+xml",".xml");
-    table->insert("application/shf+xml",".shf");
-    table->insert("application/vnd.sailingtracker.track",".st");
-    table->insert("image/svg+xml",".svg");
-    table->insert("application/vnd.sus-calendar",".sus");
-    table->insert("application/sru+xml",".sru");
-    table->insert("application/set-payment-initiation",".setpay");
-    table->insert("application/set-registration-initiation",".setreg");
-    table->insert("application/vnd.sema",".sema");
-    table->insert("application/vnd.semd",".semd");
-    table->insert("application/vnd.semf",".semf");
-    table->insert("application/vnd.seemail",".see");
-    table->insert("application/x-font-snf",".snf");
-    table->insert("application/scvp-vp-request",".spq");
-    table->insert("application/scvp-vp-response",".spp");
-    table->insert("application/scvp-cv-request",".scq");
-    table->insert("application/scvp-cv-response",".scs");
-    table->insert("application/sdp",".sdp");
-    table->insert("text/x-setext",".etx");
-    table->insert("video/x-sgi-movie",".movie");
-    table->insert("application/vnd.shana.informed.formdata",".ifm");
-    table->insert("application/vnd.shana.informed.formtemplate",".itp");
-    table->insert("application/vnd.shana.informed.interchange",".iif");
-    table->insert("application/vnd.shana.informed.package",".ipk");
-    table->insert("application/thraud+xml",".tfi");
-    table->insert("application/x-shar",".shar");
-    table->insert("image/x-rgb",".rgb");
-    table->insert("application/vnd.epson.salt",".slt");
-    table->insert("application/vnd.accpac.simply.aso",".aso");
-    table->insert("application/vnd.accpac.simply.imp",".imp");
-    table->insert("application/vnd.simtech-mindmapper",".twd");
-    table->insert("application/vnd.commonspace",".csp");
-    table->insert("application/vnd.yamaha.smaf-audio",".saf");
-    table->insert("application/vnd.smaf",".mmf");
-    table->insert("application/vnd.yamaha.smaf-phrase",".spf");
-    table->insert("application/vnd.smart.teacher",".teacher");
-    table->insert("application/vnd.svd",".svd");
-    table->insert("application/sparql-query",".rq");
-    table->insert("application/sparql-results+xml",".srx");
-    table->insert("application/srgs",".gram");
-    table->insert("application/srgs+xml",".grxml");
-    table->insert("application/ssml+xml",".ssml");
-    table->insert("application/vnd.koan",".skp");
-    table->insert("text/sgml",".sgml");
-    table->insert("application/vnd.stardivision.calc",".sdc");
-    table->insert("application/vnd.stardivision.draw",".sda");
-    table->insert("application/vnd.stardivision.impress",".sdd");
-    table->insert("application/vnd.stardivision.math",".smf");
-    table->insert("application/vnd.stardivision.writer",".sdw");
-    table->insert("application/vnd.stardivision.writer-global",".sgl");
-    table->insert("application/vnd.stepmania.stepchart",".sm");
-    table->insert("application/x-stuffit",".sit");
-    table->insert("application/x-stuffitx",".sitx");
-    table->insert("application/vnd.solent.sdkm+xml",".sdkm");
-    table->insert("application/vnd.olpc-sugar",".xo");
-    table->insert("audio/basic",".au");
-    table->insert("application/vnd.wqd",".wqd");
-    table->insert("application/vnd.symbian.install",".sis");
-    table->insert("application/smil+xml",".smi");
-    table->insert("application/vnd.syncml+xml",".xsm");
-    table->insert("application/vnd.syncml.dm+wbxml",".bdm");
-    table->insert("application/vnd.syncml.dm+xml",".xdm");
-    table->insert("application/x-sv4cpio",".sv4cpio");
-    table->insert("application/x-sv4crc",".sv4crc");
-    table->insert("application/sbml+xml",".sbml");
-    table->insert("text/tab-separated-values",".tsv");
-    table->insert("image/tiff",".tiff");
-    table->insert("application/vnd.tao.intent-module-archive",".tao");
-    table->insert("application/x-tar",".tar");
-    table->insert("application/x-tcl",".tcl");
-    table->insert("application/x-tex",".tex");
-    table->insert("application/x-tex-tfm",".tfm");
-    table->insert("application/tei+xml",".tei");
-    table->insert("text/plain",".txt");
-    table->insert("application/vnd.spotfire.dxp",".dxp");
-    table->insert("application/vnd.spotfire.sfs",".sfs");
-    table->insert("application/timestamped-data",".tsd");
-    table->insert("application/vnd.trid.tpt",".tpt");
-    table->insert("application/vnd.triscape.mxs",".mxs");
-    table->insert("text/troff",".t");
-    table->insert("application/vnd.trueapp",".tra");
-    table->insert("application/x-font-ttf",".ttf");
-    table->insert("text/turtle",".ttl");
-    table->insert("application/vnd.umajin",".umj");
-    table->insert("application/vnd.uoml+xml",".uoml");
-    table->insert("application/vnd.unity",".unityweb");
-    table->insert("application/vnd.ufdl",".ufd");
-    table->insert("text/uri-list",".uri");
-    table->insert("application/vnd.uiq.theme",".utz");
-    table->insert("application/x-ustar",".ustar");
-    table->insert("text/x-uuencode",".uu");
-    table->insert("text/x-vcalendar",".vcs");
-    table->insert("text/x-vcard",".vcf");
-    table->insert("application/x-cdlink",".vcd");
-    table->insert("application/vnd.vsf",".vsf");
-    table->insert("model/vrml",".wrl");
-    table->insert("application/vnd.vcx",".vcx");
-    table->insert("model/vnd.mts",".mts");
-    table->insert("model/vnd.vtu",".vtu");
-    table->insert("application/vnd.visionary",".vis");
-    table->insert("video/vnd.vivo",".viv");
-    table->insert("application/ccxml+xml","ccxml");
-    table->insert("application/voicexml+xml",".vxml");
-    table->insert("application/x-wais-source",".src");
-    table->insert("application/vnd.wap.wbxml",".wbxml");
-    table->insert("image/vnd.wap.wbmp",".wbmp");
-    table->insert("audio/x-wav",".wav");
-    table->insert("application/davmount+xml",".davmount");
-    table->insert("application/x-font-woff",".woff");
-    table->insert("application/wspolicy+xml",".wspolicy");
-    table->insert("image/webp",".webp");
-    table->insert("application/vnd.webturbo",".wtb");
-    table->insert("application/widget",".wgt");
-    table->insert("application/winhlp",".hlp");
-    table->insert("text/vnd.wap.wml",".wml");
-    table->insert("text/vnd.wap.wmlscript",".wmls");
-    table->insert("application/vnd.wap.wmlscriptc",".wmlsc");
-    table->insert("application/vnd.wordperfect",".wpd");
-    table->insert("application/vnd.wt.stf",".stf");
-    table->insert("application/wsdl+xml",".wsdl");
-    table->insert("image/x-xbitmap",".xbm");
-    table->insert("image/x-xpixmap",".xpm");
-    table->insert("image/x-xwindowdump",".xwd");
-    table->insert("application/x-x509-ca-cert",".der");
-    table->insert("application/x-xfig",".fig");
-    table->insert("application/xhtml+xml",".xhtml");
-    table->insert("application/xml",".xml");
-    table->insert("application/xcap-diff+xml",".xdf");
-    table->insert("application/xenc+xml",".xenc");
-    table->insert("application/patch-ops-error+xml",".xer");
-    table->insert("application/resource-lists+xml",".rl");
-    table->insert("application/rls-services+xml",".rs");
-    table->insert("application/resource-lists-diff+xml",".rld");
-    table->insert("application/xslt+xml",".xslt");
-    table->insert("application/xop+xml",".xop");
-    table->insert("application/x-xpinstall",".xpi");
-    table->insert("application/xspf+xml",".xspf");
-    table->insert("application/vnd.mozilla.xul+xml",".xul");
-    table->insert("chemical/x-xyz",".xyz");
-    table->insert("application/yang",".yang");
-    table->insert("application/yin+xml",".yin");
-    table->insert("application/vnd.zul",".zir");
-    table->insert("application/zip",".zip");
-    table->insert("application/vnd.handheld-entertainment+xml",".zmm");
-    table->insert("application/vnd.zzazz.deck+xml",".zaz");
+public:
+    const char *mime;
+    const char *extension;
+};
+
+
+// Sorted by MIME type (plain byte order) for a binary search.  Keep it
+// sorted when adding entries; debug builds check it on first use.
+const MimeEntry mimeTable[] = {
+    {"application/andrew-inset", "N/A"},
+    {"application/applixware", ".aw"},
+    {"application/atom+xml", ".xml"},
+    {"application/atomcat+xml", ".atomcat"},
+    {"application/atomsvc+xml", ".atomsvc"},
+    {"application/ccxml+xml", "ccxml"},
+    {"application/cdmi-capability", ".cdmia"},
+    {"application/cdmi-container", ".cdmic"},
+    {"application/cdmi-domain", ".cdmid"},
+    {"application/cdmi-object", ".cdmio"},
+    {"application/cdmi-queue", ".cdmiq"},
+    {"application/cu-seeme", ".cu"},
+    {"application/davmount+xml", ".davmount"},
+    {"application/dssc+der", ".dssc"},
+    {"application/dssc+xml", ".xdssc"},
+    {"application/ecmascript", ".es"},
+    {"application/emma+xml", ".emma"},
+    {"application/epub+zip", ".epub"},
+    {"application/exi", ".exi"},
+    {"application/font-tdpfr", ".pfr"},
+    {"application/hyperstudio", ".stk"},
+    {"application/ipfix", ".ipfix"},
+    {"application/java-archive", ".jar"},
+    {"application/java-serialized-object", ".ser"},
+    {"application/java-vm", ".class"},
+    {"application/javascript", ".js"},
+    {"application/json", ".json"},
+    {"application/mac-binhex40", ".hqx"},
+    {"application/mac-compactpro", ".cpt"},
+    {"application/mads+xml", ".mads"},
+    {"application/marc", ".mrc"},
+    {"application/marcxml+xml", ".mrcx"},
+    {"application/mathematica", ".ma"},
+    {"application/mathml+xml", ".mathml"},
+    {"application/mbox", ".mbox"},
+    {"application/mediaservercontrol+xml", ".mscml"},
+    {"application/metalink4+xml", ".meta4"},
+    {"application/mets+xml", ".mets"},
+    {"application/mods+xml", ".mods"},
+    {"application/mp21", ".m21"},
+    {"application/mp4", ".mp4"},
+    {"application/msword", ".doc"},
+    {"application/mxf", ".mxf"},
+    {"application/octet-stream", ".bin"},
+    {"application/oda", ".oda"},
+    {"application/oebps-package+xml", ".opf"},
+    {"application/ogg", ".ogx"},
+    {"application/onenote", ".onetoc"},
+    {"application/patch-ops-error+xml", ".xer"},
+    {"application/pdf", ".pdf"},
+    {"application/pgp-encrypted", ""},
+    {"application/pgp-signature", ".pgp"},
+    {"application/pics-rules", ".prf"},
+    {"application/pkcs10", ".p10"},
+    {"application/pkcs7-mime", ".p7m"},
+    {"application/pkcs7-signature", ".p7s"},
+    {"application/pkcs8", ".p8"},
+    {"application/pkix-attr-cert", ".ac"},
+    {"application/pkix-cert", ".cer"},
+    {"application/pkix-crl", ".crl"},
+    {"application/pkix-pkipath", ".pkipath"},
+    {"application/pkixcmp", ".pki"},
+    {"application/pls+xml", ".pls"},
+    {"application/postscript", ".ai"},
+    {"application/prs.cww", ".cww"},
+    {"application/pskc+xml", ".pskcxml"},
+    {"application/rdf+xml", ".rdf"},
+    {"application/reginfo+xml", ".rif"},
+    {"application/relax-ng-compact-syntax", ".rnc"},
+    {"application/resource-lists+xml", ".rl"},
+    {"application/resource-lists-diff+xml", ".rld"},
+    {"application/rls-services+xml", ".rs"},
+    {"application/rsd+xml", ".rsd"},
+    {"application/rss+xml", ".xml"},
+    {"application/rtf", ".rtf"},
+    {"application/sbml+xml", ".sbml"},
+    {"application/scvp-cv-request", ".scq"},
+    {"application/scvp-cv-response", ".scs"},
+    {"application/scvp-vp-request", ".spq"},
+    {"application/scvp-vp-response", ".spp"},
+    {"application/sdp", ".sdp"},
+    {"application/set-payment-initiation", ".setpay"},
+    {"application/set-registration-initiation", ".setreg"},
+    {"application/shf+xml", ".shf"},
+    {"application/smil+xml", ".smi"},
+    {"application/sparql-query", ".rq"},
+    {"application/sparql-results+xml", ".srx"},
+    {"application/srgs", ".gram"},
+    {"application/srgs+xml", ".grxml"},
+    {"application/sru+xml", ".sru"},
+    {"application/ssml+xml", ".ssml"},
+    {"application/tei+xml", ".tei"},
+    {"application/thraud+xml", ".tfi"},
+    {"application/timestamped-data", ".tsd"},
+    {"application/vnd.3gpp.pic-bw-large", ".plb"},
+    {"application/vnd.3gpp.pic-bw-small", ".psb"},
+    {"application/vnd.3gpp.pic-bw-var", ".pvb"},
+    {"application/vnd.3gpp2.tcap", ".tcap"},
+    {"application/vnd.3m.post-it-notes", ".pwn"},
+    {"application/vnd.accpac.simply.aso", ".aso"},
+    {"application/vnd.accpac.simply.imp", ".imp"},
+    {"application/vnd.acucobol", ".acu"},
+    {"application/vnd.acucorp", ".atc"},
+    {"application/vnd.adobe.air-application-installer-package+zip", ".air"},
+    {"application/vnd.adobe.fxp", ".fxp"},
+    {"application/vnd.adobe.xdp+xml", ".xdp"},
+    {"application/vnd.adobe.xfdf", ".xfdf"},
+    {"application/vnd.ahead.space", ".ahead"},
+    {"application/vnd.airzip.filesecure.azf", ".azf"},
+    {"application/vnd.airzip.filesecure.azs", ".azs"},
+    {"application/vnd.amazon.ebook", ".azw"},
+    {"application/vnd.americandynamics.acc", ".acc"},
+    {"application/vnd.amiga.ami", ".ami"},
+    {"application/vnd.android.package-archive", ".apk"},
+    {"application/vnd.anser-web-certificate-issue-initiation", ".cii"},
+    {"application/vnd.anser-web-funds-transfer-initiation", ".fti"},
+    {"application/vnd.antix.game-component", ".atx"},
+    {"application/vnd.apple.installer+xml", ".mpkg"},
+    {"application/vnd.apple.mpegurl", ".m3u8"},
+    {"application/vnd.aristanetworks.swi", ".swi"},
+    {"application/vnd.audiograph", ".aep"},
+    {"application/vnd.blueice.multipass", ".mpm"},
+    {"application/vnd.bmi", ".bmi"},
+    {"application/vnd.businessobjects", ".rep"},
+    {"application/vnd.chemdraw+xml", ".cdxml"},
+    {"application/vnd.chipnuts.karaoke-mmd", ".mmd"},
+    {"application/vnd.cinderella", ".cdy"},
+    {"application/vnd.claymore", ".cla"},
+    {"application/vnd.cloanto.rp9", ".rp9"},
+    {"application/vnd.clonk.c4group", ".c4g"},
+    {"application/vnd.cluetrust.cartomobile-config", ".c11amc"},
+    {"application/vnd.cluetrust.cartomobile-config-pkg", ".c11amz"},
+    {"application/vnd.commonspace", ".csp"},
+    {"application/vnd.contact.cmsg", ".cdbcmsg"},
+    {"application/vnd.cosmocaller", ".cmc"},
+    {"application/vnd.crick.clicker", ".clkx"},
+    {"application/vnd.crick.clicker.keyboard", ".clkk"},
+    {"application/vnd.crick.clicker.palette", ".clkp"},
+    {"application/vnd.crick.clicker.template", ".clkt"},
+    {"application/vnd.crick.clicker.wordbank", ".clkw"},
+    {"application/vnd.criticaltools.wbs+xml", ".wbs"},
+    {"application/vnd.ctc-posml", ".pml"},
+    {"application/vnd.cups-ppd", ".ppd"},
+    {"application/vnd.curl.car", ".car"},
+    {"application/vnd.curl.pcurl", ".pcurl"},
+    {"application/vnd.data-vision.rdz", ".rdz"},
+    {"application/vnd.denovo.fcselayout-link", ".fe_launch"},
+    {"application/vnd.dna", ".dna"},
+    {"application/vnd.dolby.mlp", ".mlp"},
+    {"application/vnd.dpgraph", ".dpg"},
+    {"application/vnd.dreamfactory", ".dfac"},
+    {"application/vnd.dvb.ait", ".ait"},
+    {"application/vnd.dvb.service", ".svc"},
+    {"application/vnd.dynageo", ".geo"},
+    {"application/vnd.ecowin.chart", ".mag"},
+    {"application/vnd.enliven", ".nml"},
+    {"application/vnd.epson.esf", ".esf"},
+    {"application/vnd.epson.msf", ".msf"},
+    {"application/vnd.epson.quickanime", ".qam"},
+    {"application/vnd.epson.salt", ".slt"},
+    {"application/vnd.epson.ssf", ".ssf"},
+    {"application/vnd.eszigno3+xml", ".es3"},
+    {"application/vnd.ezpix-album", ".ez2"},
+    {"application/vnd.ezpix-package", ".ez3"},
+    {"application/vnd.fdf", ".fdf"},
+    {"application/vnd.fdsn.seed", ".seed"},
+    {"application/vnd.flographit", ".gph"},
+    {"application/vnd.fluxtime.clip", ".ftc"},
+    {"application/vnd.framemaker", ".fm"},
+    {"application/vnd.frogans.fnc", ".fnc"},
+    {"application/vnd.frogans.ltf", ".ltf"},
+    {"application/vnd.fsc.weblaunch", ".fsc"},
+    {"application/vnd.fujitsu.oasys", ".oas"},
+    {"application/vnd.fujitsu.oasys2", ".oa2"},
+    {"application/vnd.fujitsu.oasys3", ".oa3"},
+    {"application/vnd.fujitsu.oasysgp", ".fg5"},
+    {"application/vnd.fujitsu.oasysprs", ".bh2"},
+    {"application/vnd.fujixerox.ddd", ".ddd"},
+    {"application/vnd.fujixerox.docuworks", ".xdw"},
+    {"application/vnd.fujixerox.docuworks.binder", ".xbd"},
+    {"application/vnd.fuzzysheet", ".fzs"},
+    {"application/vnd.genomatix.tuxedo", ".txd"},
+    {"application/vnd.geogebra.file", ".ggb"},
+    {"application/vnd.geogebra.tool", ".ggt"},
+    {"application/vnd.geometry-explorer", ".gex"},
+    {"application/vnd.geonext", ".gxt"},
+    {"application/vnd.geoplan", ".g2w"},
+    {"application/vnd.geospace", ".g3w"},
+    {"application/vnd.gmx", ".gmx"},
+    {"application/vnd.google-earth.kml+xml", ".kml"},
+    {"application/vnd.google-earth.kmz", ".kmz"},
+    {"application/vnd.grafeq", ".gqf"},
+    {"application/vnd.groove-account", ".gac"},
+    {"application/vnd.groove-help", ".ghf"},
+    {"application/vnd.groove-identity-message", ".gim"},
+    {"application/vnd.groove-injector", ".grv"},
+    {"application/vnd.groove-tool-message", ".gtm"},
+    {"application/vnd.groove-tool-template", ".tpl"},
+    {"application/vnd.groove-vcard", ".vcg"},
+    {"application/vnd.hal+xml", ".hal"},
+    {"application/vnd.handheld-entertainment+xml", ".zmm"},
+    {"application/vnd.hbci", ".hbci"},
+    {"application/vnd.hhe.lesson-player", ".les"},
+    {"application/vnd.hp-hpgl", ".hpgl"},
+    {"application/vnd.hp-hpid", ".hpid"},
+    {"application/vnd.hp-hps", ".hps"},
+    {"application/vnd.hp-jlyt", ".jlt"},
+    {"application/vnd.hp-pcl", ".pcl"},
+    {"application/vnd.hp-pclxl", ".pclxl"},
+    {"application/vnd.hydrostatix.sof-data", ".sfd-hdstx"},
+    {"application/vnd.hzn-3d-crossword", ".x3d"},
+    {"application/vnd.ibm.minipay", ".mpy"},
+    {"application/vnd.ibm.modcap", ".afp"},
+    {"application/vnd.ibm.rights-management", ".irm"},
+    {"application/vnd.ibm.secure-container", ".sc"},
+    {"application/vnd.iccprofile", ".icc"},
+    {"application/vnd.igloader", ".igl"},
+    {"application/vnd.immervision-ivp", ".ivp"},
+    {"application/vnd.immervision-ivu", ".ivu"},
+    {"application/vnd.insors.igm", ".igm"},
+    {"application/vnd.intercon.formnet", ".xpw"},
+    {"application/vnd.intergeo", ".i2g"},
+    {"application/vnd.intu.qbo", ".qbo"},
+    {"application/vnd.intu.qfx", ".qfx"},
+    {"application/vnd.ipunplugged.rcprofile", ".rcprofile"},
+    {"application/vnd.irepository.package+xml", ".irp"},
+    {"application/vnd.is-xpr", ".xpr"},
+    {"application/vnd.isac.fcs", ".fcs"},
+    {"application/vnd.jam", ".jam"},
+    {"application/vnd.jcp.javame.midlet-rms", ".rms"},
+    {"application/vnd.jisp", ".jisp"},
+    {"application/vnd.joost.joda-archive", ".joda"},
+    {"application/vnd.kahootz", ".ktz"},
+    {"application/vnd.kde.karbon", ".karbon"},
+    {"application/vnd.kde.kchart", ".chrt"},
+    {"application/vnd.kde.kformula", ".kfo"},
+    {"application/vnd.kde.kivio", ".flw"},
+    {"application/vnd.kde.kontour", ".kon"},
+    {"application/vnd.kde.kpresenter", ".kpr"},
+    {"application/vnd.kde.kspread", ".ksp"},
+    {"application/vnd.kde.kword", ".kwd"},
+    {"application/vnd.kenameaapp", ".htke"},
+    {"application/vnd.kidspiration", ".kia"},
+    {"application/vnd.kinar", ".kne"},
+    {"application/vnd.koan", ".skp"},
+    {"application/vnd.kodak-descriptor", ".sse"},
+    {"application/vnd.las.las+xml", ".lasxml"},
+    {"application/vnd.llamagraphics.life-balance.desktop", ".lbd"},
+    {"application/vnd.llamagraphics.life-balance.exchange+xml", ".lbe"},
+    {"application/vnd.lotus-1-2-3", "0.123"},
+    {"application/vnd.lotus-approach", ".apr"},
+    {"application/vnd.lotus-freelance", ".pre"},
+    {"application/vnd.lotus-notes", ".nsf"},
+    {"application/vnd.lotus-organizer", ".org"},
+    {"application/vnd.lotus-screencam", ".scm"},
+    {"application/vnd.lotus-wordpro", ".lwp"},
+    {"application/vnd.macports.portpkg", ".portpkg"},
+    {"application/vnd.mcd", ".mcd"},
+    {"application/vnd.medcalcdata", ".mc1"},
+    {"application/vnd.mediastation.cdkey", ".cdkey"},
+    {"application/vnd.mfer", ".mwf"},
+    {"application/vnd.mfmp", ".mfm"},
+    {"application/vnd.micrografx.flo", ".flo"},
+    {"application/vnd.micrografx.igx", ".igx"},
+    {"application/vnd.mif", ".mif"},
+    {"application/vnd.mobius.daf", ".daf"},
+    {"application/vnd.mobius.dis", ".dis"},
+    {"application/vnd.mobius.mbk", ".mbk"},
+    {"application/vnd.mobius.mqy", ".mqy"},
+    {"application/vnd.mobius.msl", ".msl"},
+    {"application/vnd.mobius.plc", ".plc"},
+    {"application/vnd.mobius.txf", ".txf"},
+    {"application/vnd.mophun.application", ".mpn"},
+    {"application/vnd.mophun.certificate", ".mpc"},
+    {"application/vnd.mozilla.xul+xml", ".xul"},
+    {"application/vnd.ms-artgalry", ".cil"},
+    {"application/vnd.ms-cab-compressed", ".cab"},
+    {"application/vnd.ms-excel", ".xls"},
+    {"application/vnd.ms-excel.addin.macroenabled.12", ".xlam"},
+    {"application/vnd.ms-excel.sheet.binary.macroenabled.12", ".xlsb"},
+    {"application/vnd.ms-excel.sheet.macroenabled.12", ".xlsm"},
+    {"application/vnd.ms-excel.template.macroenabled.12", ".xltm"},
+    {"application/vnd.ms-fontobject", ".eot"},
+    {"application/vnd.ms-htmlhelp", ".chm"},
+    {"application/vnd.ms-ims", ".ims"},
+    {"application/vnd.ms-lrm", ".lrm"},
+    {"application/vnd.ms-officetheme", ".thmx"},
+    {"application/vnd.ms-pki.seccat", ".cat"},
+    {"application/vnd.ms-pki.stl", ".stl"},
+    {"application/vnd.ms-powerpoint", ".ppt"},
+    {"application/vnd.ms-powerpoint.addin.macroenabled.12", ".ppam"},
+    {"application/vnd.ms-powerpoint.presentation.macroenabled.12", ".pptm"},
+    {"application/vnd.ms-powerpoint.slide.macroenabled.12", ".sldm"},
+    {"application/vnd.ms-powerpoint.slideshow.macroenabled.12", ".ppsm"},
+    {"application/vnd.ms-powerpoint.template.macroenabled.12", ".potm"},
+    {"application/vnd.ms-project", ".mpp"},
+    {"application/vnd.ms-word.document.macroenabled.12", ".docm"},
+    {"application/vnd.ms-word.template.macroenabled.12", ".dotm"},
+    {"application/vnd.ms-works", ".wps"},
+    {"application/vnd.ms-wpl", ".wpl"},
+    {"application/vnd.ms-xpsdocument", ".xps"},
+    {"application/vnd.mseq", ".mseq"},
+    {"application/vnd.musician", ".mus"},
+    {"application/vnd.muvee.style", ".msty"},
+    {"application/vnd.neurolanguage.nlu", ".nlu"},
+    {"application/vnd.noblenet-directory", ".nnd"},
+    {"application/vnd.noblenet-sealer", ".nns"},
+    {"application/vnd.noblenet-web", ".nnw"},
+    {"application/vnd.nokia.n-gage.data", ".ngdat"},
+    {"application/vnd.nokia.n-gage.symbian.install", ".n-gage"},
+    {"application/vnd.nokia.radio-preset", ".rpst"},
+    {"application/vnd.nokia.radio-presets", ".rpss"},
+    {"application/vnd.novadigm.edm", ".edm"},
+    {"application/vnd.novadigm.edx", ".edx"},
+    {"application/vnd.novadigm.ext", ".ext"},
+    {"application/vnd.oasis.opendocument.chart", ".odc"},
+    {"application/vnd.oasis.opendocument.chart-template", ".otc"},
+    {"application/vnd.oasis.opendocument.database", ".odb"},
+    {"application/vnd.oasis.opendocument.formula", ".odf"},
+    {"application/vnd.oasis.opendocument.formula-template", ".odft"},
+    {"application/vnd.oasis.opendocument.graphics", ".odg"},
+    {"application/vnd.oasis.opendocument.graphics-template", ".otg"},
+    {"application/vnd.oasis.opendocument.image", ".odi"},
+    {"application/vnd.oasis.opendocument.image-template", ".oti"},
+    {"application/vnd.oasis.opendocument.presentation", ".odp"},
+    {"application/vnd.oasis.opendocument.presentation-template", ".otp"},
+    {"application/vnd.oasis.opendocument.spreadsheet", ".ods"},
+    {"application/vnd.oasis.opendocument.spreadsheet-template", ".ots"},
+    {"application/vnd.oasis.opendocument.text", ".odt"},
+    {"application/vnd.oasis.opendocument.text-master", ".odm"},
+    {"application/vnd.oasis.opendocument.text-template", ".ott"},
+    {"application/vnd.oasis.opendocument.text-web", ".oth"},
+    {"application/vnd.olpc-sugar", ".xo"},
+    {"application/vnd.oma.dd2+xml", ".dd2"},
+    {"application/vnd.openofficeorg.extension", ".oxt"},
+    {"application/vnd.openxmlformats-officedocument.presentationml.presentation", ".pptx"},
+    {"application/vnd.openxmlformats-officedocument.presentationml.slide", ".sldx"},
+    {"application/vnd.openxmlformats-officedocument.presentationml.slideshow", ".ppsx"},
+    {"application/vnd.openxmlformats-officedocument.presentationml.template", ".potx"},
+    {"application/vnd.openxmlformats-officedocument.spreadsheetml.sheet", ".xlsx"},
+    {"application/vnd.openxmlformats-officedocument.spreadsheetml.template", ".xltx"},
+    {"application/vnd.openxmlformats-officedocument.wordprocessingml.document", ".docx"},
+    {"application/vnd.openxmlformats-officedocument.wordprocessingml.template", ".dotx"},
+    {"application/vnd.osgeo.mapguide.package", ".mgp"},
+    {"application/vnd.osgi.dp", ".dp"},
+    {"application/vnd.palm", ".pdb"},
+    {"application/vnd.pawaafile", ".paw"},
+    {"application/vnd.pg.format", ".str"},
+    {"application/vnd.pg.osasli", ".ei6"},
+    {"application/vnd.picsel", ".efif"},
+    {"application/vnd.pmi.widget", ".wg"},
+    {"application/vnd.pocketlearn", ".plf"},
+    {"application/vnd.powerbuilder6", ".pbd"},
+    {"application/vnd.previewsystems.box", ".box"},
+    {"application/vnd.proteus.magazine", ".mgz"},
+    {"application/vnd.publishare-delta-tree", ".qps"},
+    {"application/vnd.pvi.ptid1", ".ptid"},
+    {"application/vnd.quark.quarkxpress", ".qxd"},
+    {"application/vnd.realvnc.bed", ".bed"},
+    {"application/vnd.recordare.musicxml", ".mxl"},
+    {"application/vnd.recordare.musicxml+xml", ".musicxml"},
+    {"application/vnd.rig.cryptonote", ".cryptonote"},
+    {"application/vnd.rim.cod", ".cod"},
+    {"application/vnd.rn-realmedia", ".rm"},
+    {"application/vnd.route66.link66+xml", ".link66"},
+    {"application/vnd.sailingtracker.track", ".st"},
+    {"application/vnd.seemail", ".see"},
+    {"application/vnd.sema", ".sema"},
+    {"application/vnd.semd", ".semd"},
+    {"application/vnd.semf", ".semf"},
+    {"application/vnd.shana.informed.formdata", ".ifm"},
+    {"application/vnd.shana.informed.formtemplate", ".itp"},
+    {"application/vnd.shana.informed.interchange", ".iif"},
+    {"application/vnd.shana.informed.package", ".ipk"},
+    {"application/vnd.simtech-mindmapper", ".twd"},
+    {"application/vnd.smaf", ".mmf"},
+    {"application/vnd.smart.teacher", ".teacher"},
+    {"application/vnd.solent.sdkm+xml", ".sdkm"},
+    {"application/vnd.spotfire.dxp", ".dxp"},
+    {"application/vnd.spotfire.sfs", ".sfs"},
+    {"application/vnd.stardivision.calc", ".sdc"},
+    {"application/vnd.stardivision.draw", ".sda"},
+    {"application/vnd.stardivision.impress", ".sdd"},
+    {"application/vnd.stardivision.math", ".smf"},
+    {"application/vnd.stardivision.writer", ".sdw"},
+    {"application/vnd.stardivision.writer-global", ".sgl"},
+    {"application/vnd.stepmania.stepchart", ".sm"},
+    {"application/vnd.sun.xml.calc", ".sxc"},
+    {"application/vnd.sun.xml.calc.template", ".stc"},
+    {"application/vnd.sun.xml.draw", ".sxd"},
+    {"application/vnd.sun.xml.draw.template", ".std"},
+    {"application/vnd.sun.xml.impress", ".sxi"},
+    {"application/vnd.sun.xml.impress.template", ".sti"},
+    {"application/vnd.sun.xml.math", ".sxm"},
+    {"application/vnd.sun.xml.writer", ".sxw"},
+    {"application/vnd.sun.xml.writer.global", ".sxg"},
+    {"application/vnd.sun.xml.writer.template", ".stw"},
+    {"application/vnd.sus-calendar", ".sus"},
+    {"application/vnd.svd", ".svd"},
+    {"application/vnd.symbian.install", ".sis"},
+    {"application/vnd.syncml+xml", ".xsm"},
+    {"application/vnd.syncml.dm+wbxml", ".bdm"},
+    {"application/vnd.syncml.dm+xml", ".xdm"},
+    {"application/vnd.tao.intent-module-archive", ".tao"},
+    {"application/vnd.tmobile-livetv", ".tmo"},
+    {"application/vnd.trid.tpt", ".tpt"},
+    {"application/vnd.triscape.mxs", ".mxs"},
+    {"application/vnd.trueapp", ".tra"},
+    {"application/vnd.ufdl", ".ufd"},
+    {"application/vnd.uiq.theme", ".utz"},
+    {"application/vnd.umajin", ".umj"},
+    {"application/vnd.unity", ".unityweb"},
+    {"application/vnd.uoml+xml", ".uoml"},
+    {"application/vnd.vcx", ".vcx"},
+    {"application/vnd.visio", ".vsd"},
+    {"application/vnd.visionary", ".vis"},
+    {"application/vnd.vsf", ".vsf"},
+    {"application/vnd.wap.wbxml", ".wbxml"},
+    {"application/vnd.wap.wmlc", ".wmlc"},
+    {"application/vnd.wap.wmlscriptc", ".wmlsc"},
+    {"application/vnd.webturbo", ".wtb"},
+    {"application/vnd.wolfram.player", ".nbp"},
+    {"application/vnd.wordperfect", ".wpd"},
+    {"application/vnd.wqd", ".wqd"},
+    {"application/vnd.wt.stf", ".stf"},
+    {"application/vnd.xara", ".xar"},
+    {"application/vnd.xfdl", ".xfdl"},
+    {"application/vnd.yamaha.hv-dic", ".hvd"},
+    {"application/vnd.yamaha.hv-script", ".hvs"},
+    {"application/vnd.yamaha.hv-voice", ".hvp"},
+    {"application/vnd.yamaha.openscoreformat", ".osf"},
+    {"application/vnd.yamaha.openscoreformat.osfpvg+xml", ".osfpvg"},
+    {"application/vnd.yamaha.smaf-audio", ".saf"},
+    {"application/vnd.yamaha.smaf-phrase", ".spf"},
+    {"application/vnd.yellowriver-custom-menu", ".cmp"},
+    {"application/vnd.zul", ".zir"},
+    {"application/vnd.zzazz.deck+xml", ".zaz"},
+    {"application/voicexml+xml", ".vxml"},
+    {"application/widget", ".wgt"},
+    {"application/winhlp", ".hlp"},
+    {"application/wsdl+xml", ".wsdl"},
+    {"application/wspolicy+xml", ".wspolicy"},
+    {"application/x-7z-compressed", ".7z"},
+    {"application/x-abiword", ".abw"},
+    {"application/x-ace-compressed", ".ace"},
+    {"application/x-authorware-bin", ".aab"},
+    {"application/x-authorware-map", ".aam"},
+    {"application/x-authorware-seg", ".aas"},
+    {"application/x-bcpio", ".bcpio"},
+    {"application/x-bittorrent", ".torrent"},
+    {"application/x-bzip", ".bz"},
+    {"application/x-bzip2", ".bz2"},
+    {"application/x-cdlink", ".vcd"},
+    {"application/x-chat", ".chat"},
+    {"application/x-chess-pgn", ".pgn"},
+    {"application/x-cpio", ".cpio"},
+    {"application/x-csh", ".csh"},
+    {"application/x-debian-package", ".deb"},
+    {"application/x-director", ".dir"},
+    {"application/x-doom", ".wad"},
+    {"application/x-dtbncx+xml", ".ncx"},
+    {"application/x-dtbook+xml", ".dtb"},
+    {"application/x-dtbresource+xml", ".res"},
+    {"application/x-dvi", ".dvi"},
+    {"application/x-font-bdf", ".bdf"},
+    {"application/x-font-ghostscript", ".gsf"},
+    {"application/x-font-linux-psf", ".psf"},
+    {"application/x-font-otf", ".otf"},
+    {"application/x-font-pcf", ".pcf"},
+    {"application/x-font-snf", ".snf"},
+    {"application/x-font-ttf", ".ttf"},
+    {"application/x-font-type1", ".pfa"},
+    {"application/x-font-woff", ".woff"},
+    {"application/x-futuresplash", ".spl"},
+    {"application/x-gnumeric", ".gnumeric"},
+    {"application/x-gtar", ".gtar"},
+    {"application/x-hdf", ".hdf"},
+    {"application/x-java-jnlp-file", ".jnlp"},
+    {"application/x-latex", ".latex"},
+    {"application/x-mobipocket-ebook", ".prc"},
+    {"application/x-ms-application", ".application"},
+    {"application/x-ms-wmd", ".wmd"},
+    {"application/x-ms-wmz", ".wmz"},
+    {"application/x-ms-xbap", ".xbap"},
+    {"application/x-msaccess", ".mdb"},
+    {"application/x-msbinder", ".obd"},
+    {"application/x-mscardfile", ".crd"},
+    {"application/x-msclip", ".clp"},
+    {"application/x-msdownload", ".exe"},
+    {"application/x-msmediaview", ".mvb"},
+    {"application/x-msmetafile", ".wmf"},
+    {"application/x-msmoney", ".mny"},
+    {"application/x-mspublisher", ".pub"},
+    {"application/x-msschedule", ".scd"},
+    {"application/x-msterminal", ".trm"},
+    {"application/x-mswrite", ".wri"},
+    {"application/x-netcdf", ".nc"},
+    {"application/x-pkcs12", ".p12"},
+    {"application/x-pkcs7-certificates", ".p7b"},
+    {"application/x-pkcs7-certreqresp", ".p7r"},
+    {"application/x-rar-compressed", ".rar"},
+    {"application/x-sh", ".sh"},
+    {"application/x-shar", ".shar"},
+    {"application/x-shockwave-flash", ".swf"},
+    {"application/x-silverlight-app", ".xap"},
+    {"application/x-stuffit", ".sit"},
+    {"application/x-stuffitx", ".sitx"},
+    {"application/x-sv4cpio", ".sv4cpio"},
+    {"application/x-sv4crc", ".sv4crc"},
+    {"application/x-tar", ".tar"},
+    {"application/x-tcl", ".tcl"},
+    {"application/x-tex", ".tex"},
+    {"application/x-tex-tfm", ".tfm"},
+    {"application/x-texinfo", ".texinfo"},
+    {"application/x-ustar", ".ustar"},
+    {"application/x-wais-source", ".src"},
+    {"application/x-x509-ca-cert", ".der"},
+    {"application/x-xfig", ".fig"},
+    {"application/x-xpinstall", ".xpi"},
+    {"application/xcap-diff+xml", ".xdf"},
+    {"application/xenc+xml", ".xenc"},
+    {"application/xhtml+xml", ".xhtml"},
+    {"application/xml", ".xml"},
+    {"application/xml-dtd", ".dtd"},
+    {"application/xop+xml", ".xop"},
+    {"application/xslt+xml", ".xslt"},
+    {"application/xspf+xml", ".xspf"},
+    {"application/xv+xml", ".mxml"},
+    {"application/yang", ".yang"},
+    {"application/yin+xml", ".yin"},
+    {"application/zip", ".zip"},
+    {"audio/adpcm", ".adp"},
+    {"audio/basic", ".au"},
+    {"audio/midi", ".mid"},
+    {"audio/mp4", ".mp4a"},
+    {"audio/mpeg", ".mpga"},
+    {"audio/ogg", ".oga"},
+    {"audio/vnd.dece.audio", ".uva"},
+    {"audio/vnd.digital-winds", ".eol"},
+    {"audio/vnd.dra", ".dra"},
+    {"audio/vnd.dts", ".dts"},
+    {"audio/vnd.dts.hd", ".dtshd"},
+    {"audio/vnd.lucent.voice", ".lvp"},
+    {"audio/vnd.ms-playready.media.pya", ".pya"},
+    {"audio/vnd.nuera.ecelp4800", ".ecelp4800"},
+    {"audio/vnd.nuera.ecelp7470", ".ecelp7470"},
+    {"audio/vnd.nuera.ecelp9600", ".ecelp9600"},
+    {"audio/vnd.rip", ".rip"},
+    {"audio/webm", ".weba"},
+    {"audio/x-aac", ".aac"},
+    {"audio/x-aiff", ".aif"},
+    {"audio/x-mpegurl", ".m3u"},
+    {"audio/x-ms-wax", ".wax"},
+    {"audio/x-ms-wma", ".wma"},
+    {"audio/x-pn-realaudio", ".ram"},
+    {"audio/x-pn-realaudio-plugin", ".rmp"},
+    {"audio/x-wav", ".wav"},
+    {"chemical/x-cdx", ".cdx"},
+    {"chemical/x-cif", ".cif"},
+    {"chemical/x-cmdf", ".cmdf"},
+    {"chemical/x-cml", ".cml"},
+    {"chemical/x-csml", ".csml"},
+    {"chemical/x-xyz", ".xyz"},
+    {"image/bmp", ".bmp"},
+    {"image/cgm", ".cgm"},
+    {"image/g3fax", ".g3"},
+    {"image/gif", ".gif"},
+    {"image/ief", ".ief"},
+    {"image/jpeg", ".jpg"},
+    {"image/ktx", ".ktx"},
+    {"image/png", ".png"},
+    {"image/prs.btif", ".btif"},
+    {"image/svg+xml", ".svg"},
+    {"image/tiff", ".tiff"},
+    {"image/vnd.adobe.photoshop", ".psd"},
+    {"image/vnd.dece.graphic", ".uvi"},
+    {"image/vnd.djvu", ".djvu"},
+    {"image/vnd.dvb.subtitle", ".sub"},
+    {"image/vnd.dwg", ".dwg"},
+    {"image/vnd.dxf", ".dxf"},
+    {"image/vnd.fastbidsheet", ".fbs"},
+    {"image/vnd.fpx", ".fpx"},
+    {"image/vnd.fst", ".fst"},
+    {"image/vnd.fujixerox.edmics-mmr", ".mmr"},
+    {"image/vnd.fujixerox.edmics-rlc", ".rlc"},
+    {"image/vnd.ms-modi", ".mdi"},
+    {"image/vnd.net-fpx", ".npx"},
+    {"image/vnd.wap.wbmp", ".wbmp"},
+    {"image/vnd.xiff", ".xif"},
+    {"image/webp", ".webp"},
+    {"image/x-cmu-raster", ".ras"},
+    {"image/x-cmx", ".cmx"},
+    {"image/x-freehand", ".fh"},
+    {"image/x-icon", ".ico"},
+    {"image/x-pcx", ".pcx"},
+    {"image/x-pict", ".pic"},
+    {"image/x-portable-anymap", ".pnm"},
+    {"image/x-portable-bitmap", ".pbm"},
+    {"image/x-portable-graymap", ".pgm"},
+    {"image/x-portable-pixmap", ".ppm"},
+    {"image/x-rgb", ".rgb"},
+    {"image/x-xbitmap", ".xbm"},
+    {"image/x-xpixmap", ".xpm"},
+    {"image/x-xwindowdump", ".xwd"},
+    {"message/rfc822", ".eml"},
+    {"model/iges", ".igs"},
+    {"model/mesh", ".msh"},
+    {"model/vnd.collada+xml", ".dae"},
+    {"model/vnd.dwf", ".dwf"},
+    {"model/vnd.gdl", ".gdl"},
+    {"model/vnd.gtw", ".gtw"},
+    {"model/vnd.mts", ".mts"},
+    {"model/vnd.vtu", ".vtu"},
+    {"model/vrml", ".wrl"},
+    {"text/calendar", ".ics"},
+    {"text/css", ".css"},
+    {"text/csv", ".csv"},
+    {"text/html", ".html"},
+    {"text/n3", ".n3"},
+    {"text/plain", ".txt"},
+    {"text/prs.lines.tag", ".dsc"},
+    {"text/richtext", ".rtx"},
+    {"text/sgml", ".sgml"},
+    {"text/tab-separated-values", ".tsv"},
+    {"text/troff", ".t"},
+    {"text/turtle", ".ttl"},
+    {"text/uri-list", ".uri"},
+    {"text/vnd.curl", ".curl"},
+    {"text/vnd.curl.dcurl", ".dcurl"},
+    {"text/vnd.curl.mcurl", ".mcurl"},
+    {"text/vnd.curl.scurl", ".scurl"},
+    {"text/vnd.fly", ".fly"},
+    {"text/vnd.fmi.flexstor", ".flx"},
+    {"text/vnd.graphviz", ".gv"},
+    {"text/vnd.in3d.3dml", ".3dml"},
+    {"text/vnd.in3d.spot", ".spot"},
+    {"text/vnd.sun.j2me.app-descriptor", ".jad"},
+    {"text/vnd.wap.wml", ".wml"},
+    {"text/vnd.wap.wmlscript", ".wmls"},
+    {"text/x-asm", ".s"},
+    {"text/x-c", ".c"},
+    {"text/x-fortran", ".f"},
+    {"text/x-java-source", ".java"},
+    {"text/x-pascal", ".p"},
+    {"text/x-setext", ".etx"},
+    {"text/x-uuencode", ".uu"},
+    {"text/x-vcalendar", ".vcs"},
+    {"text/x-vcard", ".vcf"},
+    {"video/3gpp", ".3gp"},
+    {"video/3gpp2", ".3g2"},
+    {"video/h261", ".h261"},
+    {"video/h263", ".h263"},
+    {"video/h264", ".h264"},
+    {"video/jpm", ".jpm"},
+    {"video/mj2", ".mj2"},
+    {"video/mp4", ".mp4"},
+    {"video/mpeg", ".mpeg"},
+    {"video/ogg", ".ogv"},
+    {"video/quicktime", ".qt"},
+    {"video/vnd.dece.hd", ".uvh"},
+    {"video/vnd.dece.mobile", ".uvm"},
+    {"video/vnd.dece.pd", ".uvp"},
+    {"video/vnd.dece.sd", ".uvs"},
+    {"video/vnd.dece.video", ".uvv"},
+    {"video/vnd.fvt", ".fvt"},
+    {"video/vnd.mpegurl", ".mxu"},
+    {"video/vnd.ms-playready.media.pyv", ".pyv"},
+    {"video/vnd.uvvu.mp4", ".uvu"},
+    {"video/vnd.vivo", ".viv"},
+    {"video/webm", ".webm"},
+    {"video/x-f4v", ".f4v"},
+    {"video/x-fli", ".fli"},
+    {"video/x-flv", ".flv"},
+    {"video/x-m4v", ".m4v"},
+    {"video/x-ms-asf", ".asf"},
+    {"video/x-ms-wm", ".wm"},
+    {"video/x-ms-wmv", ".wmv"},
+    {"video/x-ms-wmx", ".wmx"},
+    {"video/x-ms-wvx", ".wvx"},
+    {"video/x-msvideo", ".avi"},
+    {"video/x-sgi-movie", ".movie"},
+    {"x-conference/x-cooltalk", ".ice"},
+};
+
+const int mimeTableSize = sizeof(mimeTable) / sizeof(mimeTable[0]);
+
+
+// Reverse index: positions in mimeTable sorted by extension, built once
+// from the table.  Entries without a real extension are left out, and where
+// several types share an extension the last one in the table is preferred
+// (application/xml for .xml, video/mp4 for .mp4).
+QVector<short> buildExtensionIndex() {
+    QVector<short> index;
+    index.reserve(mimeTableSize);
+    for (short i=0; i<mimeTableSize; i++) {
+        if (mimeTable[i].extension[0] == '.')
+            index.append(i);
+    }
+    std::stable_sort(index.begin(), index.end(), [](short a, short b) {
+        return strcmp(mimeTable[a].extension, mimeTable[b].extension) < 0;
+    });
+    QVector<short> unique;
+    unique.reserve(index.size());
+    for (int i=0; i<index.size(); i++) {
+        if (!unique.isEmpty() && strcmp(mimeTable[unique.last()].extension, mimeTable[index[i]].extension) == 0)
+            unique.last() = index[i];
+        else
+            unique.append(index[i]);
+    }
+    return unique;
 }
 
+const QVector<short> extensionIndex = buildExtensionIndex();
+
+
+#ifndef QT_NO_DEBUG
+bool tablesSorted() {
+    for (int i=1; i<mimeTableSize; i++) {
+        if (strcmp(mimeTable[i-1].mime, mimeTable[i].mime) >= 0)
+            return false;
+    }
+    return true;
+}
+#endif
+
+
+// Binary search by MIME type.  Compares against the Latin-1 table directly
+// so no temporary strings are built.
+const MimeEntry *findMime(const QString &mime) {
+#ifndef QT_NO_DEBUG
+    static const bool sorted = tablesSorted();
+    Q_ASSERT(sorted);
+#endif
+    const MimeEntry *end = mimeTable + mimeTableSize;
+    const MimeEntry *entry = std::lower_bound(mimeTable, end, mime,
+            [](const MimeEntry &e, const QString &key) {
+                return key.compare(QLatin1String(e.mime)) > 0;
+            });
+    if (entry == end || mime.compare(QLatin1String(entry->mime)) != 0)
+        return nullptr;
+    return entry;
+}
+
+
+// Binary search of the reverse index.  Extensions are matched ignoring case.
+const MimeEntry *findExtension(const QString &extension) {
+    QVector<short>::const_iterator end = extensionIndex.constEnd();
+    QVector<short>::const_iterator index = std::lower_bound(extensionIndex.constBegin(), end, extension,
+            [](short i, const QString &key) {
+                return key.compare(QLatin1String(mimeTable[i].extension), Qt::CaseInsensitive) > 0;
+            });
+    if (index == end || extension.compare(QLatin1String(mimeTable[*index].extension), Qt::CaseInsensitive) != 0)
+        return nullptr;
+    return &mimeTable[*index];
+}
 
-MimeReference::~MimeReference() {
-    delete table;
 }
 
 
 
 QString MimeReference::getExtensionFromMime(QString key, QString filename) {
-    if (!table->contains(key)) {
+    const MimeEntry *entry = findMime(key);
+    if (entry == nullptr) {
         if (filename == "")
             filename = key;
         int pos = filename.lastIndexOf(".");
@@ -732,29 +816,29 @@ QString MimeReference::getExtensionFromMime(QString key, QString filename) {
             }
         }
     }
-    QString extension = table->value(key);
     if (filename.endsWith(".zip", Qt::CaseInsensitive))
-        extension = ".zip";
-    return extension;
+        return ".zip";
+    if (entry == nullptr)
+        return "";
+    return QString::fromLatin1(entry->extension);
 }
 
 QString MimeReference::getMimeFromExtension(QString fileExtension) {
-
-    QString retVal =  table->key(fileExtension.toLower());
-    if (retVal == "") {
+    const MimeEntry *entry = findExtension(fileExtension);
+    if (entry == nullptr) {
         return "application/data";
     }
-    return retVal;
+    return QString::fromLatin1(entry->mime);
 }
 
 
 QString MimeReference::getExtensionFromMime(string key, string mime) {
-    return this->getExtensionFromMime(QString::fromStdString(key), QString::fromStdString(mime));
+    return getExtensionFromMime(QString::fromStdString(key), QString::fromStdString(mime));
 }
 
 
 QString MimeReference::getMimeFromExtension(string fileExtension) {
-    return this->getMimeFromExtension(QString::fromStdString(fileExtension));
+    return getMimeFromExtension(QString::fromStdString(fileExtension));
 }
 
 
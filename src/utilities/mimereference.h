@@ -20,30 +20,22 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #ifndef MIMEREFERENCE_H
 #define MIMEREFERENCE_H
 
-#include <QObject>
-#include <QHash>
+#include <QString>
 #include <string>
 
 using namespace std;
 
-class MimeReference : public QObject
+// MIME type <-> file extension lookups.  The mapping is a static sorted
+// table, so the functions are cheap enough to call once per resource.
+class MimeReference
 {
-    Q_OBJECT
 public:
-    explicit MimeReference(QObject *parent = 0);
-    ~MimeReference();
-    QHash<QString,QString> *table;
-    QString getExtensionFromMime(QString mime, QString filename);
-    QString getMimeFromExtension(QString fileExtension);
-    QString getMimeFromExtension(string fileExtension);
-    QString getMimeFromFileName(QString fileName);
-    QString getMimeFromFileName(string filename);
-    QString getExtensionFromMime(string extension, string filename);
-    
-signals:
-    
-public slots:
-    
+    static QString getExtensionFromMime(QString mime, QString filename);
+    static QString getMimeFromExtension(QString fileExtension);
+    static QString getMimeFromExtension(string fileExtension);
+    static QString getMimeFromFileName(QString fileName);
+    static QString getMimeFromFileName(string filename);
+    static QString getExtensionFromMime(string extension, string filename);
 };
 
 #endif // MIMEREFERENCE_H
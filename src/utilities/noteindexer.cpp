@@ -24,6 +24,9 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #include "src/sql/notetable.h"
 #include "src/sql/nsqlquery.h"
 #include "src/sql/resourcetable.h"
+#include "src/sql/searchindextable.h"
+#include "src/utilities/extractedtextcache.h"
+#include "src/utilities/metrics.h"
 #include <QTextDocument>
 #include <QtXml>
 #if QT_VERSION < 0x050000
@@ -87,24 +90,14 @@ void NoteIndexer::indexNote(qint32 lid) {
 
 
 void NoteIndexer::addTextIndex(int lid, QString content) {
-    // Delete any old content
-    NSqlQuery sql(db);
-    sql.prepare("Delete from SearchIndex where lid=:lid and source=:source");
-    sql.bindValue(":lid", lid);
-    sql.bindValue(":source", "text");
-    sql.exec();
-
-    // Add the new content.  it is basically a text version of the note with a weight of 100.
-    sql.prepare("Insert into SearchIndex (lid, weight, source, content) values (:lid, :weight, :source, :content)");
-    sql.bindValue(":lid", lid);
-    sql.bindValue(":weight", 100);
-    sql.bindValue(":source", "text");
-
-    content = global.normalizeTermForSearchAndIndex(content);
-    sql.bindValue(":content", content);
-
-    sql.exec();
+    // The rows are only rewritten when the text changed.  It is basically a
+    // text version of the note with a weight of 100.
+    SearchIndexTable searchIndex(db);
+    QList<SearchIndexRow> rows;
+    rows.append(SearchIndexRow(100, global.normalizeTermForSearchAndIndex(content)));
+    searchIndex.replace(lid, "text", SearchIndexTable::contentHash(rows), rows);
 
+    NSqlQuery sql(db);
     sql.prepare("Delete from DataStore where lid=:lid and key=:key");
     sql.bindValue(":lid", lid);
     sql.bindValue(":key", NOTE_INDEX_NEEDED);
@@ -114,7 +107,13 @@ void NoteIndexer::addTextIndex(int lid, QString content) {
 
 
 
-void NoteIndexer::indexResource(qint32 lid) {
+// Each source of the resource is only rewritten when what it is indexed
+// from changed.  A PDF is keyed by the hash of its data, so it is only
+// read when the data changed, and its text is taken from the cache when
+// the same file was read before.
+bool NoteIndexer::indexResource(qint32 lid) {
+    static MetricHistogram *latency = Metrics::instance().histogram("index.resource");
+    MetricsTimer timer(latency);
     // Since this can be called from multiple threads, we need to know which DB connection we are using.
 
     QLOG_DEBUG() << "Fetching resource for index using " << db->getConnectionName();
@@ -123,72 +122,69 @@ void NoteIndexer::indexResource(qint32 lid) {
     resourceTable.get(r, lid, false);
 
     NSqlQuery sql(db);
-
-    // Delete the old index
-    QLOG_DEBUG() << "Deleting old resource from index";
-    sql.prepare("Delete from SearchIndex where lid=:lid");
-    sql.bindValue(":lid", lid);
-    sql.exec();
-
-    QLOG_DEBUG() << "Adding attributes to index.";
-    if (r.attributes.isSet()) {
-        ResourceAttributes a = r.attributes;
-        if (a.fileName.isSet()) {
-            sql.prepare("Insert into SearchIndex (lid, weight, source, content) values (:lid, :weight, :source, :content)");
-            sql.bindValue(":lid", lid);
-            sql.bindValue(":weight", 100);
-            sql.bindValue(":source", "recognition");
-            sql.bindValue(":content", QString(a.fileName));
-            sql.exec();
-        }
-        if (a.sourceURL.isSet()) {
-            sql.prepare("Insert into SearchIndex (lid, weight, source, content) values (:lid, :weight, :source, :content)");
-            sql.bindValue(":lid", lid);
-            sql.bindValue(":weight", 100);
-            sql.bindValue(":source", "recognition");
-            sql.bindValue(":content", QString(a.sourceURL));
-            sql.exec();
-        }
-    }
+    SearchIndexTable searchIndex(db);
 
     QLOG_TRACE() << "Indexing recognition";
-    indexRecognition(lid, r);
+    QList<SearchIndexRow> recognition = recognitionRows(r);
+
     QString mime = "";
     if (r.mime.isSet())
         mime = r.mime;
-    if (mime.toLower() == "application/pdf")
-        this->indexPdf(lid);
-//    else {
-//        if (mime.startsWith("application", Qt::CaseInsensitive))
-//            indexAttachment(noteLid, r);
-//   }
+    QString pdfHash = "";
+    bool pdfNeeded = false;
+    QList<SearchIndexRow> pdfRows;
+    QList<qint32> pageOffsets;
+    if (mime.toLower() == "application/pdf" && global.indexPDFLocally) {
+        QByteArray hash = bodyHash(r);
+        if (!hash.isEmpty())
+            pdfHash = SearchIndexTable::contentHash(hash);
+        pdfNeeded = pdfHash == "" || searchIndex.getHash(lid, "attachment") != pdfHash;
+        QStringList pages;
+        if (pdfNeeded) {
+            if (pdfPages(lid, hash, pages, cancelled))
+                pdfRows.append(SearchIndexRow(100, pdfText(pages, pageOffsets)));
+            else if (cancelled && cancelled())
+                return false;
+            else
+                pdfHash = "";
+        }
+    }
+
+    bool transaction = db->conn.transaction();
+    searchIndex.replace(lid, "recognition", SearchIndexTable::contentHash(recognition), recognition);
+    if (pdfNeeded) {
+        QLOG_TRACE() << "Adding PDF";
+        searchIndex.replace(lid, "attachment", pdfHash, pdfRows);
+        resourceTable.setPdfPages(lid, pageOffsets);
+    }
 
     QLOG_DEBUG() << "Resetting index needed.";
     sql.prepare("delete from DataStore where lid=:lid and key=:key");
     sql.bindValue(":lid", lid);
     sql.bindValue(":key", RESOURCE_INDEX_NEEDED);
     sql.exec();
+    if (transaction)
+        db->conn.commit();
+    return true;
 }
 
 
-// Index any resources
-void NoteIndexer::indexRecognition(qint32 reslid, Resource &r) {
-
-    QLOG_TRACE_IN();
-    if (!r.noteGuid.isSet() || !r.guid.isSet())
-        return;
-
-    if (reslid <= 0)
-        return;
-
-    NSqlQuery sql(db);
+QList<SearchIndexRow> NoteIndexer::recognitionRows(Resource &r) {
+    QList<SearchIndexRow> rows;
+    if (r.attributes.isSet()) {
+        ResourceAttributes a = r.attributes;
+        if (a.fileName.isSet())
+            rows.append(SearchIndexRow(100, global.normalizeTermForSearchAndIndex(QString(a.fileName))));
+        if (a.sourceURL.isSet())
+            rows.append(SearchIndexRow(100, global.normalizeTermForSearchAndIndex(QString(a.sourceURL))));
+    }
 
     // Make sure we have something to look through.
     Data recognition;
     if (r.recognition.isSet())
         recognition = r.recognition;
     if (!recognition.body.isSet())
-        return;
+        return rows;
 
     QDomDocument doc;
     QString emsg;
@@ -196,75 +192,75 @@ void NoteIndexer::indexRecognition(qint32 reslid, Resource &r) {
 
     // look for text tags
     QDomNodeList anchors = doc.documentElement().elementsByTagName("t");
-
-    QLOG_TRACE() << "Beginning insertion of recognition:";
     QLOG_TRACE() << "Anchors found: " << anchors.length();
-    sql.exec("begin;");
 #if QT_VERSION < 0x050000
     for (unsigned int i=0;  i<anchors.length(); i++) {
 #else
     for (int i=0; i<anchors.length(); i++) {
 #endif
-        QLOG_TRACE() << "Anchor: " << i;
-        QApplication::processEvents();
         QDomElement enmedia = anchors.at(i).toElement();
         QString weight = enmedia.attribute("w");
         QString text = enmedia.text();
-        if (text != "") {
-            // Add the new content.  it is basically a text version of the note with a weight of 100.
-            sql.prepare("Insert into SearchIndex (lid, weight, source, content) values (:lid, :weight, :source, :content)");
-            sql.bindValue(":lid", reslid);
-            sql.bindValue(":weight", weight);
-            sql.bindValue(":source", "recognition");
-
-
-            text = global.normalizeTermForSearchAndIndex(text);
-            sql.bindValue(":content", text);
-
-            sql.exec();
-        }
+        if (text != "")
+            rows.append(SearchIndexRow(weight.toInt(), global.normalizeTermForSearchAndIndex(text)));
     }
-    QLOG_TRACE() << "Committing";
-    sql.exec("commit");
-    QLOG_TRACE_OUT();
+    return rows;
 }
 
 
+QByteArray NoteIndexer::bodyHash(Resource &r) {
+    if (!r.data.isSet())
+        return QByteArray();
+    Data data = r.data;
+    if (!data.bodyHash.isSet())
+        return QByteArray();
+    return data.bodyHash;
+}
 
-// Index any PDFs that are attached.  Basically it turns the PDF into text and adds it the same
-// way as a note's body
-void NoteIndexer::indexPdf(qint32 reslid) {
-
-    QLOG_TRACE_IN();
-    if (!global.indexPDFLocally)
-        return;
 
-    NSqlQuery sql(db);
-    if (reslid <= 0)
-        return;
+bool NoteIndexer::pdfPages(qint32 reslid, const QByteArray &bodyHash, QStringList &pages,
+                           const std::function<bool()> &cancelled) {
+    static MetricCounter *cacheHits = Metrics::instance().counter("index.textCacheHits");
+    ExtractedTextCache cache(global.fileManager.getTextCacheDirPath(""));
+    if (cache.get(bodyHash, pages)) {
+        cacheHits->increment();
+        return true;
+    }
 
+    static MetricHistogram *latency = Metrics::instance().histogram("index.pdf");
+    MetricsTimer timer(latency);
     QString file = global.fileManager.getDbaDirPath() + QString::number(reslid) +".pdf";
-
-    QString text = "";
     Poppler::Document *doc = Poppler::Document::load(file);
-    if (doc == nullptr || doc->isEncrypted() || doc->isLocked())
-        return;
-
+    if (doc == nullptr || doc->isEncrypted() || doc->isLocked()) {
+        delete doc;
+        return false;
+    }
     for (int i=0; i<doc->numPages(); i++) {
+        if (cancelled && cancelled()) {
+            delete doc;
+            pages.clear();
+            return false;
+        }
+        Poppler::Page *page = doc->page(i);
         QRectF rect;
-        text = text + doc->page(i)->text(rect) + QString(" ");
+        pages.append(page != nullptr ? page->text(rect) : QString());
+        delete page;
     }
+    delete doc;
+    cache.put(bodyHash, pages);
+    return true;
+}
 
-    QLOG_TRACE() << "Adding PDF";
-    // Add the new content.  it is basically a text version of the note with a weight of 100.
-    sql.prepare("Insert into SearchIndex (lid, weight, source, content) values (:lid, :weight, :source, :content)");
-    sql.bindValue(":lid", reslid);
-    sql.bindValue(":weight", 100);
-    sql.bindValue(":source", "recognition");
-
-    text = global.normalizeTermForSearchAndIndex(text);
-    sql.bindValue(":content", text);
 
-    sql.exec();
-    QLOG_TRACE_OUT();
+// Pages are normalized one at a time so the offsets are those of the
+// normalized text, which can be longer or shorter than the original.
+QString NoteIndexer::pdfText(const QStringList &pages, QList<qint32> &pageOffsets) {
+    QString text;
+    pageOffsets.clear();
+    for (int i=0; i<pages.size(); i++) {
+        pageOffsets.append(text.length());
+        text += global.normalizeTermForSearchAndIndex(pages[i]);
+        text += QString(" ");
+    }
+    return text;
 }
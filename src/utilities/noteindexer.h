@@ -23,7 +23,9 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 
 
 #include <QString>
+#include <functional>
 #include "src/sql/databaseconnection.h"
+#include "src/sql/searchindextable.h"
 
 #include <iostream>
 #include <string>
@@ -45,9 +47,28 @@ public:
     NoteIndexer(DatabaseConnection *db);
     void indexNote(qint32 lid);
     void addTextIndex(qint32 lid, QString content);
-    void indexResource(qint32 lid);
-    void indexRecognition(qint32 reslid, Resource &r);
-    void indexPdf(qint32 reslid);
+
+    // False when it was stopped by the cancel check before it was done.  The
+    // resource is then left to be indexed again.
+    bool indexResource(qint32 lid);
+
+    // Checked between the pages of a PDF, which can take a long time to read
+    std::function<bool()> cancelled;
+
+    // Rows of the "recognition" source of a resource: its file name,
+    // source URL & the words recognized in it
+    static QList<SearchIndexRow> recognitionRows(Resource &r);
+
+    // Hash of a resource's data, empty when it isn't known
+    static QByteArray bodyHash(Resource &r);
+
+    // Text of each page of a PDF resource, from the extracted text cache
+    // when possible.  False when the PDF can't be read or it was cancelled.
+    static bool pdfPages(qint32 reslid, const QByteArray &bodyHash, QStringList &pages,
+                         const std::function<bool()> &cancelled = std::function<bool()>());
+
+    // Text of a PDF as it is indexed, with the offset each page starts at
+    static QString pdfText(const QStringList &pages, QList<qint32> &pageOffsets);
 };
 
 #endif // NOTEINDEXER_H
@@ -163,8 +163,7 @@ void FileWatcher::saveFile(QString filename) {
     if (newNote.content.isSet())
         newNoteBody.append(newNote.content);
 
-    MimeReference mimeRef;
-    QString mime = mimeRef.getMimeFromFileName(filename);
+    QString mime = MimeReference::getMimeFromFileName(filename);
     QString enMedia =QString("<en-media hash=\"") +hash.toHex() +QString("\" border=\"0\"")
             +QString(" type=\"" +mime +"\" ")
             +QString("/>");
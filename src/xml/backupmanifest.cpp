@@ -0,0 +1,384 @@
+/*********************************************************************************
+NixNote - An open-source client for the Evernote service.
+Copyright (C) 2013 Randy Baumgarte
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+***********************************************************************************/
+
+#include "backupmanifest.h"
+#include "src/global.h"
+#include "src/sql/notetable.h"
+#include "src/sql/resourcetable.h"
+#include "src/sql/notebooktable.h"
+#include "src/sql/tagtable.h"
+#include "src/sql/nsqlquery.h"
+#include "src/utilities/gzipdevice.h"
+
+#include <QFile>
+#include <QFileInfo>
+#include <QDir>
+#include <QSaveFile>
+#include <QDateTime>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QXmlStreamReader>
+
+extern Global global;
+
+// Problems listed by verifyChain() before it only counts them
+#define MANIFEST_MAX_PROBLEMS 50
+
+
+bool ManifestEntry::sameContent(const ManifestEntry &other) const {
+    return updated == other.updated && contentHash == other.contentHash
+            && resourceHashes == other.resourceHashes
+            && notebookGuid == other.notebookGuid && tagGuids == other.tagGuids
+            && active == other.active && deleted == other.deleted;
+}
+
+
+
+
+BackupManifest::BackupManifest() {
+    created = QDateTime::currentMSecsSinceEpoch();
+}
+
+
+// Read the current state of every note
+void BackupManifest::loadFromDatabase(DatabaseConnection *db) {
+    notes.clear();
+    QHash<qint32, QString> guids;
+    QHash<qint32, ManifestEntry> entries;
+    QHash<qint32, qint32> notebookLids;
+    QMultiHash<qint32, qint32> tagLids;
+    QHash<qint32, QString> notebookGuids;
+    QHash<qint32, QString> tagGuids;
+
+    NSqlQuery query(db);
+    db->lockForRead();
+    query.prepare("Select lid, key, data from DataStore where key=:guid or key=:updated or key=:hash "
+                  "or key=:notebook or key=:tag or key=:active or key=:deleted");
+    query.bindValue(":guid", NOTE_GUID);
+    query.bindValue(":updated", NOTE_UPDATED_DATE);
+    query.bindValue(":hash", NOTE_CONTENT_HASH);
+    query.bindValue(":notebook", NOTE_NOTEBOOK_LID);
+    query.bindValue(":tag", NOTE_TAG_LID);
+    query.bindValue(":active", NOTE_ACTIVE);
+    query.bindValue(":deleted", NOTE_DELETED_DATE);
+    query.exec();
+    while (query.next()) {
+        qint32 lid = query.value(0).toInt();
+        ManifestEntry &entry = entries[lid];
+        entry.lid = lid;
+        switch (query.value(1).toInt()) {
+        case NOTE_GUID:
+            guids.insert(lid, query.value(2).toString());
+            break;
+        case NOTE_UPDATED_DATE:
+            entry.updated = query.value(2).toLongLong();
+            break;
+        case NOTE_CONTENT_HASH:
+            entry.contentHash = query.value(2).toByteArray().toHex();
+            break;
+        case NOTE_NOTEBOOK_LID:
+            notebookLids.insert(lid, query.value(2).toInt());
+            break;
+        case NOTE_TAG_LID:
+            tagLids.insert(lid, query.value(2).toInt());
+            break;
+        case NOTE_ACTIVE:
+            entry.active = query.value(2).toBool();
+            break;
+        case NOTE_DELETED_DATE:
+            entry.deleted = query.value(2).toLongLong();
+            break;
+        }
+    }
+
+    // Backups name notebooks & tags by guid
+    query.prepare("Select lid, key, data from DataStore where key=:notebook or key=:tag");
+    query.bindValue(":notebook", NOTEBOOK_GUID);
+    query.bindValue(":tag", TAG_GUID);
+    query.exec();
+    while (query.next()) {
+        if (query.value(1).toInt() == NOTEBOOK_GUID)
+            notebookGuids.insert(query.value(0).toInt(), query.value(2).toString());
+        else
+            tagGuids.insert(query.value(0).toInt(), query.value(2).toString());
+    }
+
+    // Resource hashes are stored as hex already
+    query.prepare("Select a.data, b.data from DataStore a, DataStore b where a.key=:noteLid and b.lid=a.lid and b.key=:hash");
+    query.bindValue(":noteLid", RESOURCE_NOTE_LID);
+    query.bindValue(":hash", RESOURCE_DATA_HASH);
+    query.exec();
+    while (query.next()) {
+        qint32 lid = query.value(0).toInt();
+        if (entries.contains(lid))
+            entries[lid].resourceHashes.append(query.value(1).toByteArray().toLower());
+    }
+    query.finish();
+    db->unlock();
+
+    for (auto i = guids.constBegin(); i != guids.constEnd(); ++i) {
+        ManifestEntry entry = entries.value(i.key());
+        qSort(entry.resourceHashes);
+        entry.notebookGuid = notebookGuids.value(notebookLids.value(i.key()));
+        QList<qint32> tags = tagLids.values(i.key());
+        for (int j=0; j<tags.size(); j++)
+            entry.tagGuids.append(tagGuids.value(tags[j]));
+        entry.tagGuids.sort();
+        notes.insert(i.value(), entry);
+    }
+}
+
+
+bool BackupManifest::read(const QString &manifestFile) {
+    QFile file(manifestFile);
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+    QJsonDocument doc = QJsonDocument::fromJson(file.readAll());
+    file.close();
+    if (!doc.isObject())
+        return false;
+
+    QJsonObject root = doc.object();
+    backupFile = root["backup"].toString();
+    baseFile = root["base"].toString();
+    created = static_cast<qlonglong>(root["created"].toDouble());
+    notes.clear();
+    QJsonObject n = root["notes"].toObject();
+    for (auto i = n.constBegin(); i != n.constEnd(); ++i) {
+        QJsonArray values = i.value().toArray();
+        ManifestEntry entry;
+        entry.lid = values.at(0).toInt();
+        entry.updated = static_cast<qlonglong>(values.at(1).toDouble());
+        entry.contentHash = values.at(2).toString().toLatin1();
+        QJsonArray resources = values.at(3).toArray();
+        for (int j=0; j<resources.size(); j++)
+            entry.resourceHashes.append(resources.at(j).toString().toLatin1());
+        entry.notebookGuid = values.at(4).toString();
+        QJsonArray tags = values.at(5).toArray();
+        for (int j=0; j<tags.size(); j++)
+            entry.tagGuids.append(tags.at(j).toString());
+        entry.active = values.at(6).toBool(true);
+        entry.deleted = static_cast<qlonglong>(values.at(7).toDouble());
+        notes.insert(i.key(), entry);
+    }
+    return true;
+}
+
+
+// Notes are stored as guid: [lid, updated, contentHash, [resourceHashes],
+// notebookGuid, [tagGuids], active, deleted] to keep the file small on
+// large accounts.  Manifests written before the notebook, tags & state were
+// recorded have only the first four, so every note of such a manifest is
+// backed up once more.
+bool BackupManifest::write(const QString &manifestFile) const {
+    QJsonObject n;
+    for (auto i = notes.constBegin(); i != notes.constEnd(); ++i) {
+        QJsonArray resources;
+        for (int j=0; j<i.value().resourceHashes.size(); j++)
+            resources.append(QString::fromLatin1(i.value().resourceHashes[j]));
+        QJsonArray values;
+        values.append(i.value().lid);
+        values.append(static_cast<double>(i.value().updated));
+        values.append(QString::fromLatin1(i.value().contentHash));
+        values.append(resources);
+        values.append(i.value().notebookGuid);
+        values.append(QJsonArray::fromStringList(i.value().tagGuids));
+        values.append(i.value().active);
+        values.append(static_cast<double>(i.value().deleted));
+        n[i.key()] = values;
+    }
+    QJsonObject root;
+    root["backup"] = backupFile;
+    root["base"] = baseFile;
+    root["created"] = static_cast<double>(created);
+    root["notes"] = n;
+
+    QSaveFile file(manifestFile);
+    if (!file.open(QIODevice::WriteOnly))
+        return false;
+    file.write(QJsonDocument(root).toJson(QJsonDocument::Compact));
+    return file.commit();
+}
+
+
+void BackupManifest::changedSince(const BackupManifest &previous, QList<qint32> &changed, QStringList &removed) const {
+    changed.clear();
+    removed.clear();
+    for (auto i = notes.constBegin(); i != notes.constEnd(); ++i) {
+        auto old = previous.notes.constFind(i.key());
+        if (old == previous.notes.constEnd() || !old.value().sameContent(i.value()))
+            changed.append(i.value().lid);
+    }
+    for (auto i = previous.notes.constBegin(); i != previous.notes.constEnd(); ++i) {
+        if (!notes.contains(i.key()))
+            removed.append(i.key());
+    }
+}
+
+
+QString BackupManifest::manifestFile(const QString &backupFile) {
+    return backupFile + ".manifest";
+}
+
+
+// Follow the base of each manifest back to the full backup.  A chain that
+// was moved to another directory is still found next to the later files.
+QStringList BackupManifest::chain(const QString &lastBackup) {
+    QStringList files;
+    QString current = lastBackup;
+    while (current != "" && !files.contains(current)) {
+        files.prepend(current);
+        BackupManifest manifest;
+        if (!manifest.read(manifestFile(current)))
+            break;
+        QString base = manifest.baseFile;
+        if (base != "" && !QFile::exists(base))
+            base = QFileInfo(current).absoluteDir().filePath(QFileInfo(base).fileName());
+        current = base;
+    }
+    return files;
+}
+
+
+// Collect the state of the notes in one backup file.  Notes are replaced
+// by newer versions and removed by the tombstones of incremental backups.
+bool BackupManifest::readBackupNotes(const QString &backupFile, QHash<QString, ManifestEntry> &notes, QStringList &problems) {
+    QFile plainFile(backupFile);
+    GzipDevice compressedFile(backupFile);
+    QIODevice &file = GzipDevice::isGzipFile(backupFile) ?
+                static_cast<QIODevice&>(compressedFile) : static_cast<QIODevice&>(plainFile);
+    if (!file.open(QIODevice::ReadOnly)) {
+        problems.append(QObject::tr("Cannot open %1").arg(backupFile));
+        return false;
+    }
+
+    QXmlStreamReader reader(&file);
+    QStringList path;
+    ManifestEntry entry;
+    QString guid;
+    while (!reader.atEnd()) {
+        reader.readNext();
+        if (reader.isStartElement()) {
+            QString name = reader.name().toString();
+            int depth = path.size();
+            if (depth == 2 && path[1] == "Note") {
+                if (name == "Guid") {
+                    guid = reader.readElementText();
+                    continue;
+                }
+                if (name == "Updated") {
+                    entry.updated = reader.readElementText().toLongLong();
+                    continue;
+                }
+                if (name == "ContentHash") {
+                    entry.contentHash = reader.readElementText().toLatin1().toLower();
+                    continue;
+                }
+                if (name == "NotebookGuid") {
+                    entry.notebookGuid = reader.readElementText();
+                    continue;
+                }
+                if (name == "Active") {
+                    entry.active = reader.readElementText() == "true";
+                    continue;
+                }
+                if (name == "Deleted") {
+                    entry.deleted = reader.readElementText().toLongLong();
+                    continue;
+                }
+            }
+            if (depth == 3 && path[1] == "Note" && path[2] == "Tag" && name == "Guid") {
+                entry.tagGuids.append(reader.readElementText());
+                continue;
+            }
+            if (depth == 4 && path[1] == "Note" && path[2] == "NoteResource" && path[3] == "Data" && name == "BodyHash") {
+                entry.resourceHashes.append(reader.readElementText().toLatin1().toLower());
+                continue;
+            }
+            if (depth == 2 && path[1] == "Tombstones" && name == "Note") {
+                notes.remove(reader.readElementText());
+                continue;
+            }
+            if (depth == 1 && name == "Note") {
+                entry = ManifestEntry();
+                guid.clear();
+            }
+            path.append(name);
+        } else if (reader.isEndElement()) {
+            if (path.size() == 2 && path[1] == "Note" && guid != "") {
+                qSort(entry.resourceHashes);
+                entry.tagGuids.sort();
+                notes.insert(guid, entry);
+            }
+            if (!path.isEmpty())
+                path.removeLast();
+        }
+    }
+    if (reader.hasError()) {
+        problems.append(QObject::tr("%1: %2").arg(backupFile).arg(reader.errorString()));
+        return false;
+    }
+    return true;
+}
+
+
+bool BackupManifest::verifyChain(const QString &lastBackup, DatabaseConnection *db, QStringList &problems) {
+    QStringList files = chain(lastBackup);
+    BackupManifest first;
+    if (!first.read(manifestFile(files[0])))
+        problems.append(QObject::tr("No manifest for %1").arg(files[0]));
+    else if (first.baseFile != "")
+        problems.append(QObject::tr("Chain is incomplete, %1 is missing").arg(first.baseFile));
+
+    QHash<QString, ManifestEntry> backupNotes;
+    for (int i=0; i<files.size(); i++) {
+        QLOG_INFO() << "Verifying " << files[i];
+        readBackupNotes(files[i], backupNotes, problems);
+    }
+
+    BackupManifest live;
+    live.loadFromDatabase(db);
+    qint32 missing = 0, extra = 0, different = 0;
+    for (auto i = live.notes.constBegin(); i != live.notes.constEnd(); ++i) {
+        auto b = backupNotes.constFind(i.key());
+        QString problem;
+        if (b == backupNotes.constEnd()) {
+            missing++;
+            problem = QObject::tr("Note %1 (lid %2) is not in the backup").arg(i.key()).arg(i.value().lid);
+        } else if (!b.value().sameContent(i.value())) {
+            different++;
+            problem = QObject::tr("Note %1 (lid %2) differs from the backup").arg(i.key()).arg(i.value().lid);
+        }
+        if (problem != "" && problems.size() < MANIFEST_MAX_PROBLEMS)
+            problems.append(problem);
+    }
+    for (auto i = backupNotes.constBegin(); i != backupNotes.constEnd(); ++i) {
+        if (!live.notes.contains(i.key())) {
+            extra++;
+            if (problems.size() < MANIFEST_MAX_PROBLEMS)
+                problems.append(QObject::tr("Note %1 is in the backup but not in the database").arg(i.key()));
+        }
+    }
+    if (missing + extra + different > 0)
+        problems.append(QObject::tr("%1 notes missing, %2 changed, %3 deleted since the backup")
+                        .arg(missing).arg(different).arg(extra));
+    QLOG_INFO() << "Verified " << files.size() << " backups, " << backupNotes.size() << " notes";
+    return problems.isEmpty();
+}
@@ -0,0 +1,88 @@
+/*********************************************************************************
+NixNote - An open-source client for the Evernote service.
+Copyright (C) 2013 Randy Baumgarte
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+***********************************************************************************/
+
+
+//****************************************************
+//*  Manifest written next to every backup.  It holds
+//*  the state of every note at the time of the backup
+//*  so the next incremental backup only has to write
+//*  what changed since.  Incremental backups point to
+//*  the backup they are based on, which makes a chain
+//*  that is restored oldest first.
+//*****************************************************
+
+#ifndef BACKUPMANIFEST_H
+#define BACKUPMANIFEST_H
+
+#include <QString>
+#include <QStringList>
+#include <QHash>
+#include <QList>
+#include <QByteArray>
+
+#include "src/sql/databaseconnection.h"
+
+
+// State of one note.  Hashes are hex, the way they are written in a backup.
+class ManifestEntry
+{
+public:
+    ManifestEntry() : lid(0), updated(0), active(true), deleted(0) {}
+    qint32 lid;
+    qlonglong updated;
+    QByteArray contentHash;
+    QList<QByteArray> resourceHashes;       // sorted
+    QString notebookGuid;
+    QStringList tagGuids;                   // sorted
+    bool active;
+    qlonglong deleted;
+
+    bool sameContent(const ManifestEntry &other) const;
+};
+
+
+class BackupManifest
+{
+public:
+    BackupManifest();
+
+    QString backupFile;         // backup described by this manifest
+    QString baseFile;           // backup this one is based on, empty for a full backup
+    qlonglong created;
+    QHash<QString, ManifestEntry> notes;    // by note guid
+
+    void loadFromDatabase(DatabaseConnection *db);
+    bool read(const QString &manifestFile);
+    bool write(const QString &manifestFile) const;
+
+    // Lids of the notes which are new or changed since the previous manifest,
+    // and guids of the notes which no longer exist.
+    void changedSince(const BackupManifest &previous, QList<qint32> &changed, QStringList &removed) const;
+
+    static QString manifestFile(const QString &backupFile);
+    static QStringList chain(const QString &lastBackup);        // oldest (full) backup first
+
+    // Fold the backups of a chain and compare the result with the DB
+    static bool verifyChain(const QString &lastBackup, DatabaseConnection *db, QStringList &problems);
+
+private:
+    static bool readBackupNotes(const QString &backupFile, QHash<QString, ManifestEntry> &notes, QStringList &problems);
+};
+
+#endif // BACKUPMANIFEST_H
@@ -240,12 +240,11 @@ qint32 BatchImport::addNoteNode() {
                         file.open(QIODevice::ReadOnly);
                         QByteArray ba = file.readAll();
                         file.close();
-                        MimeReference mimeRef;
                         QString extension = filename;
                         int endPos = filename.lastIndexOf(".");
                         if (endPos != -1)
                             extension = extension.mid(endPos);
-                        QString mime =  mimeRef.getMimeFromExtension(extension);
+                        QString mime =  MimeReference::getMimeFromExtension(extension);
                         Resource newRes;
                         bool attachment = true;
                         if (mime == "application/pdf" || mime.startsWith("image/"))
@@ -297,12 +296,11 @@ qint32 BatchImport::addNoteNode() {
                         file.open(QIODevice::ReadOnly);
                         QByteArray ba = file.readAll();
                         file.close();
-                        MimeReference mimeRef;
                         QString extension = filename;
                         int endPos = filename.lastIndexOf(".");
                         if (endPos != -1)
                             extension = extension.mid(endPos);
-                        QString mime =  mimeRef.getMimeFromExtension(extension);
+                        QString mime =  MimeReference::getMimeFromExtension(extension);
                         Resource newRes;
                         bool attachment = true;
                         if (mime == "application/pdf" || mime.startsWith("image/"))
@@ -28,11 +28,66 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #include "src/sql/sharednotebooktable.h"
 #include "src/sql/notebooktable.h"
 #include "src/sql/searchtable.h"
+#include "src/sql/resourcetable.h"
+#include "src/utilities/gzipdevice.h"
+#include "src/xml/backupmanifest.h"
 
 #include <QProgressDialog>
+#include <QElapsedTimer>
+#include <QFileInfo>
 
 extern Global global;
 
+// Notes loaded ahead of the writer thread
+#define EXPORT_QUEUE_SIZE 32
+
+// Chunk of a resource file encoded at a time
+#define EXPORT_BUFFER_SIZE (64*1024)
+
+
+
+ExportWriter::ExportWriter(ExportData *exporter) {
+    this->exporter = exporter;
+    finished = false;
+}
+
+
+bool ExportWriter::push(const ExportItem &item, unsigned long timeout) {
+    QMutexLocker locker(&mutex);
+    if (queue.size() >= EXPORT_QUEUE_SIZE && !notFull.wait(&mutex, timeout))
+        return false;
+    if (queue.size() >= EXPORT_QUEUE_SIZE)
+        return false;
+    queue.enqueue(item);
+    notEmpty.wakeOne();
+    return true;
+}
+
+
+void ExportWriter::finish() {
+    QMutexLocker locker(&mutex);
+    finished = true;
+    notEmpty.wakeOne();
+}
+
+
+void ExportWriter::run() {
+    forever {
+        ExportItem item;
+        {
+            QMutexLocker locker(&mutex);
+            while (queue.isEmpty() && !finished)
+                notEmpty.wait(&mutex);
+            if (queue.isEmpty())
+                return;
+            item = queue.dequeue();
+            notFull.wakeOne();
+        }
+        exporter->writeNote(item);
+    }
+}
+
+
 
 ExportData::ExportData(bool backup, bool cmdLine, QObject *parent) :
     QObject(parent)
@@ -46,9 +101,25 @@ ExportData::ExportData(bool backup, bool cmdLine, QObject *parent) :
 
 
 
+//*******************************************************************
+// Make the next backup incremental: only the notes changed since
+// the given backup (found through its manifest) are written, plus
+// tombstones for the notes expunged since.
+//*******************************************************************
+void ExportData::setIncrementalBase(QString baseFile) {
+    this->baseFile = baseFile;
+}
+
+
+
 void ExportData::backupData(QString filename) {
     quitNow = false;
-    QFile xmlFile(filename);
+
+    // A name ending in .gz gets a compressed file
+    QFile plainFile(filename);
+    GzipDevice compressedFile(filename);
+    QIODevice &xmlFile = GzipDevice::isGzipFile(filename) ?
+                static_cast<QIODevice&>(compressedFile) : static_cast<QIODevice&>(plainFile);
     if (!xmlFile.open(QIODevice::WriteOnly)) {
         lastError = 16;
         errorMessage = tr("Cannot open file.");
@@ -68,15 +139,40 @@ void ExportData::backupData(QString filename) {
     writer->writeDTD("<!DOCTYPE NixNote-Export>");
     writer->writeStartElement("nixnote-export");
     writer->writeAttribute("version", "2");
-    if (backup)
+
+    // State of the notes for this backup's manifest.  When there is a
+    // usable base only what changed since is written.
+    BackupManifest manifest;
+    QStringList tombstones;
+    bool incremental = false;
+    if (backup) {
+        manifest.loadFromDatabase(global.db);
+        manifest.backupFile = QFileInfo(filename).absoluteFilePath();
+        BackupManifest previous;
+        if (baseFile != "" && previous.read(BackupManifest::manifestFile(baseFile))) {
+            incremental = true;
+            manifest.baseFile = QFileInfo(baseFile).absoluteFilePath();
+            manifest.changedSince(previous, this->lids, tombstones);
+            QLOG_INFO() << "Incremental backup based on " << baseFile << ": " << this->lids.size()
+                        << " changed notes, " << tombstones.size() << " expunged";
+        } else if (baseFile != "") {
+            QLOG_WARN() << "No manifest for " << baseFile << ", doing a full backup";
+        }
+    }
+
+    if (incremental)
+        writer->writeAttribute("exportType", "incremental");
+    else if (backup)
         writer->writeAttribute("exportType", "backup");
     else
         writer->writeAttribute("exportType", "export");
     writer->writeAttribute("application", APP_NNEX_APP_NAME);
     writer->writeAttribute("applicationVersion", "2.x");
     if (backup) {
-        NoteTable noteTable(global.db);
-        noteTable.getAll(this->lids);
+        if (!incremental) {
+            NoteTable noteTable(global.db);
+            noteTable.getAll(this->lids);
+        }
         if (!cmdLine)
             progress->setWindowTitle(tr("Backup"));
         writer->writeStartElement("Synchronization");
@@ -94,11 +190,41 @@ void ExportData::backupData(QString filename) {
         writeSharedNotebooks();
     }
     writeNotes();
+    if (incremental)
+        writeTombstones(tombstones);
     writer->writeEndElement();
     writer->writeEndDocument();
     if (!cmdLine)
         progress->hide();
+    if (writer->hasError() && lastError == 0) {
+        lastError = 16;
+        errorMessage = tr("Error writing file.");
+    }
+    delete writer;
+    writer = nullptr;
     xmlFile.close();
+
+    // The manifest is what the next incremental backup is based on, so
+    // it is only written for a complete backup.
+    if (backup && lastError == 0 && !quitNow) {
+        if (!manifest.write(BackupManifest::manifestFile(filename))) {
+            QLOG_ERROR() << "Unable to write backup manifest for " << filename;
+        } else {
+            global.settings->beginGroup(INI_GROUP_BACKUP);
+            global.settings->setValue("lastBackup", manifest.backupFile);
+            global.settings->endGroup();
+        }
+    }
+}
+
+
+
+// Guids of the notes expunged since the base backup
+void ExportData::writeTombstones(const QStringList &guids) {
+    writer->writeStartElement("Tombstones");
+    for (int i=0; i<guids.size(); i++)
+        createNode("Note", guids[i]);
+    writer->writeEndElement();
 }
 
 
@@ -339,10 +465,12 @@ void ExportData::writeUser(User user) {
 }
 
 
-void ExportData::writeData(QString name, Data data) {
+void ExportData::writeData(QString name, Data data, QString bodyFile) {
     writer->writeStartElement(name);
     if (data.body.isSet())
         createNode("Body", data.body.value());
+    else if (bodyFile != "")
+        writeBody(bodyFile);
     if (data.bodyHash.isSet()) {
         createNode("BodyHash", data.bodyHash);
         QByteArray ba;
@@ -353,6 +481,24 @@ void ExportData::writeData(QString name, Data data) {
     writer->writeEndElement();
 }
 
+
+// Copy a resource body from its file to the output as hex, a buffer at a
+// time, so large attachments are never held in memory.
+void ExportData::writeBody(const QString &fileName) {
+    writer->writeStartElement("Body");
+    QFile file(fileName);
+    if (file.open(QIODevice::ReadOnly)) {
+        QByteArray buffer;
+        while (!(buffer = file.read(EXPORT_BUFFER_SIZE)).isEmpty())
+            writer->writeCharacters(QString::fromLatin1(buffer.toHex()));
+        file.close();
+    } else {
+        QLOG_ERROR() << "Unable to read resource file " << fileName;
+    }
+    writer->writeEndElement();
+}
+
+
 void ExportData::writeSavedSearches() {
     QList<qint32> lids;
     SearchTable table(global.db);
@@ -507,8 +653,10 @@ void ExportData::writeSharedNotebooks() {
 
 void ExportData::writeNotes() {
     NoteTable table(global.db);
+    ResourceTable resTable(global.db);
     QList<qint32> dirtyLids;
     table.getAllDirty(dirtyLids);
+    QSet<qint32> dirty = dirtyLids.toSet();
     if (!cmdLine) {
         progress->setMaximum(lids.size());
         progress->setLabelText(tr("Notes"));
@@ -516,105 +664,137 @@ void ExportData::writeNotes() {
     }
     QCoreApplication::processEvents();
 
+    // Notes are loaded here (the DB connection belongs to this thread)
+    // and serialized by the writer thread.
+    ExportWriter exportWriter(this);
+    exportWriter.start();
+    QElapsedTimer clock;
+    clock.start();
     for (int i=0; i<lids.size() && !quitNow; i++) {
+        ExportItem item;
+        table.get(item.note, lids[i], false, false);
+        QList<qint32> resLids;
+        resTable.getResourceList(resLids, lids[i]);
+        qSort(resLids);
+        QList<Resource> resources;
+        for (int j=0; j<resLids.size(); j++) {
+            Resource r;
+            resTable.get(r, resLids[j], false);
+            item.bodyFiles.append(resTable.getDataFilePath(resLids[j], r));
+            resources.append(r);
+        }
+        item.note.resources = resources;
+        item.dirty = dirty.contains(lids[i]);
+
+        while (!exportWriter.push(item, 100))
+            QCoreApplication::processEvents();
         if (!cmdLine)
             progress->setValue(i+1);
-        QCoreApplication::processEvents();
-        Note n;
-        table.get(n,lids[i], true,true);
-        writer->writeStartElement("Note");
-        if (n.guid.isSet())
-            createNode("Guid", n.guid);
-        if (n.title.isSet())
-            createNode("Title", n.title);
-        if (n.content.isSet()) {
-            writer->writeStartElement("Content");
-            writer->writeCDATA(n.content);
+        else if (i % 100 == 0)
+            QCoreApplication::processEvents();
+    }
+    exportWriter.finish();
+    exportWriter.wait();
+    QLOG_INFO() << "Exported " << lids.size() << " notes in " << clock.elapsed() << " ms";
+}
+
+
+
+// Serialize one note.  Runs on the writer thread.
+void ExportData::writeNote(const ExportItem &item) {
+    const Note &n = item.note;
+    writer->writeStartElement("Note");
+    if (n.guid.isSet())
+        createNode("Guid", n.guid);
+    if (n.title.isSet())
+        createNode("Title", n.title);
+    if (n.content.isSet()) {
+        writer->writeStartElement("Content");
+        writer->writeCDATA(n.content);
+        writer->writeEndElement();
+    }
+    if (n.contentHash.isSet())
+        createNode("ContentHash", n.contentHash);
+    if (n.contentLength.isSet())
+        createNode("ContentLength", n.contentLength);
+    if (n.created.isSet())
+        createTimestampNode("Created", n.created);
+    if (n.updated.isSet())
+        createTimestampNode("Updated", n.updated);
+    if (n.deleted.isSet())
+        createTimestampNode("Deleted", n.deleted);
+    if (n.active.isSet())
+        createNode("Active", n.active);
+    if (n.updateSequenceNum.isSet())
+        createNode("UpdateSequenceNumber", n.updateSequenceNum);
+    if (n.notebookGuid.isSet())
+        createNode("NotebookGuid", n.notebookGuid);
+    if (n.tagGuids.isSet() && n.tagNames.isSet() && n.tagNames.value().size() == n.tagGuids.value().size()) {
+        for (int j=0; j<n.tagGuids.value().size(); j++) {
+            writer->writeStartElement("Tag");
+            createNode("Guid", n.tagGuids.value()[j]);
+            createNode("Name", n.tagNames.value()[j]);
             writer->writeEndElement();
         }
-        if (n.contentHash.isSet())
-            createNode("ContentHash", n.contentHash);
-        if (n.contentLength.isSet())
-            createNode("ContentLength", n.contentLength);
-        if (n.created.isSet())
-            createTimestampNode("Created", n.created);
-        if (n.updated.isSet())
-            createTimestampNode("Updated", n.updated);
-        if (n.deleted.isSet())
-            createTimestampNode("Deleted", n.deleted);
-        if (n.active.isSet())
-            createNode("Active", n.active);
-        if (n.updateSequenceNum.isSet())
-            createNode("UpdateSequenceNumber", n.updateSequenceNum);
-        if (n.notebookGuid.isSet())
-            createNode("NotebookGuid", n.notebookGuid);
-        if (n.tagGuids.isSet() && n.tagNames.isSet() && n.tagNames.value().size() == n.tagGuids.value().size()) {
-            for (int j=0; j<n.tagGuids.value().size(); j++) {
-                writer->writeStartElement("Tag");
-                createNode("Guid", n.tagGuids.value()[j]);
-                createNode("Name", n.tagNames.value()[j]);
-                writer->writeEndElement();
-            }
 
+    }
+    if (n.resources.isSet()) {
+        for (int j=0; j<n.resources.value().size(); j++) {
+            writeResource(n.resources.value()[j], item.bodyFiles.value(j));
         }
-        if (n.resources.isSet()) {
-            for (int j=0; j<n.resources.value().size(); j++) {
-                writeResource(n.resources.value()[j]);
-            }
-        }
-        if (n.attributes.isSet()) {
-            writer->writeStartElement("Attributes");
-            if (n.attributes.value().subjectDate.isSet())
-                createTimestampNode("SubjectDate", n.attributes.value().subjectDate);
-            if (n.attributes.value().latitude.isSet())
-                createNode("Latitude", n.attributes.value().latitude);
-            if (n.attributes.value().longitude.isSet())
-                createNode("Longitude",n.attributes.value().longitude);
-            if (n.attributes.value().altitude.isSet())
-                createNode("Altitude", n.attributes.value().altitude);
-            if (n.attributes.value().author.isSet())
-                createNode("Author", n.attributes.value().author);
-            if (n.attributes.value().source.isSet())
-                createNode("Source", n.attributes.value().source);
-            if (n.attributes.value().sourceApplication.isSet())
-                createNode("SourceApplication", n.attributes.value().sourceApplication);
-            if (n.attributes.value().sourceURL.isSet())
-                createNode("SourceUrl", n.attributes.value().sourceURL);
-            if (n.attributes.value().shareDate.isSet())
-                createTimestampNode("ShareDate", n.attributes.value().shareDate);
-            if (n.attributes.value().reminderOrder.isSet())
-                createNode("ReminderOrder",QString::number(n.attributes.value().reminderOrder));
-            if (n.attributes.value().reminderDoneTime.isSet())
-                createNode("ReminderDoneTime", QString::number(n.attributes.value().reminderDoneTime));
-            if (n.attributes.value().reminderTime.isSet())
-                createNode("ReminderTime", QString::number(n.attributes.value().reminderTime));
-            if (n.attributes.value().placeName.isSet())
-                createNode("PlaceName", n.attributes.value().placeName);
-            if (n.attributes.value().contentClass.isSet())
-                createNode("ContentClass",n.attributes.value().contentClass);
-            if (n.attributes.value().lastEditedBy.isSet())
-                createNode("LastEditedBy", n.attributes.value().lastEditedBy);
-            if (n.attributes.value().creatorId.isSet())
-                createNode("CreatorId", n.attributes.value().creatorId);
-            if (n.attributes.value().lastEditorId.isSet())
-                createNode("LastEditorId", n.attributes.value().lastEditorId);
-            writer->writeEndElement();
-        }
-        createNode("Dirty", dirtyLids.contains(lids[i]));
+    }
+    if (n.attributes.isSet()) {
+        writer->writeStartElement("Attributes");
+        if (n.attributes.value().subjectDate.isSet())
+            createTimestampNode("SubjectDate", n.attributes.value().subjectDate);
+        if (n.attributes.value().latitude.isSet())
+            createNode("Latitude", n.attributes.value().latitude);
+        if (n.attributes.value().longitude.isSet())
+            createNode("Longitude",n.attributes.value().longitude);
+        if (n.attributes.value().altitude.isSet())
+            createNode("Altitude", n.attributes.value().altitude);
+        if (n.attributes.value().author.isSet())
+            createNode("Author", n.attributes.value().author);
+        if (n.attributes.value().source.isSet())
+            createNode("Source", n.attributes.value().source);
+        if (n.attributes.value().sourceApplication.isSet())
+            createNode("SourceApplication", n.attributes.value().sourceApplication);
+        if (n.attributes.value().sourceURL.isSet())
+            createNode("SourceUrl", n.attributes.value().sourceURL);
+        if (n.attributes.value().shareDate.isSet())
+            createTimestampNode("ShareDate", n.attributes.value().shareDate);
+        if (n.attributes.value().reminderOrder.isSet())
+            createNode("ReminderOrder",QString::number(n.attributes.value().reminderOrder));
+        if (n.attributes.value().reminderDoneTime.isSet())
+            createNode("ReminderDoneTime", QString::number(n.attributes.value().reminderDoneTime));
+        if (n.attributes.value().reminderTime.isSet())
+            createNode("ReminderTime", QString::number(n.attributes.value().reminderTime));
+        if (n.attributes.value().placeName.isSet())
+            createNode("PlaceName", n.attributes.value().placeName);
+        if (n.attributes.value().contentClass.isSet())
+            createNode("ContentClass",n.attributes.value().contentClass);
+        if (n.attributes.value().lastEditedBy.isSet())
+            createNode("LastEditedBy", n.attributes.value().lastEditedBy);
+        if (n.attributes.value().creatorId.isSet())
+            createNode("CreatorId", n.attributes.value().creatorId);
+        if (n.attributes.value().lastEditorId.isSet())
+            createNode("LastEditorId", n.attributes.value().lastEditorId);
         writer->writeEndElement();
     }
+    createNode("Dirty", item.dirty);
+    writer->writeEndElement();
 }
 
 
 
-void ExportData::writeResource(Resource r) {
+void ExportData::writeResource(Resource r, QString bodyFile) {
     writer->writeStartElement("NoteResource");
     if (r.guid.isSet())
         createNode("Guid", r.guid);
     if (r.noteGuid.isSet())
         createNode("NoteGuid", r.noteGuid);
-    if (r.data.isSet())
-        writeData("Data", r.data);
+    if (r.data.isSet() || bodyFile != "")
+        writeData("Data", r.data.isSet() ? r.data.ref() : Data(), bodyFile);
     if (r.mime.isSet())
         createNode("Mime", r.mime);
     if (r.width.isSet())
@@ -28,6 +28,10 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #include <QHash>
 #include <QtXml>
 #include <QProgressDialog>
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QQueue>
 
 // Windows Check
 #ifdef _WIN32
@@ -40,6 +44,43 @@ using namespace std;
 using namespace qevercloud;
 
 
+// A note loaded for export.  Resource bodies are not loaded, they are
+// streamed from their files in dba when the note is written.
+class ExportItem
+{
+public:
+    Note note;
+    QStringList bodyFiles;      // one per resource, same order as note.resources
+    bool dirty;
+};
+
+
+class ExportData;
+
+// Writes the notes queued by ExportData::writeNotes() so the next notes
+// can be loaded while the previous ones are encoded & written.  The queue
+// is bounded to keep memory flat.
+class ExportWriter : public QThread
+{
+    Q_OBJECT
+private:
+    ExportData *exporter;
+    QQueue<ExportItem> queue;
+    QMutex mutex;
+    QWaitCondition notEmpty;
+    QWaitCondition notFull;
+    bool finished;
+
+protected:
+    void run();
+
+public:
+    explicit ExportWriter(ExportData *exporter);
+    bool push(const ExportItem &item, unsigned long timeout);   // false if the queue stayed full
+    void finish();                                              // no more notes
+};
+
+
 class ExportData : public QObject
 {
     Q_OBJECT
@@ -62,8 +103,11 @@ private:
     void writeSharedNotebooks();
     void writeNotes();
     void writeUser(User user);
-    void writeData(QString name, Data data);
-    void writeResource(Resource r);
+    void writeData(QString name, Data data, QString bodyFile = QString());
+    void writeBody(const QString &fileName);
+    void writeResource(Resource r, QString bodyFile = QString());
+    void writeTombstones(const QStringList &guids);
+    QString baseFile;
     QProgressDialog *progress;
 
 
@@ -71,11 +115,13 @@ public:
     bool backup;
     explicit ExportData(bool backup, bool cmdLine=false, QObject *parent = 0);
     void backupData(QString filename);
+    void setIncrementalBase(QString baseFile);
     int lastError;
     QString errorMessage;
     QXmlStreamWriter *writer;
     QList<qint32> lids;
     bool cmdLine;
+    void writeNote(const ExportItem &item);     // called on the writer thread
 
 signals:
 
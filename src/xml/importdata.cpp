@@ -27,11 +27,13 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #include "src/sql/tagtable.h"
 #include "src/sql/searchtable.h"
 #include "src/sql/usertable.h"
+#include "src/sql/configstore.h"
 #include "src/global.h"
+#include "src/utilities/gzipdevice.h"
+#include "src/xml/backupmanifest.h"
+#include "src/threads/fileremover.h"
 
 #include <QProgressDialog>
-#include <QMessageBox>
-#include <QPushButton>
 
 extern Global global;
 
@@ -49,6 +51,7 @@ ImportData::ImportData(bool full, bool cmdline, QObject *parent) : QObject(paren
     importTags = false;
     importNotebooks = false;
     backup = full;
+    incremental = false;
     createTags = false;
     stopNow = false;
     this->cmdline = cmdline;
@@ -89,42 +92,21 @@ void ImportData::import(QString file) {
     errorMessage = "";
 
     lastError = 0;
-    QFile xmlFile(fileName);
-    QFile scanFile(fileName);
-    if (!xmlFile.open(QIODevice::ReadOnly) || !scanFile.open(QIODevice::ReadOnly)) {
+    QFile plainFile(fileName);
+    GzipDevice compressedFile(fileName);
+    QIODevice &xmlFile = GzipDevice::isGzipFile(fileName) ?
+                static_cast<QIODevice&>(compressedFile) : static_cast<QIODevice&>(plainFile);
+    if (!xmlFile.open(QIODevice::ReadOnly)) {
         lastError = 16;
         errorMessage = "Cannot open file.";
         return;
     }
 
-    QTextStream *countReader = new QTextStream(&scanFile);
-
-    int recCnt = 0;
-    QMessageBox *mb = nullptr;
-    if (!cmdline) {
-        mb = new QMessageBox();
-        mb->setWindowTitle(tr("Scanning File"));
-        mb->setText(QString::number(recCnt) + tr(" notes found."));
-        QPushButton *cancelButton = mb->addButton(QMessageBox::Cancel);
-        connect(cancelButton, SIGNAL(clicked()), this, SLOT(cancel()));
-        mb->show();
-        QCoreApplication::processEvents();
-    }
-
-    while (!countReader->atEnd() && !stopNow) {
-        QString line = countReader->readLine();
-        if (line.contains("<note>", Qt::CaseInsensitive)) {
-            recCnt++;
-            if (!cmdline) {
-                mb->setText(QString::number(recCnt) + tr(" notes found."));
-                QCoreApplication::processEvents();
-            }
-        }
-    }
-
+    // Progress is by position in the file so it doesn't have to be
+    // scanned for the number of notes first.
     notebookData.clear();
     if (!cmdline) {
-        progress->setMaximum(recCnt);
+        progress->setMaximum(1000);
         progress->setMinimum(0);
         if (backup) {
             progress->setWindowTitle(tr("Importing"));
@@ -136,31 +118,38 @@ void ImportData::import(QString file) {
         progress->setWindowModality(Qt::ApplicationModal);
         connect(progress, SIGNAL(canceled()), this, SLOT(cancel()));
         progress->setVisible(true);
-        mb->close();
         progress->show();
     }
-    recCnt = 0;
 
     reader = new QXmlStreamReader(&xmlFile);
-    NSqlQuery query(global.db);
-    query.exec("begin");
-    int commitCount = 100;
+    pipeline.start(&xmlFile);
+    qint32 lastProgress = -1;
     while (!reader->atEnd() && !stopNow) {
-        if (commitCount <=  0) {
-            query.exec("commit");
-            commitCount = 100;
-        }
-        commitCount--;
         reader->readNext();
         if (reader->hasError()) {
             errorMessage = reader->errorString();
             QLOG_ERROR() << "************************* ERROR READING BACKUP " << errorMessage;
             lastError = 16;
-            if (mb != nullptr)
-                delete mb;
+            writeBatch();
+            if (!cmdline)
+                progress->hide();
             return;
         }
-        if (reader->name().toString().toLower() == "nevernote-export" && reader->isStartElement()) {
+        if (!reader->isStartElement())
+            continue;
+
+        QStringRef name = reader->name();
+        if (isNode(name, "nixnote-export")) {
+            QString type = reader->attributes().value("exportType").toString();
+            incremental = type.toLower() == "incremental";
+            if (incremental && !backup) {
+                lastError = 4;
+                errorMessage = "This is an incremental backup file, not an export file";
+                if (!cmdline)
+                    progress->hide();
+                return;
+            }
+        } else if (isNode(name, "nevernote-export")) {
             QXmlStreamAttributes attributes = reader->attributes();
             QString version = attributes.value("version").toString();
             QString type = attributes.value("exportType").toString();
@@ -169,15 +158,15 @@ void ImportData::import(QString file) {
                     && version != "0.95") {
                 lastError = 1;
                 errorMessage = "Unknown backup version = " +version;
-                if (mb != nullptr)
-                    delete mb;
+                if (!cmdline)
+                    progress->hide();
                 return;
             }
             if (application.toLower() != "nevernote") {
                 lastError = 2;
                 errorMessage = "This backup is from an unknown application = " +application;
-                if (mb != nullptr)
-                    delete mb;
+                if (!cmdline)
+                    progress->hide();
                 return;
             }
             if (type.toLower() == "backup" && !backup) {
@@ -185,45 +174,44 @@ void ImportData::import(QString file) {
                 errorMessage = "This is backup file, not an export file";
                 if (!cmdline)
                     progress->hide();
-                if (mb != nullptr)
-                    delete mb;
                 return;
             }
             if (type.toLower() == "export" && backup) {
                 lastError = 5;
                 errorMessage = "This is an export file, not a backup file";
-                if (mb != nullptr)
-                    delete mb;
+                if (!cmdline)
+                    progress->hide();
                 return;
             }
-        }
-        if (reader->name().toString().toLower() == "synchronization" && reader->isStartElement() && backup) {
+        } else if (isNode(name, "synchronization") && backup) {
             processSynchronizationNode();
-        }
-        if (reader->name().toString().toLower() == "note" && reader->isStartElement()) {
+        } else if (isNode(name, "note")) {
             processNoteNode();
-            recCnt++;
-            if (!cmdline)
-                progress->setValue(recCnt);
-        }
-        if (reader->name().toString().toLower() == "notebook" && reader->isStartElement() && (backup || importNotebooks)) {
+            if (pipeline.batchFull())
+                writeBatch();
+            qint32 position = pipeline.progress();
+            if (!cmdline && position != lastProgress) {
+                lastProgress = position;
+                progress->setValue(position);
+            }
+        } else if (isNode(name, "notebook") && (backup || importNotebooks)) {
             processNotebookNode();
-        }
-        if (reader->name().toString().toLower() == "tag" && reader->isStartElement() && (backup || importTags)) {
+        } else if (isNode(name, "tag") && (backup || importTags)) {
             processTagNode();
-        }
-        if (reader->name().toString().toLower() == "savedsearch" && reader->isStartElement() && backup) {
+        } else if (isNode(name, "savedsearch") && backup) {
             processSavedSearchNode();
-        }
-        if (reader->name().toString().toLower() == "linkednotebook" && reader->isStartElement() && backup) {
+        } else if (isNode(name, "linkednotebook") && backup) {
             processLinkedNotebookNode();
-        }
-        if (reader->name().toString().toLower() == "SharedNotebook" && reader->isStartElement() && backup) {
+        } else if (isNode(name, "sharednotebook") && backup) {
             processSharedNotebookNode();
+        } else if (isNode(name, "tombstones") && incremental) {
+            writeBatch();
+            processTombstonesNode();
         }
     }
+    writeBatch();
     xmlFile.close();
-    query.exec("commit");
+    pipeline.logThroughput(backup ? "NNEX restore" : "NNEX import");
 
     // Now we do what is a "ahem" hack.  We need to
     // go through all of the notes & rebuild the NoteTable.  This
@@ -233,6 +221,8 @@ void ImportData::import(QString file) {
     // as well as any other way.
 
     NoteTable noteTable(global.db);
+    NSqlQuery query(global.db);
+    query.exec("begin");
     for (qint32 i=0; i<noteList.size(); i++) {
         qint32 lid = noteTable.getLid(noteList[i]);
         if (lid > 0) {
@@ -245,8 +235,94 @@ void ImportData::import(QString file) {
     query.exec("commit");
     if (!this->cmdline)
         progress->hide();
-    if (mb != nullptr)
-        delete mb;
+}
+
+
+//***********************************************************
+//* Write the notes parsed so far in a single transaction
+//***********************************************************
+void ImportData::writeBatch() {
+    QList<PendingNote> batch = pipeline.takeBatch();
+    if (batch.isEmpty())
+        return;
+
+    // One lid per note & resource
+    qint32 objects = 0;
+    for (int i=0; i<batch.size(); i++) {
+        objects++;
+        if (batch[i].note.resources.isSet())
+            objects += batch[i].note.resources.ref().size();
+    }
+    ConfigStore cs(global.db);
+    cs.reserveLids(objects);
+
+    NSqlQuery query(global.db);
+    query.exec("begin");
+    NoteTable noteTable(global.db);
+    QStringList files;
+    for (int i=0; i<batch.size(); i++) {
+        Note &note = batch[i].note;
+        // An incremental backup holds newer versions of notes restored
+        // from earlier backups of the chain.  Their old files are only
+        // removed once the batch is committed.
+        if (incremental) {
+            qint32 oldLid = noteTable.getLid(note.guid);
+            if (oldLid > 0)
+                noteTable.expunge(QList<qint32>() << oldLid, files, false);
+        }
+        if (backup)
+            noteTable.add(0,note, batch[i].dirty);
+        else {
+            note.updateSequenceNum = 0;
+            if (notebookGuid != nullptr)
+                note.notebookGuid = notebookGuid;
+            noteTable.add(0,note, true);
+            if (metaData.contains(note.guid)) {
+                QLOG_ERROR() << "ERROR IN IMPORTING DATA:  Metadata not yet supported";
+            }
+        }
+        pipeline.adoptBodyFiles(batch[i]);
+    }
+    query.exec("commit");
+    FileRemover::removeInBackground(files);
+}
+
+
+//***********************************************************
+//* Restore a backup.  If it is an incremental backup the
+//* backups it is based on are restored first.
+//***********************************************************
+void ImportData::importChain(QString file) {
+    QStringList files = BackupManifest::chain(file);
+    for (int i=0; i<files.size() && lastError == 0 && !stopNow; i++) {
+        QLOG_INFO() << "Restoring " << files[i];
+        import(files[i]);
+    }
+}
+
+
+//***********************************************************
+//* Process the <Tombstones> of an incremental backup.  These
+//* are the notes expunged since the previous backup.
+//***********************************************************
+void ImportData::processTombstonesNode() {
+    QLOG_DEBUG() << "Processing Tombstones Node";
+    NoteTable noteTable(global.db);
+    QList<qint32> lids;
+    bool atEnd = false;
+    while(!atEnd) {
+        if (reader->isStartElement() && isNode(reader->name(), "note")) {
+            qint32 lid = noteTable.getLid(textValue());
+            if (lid > 0)
+                lids.append(lid);
+        }
+        reader->readNext();
+        if (reader->atEnd() || (reader->isEndElement() && isNode(reader->name(), "tombstones")))
+            atEnd = true;
+    }
+    QStringList files;
+    noteTable.expunge(lids, files, false);
+    FileRemover::removeInBackground(files);
 }
 
 
@@ -261,163 +337,134 @@ void ImportData::processNoteNode() {
     note.guid = newGuid;
     NoteMetaData meta;
     bool noteIsDirty = false;
+    QList<Resource> resources;
 
     bool atEnd = false;
     while(!atEnd) {
-        QString name = reader->name().toString().toLower();
-        QLOG_TRACE() << name;
-        if (name == "guid" && !reader->isEndElement() && backup) {
-            note.guid = textValue();
-            noteList.append(note.guid);
-        }
-        if (name == "updatesequencenumber" && !reader->isEndElement()) {
-            note.updateSequenceNum = textValue().toLong();
-        }
-        if (name == "title" && !reader->isEndElement()) {
-            note.title = textValue();
-        }
-        if (name == "created" && !reader->isEndElement()) {
-            note.created = longLongValue();
-        }
-        if (name == "updated" && !reader->isEndElement()) {
-            note.updated = longLongValue();
-        }
-        if (name == "deleted" && !reader->isEndElement()) {
-            note.deleted = longLongValue();
-        }
-        if (name == "active" && !reader->isEndElement()) {
-            note.active = booleanValue();
-        }
-        if (name == "notebookguid" && !reader->isEndElement()) {
-            note.notebookGuid = textValue();
-        }
-        if (name == "dirty" && !reader->isEndElement()) {
-            noteIsDirty = booleanValue();
-        }
-        if (name == "content" && !reader->isEndElement()) {
-            note.content = textValue();
-        }
-        if (name == "titlecolor" && !reader->isEndElement()) {
-            meta.setColor(intValue());
-        }
-        if (name == "notetags" && (createTags || backup) && !reader->isEndElement()) {
-            QStringList names, guids;
-            processNoteTagList(guids, names);
-            QList<QString> tagGuids;
-            QList<QString> tagNames;
-            for (qint32 i=0; i<guids.size(); i++) {
-                tagGuids.append(guids[i]);
-                tagNames.append(names[i]);
-            }
-            note.tagNames = tagNames;
-            note.tagGuids = tagGuids;
-        }
-        if (name == "noteattributes" && !reader->isEndElement()) {
-            NoteAttributes na;
-            if (!note.attributes.isSet()) {
-                note.attributes = na;
+        if (reader->isStartElement()) {
+            QStringRef name = reader->name();
+            if (isNode(name, "guid") && backup) {
+                note.guid = textValue();
+                noteList.append(note.guid);
+            } else if (isNode(name, "updatesequencenumber")) {
+                note.updateSequenceNum = textValue().toLong();
+            } else if (isNode(name, "title")) {
+                note.title = textValue();
+            } else if (isNode(name, "created")) {
+                note.created = longLongValue();
+            } else if (isNode(name, "updated")) {
+                note.updated = longLongValue();
+            } else if (isNode(name, "deleted")) {
+                note.deleted = longLongValue();
+            } else if (isNode(name, "active")) {
+                note.active = booleanValue();
+            } else if (isNode(name, "notebookguid")) {
+                note.notebookGuid = textValue();
+            } else if (isNode(name, "dirty")) {
+                noteIsDirty = booleanValue();
+            } else if (isNode(name, "content")) {
+                note.content = textValue();
+            } else if (isNode(name, "titlecolor")) {
+                meta.setColor(intValue());
+            } else if (isNode(name, "notetags") && (createTags || backup)) {
+                QStringList names, guids;
+                processNoteTagList(guids, names);
+                QList<QString> tagGuids;
+                QList<QString> tagNames;
+                for (qint32 i=0; i<guids.size(); i++) {
+                    tagGuids.append(guids[i]);
+                    tagNames.append(names[i]);
+                }
+                note.tagNames = tagNames;
+                note.tagGuids = tagGuids;
+            } else if (isNode(name, "tag") && (createTags || backup)) {
+                // Backups list each tag of the note as <Tag><Guid/><Name/></Tag>
+                QString tagGuid, tagName;
+                while (!(reader->isEndElement() && isNode(reader->name(), "tag")) && !reader->atEnd()) {
+                    reader->readNext();
+                    if (reader->isStartElement() && isNode(reader->name(), "guid"))
+                        tagGuid = textValue();
+                    else if (reader->isStartElement() && isNode(reader->name(), "name"))
+                        tagName = textValue();
+                }
+                if (!note.tagGuids.isSet()) {
+                    note.tagGuids = QList<QString>();
+                    note.tagNames = QList<QString>();
+                }
+                note.tagGuids->append(tagGuid);
+                note.tagNames->append(tagName);
+            } else if (isNode(name, "noteattributes")) {
+                NoteAttributes na;
+                if (!note.attributes.isSet()) {
+                    note.attributes = na;
+                }
+                processNoteAttributes(note.attributes);
+            } else if (isNode(name, "noteresource")) {
+                Resource newRes;
+                processResource(newRes, resources.size());
+                if (!backup)
+                    newRes.updateSequenceNum = 0;
+                resources.append(newRes);
             }
-            processNoteAttributes(note.attributes);
-        }
-        if (name == "noteresource" && !reader->isEndElement()) {
-            Resource newRes;
-            processResource(newRes);
-            newRes.noteGuid = note.guid;
-            if (!backup)
-                newRes.updateSequenceNum = 0;
-            QList<Resource> resources;
-            if (note.resources.isSet())
-                resources = note.resources;
-            resources.append(newRes);
-            note.resources = resources;
         }
         reader->readNext();
-        QString endName = reader->name().toString().toLower();
-        if (endName == "note" && reader->isEndElement())
+        if (reader->isEndElement() && isNode(reader->name(), "note"))
             atEnd = true;
     }
 
-    // Loop through the resources & make sure they all have the
-    // proper guid for this note
-    QList<Resource> resources;
-    if (note.resources.isSet())
-        resources = note.resources;
+    // Make sure all the resources have the proper guid for this note
     for (int i=0; i<resources.size(); i++) {
         resources[i].noteGuid = note.guid;
     }
     note.resources = resources;
-    NoteTable noteTable(global.db);
-    if (backup)
-        noteTable.add(0,note, noteIsDirty);
-    else {
-        note.updateSequenceNum = 0;
-        if (notebookGuid != nullptr)
-            note.notebookGuid = notebookGuid;
-        noteTable.add(0,note, true);
-        if (metaData.contains(note.guid)) {
-            QLOG_ERROR() << "ERROR IN IMPORTING DATA:  Metadata not yet supported";
-        }
-    }
-    return;
+
+    // The resource bodies are still being decoded.  The note is
+    // written with the rest of its batch.
+    pipeline.addNote(note, noteIsDirty);
 }
 
 
 //***********************************************************
-//* Process a <noteresource> node.
+//* Process a <noteresource> node.  index is the position of
+//* the resource in its note.
 //***********************************************************
-void ImportData::processResource(Resource &resource) {
+void ImportData::processResource(Resource &resource, qint32 index) {
     QLOG_DEBUG() << "Processing Resource Node";
 
     bool atEnd = false;
-    //bool isDirty = false;
+    if (!backup) {
+        QUuid uuid;
+        resource.guid = uuid.createUuid().toString().replace("{","").replace("}","");
+    }
 
     while(!atEnd) {
         if (reader->isStartElement()) {
-            QString name = reader->name().toString().toLower();
-            if (name == "guid") {
-                resource.guid = textValue();
-            }
-            if (!backup) {
-                QUuid uuid;
-                QString g =  uuid.createUuid().toString().replace("{","").replace("}","");
-                resource.guid = g;
-            }
-            if (name == "noteguid") {
-                QString tx = textValue();
-                resource.noteGuid = tx;
-            }
-            if (name == "updatesequencenumber") {
+            QStringRef name = reader->name();
+            if (isNode(name, "guid")) {
+                QString guid = textValue();
+                if (backup)
+                    resource.guid = guid;
+            } else if (isNode(name, "noteguid")) {
+                resource.noteGuid = textValue();
+            } else if (isNode(name, "updatesequencenumber")) {
                 resource.updateSequenceNum = intValue();
-            }
-            if (name == "active") {
+            } else if (isNode(name, "active")) {
                 resource.active =  booleanValue();
-            }
-            if (name == "mime") {
+            } else if (isNode(name, "mime")) {
                 resource.mime = textValue();
-            }
-            if (name == "duration") {
+            } else if (isNode(name, "duration")) {
                 resource.duration = shortValue();
-            }
-            if (name == "height") {
+            } else if (isNode(name, "height")) {
                 resource.height = shortValue();
-            }
-            if (name == "width") {
+            } else if (isNode(name, "width")) {
                 resource.width = shortValue();
-            }
-//            if (name == "dirty")
-//                isDirty = booleanValue();
-            if (name == "data") {
-                Data data;
-                resource.data = data;
-                processData("Data", resource.data);
-            }
-            if (name == "alternatedata") {
-                processData("AlternateData", resource.data);
-            }
-            if (name == "recognitiondata") {
-                processData("RecognitionData", resource.recognition);
-            }
-            if (name == "noteresourceattributes") {
+            } else if (isNode(name, "data")) {
+                processData("Data", index, PendingData::Body);
+            } else if (isNode(name, "alternatedata")) {
+                processData("AlternateData", index, PendingData::AlternateData);
+            } else if (isNode(name, "recognitiondata")) {
+                processData("RecognitionData", index, PendingData::Recognition);
+            } else if (isNode(name, "noteresourceattributes")) {
                 ResourceAttributes ra;
                 if (!resource.attributes.isSet()) {
                    resource.attributes = ra;
@@ -426,8 +473,7 @@ void ImportData::processResource(Resource &resource) {
             }
         }
         reader->readNext();
-        QString endName = reader->name().toString().toLower();
-        if (endName == "noteresource" && reader->isEndElement())
+        if (reader->isEndElement() && isNode(reader->name(), "noteresource"))
             atEnd = true;
     }
 }
@@ -435,50 +481,18 @@ void ImportData::processResource(Resource &resource) {
 
 
 //***********************************************************
-//* Process any type of data node
+//* Process any type of data node.  The hex body is decoded
+//* & hashed by the pipeline.
 //***********************************************************
-void ImportData::processData(QString nodeName, Data &data) {
+void ImportData::processData(QString nodeName, qint32 index, PendingData::Field field) {
     QLOG_DEBUG() << "Processing Data Node";
-    nodeName.toLower();
     bool atEnd = false;
     while(!atEnd) {
-        if (reader->isStartElement()) {
-            QString name = reader->name().toString().toLower();
-//            if (name == "size") {
-//                data.size = intValue();
-//                data.__isset.size = true;
-//            }
-            if (name == "body") {
-                QString x = textValue();
-                QByteArray bin = QByteArray::fromHex(x.toLocal8Bit());
-                data.body.clear();
-                data.body = bin;
-
-                QCryptographicHash md5hash(QCryptographicHash::Md5);
-                QByteArray hash = md5hash.hash(bin, QCryptographicHash::Md5);
-                QLOG_DEBUG() << "Actual:" << hash.toHex();
-
-                data.bodyHash.clear();
-                data.bodyHash = hash;
-
-
-                data.size = bin.size();
-            }
-//            if (name == "bodyhash") {
-//                QByteArray hexData = textValue().toLocal8Bit();
-//                QLOG_DEBUG() << hexData;
-//                //QByteArray hexData;
-//                //hexData.append(textValue());
-//                QByteArray binData = QByteArray::fromHex(hexData);
-//                QLOG_DEBUG() << QByteArray::fromHex(hexData);
-//                data.bodyHash.clear();
-//                data.bodyHash.append(binData.data(), binData.size());
-//                data.__isset.bodyHash = true;
-//            }
+        if (reader->isStartElement() && isNode(reader->name(), "body")) {
+            pipeline.readData(reader, DataDecoder::Hex, index, field);
         }
         reader->readNext();
-        QString nName = reader->name().toString().toLower();
-        if (nName == nodeName.toLower() && reader->isEndElement())
+        if (reader->isEndElement() && reader->name().compare(nodeName, Qt::CaseInsensitive) == 0)
             atEnd = true;
     }
 }
@@ -530,8 +544,7 @@ void ImportData::processResourceAttributes(ResourceAttributes &attributes) {
             }
         }
         reader->readNext();
-        QString endName = reader->name().toString().toLower();
-        if (endName == "noteresourceattribute" && reader->isEndElement())
+        if (reader->isEndElement() && isNode(reader->name(), "noteresourceattribute"))
             atEnd = true;
     }
 }
@@ -547,8 +560,7 @@ void ImportData::processNoteTagList(QStringList &guidList, QStringList &names) {
                 guidList.append(textValue());
         }
         reader->readNext();
-        QString endName = reader->name().toString().toLower();
-        if (endName == "notetags" && reader->isEndElement())
+        if (reader->isEndElement() && isNode(reader->name(), "notetags"))
             atEnd = true;
     }
 
@@ -609,8 +621,7 @@ void ImportData::processNoteAttributes(NoteAttributes &attributes) {
             }
         }
         reader->readNext();
-        QString endName = reader->name().toString().toLower();
-        if (endName == "noteattributes" && reader->isEndElement())
+        if (reader->isEndElement() && isNode(reader->name(), "noteattributes"))
             atEnd = true;
     }
 
@@ -636,8 +647,7 @@ void ImportData::processSynchronizationNode() {
                 userTable.updateLastSyncDate(longValue());
         }
         reader->readNext();
-        QString endName = reader->name().toString().toLower();
-        if (endName == "synchronization" && reader->isEndElement())
+        if (reader->isEndElement() && isNode(reader->name(), "synchronization"))
             atEnd = true;
     }
 
@@ -678,8 +688,7 @@ void ImportData::processSavedSearchNode() {
             }
         }
         reader->readNext();
-        QString endName = reader->name().toString().toLower();
-        if (endName == "savedsearch" && reader->isEndElement())
+        if (reader->isEndElement() && isNode(reader->name(), "savedsearch"))
             atEnd = true;
     }
 
@@ -727,8 +736,7 @@ void ImportData::processLinkedNotebookNode() {
             }
         }
         reader->readNext();
-        QString endName = reader->name().toString().toLower();
-        if (endName == "linkednotebook" && reader->isEndElement())
+        if (reader->isEndElement() && isNode(reader->name(), "linkednotebook"))
             atEnd = true;		}
 }
 
@@ -773,8 +781,7 @@ void ImportData::processSharedNotebookNode() {
             }
         }
         reader->readNext();
-        QString endName = reader->name().toString().toLower();
-        if (endName == "sharednotebook" && reader->isEndElement())
+        if (reader->isEndElement() && isNode(reader->name(), "sharednotebook"))
             atEnd = true;		}
 }
 
@@ -856,8 +863,7 @@ void ImportData::processNotebookNode() {
             }
         }
         reader->readNext();
-        QString endName = reader->name().toString().toLower();
-        if (endName == "notebook" && reader->isEndElement())
+        if (reader->isEndElement() && isNode(reader->name(), "notebook"))
             atEnd = true;
     }
     notebook.publishing = publishing;
@@ -922,8 +928,7 @@ void ImportData::processTagNode() {
             }
         }
         reader->readNext();
-        QString endName = reader->name().toString().toLower();
-        if (endName == "tag" && reader->isEndElement())
+        if (reader->isEndElement() && isNode(reader->name(), "tag"))
             atEnd = true;
     }
 
@@ -28,6 +28,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 
 #include "src/sql/notemetadata.h"
 #include "src/global.h"
+#include "src/xml/importpipeline.h"
 
 using namespace std;
 
@@ -49,8 +50,10 @@ private:
     QString                 fileName;
     QXmlStreamReader        *reader;
     bool                    backup;
+    bool                    incremental;
     QString                 notebookGuid;
     QProgressDialog         *progress;
+    ImportPipeline          pipeline;
 
     QHash<QString,QString>		noteMap;
     QHash<QString, NoteMetadata> metaData;
@@ -58,8 +61,9 @@ private:
     QHash<QString, qint32>  notebookData;
 
     void processNoteNode();
-    void processResource(Resource &resource);
-    void processData(QString nodeName, Data &data);
+    void writeBatch();
+    void processResource(Resource &resource, qint32 index);
+    void processData(QString nodeName, qint32 index, PendingData::Field field);
     void processResourceAttributes(ResourceAttributes &attributes);
     void processNoteTagList(QStringList &guids, QStringList &names);
     void processNoteAttributes(NoteAttributes &attributes);
@@ -69,6 +73,7 @@ private:
     void processSharedNotebookNode();
     void processNotebookNode();
     void processTagNode();
+    void processTombstonesNode();
     QString textValue();
     qint32 intValue();
     long longValue();
@@ -87,6 +92,7 @@ public:
     bool                    cmdline;
     ImportData(bool full, bool cmdline=false, QObject *parent=0);
     void import(QString file);
+    void importChain(QString file);
     void setNotebookGuid(QString g);
     QString getErrorMessage();
 
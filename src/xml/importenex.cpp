@@ -24,9 +24,8 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #include "src/sql/tagtable.h"
 #include "src/sql/notetable.h"
 #include "src/sql/nsqlquery.h"
+#include "src/sql/configstore.h"
 
-#include <QMessageBox>
-#include <QPushButton>
 
 
 extern Global global;
@@ -68,58 +67,41 @@ void ImportEnex::import(QString file) {
 
     lastError = 0;
     QFile xmlFile(fileName);
-    QFile scanFile(fileName);
-    if (!xmlFile.open(QIODevice::ReadOnly) || !scanFile.open(QIODevice::ReadOnly)) {
+    if (!xmlFile.open(QIODevice::ReadOnly)) {
         lastError = 16;
         errorMessage = "Cannot open file.";
         return;
     }
 
-    reader = new QXmlStreamReader(&xmlFile);
-    QTextStream *countReader = new QTextStream(&scanFile);
-    int recCnt = 0;
-
-    QMessageBox mb;
-    mb.setWindowTitle(tr("Scanning File"));
-    mb.setText(QString::number(recCnt) + tr(" notes found."));
-    QPushButton *cancelButton = mb.addButton(QMessageBox::Cancel);
-    connect(cancelButton, SIGNAL(clicked()), this, SLOT(canceled()));
-    mb.show();
-    QCoreApplication::processEvents();
-
-    while (!countReader->atEnd() && !stopNow) {
-        QString line = countReader->readLine();
-        if (line.contains("<note>")) {
-            recCnt++;
-            mb.setText(QString::number(recCnt) + tr(" notes found."));
-            QCoreApplication::processEvents();
-        }
-    }
-
-    progress->setMaximum(recCnt);
+    // Progress is by position in the file so it doesn't have to be
+    // scanned for the number of notes first.
+    progress->setMaximum(1000);
     progress->setMinimum(0);
     progress->setWindowTitle(tr("Importing Notes"));
     progress->setLabelText(tr("Importing Notes"));
     progress->setWindowModality(Qt::ApplicationModal);
     connect(progress, SIGNAL(canceled()), this, SLOT(canceled()));
     progress->setVisible(true);
-    mb.close();
     progress->show();
 
-
-    NSqlQuery query(global.db);
-    query.exec("begin");
-    recCnt = 0;
+    reader = new QXmlStreamReader(&xmlFile);
+    pipeline.start(&xmlFile);
+    qint32 recCnt = 0;
+    qint32 lastProgress = -1;
     while (!reader->atEnd() && !stopNow) {
         reader->readNext();
         if (reader->hasError()) {
             errorMessage = reader->errorString();
             QLOG_ERROR() << "************************* ERROR READING BACKUP " << errorMessage;
             lastError = 16;
+            writeBatch();
+            progress->hide();
             return;
         }
+        if (!reader->isStartElement())
+            continue;
 
-        if (reader->name().toString().toLower() == "en-export" && reader->isStartElement()) {
+        if (isNode(reader->name(), "en-export")) {
             QXmlStreamAttributes attributes = reader->attributes();
             QString version = attributes.value("version").toString();
             QString application = attributes.value("application").toString();
@@ -127,28 +109,66 @@ void ImportEnex::import(QString file) {
             if (version != "5.x" && version != "6.x" && version.toLower() != "evernote mac") {
                 lastError = 1;
                 errorMessage = "Unknown export version = " +version;
+                progress->hide();
                 return;
             }
             if (application.toLower() != "evernote/windows" && application.toLower() != "evernote") {
                 lastError = 2;
                 errorMessage = "This export is from an unknown application = " +application;
+                progress->hide();
                 return;
             }
-        }
-        if (reader->name().toString().toLower() == "note" && reader->isStartElement()) {
+        } else if (isNode(reader->name(), "note")) {
             recCnt++;
-            progress->setValue(recCnt);
             QLOG_DEBUG() << "Importing Note " << recCnt;
             processNoteNode();
+            if (pipeline.batchFull())
+                writeBatch();
+            qint32 position = pipeline.progress();
+            if (position != lastProgress) {
+                lastProgress = position;
+                progress->setValue(position);
+            }
         }
     }
+    writeBatch();
     xmlFile.close();
-    query.exec("commit");
+    pipeline.logThroughput("ENEX import");
     progress->hide();
 }
 
 
 
+//***********************************************************
+//* Write the notes parsed so far in a single transaction
+//***********************************************************
+void ImportEnex::writeBatch() {
+    QList<PendingNote> batch = pipeline.takeBatch();
+    if (batch.isEmpty())
+        return;
+
+    // One lid per note & resource, plus any tags that may be created
+    qint32 objects = 0;
+    for (int i=0; i<batch.size(); i++) {
+        const Note &n = batch[i].note;
+        objects++;
+        if (n.resources.isSet())
+            objects += n.resources.ref().size();
+        if (n.tagNames.isSet())
+            objects += n.tagNames.ref().size();
+    }
+    ConfigStore cs(global.db);
+    cs.reserveLids(objects);
+
+    NSqlQuery query(global.db);
+    query.exec("begin");
+    for (int i=0; i<batch.size(); i++) {
+        saveNote(batch[i].note);
+        pipeline.adoptBodyFiles(batch[i]);
+    }
+    query.exec("commit");
+}
+
 
 
 //***********************************************************
@@ -161,60 +181,56 @@ void ImportEnex::processNoteNode() {
     note.guid = newGuid;
     note.active = true;
     QList<Resource> resources;
-    //QList<QString> tagNames;
 
     bool atEnd = false;
     while(!atEnd) {
-        QString name = reader->name().toString().toLower();
-        if (name == "title" && !reader->isEndElement()) {
-            note.title = textValue();
-        }
-        if (name == "created" && !reader->isEndElement()) {
-            note.created = datetimeValue();
-        }
-        if (name == "updated" && !reader->isEndElement()) {
-            note.updated = datetimeValue();
-        }
-        if (name == "deleted" && !reader->isEndElement()) {
-            note.deleted = datetimeValue();
-        }
-        if (name == "active" && !reader->isEndElement()) {
-            note.active = booleanValue();
-        }
-        if (name == "content" && !reader->isEndElement()) {
-            note.content = textValue();
-        }
-        if (name == "note-attributes" && !reader->isEndElement()) {
-            NoteAttributes na;
-            note.attributes = na;
-            processNoteAttributes(note.attributes);
-        }
-        if (name == "resource" && !reader->isEndElement()) {
-            Resource newRes;
-            processResource(newRes);
-            newRes.noteGuid = note.guid;
-            newRes.updateSequenceNum = 0;
-            resources.append(newRes);
-        }
-        if (name == "tag" && !reader->isEndElement()) {
-            if (!note.tagNames.isSet())
-                note.tagNames = QStringList();
-           note.tagNames->append(textValue());
+        if (reader->isStartElement()) {
+            QStringRef name = reader->name();
+            if (isNode(name, "title")) {
+                note.title = textValue();
+            } else if (isNode(name, "created")) {
+                note.created = datetimeValue();
+            } else if (isNode(name, "updated")) {
+                note.updated = datetimeValue();
+            } else if (isNode(name, "deleted")) {
+                note.deleted = datetimeValue();
+            } else if (isNode(name, "active")) {
+                note.active = booleanValue();
+            } else if (isNode(name, "content")) {
+                note.content = textValue();
+            } else if (isNode(name, "note-attributes")) {
+                NoteAttributes na;
+                note.attributes = na;
+                processNoteAttributes(note.attributes);
+            } else if (isNode(name, "resource")) {
+                Resource newRes;
+                processResource(newRes, resources.size());
+                newRes.noteGuid = note.guid;
+                newRes.updateSequenceNum = 0;
+                resources.append(newRes);
+            } else if (isNode(name, "tag")) {
+                if (!note.tagNames.isSet())
+                    note.tagNames = QStringList();
+                note.tagNames->append(textValue());
+            }
         }
         reader->readNext();
-        QString endName = reader->name().toString().toLower();
-        if (endName == "note" && reader->isEndElement())
+        if (reader->isEndElement() && isNode(reader->name(), "note"))
             atEnd = true;
     }
+    note.resources = resources;
+
+    // The resource bodies are still being decoded.  The note is
+    // written with the rest of its batch.
+    pipeline.addNote(note, true);
+}
 
 
-    // Loop through the resources & make sure they all have the
-    // proper guid for this note
-    for (int i=0; i<resources.size(); i++) {
-        Resource *r = &resources[i];
-        r->noteGuid = note.guid;
-    }
 
+//***********************************************************
+//* Save a parsed note, creating any tags it references
+//***********************************************************
+void ImportEnex::saveNote(Note &note) {
     // Loop through the tag names & find any matching tags.
     if (note.tagNames.isSet()) {
         note.tagGuids = QList< Guid >();
@@ -235,8 +251,6 @@ void ImportEnex::processNoteNode() {
             }
         }
     }
-    note.resources = resources;
-//    note.tagNames = tagNames;
 
     NoteTable noteTable(global.db);
     note.updateSequenceNum = 0;
@@ -253,96 +267,54 @@ void ImportEnex::processNoteNode() {
     }
 
     noteTable.add(0,note, true);
-    return;
 }
 
 
 
-
-
-
-
-
 //***********************************************************
-//* Process a <noteresource> node.
+//* Process a <noteresource> node.  index is the position
+//* of the resource in its note.
 //***********************************************************
-void ImportEnex::processResource(Resource &resource) {
+void ImportEnex::processResource(Resource &resource, qint32 index) {
     bool atEnd = false;
 
     resource.active = true;
+    QUuid uuid;
+    resource.guid = uuid.createUuid().toString().replace("{","").replace("}","");
 
     while(!atEnd) {
         if (reader->isStartElement()) {
-            QString name = reader->name().toString().toLower();
-            QUuid uuid;
-            QString g =  uuid.createUuid().toString().replace("{","").replace("}","");
-            resource.guid = g;
-            if (name == "active") {
+            QStringRef name = reader->name();
+            if (isNode(name, "active")) {
                 resource.active =  booleanValue();
-            }
-            if (name == "mime") {
+            } else if (isNode(name, "mime")) {
                 resource.mime = textValue();
-            }
-            if (name == "duration") {
+            } else if (isNode(name, "duration")) {
                 resource.duration = shortValue();
-            }
-            if (name == "height") {
+            } else if (isNode(name, "height")) {
                 resource.height = shortValue();
-            }
-            if (name == "width") {
+            } else if (isNode(name, "width")) {
                 resource.width = shortValue();
-            }
-            if (name == "data") {
-                Data d;
-                resource.data = d;
-                processData("Data", resource.data);
-            }
-            if (name == "alternate-data") {
-                Data d;
-                resource.alternateData = d;
-                processData("AlternateData", resource.data);
-            }
-            if (name == "recognition-data") {
-                Data d;
-                resource.recognition = d;
-                processData("RecognitionData", resource.recognition);
-            }
-            if (name == "resource-attributes") {
+            } else if (isNode(name, "data")) {
+                pipeline.readData(reader, DataDecoder::Base64, index, PendingData::Body);
+            } else if (isNode(name, "alternate-data")) {
+                pipeline.readData(reader, DataDecoder::Base64, index, PendingData::AlternateData);
+            } else if (isNode(name, "recognition-data")) {
+                pipeline.readData(reader, DataDecoder::Base64, index, PendingData::Recognition);
+            } else if (isNode(name, "resource-attributes")) {
                 ResourceAttributes ra;
                 resource.attributes = ra;
                 processResourceAttributes(resource.attributes);
             }
         }
         reader->readNext();
-        QString endName = reader->name().toString().toLower();
-        if (endName == "resource" && reader->isEndElement())
+        if (reader->isEndElement() && isNode(reader->name(), "resource"))
             atEnd = true;
     }
 }
 
 
 
-//***********************************************************
-//* Process any type of data node
-//***********************************************************
-void ImportEnex::processData(QString nodeName, Data &data) {
-    nodeName.toLower();
-
-    QString x = textValue();
-    QByteArray ba;
-    ba.append(x);
-    QByteArray bin = QByteArray::fromBase64(ba);
-    data.body.clear();
-    data.body = bin;
-    data.size = bin.length();
-
-    QCryptographicHash md5hash(QCryptographicHash::Md5);
-    QByteArray hash = md5hash.hash(bin, QCryptographicHash::Md5);
-    data.bodyHash = hash;
-}
-
-
-
 //***********************************************************
 //* Process a node that has the <noteresourceattribute>
 //***********************************************************
@@ -350,41 +322,31 @@ void ImportEnex::processResourceAttributes(ResourceAttributes &attributes) {
     bool atEnd = false;
     while(!atEnd) {
         if (reader->isStartElement()) {
-            QString name = reader->name().toString().toLower();
-            if (name == "camera-make") {
+            QStringRef name = reader->name();
+            if (isNode(name, "camera-make")) {
                 attributes.cameraMake = textValue();
-            }
-            if (name == "camera-model") {
+            } else if (isNode(name, "camera-model")) {
                 attributes.cameraModel = textValue();
-            }
-            if (name == "file-name") {
+            } else if (isNode(name, "file-name")) {
                 attributes.fileName = textValue();
-            }
-            if (name == "reco-type") {
+            } else if (isNode(name, "reco-type")) {
                 attributes.recoType = textValue();
-            }
-            if (name  == "source-url") {
+            } else if (isNode(name, "source-url")) {
                 attributes.sourceURL = textValue();
-            }
-            if (name == "altitude") {
+            } else if (isNode(name, "altitude")) {
                 attributes.altitude = doubleValue();
-            }
-            if (name == "longitude") {
+            } else if (isNode(name, "longitude")) {
                 attributes.longitude = doubleValue();
-            }
-            if (name == "altitude") {
+            } else if (isNode(name, "latitude")) {
                 attributes.latitude = doubleValue();
-            }
-            if (name == "timestamp") {
+            } else if (isNode(name, "timestamp")) {
                 attributes.timestamp = longValue();
-            }
-            if (name == "attachment") {
+            } else if (isNode(name, "attachment")) {
                 attributes.attachment = booleanValue();
             }
         }
         reader->readNext();
-        QString endName = reader->name().toString().toLower();
-        if (endName == "resource-attributes" && reader->isEndElement())
+        if (reader->isEndElement() && isNode(reader->name(), "resource-attributes"))
             atEnd = true;
     }
 }
@@ -398,35 +360,27 @@ void ImportEnex::processNoteAttributes(NoteAttributes &attributes) {
     bool atEnd = false;
     while(!atEnd) {
         if (reader->isStartElement()) {
-            QString name = reader->name().toString().toLower();
-            if (name == "author" && !reader->isEndElement()) {
+            QStringRef name = reader->name();
+            if (isNode(name, "author")) {
                 attributes.author = textValue();
-            }
-            if (name == "source-url" && !reader->isEndElement()) {
+            } else if (isNode(name, "source-url")) {
                 attributes.sourceURL = textValue();
-            }
-            if (name == "source" && !reader->isEndElement()) {
+            } else if (isNode(name, "source")) {
                 attributes.source = textValue();
-            }
-            if (name == "source-application" && !reader->isEndElement()) {
+            } else if (isNode(name, "source-application")) {
                 attributes.sourceApplication = textValue();
-            }
-            if (name == "altitude" && !reader->isEndElement()) {
+            } else if (isNode(name, "altitude")) {
                 attributes.altitude = doubleValue();
-            }
-            if (name == "longitude" && !reader->isEndElement()) {
+            } else if (isNode(name, "longitude")) {
                 attributes.longitude = doubleValue();
-            }
-            if (name == "latitude" && !reader->isEndElement()) {
+            } else if (isNode(name, "latitude")) {
                 attributes.latitude = doubleValue();
-            }
-            if (name == "subject-date" && !reader->isEndElement()) {
+            } else if (isNode(name, "subject-date")) {
                 attributes.subjectDate = datetimeValue();
             }
         }
         reader->readNext();
-        QString endName = reader->name().toString().toLower();
-        if (endName == "note-attributes" && reader->isEndElement())
+        if (reader->isEndElement() && isNode(reader->name(), "note-attributes"))
             atEnd = true;
     }
 
@@ -31,6 +31,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 
 #include "src/sql/notemetadata.h"
 #include "src/global.h"
+#include "src/xml/importpipeline.h"
 using namespace std;
 
 class ImportEnex : public QObject
@@ -39,15 +40,17 @@ class ImportEnex : public QObject
 
 private:
     void                        processNoteNode();
-    void                        processResource(Resource &resource);
+    void                        processResource(Resource &resource, qint32 index);
     void                        setNotebookGuid(QString g);
-    void                        processData(QString nodeName, Data &data);
+    void                        writeBatch();
+    void                        saveNote(Note &note);
     void                        processResourceAttributes(ResourceAttributes &attributes);
     void                        processNoteAttributes(NoteAttributes &attributes);
     QString                     fileName;
     QXmlStreamReader            *reader;
     QString                     notebookGuid;
     QProgressDialog             *progress;
+    ImportPipeline              pipeline;
 
     QHash<QString,QString>          noteMap;
     QHash<QString, NoteMetadata>    metaData;
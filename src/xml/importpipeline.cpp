@@ -0,0 +1,268 @@
+/*********************************************************************************
+NixNote - An open-source client for the Evernote service.
+Copyright (C) 2013 Randy Baumgarte
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+***********************************************************************************/
+
+#include "importpipeline.h"
+#include <QCryptographicHash>
+#include <QUuid>
+#include "src/utilities/metrics.h"
+#include "src/sql/resourcetable.h"
+
+
+DataDecoder::DataDecoder(QByteArray encoded, Encoding encoding, QSharedPointer<DecodedData> target) {
+    this->encoded = encoded;
+    this->encoding = encoding;
+    this->target = target;
+}
+
+
+void DataDecoder::run() {
+    if (encoding == Base64)
+        target->body = QByteArray::fromBase64(encoded);
+    else
+        target->body = QByteArray::fromHex(encoded);
+    encoded.clear();
+    target->hash = QCryptographicHash::hash(target->body, QCryptographicHash::Md5);
+    target->size = target->body.size();
+}
+
+
+
+ChunkDecoder::ChunkDecoder(DataDecoder::Encoding encoding, const QString &fileName) :
+    hash(QCryptographicHash::Md5) {
+    this->encoding = encoding;
+    size = 0;
+    if (fileName != "") {
+        file.setFileName(fileName);
+        if (!file.open(QIODevice::WriteOnly))
+            QLOG_ERROR() << "Unable to open " << fileName << ", decoding into memory";
+    }
+}
+
+
+void ChunkDecoder::write(const QByteArray &decoded) {
+    hash.addData(decoded);
+    size += decoded.size();
+    if (file.isOpen())
+        file.write(decoded);
+    else
+        body.append(decoded);
+}
+
+
+// Only whole groups (4 base64 or 2 hex characters) are decoded, the rest
+// waits for the next piece.  Line breaks & other filler are dropped first
+// so they don't upset the grouping.
+void ChunkDecoder::append(const QByteArray &encoded) {
+    carry.reserve(carry.size() + encoded.size());
+    for (int i=0; i<encoded.size(); i++) {
+        char c = encoded[i];
+        if ((c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') ||
+                (encoding == DataDecoder::Base64 && (c == '+' || c == '/' || c == '=')))
+            carry.append(c);
+    }
+    int group = encoding == DataDecoder::Base64 ? 4 : 2;
+    int whole = carry.size() - carry.size() % group;
+    if (whole == 0)
+        return;
+    QByteArray decoded = encoding == DataDecoder::Base64 ?
+                QByteArray::fromBase64(carry.left(whole)) : QByteArray::fromHex(carry.left(whole));
+    carry.remove(0, whole);
+    write(decoded);
+}
+
+
+void ChunkDecoder::finish(DecodedData &target) {
+    if (!carry.isEmpty()) {
+        QByteArray decoded = encoding == DataDecoder::Base64 ?
+                    QByteArray::fromBase64(carry) : QByteArray::fromHex(carry);
+        write(decoded);
+        carry.clear();
+    }
+    if (file.isOpen()) {
+        file.close();
+        target.file = file.fileName();
+    }
+    target.body = body;
+    target.hash = hash.result();
+    target.size = size;
+    body.clear();
+}
+
+
+
+
+ImportPipeline::ImportPipeline() {
+    pendingBytes = 0;
+    device = nullptr;
+    deviceSize = 0;
+    noteCount = 0;
+}
+
+
+ImportPipeline::~ImportPipeline() {
+    pool.waitForDone();
+    for (int i=0; i<streamedFiles.size(); i++)
+        QFile::remove(streamedFiles[i]);
+}
+
+
+void ImportPipeline::start(QIODevice *device) {
+    this->device = device;
+    deviceSize = device->size();
+    noteCount = 0;
+    clock.start();
+}
+
+
+// The reader is on the start element of the data node.  The text is
+// collected as Latin-1 (base64 & hex are plain ASCII), which is half the
+// size of the QString the reader would otherwise build.  Small bodies are
+// decoded on the pool; once a body gets large it is decoded piece by piece
+// as it is read, so the encoded text is never held whole.  A large resource
+// body is decoded straight into a file in dba, which the writer renames
+// into place.  The reader is left on the end element.
+void ImportPipeline::readData(QXmlStreamReader *reader, DataDecoder::Encoding encoding,
+                              qint32 resource, PendingData::Field field) {
+    PendingData pending;
+    pending.resource = resource;
+    pending.field = field;
+    pending.decoded = QSharedPointer<DecodedData>(new DecodedData());
+    current.append(pending);
+
+    QByteArray encoded;
+    QScopedPointer<ChunkDecoder> stream;
+    reader->readNext();
+    while (reader->isCharacters() && !reader->atEnd()) {
+        encoded.append(reader->text().toLatin1());
+        if (encoded.size() >= IMPORT_STREAM_DECODE_BYTES) {
+            if (stream.isNull()) {
+                QString fileName;
+                if (field == PendingData::Body) {
+                    fileName = global.fileManager.getDbaDirPath() + "import-" +
+                            QUuid::createUuid().toString().mid(1, 36) + ".tmp";
+                    streamedFiles.append(fileName);
+                }
+                stream.reset(new ChunkDecoder(encoding, fileName));
+            }
+            if (field != PendingData::Body)
+                pendingBytes += encoded.size();
+            stream->append(encoded);
+            encoded.clear();
+        }
+        reader->readNext();
+    }
+
+    if (stream.isNull() || field != PendingData::Body)
+        pendingBytes += encoded.size();
+    if (stream.isNull()) {
+        pool.start(new DataDecoder(encoded, encoding, pending.decoded));
+    } else {
+        stream->append(encoded);
+        stream->finish(*pending.decoded);
+    }
+}
+
+
+void ImportPipeline::addNote(const Note &note, bool dirty) {
+    PendingNote pending;
+    pending.note = note;
+    pending.dirty = dirty;
+    pending.data = current;
+    current.clear();
+    batch.append(pending);
+}
+
+
+bool ImportPipeline::batchFull() {
+    return batch.size() >= IMPORT_BATCH_NOTES || pendingBytes >= IMPORT_MAX_PENDING_BYTES;
+}
+
+
+// Wait for the decoders of the batch and copy their results into the notes
+QList<PendingNote> ImportPipeline::takeBatch() {
+    static MetricCounter *notes = Metrics::instance().counter("import.notes");
+    static MetricCounter *bytes = Metrics::instance().counter("import.resourceBytes");
+
+    pool.waitForDone();
+    QList<PendingNote> result;
+    result.swap(batch);
+    for (int i=0; i<result.size(); i++) {
+        PendingNote &p = result[i];
+        for (int j=0; j<p.data.size(); j++) {
+            const PendingData &d = p.data[j];
+            if (!p.note.resources.isSet() || d.resource >= p.note.resources.ref().size())
+                continue;
+            Data data;
+            if (d.decoded->file == "")
+                data.body = d.decoded->body;
+            else
+                p.bodyFiles.insert(d.resource, d.decoded->file);
+            data.bodyHash = d.decoded->hash;
+            data.size = d.decoded->size;
+            bytes->increment(d.decoded->size);
+
+            Resource &r = p.note.resources.ref()[d.resource];
+            if (d.field == PendingData::Body)
+                r.data = data;
+            else if (d.field == PendingData::AlternateData)
+                r.alternateData = data;
+            else
+                r.recognition = data;
+        }
+        p.data.clear();
+    }
+    noteCount += result.size();
+    notes->increment(result.size());
+    pendingBytes = 0;
+    return result;
+}
+
+
+// Once a note is added, move the bodies streamed to dba under the lids of
+// their resources.
+void ImportPipeline::adoptBodyFiles(const PendingNote &pending) {
+    if (pending.bodyFiles.isEmpty())
+        return;
+    ResourceTable resourceTable(global.db);
+    QList<Resource> resources = pending.note.resources;
+    QHash<qint32, QString>::const_iterator i;
+    for (i = pending.bodyFiles.constBegin(); i != pending.bodyFiles.constEnd(); ++i) {
+        const Resource &resource = resources[i.key()];
+        qint32 lid = resourceTable.getLid(QString(pending.note.guid), QString(resource.guid));
+        if (lid <= 0 || !resourceTable.adoptDataFile(lid, resource, i.value()))
+            QLOG_ERROR() << "Unable to store the body of resource " << QString(resource.guid);
+    }
+}
+
+
+qint32 ImportPipeline::progress() {
+    if (device == nullptr || deviceSize <= 0)
+        return 0;
+    return static_cast<qint32>(device->pos() * 1000 / deviceSize);
+}
+
+
+void ImportPipeline::logThroughput(const QString &what) {
+    qint64 elapsed = qMax(clock.elapsed(), static_cast<qint64>(1));
+    double mb = static_cast<double>(deviceSize) / (1024.0*1024.0);
+    QLOG_INFO() << what << ": " << noteCount << " notes, "
+                << QString::number(mb, 'f', 1) << " MB in " << elapsed << " ms ("
+                << QString::number(noteCount * 1000.0 / elapsed, 'f', 1) << " notes/sec, "
+                << QString::number(mb * 1000.0 / elapsed, 'f', 2) << " MB/sec)";
+}
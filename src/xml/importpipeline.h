@@ -0,0 +1,174 @@
+/*********************************************************************************
+NixNote - An open-source client for the Evernote service.
+Copyright (C) 2013 Randy Baumgarte
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+***********************************************************************************/
+
+
+//****************************************************
+//*  Shared plumbing of the ENEX & NNEX importers.
+//*  The XML is parsed once on the importing thread,
+//*  resource bodies are decoded & hashed on a worker
+//*  pool while parsing continues, and finished notes
+//*  are handed back in batches to be written in one
+//*  transaction each.
+//*****************************************************
+
+#ifndef IMPORTPIPELINE_H
+#define IMPORTPIPELINE_H
+
+#include <QRunnable>
+#include <QThreadPool>
+#include <QSharedPointer>
+#include <QXmlStreamReader>
+#include <QElapsedTimer>
+#include <QIODevice>
+#include <QFile>
+#include <QList>
+#include <QHash>
+#include <QStringList>
+#include <QCryptographicHash>
+
+#include "src/global.h"
+
+// Notes written per transaction
+#define IMPORT_BATCH_NOTES 100
+
+// Encoded resource data allowed in the pipeline before the batch is written.
+// Keeps memory bounded when the file holds large attachments.
+#define IMPORT_MAX_PENDING_BYTES (64*1024*1024)
+
+// Encoded text of a single data node collected before it is decoded while it
+// is being read, rather than as a whole on the pool.
+#define IMPORT_STREAM_DECODE_BYTES (4*1024*1024)
+
+
+// Case insensitive compare of the current node name without building a QString
+inline bool isNode(const QStringRef &name, const char *node) {
+    return name.compare(QLatin1String(node), Qt::CaseInsensitive) == 0;
+}
+
+
+// Result of decoding one data node
+class DecodedData
+{
+public:
+    QByteArray body;
+    QByteArray hash;
+    qint32 size;
+    QString file;       // set if the body was streamed to a file in dba instead
+
+    DecodedData() : size(0) {}
+};
+
+
+// Decode (base64 or hex) & hash one resource body on the import pool
+class DataDecoder : public QRunnable
+{
+public:
+    enum Encoding { Base64, Hex };
+
+    DataDecoder(QByteArray encoded, Encoding encoding, QSharedPointer<DecodedData> target);
+    void run();
+
+private:
+    QByteArray encoded;
+    Encoding encoding;
+    QSharedPointer<DecodedData> target;
+};
+
+
+// Decodes (base64 or hex) & hashes a body which arrives in pieces of any
+// size, so the encoded text never has to be held as a whole.  Given a file
+// name, the decoded body goes to that file rather than into memory.
+class ChunkDecoder
+{
+public:
+    explicit ChunkDecoder(DataDecoder::Encoding encoding, const QString &fileName = QString());
+    void append(const QByteArray &encoded);
+    void finish(DecodedData &target);
+
+private:
+    DataDecoder::Encoding encoding;
+    QByteArray carry;               // encoded characters not yet a whole group
+    QByteArray body;
+    QFile file;
+    qint32 size;
+    QCryptographicHash hash;
+
+    void write(const QByteArray &decoded);
+};
+
+
+// A resource body of a parsed note which is still being decoded
+class PendingData
+{
+public:
+    enum Field { Body, AlternateData, Recognition };
+
+    qint32 resource;        // index in note.resources
+    Field field;
+    QSharedPointer<DecodedData> decoded;
+};
+
+
+// A parsed note waiting to be written
+class PendingNote
+{
+public:
+    Note note;
+    bool dirty;
+    QList<PendingData> data;
+    QHash<qint32, QString> bodyFiles;   // resource index -> body streamed to dba
+};
+
+
+class ImportPipeline
+{
+private:
+    QThreadPool pool;
+    QList<PendingNote> batch;
+    QList<PendingData> current;     // data of the note being parsed
+    qint64 pendingBytes;
+    QStringList streamedFiles;      // removed unless a writer adopted them
+
+    QIODevice *device;
+    qint64 deviceSize;
+    QElapsedTimer clock;
+    qint64 noteCount;
+
+public:
+    ImportPipeline();
+    ~ImportPipeline();
+
+    void start(QIODevice *device);
+
+    // Read the text of the current node (which may arrive in several
+    // chunks) and queue it for decoding into a resource of the note
+    // currently being parsed.
+    void readData(QXmlStreamReader *reader, DataDecoder::Encoding encoding,
+                  qint32 resource, PendingData::Field field);
+
+    void addNote(const Note &note, bool dirty);
+    bool batchFull();
+    QList<PendingNote> takeBatch();     // waits for the decoders
+    void adoptBodyFiles(const PendingNote &pending);    // after the note is added
+
+    qint32 progress();                  // 0-1000, by position in the file
+    void logThroughput(const QString &what);
+};
+
+#endif // IMPORTPIPELINE_H
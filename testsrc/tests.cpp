@@ -3,12 +3,38 @@
 #include <QString>
 #include <QHash>
 #include <QPair>
+#include <QtSql>
 
 #include "tests.h"
 #include "../src/html/enmlformatter.h"
 #include "../src/logger/qslog.h"
 #include "../src/logger/qslogdest.h"
 #include "../src/utilities/NixnoteStringUtils.h"
+#include "../src/utilities/metrics.h"
+#include "../src/utilities/mimereference.h"
+#include "../src/filters/searchquery.h"
+#include "../src/sql/dataversion.h"
+#include "../src/filters/tagfilter.h"
+#include "../src/filters/filterengine.h"
+#include "../src/filters/filtercriteria.h"
+#include "../src/filters/resourcehits.h"
+#include "../src/filters/notesnippets.h"
+#include "../src/utilities/extractedtextcache.h"
+#include "../src/sql/resourcetable.h"
+#include "../src/sql/searchindextable.h"
+#include "../src/sql/databaseupgrade.h"
+#include "../src/sql/notetable.h"
+#include "../src/sql/tagtable.h"
+#include "../src/sql/configstore.h"
+#include "../src/models/notemodel.h"
+#include "../src/threads/fileremover.h"
+#include "../src/xml/importenex.h"
+#include "../src/xml/exportdata.h"
+#include "../src/xml/importdata.h"
+#include "../src/xml/backupmanifest.h"
+#include "../src/sql/notebooktable.h"
+#include "../src/global.h"
+#include "../src/quentier/utility/StringUtils.h"
 
 
 // ENML: https://dev.evernote.com/doc/articles/enml.php
@@ -19,12 +45,58 @@
 // note use string as params, not expressions
 #define QCOMPAREX(r1, r2) if (QString::compare(r1,r2) != 0) { QLOG_WARN() << "DIFF r1: " << r1 << ", r2: " << r2; } QCOMPARE(r1, r2);
 
+extern Global global;
+
 Tests::Tests(QObject *parent) :
         QObject(parent) {
 
 }
 
 
+FixtureAccount::FixtureAccount() : db(nullptr), valid(false) {
+    if (!dir.isValid())
+        return;
+
+    // FileManager::setup() insists on the read only program data directories
+    QDir root(dir.path());
+    root.mkpath("program/images");
+    root.mkpath("program/java");
+    root.mkpath("program/translations");
+    global.fileManager.setup(dir.path() + "/config", dir.path() + "/data", dir.path() + "/program");
+    global.fileManager.setupUserDirectories(1);
+
+    delete global.settings;
+    global.settings = new QSettings(dir.path() + "/config/" NN_CONFIG_FILE_PREFIX "-1.conf", QSettings::IniFormat);
+
+    // DatabaseConnection exits without FTS5 and the trigram tokenizer
+    {
+        QSqlDatabase check = QSqlDatabase::addDatabase("QSQLITE", "fixtureCheck");
+        check.setDatabaseName(":memory:");
+        bool supported = check.open() && SearchIndexTable::isSupported(check);
+        check.close();
+        check = QSqlDatabase();
+        QSqlDatabase::removeDatabase("fixtureCheck");
+        if (!supported)
+            return;
+    }
+
+    db = new DatabaseConnection(NN_DB_CONNECTION_NAME);
+
+    // The note list table is created by its model
+    NoteModel model(nullptr);
+    valid = true;
+}
+
+
+FixtureAccount::~FixtureAccount() {
+    delete db;
+    global.db = nullptr;
+    delete global.settings;
+    global.settings = nullptr;
+    QSqlDatabase::removeDatabase(NN_DB_CONNECTION_NAME);
+}
+
+
 QString Tests::formatToEnml(QString source) {
     bool guiAvailable = true;
     QHash<QString, QPair<QString, QString> > passwordSafe;
@@ -452,6 +524,1626 @@ void Tests::enmlHtmlSvgTest() {
 }
 
 
+// writes a fixed number of messages to a log destination
+class LogWriterThread : public QThread {
+public:
+    LogWriterThread(QsLogging::Destination *destination, int id, int count) :
+            destination(destination), id(id), count(count) {}
+
+protected:
+    void run() override {
+        for (int i = 0; i < count; i++) {
+            destination->write(QString("thread %1 message %2").arg(id).arg(i));
+        }
+    }
+
+private:
+    QsLogging::Destination *destination;
+    int id;
+    int count;
+};
+
+void Tests::asyncFileLogTest() {
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const int threads = 4;
+    const int count = 10000;   // more than the queue holds, so producers have to wait for the writer
+
+    {
+        QString path = dir.path() + "/messages.log";
+        QsLogging::DestinationPtr destination(QsLogging::DestinationFactory::MakeFileDestination(path));
+        QList<LogWriterThread *> writers;
+        for (int i = 0; i < threads; i++) {
+            writers.append(new LogWriterThread(destination.get(), i, count));
+            writers.last()->start();
+        }
+        for (int i = 0; i < threads; i++) {
+            writers[i]->wait();
+            delete writers[i];
+        }
+        destination->flush();
+
+        QStringList lines = readFile(path).split("\n", QString::SkipEmptyParts);
+        QCOMPARE(lines.size(), threads * count);
+        QVERIFY(lines.contains("thread 3 message 9999"));
+    }
+
+    {
+        // size based rotation
+        QString path = dir.path() + "/rotated.log";
+        QsLogging::DestinationPtr destination(QsLogging::DestinationFactory::MakeFileDestination(path, 1024, 2));
+        for (int i = 0; i < 1000; i++) {
+            destination->write(QString("rotated message %1").arg(i));
+            if (i % 100 == 0)
+                destination->flush();
+        }
+        destination->flush();
+        QVERIFY(QFile::exists(path + ".1"));
+        QVERIFY(QFile::exists(path + ".2"));
+        QVERIFY(!QFile::exists(path + ".3"));
+    }
+
+    {
+        // flush() only returns once the message is in the file
+        QString path = dir.path() + "/flushed.log";
+        QsLogging::DestinationPtr destination(QsLogging::DestinationFactory::MakeFileDestination(path));
+        for (int i = 0; i < 200; i++) {
+            destination->write(QString("flushed message %1").arg(i));
+            destination->flush();
+            QVERIFY(readFile(path).endsWith(QString("flushed message %1\n").arg(i)));
+        }
+    }
+}
+
+
+void Tests::metricsHistogramTest() {
+    MetricHistogram histogram;
+    QCOMPARE(histogram.percentile(0.5), 0LL);
+
+    // 1..1000 us, uniformly
+    for (int i = 1; i <= 1000; i++)
+        histogram.record(i);
+    QCOMPARE(histogram.getCount(), 1000LL);
+    QCOMPARE(histogram.getMax(), 1000LL);
+    QCOMPARE(histogram.getSum(), 500500LL);
+
+    // bucket resolution is a quarter of a power of two
+    qint64 p50 = histogram.percentile(0.50);
+    qint64 p95 = histogram.percentile(0.95);
+    qint64 p99 = histogram.percentile(0.99);
+    QVERIFY(p50 >= 500 && p50 < 500 * 5 / 4);
+    QVERIFY(p95 >= 950 && p95 <= 1000);
+    QVERIFY(p99 >= 990 && p99 <= 1000);
+    QVERIFY(p50 <= p95 && p95 <= p99);
+
+    MetricCounter *counter = Metrics::instance().counter("tests.counter");
+    QCOMPARE(Metrics::instance().counter("tests.counter"), counter);
+    counter->increment(3);
+    QJsonObject snapshot = Metrics::instance().snapshot();
+    QCOMPARE(snapshot["counters"].toObject()["tests.counter"].toInt(), 3);
+}
+
+
+// Tag rename on 50k notes all carrying the renamed tag (plus two others).
+// Drives TagTable::update(), which rebuilds the note list column of every
+// tagged note through NoteTable::rebuildNoteListTagsForNotes().
+void Tests::tagRenameBenchmark() {
+    const int noteCount = 50000;
+
+    FixtureAccount account;
+    QVERIFY(account.isValid());
+    bool enableIndexing = global.enableIndexing;
+    global.enableIndexing = true;     // leave the notes to the index thread
+
+    TagTable tagTable(global.db);
+    QStringList names;
+    names << "original" << "Zulu" << "alpha";
+    QList<Tag> tags;
+    QList<QString> tagGuids;
+    for (int i = 0; i < names.size(); i++) {
+        Tag tag;
+        tag.guid = QString("tag-%1").arg(i);
+        tag.name = names[i];
+        tagTable.add(0, tag, false, 0);
+        tags.append(tag);
+        tagGuids.append(tag.guid);
+    }
+
+    NoteTable noteTable(global.db);
+    bool transaction = global.db->conn.transaction();
+    for (int i = 0; i < noteCount; i++) {
+        Note note;
+        note.guid = QString("note-%1").arg(i);
+        note.title = QString("note %1").arg(i);
+        note.content = QString("<en-note>note %1</en-note>").arg(i);
+        note.tagGuids = tagGuids;
+        note.tagNames = names;
+        noteTable.add(0, note, false, 0);
+    }
+    if (transaction)
+        global.db->conn.commit();
+
+    QSqlQuery query(global.db->conn);
+    query.exec("select count(*) from NoteTable where tags='alpha, original, Zulu'");
+    QVERIFY(query.next());
+    QCOMPARE(query.value(0).toInt(), noteCount);
+
+    tags[0].name = QString("renamed");
+    QBENCHMARK_ONCE {
+        tagTable.update(tags[0], true);
+    }
+
+    query.exec("select count(*) from NoteTable where tags='alpha, renamed, Zulu'");
+    QVERIFY(query.next());
+    QCOMPARE(query.value(0).toInt(), noteCount);
+    query.finish();
+
+    global.enableIndexing = enableIndexing;
+}
+
+
+// MIME lookups as done by ResourceTable::getAllResources() for a note with
+// 200 attachments: one extension lookup per resource.
+void Tests::mimeReferenceBenchmark() {
+    QCOMPARE(MimeReference::getExtensionFromMime(QString("application/pdf"), QString("")), QString(".pdf"));
+    QCOMPARE(MimeReference::getExtensionFromMime(QString("image/png"), QString("scan.PNG")), QString(".png"));
+    QCOMPARE(MimeReference::getExtensionFromMime(QString("application/x-unknown"), QString("notes.TXT")), QString(".txt"));
+    QCOMPARE(MimeReference::getExtensionFromMime(QString("application/pdf"), QString("archive.zip")), QString(".zip"));
+    QCOMPARE(MimeReference::getMimeFromExtension(QString(".PDF")), QString("application/pdf"));
+    QCOMPARE(MimeReference::getMimeFromExtension(QString(".mp4")), QString("video/mp4"));
+    QCOMPARE(MimeReference::getMimeFromExtension(QString(".nope")), QString("application/data"));
+    QCOMPARE(MimeReference::getMimeFromFileName(QString("report.final.docx")),
+             QString("application/vnd.openxmlformats-officedocument.wordprocessingml.document"));
+
+    QStringList mimes;
+    mimes << "image/png" << "image/jpeg" << "application/pdf" << "audio/x-wav" << "application/zip";
+    QList<QPair<QString, QString> > resources;
+    for (int i = 0; i < 200; i++)
+        resources.append(qMakePair(mimes[i % mimes.size()], QString("attachment%1").arg(i)));
+
+    int found = 0;
+    QBENCHMARK {
+        found = 0;
+        for (int i = 0; i < resources.size(); i++) {
+            if (MimeReference::getExtensionFromMime(resources[i].first, resources[i].second) != "")
+                found++;
+        }
+    }
+    QCOMPARE(found, 200);
+}
+
+
+void MockNoteStore::send(qint32 lid) {
+    inFlight++;
+    maxInFlight = qMax(maxInFlight, inFlight);
+    QTimer::singleShot(lid % 3, this, [this, lid]() {
+        inFlight--;
+        if (networkFailures.remove(lid)) {
+            emit finished(lid, 0, Stop);
+        } else if (rejected.contains(lid)) {
+            emit finished(lid, 0, Failed);
+        } else {
+            stored.append(lid);
+            emit finished(lid, ++serverUsn, Uploaded);
+        }
+    });
+}
+
+
+// 50 notes, 3 in flight.  Note 7 is rejected by the server and the
+// connection drops on note 30; the second run resumes with what is left.
+void Tests::uploadPipelineTest() {
+    QList<qint32> lids;
+    for (int i = 1; i <= 50; i++)
+        lids.append(i);
+
+    MockNoteStore store(100);
+    store.rejected.insert(7);
+    store.networkFailures.insert(30);
+    UsnCheckpoint checkpoint(100);
+
+    UploadPipeline first(&store, &checkpoint, 3);
+    QList<qint32> remaining = first.run(lids);
+    QVERIFY(store.maxInFlight <= 3);
+    QVERIFY(!remaining.isEmpty());
+    QVERIFY(remaining.contains(30));
+    QVERIFY(first.failures >= 1);
+    QCOMPARE(checkpoint.value(), store.serverUsn);
+    QCOMPARE(first.maxUsn, store.serverUsn);
+
+    UploadPipeline second(&store, &checkpoint, 3);
+    QCOMPARE(second.run(remaining), QList<qint32>());
+    QCOMPARE(store.inFlight, 0);
+    QCOMPARE(store.stored.size(), 49);
+    QCOMPARE(store.stored.toSet().size(), 49);
+    QVERIFY(!store.stored.contains(7));
+    QCOMPARE(checkpoint.value(), 149);
+
+    // Out of order answers only move the mark once the gap is filled
+    UsnCheckpoint gap(10);
+    QVERIFY(!gap.add(12));
+    QVERIFY(!gap.add(13));
+    QCOMPARE(gap.value(), 10);
+    QVERIFY(gap.add(11));
+    QCOMPARE(gap.value(), 13);
+    QVERIFY(!gap.add(9));
+}
+
+
+// Fixture of 20k index rows in the old FTS4 layout and in the FTS5 word &
+// trigram layout of SearchIndexTable.  Compares the latency of the queries
+// FilterEngine runs for each class of search term; both must find the same rows.
+void Tests::searchIndexBenchmark() {
+    const int rowCount = 20000;
+    QStringList words;
+    words << "alpha" << "bravo" << "charlie" << "delta" << "echo" << "foxtrot" << "golf"
+          << "hotel" << "india" << "juliett" << "kilo" << "lima" << "mike" << "november";
+
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    {
+        QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE", "searchIndexBenchmark");
+        db.setDatabaseName(dir.path() + "/fixture.db");
+        QVERIFY(db.open());
+        QSqlQuery query(db);
+        if (!query.exec("Create virtual table OldIndex using fts4 (lid int, weight int, source text, content text)")
+                || !SearchIndexTable::isSupported(db))
+            QSKIP("SQLite is built without FTS4, FTS5 or the trigram tokenizer");
+        QVERIFY(SearchIndexTable::createTables(db));
+
+        db.transaction();
+        QSqlQuery oldInsert(db), insert(db), trigram(db);
+        oldInsert.prepare("insert into OldIndex (lid, weight, source, content) values (:lid, 100, 'text', :content)");
+        insert.prepare("insert into SearchIndex (lid, weight, source, content) values (:lid, 100, 'text', :content)");
+        trigram.prepare("insert into SearchIndexTrigram (rowid, content) values (:rowid, :content)");
+        quint32 seed = 12345;
+        for (int lid = 1; lid <= rowCount; lid++) {
+            QStringList content;
+            for (int w = 0; w < 40; w++) {
+                seed = seed * 1103515245 + 12345;
+                content.append(words[(seed >> 16) % words.size()]);
+            }
+            if (lid % 97 == 0)
+                content.append(QString("id_%1").arg(lid % 1000));
+            if (lid % 89 == 0)
+                content.append("x-ray");
+            if (lid % 53 == 0)
+                content.append("zephyrus");
+            oldInsert.bindValue(":lid", lid);
+            oldInsert.bindValue(":content", content.join(" "));
+            oldInsert.exec();
+            insert.bindValue(":lid", lid);
+            insert.bindValue(":content", content.join(" "));
+            insert.exec();
+            trigram.bindValue(":rowid", insert.lastInsertId());
+            trigram.bindValue(":content", content.join(" "));
+            trigram.exec();
+        }
+        db.commit();
+
+        // term class, old query, new query
+        QList<QStringList> cases;
+        cases << (QStringList() << "word" << "select lid from OldIndex where content match 'zeph*'"
+                  << "select lid from SearchIndex where content match '\"zeph\" *'");
+        cases << (QStringList() << "postfix" << "select lid from OldIndex where content like '%phyru%'"
+                  << "select lid from SearchIndex where rowid in (select rowid from SearchIndexTrigram where "
+                     "SearchIndexTrigram match '\"phyru\"') and content like '%phyru%'");
+        cases << (QStringList() << "underscore" << "select lid from OldIndex where content like '%id/_97%' escape '/'"
+                  << "select lid from SearchIndex where rowid in (select rowid from SearchIndexTrigram where "
+                     "SearchIndexTrigram match '\"id_97\"') and content like '%id/_97%' escape '/'");
+        cases << (QStringList() << "hyphen" << "select lid from OldIndex where content like '%x-ray%'"
+                  << "select lid from SearchIndex where rowid in (select rowid from SearchIndexTrigram where "
+                     "SearchIndexTrigram match '\"x-ray\"') and content like '%x-ray%'");
+
+        for (int i = 0; i < cases.size(); i++) {
+            QSet<qint32> oldLids, newLids;
+            QElapsedTimer timer;
+            timer.start();
+            QVERIFY(query.exec(cases[i][1]));
+            while (query.next())
+                oldLids.insert(query.value(0).toInt());
+            qint64 oldTime = timer.nsecsElapsed();
+            timer.restart();
+            QVERIFY(query.exec(cases[i][2]));
+            while (query.next())
+                newLids.insert(query.value(0).toInt());
+            qint64 newTime = timer.nsecsElapsed();
+            qDebug() << cases[i][0] << ": FTS4" << oldTime / 1000 << "us, FTS5" << newTime / 1000 << "us,"
+                     << newLids.size() << "rows";
+            QVERIFY(!oldLids.isEmpty());
+            QCOMPARE(newLids, oldLids);
+        }
+        query.finish();
+        db.close();
+    }
+    QSqlDatabase::removeDatabase("searchIndexBenchmark");
+}
+
+
+// Compiles representative search strings with SearchQuery and runs them over
+// a 20k note fixture laid out like DataStore, NoteTable & the search index.
+void Tests::searchQueryBenchmark() {
+    const int noteCount = 20000;
+
+    SearchQuery parsed(QStringList() << "notebook:work" << "-draft" << "meeting" << "*voice" << "-old" << "created:day", 20);
+    parsed.optimize();
+    QCOMPARE(parsed.others, QStringList() << "created:day");
+    QCOMPARE(parsed.terms.size(), 4);
+    QCOMPARE(parsed.terms[0].type, SearchTerm::Notebook);
+    QCOMPARE(parsed.terms[1].match, QString("(\"draft\" *) OR (\"old\" *)"));
+    QCOMPARE(parsed.terms[3].type, SearchTerm::Substring);
+    QCOMPARE(parsed.terms[3].match, QString("\"voice\""));
+    QCOMPARE(SearchQuery::substringExpression("*ab*_x_y"), QString("\"_x_y\""));
+
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    {
+        QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE", "searchQueryBenchmark");
+        db.setDatabaseName(dir.path() + "/fixture.db");
+        QVERIFY(db.open());
+        QSqlQuery query(db);
+        query.exec("Create table DataStore (lid integer, key integer, data blob default null collate nocase)");
+        query.exec("CREATE INDEX DataStore_Lid on DataStore (lid)");
+        query.exec("CREATE INDEX DataStore_Key on DataStore (key)");
+        query.exec("Create table NoteTable (lid integer, notebook text)");
+        query.exec("Create table filter (lid integer, relevance real)");
+        if (!SearchIndexTable::isSupported(db))
+            QSKIP("SQLite is built without FTS5 or the trigram tokenizer");
+        QVERIFY(SearchIndexTable::createTables(db));
+
+        db.transaction();
+        QSqlQuery note(db), data(db), index(db), trigram(db);
+        note.prepare("insert into NoteTable (lid, notebook) values (:lid, :notebook)");
+        data.prepare("insert into DataStore (lid, key, data) values (:lid, :key, :data)");
+        index.prepare("insert into SearchIndex (lid, weight, source, content) values (:lid, 100, :source, :content)");
+        trigram.prepare("insert into SearchIndexTrigram (rowid, content) values (:rowid, :content)");
+        auto addIndex = [&](int lid, const QString &source, const QString &content) {
+            index.bindValue(":lid", lid);
+            index.bindValue(":source", source);
+            index.bindValue(":content", content);
+            index.exec();
+            trigram.bindValue(":rowid", index.lastInsertId());
+            trigram.bindValue(":content", content);
+            trigram.exec();
+        };
+        auto addData = [&](int lid, int key, const QVariant &value) {
+            data.bindValue(":lid", lid);
+            data.bindValue(":key", key);
+            data.bindValue(":data", value);
+            data.exec();
+        };
+        addData(1, TAG_NAME, "project-a");
+        addData(2, TAG_NAME, "Important");
+        for (int lid = 100; lid < 100 + noteCount; lid++) {
+            note.bindValue(":lid", lid);
+            note.bindValue(":notebook", lid % 3 == 0 ? "Work" : "Home");
+            note.exec();
+            QString content = QString("note %1 alpha bravo").arg(lid);
+            if (lid % 7 == 0)
+                content += " meeting";
+            if (lid % 14 == 0)
+                content += " draft";
+            if (lid % 11 == 0)
+                content += " budget_2019";
+            addIndex(lid, "text", content);
+            addData(lid, NOTE_TITLE, lid % 50 == 0 ? "Meeting report" : "Note");
+            if (lid % 10 == 0)
+                addData(lid, NOTE_TAG_LID, 1);
+            if (lid % 100 == 0)
+                addData(lid, NOTE_TAG_LID, 2);
+            if (lid % 20 == 0) {
+                addData(lid + noteCount * 10, RESOURCE_NOTE_LID, lid);
+                addIndex(lid + noteCount * 10, "recognition", "scanned invoice");
+            }
+        }
+        db.commit();
+
+        QList<QStringList> searches;
+        searches << (QStringList() << "meeting");
+        searches << (QStringList() << "notebook:Work" << "meeting" << "-draft");
+        searches << (QStringList() << "tag:project*" << "*voice");
+        searches << (QStringList() << "any:" << "intitle:report" << "-meeting" << "draft");
+        searches << (QStringList() << "budget_2019" << "-tag:important" << "alpha");
+
+        QList<int> counts;
+        QBENCHMARK {
+            counts.clear();
+            for (int i = 0; i < searches.size(); i++) {
+                query.exec("delete from filter");
+                query.exec("insert into filter (lid, relevance) select lid, 0 from NoteTable");
+                SearchQuery search(searches[i], 20);
+                search.optimize();
+                QSqlQuery run(db);
+                run.prepare("select count(*) from (" + search.sql() + ")");
+                search.bindValues(run);
+                QVERIFY(run.exec() && run.next());
+                counts.append(run.value(0).toInt());
+            }
+        }
+
+        int meeting = 0, workMeeting = 0, taggedInvoice = 0, anyOf = 0, budget = 0;
+        for (int lid = 100; lid < 100 + noteCount; lid++) {
+            meeting += lid % 7 == 0;
+            workMeeting += lid % 3 == 0 && lid % 7 == 0 && lid % 14 != 0;
+            taggedInvoice += lid % 20 == 0;
+            anyOf += lid % 50 == 0 || lid % 7 != 0 || lid % 14 == 0;
+            budget += lid % 11 == 0 && lid % 100 != 0;
+        }
+        QCOMPARE(counts[0], meeting);
+        QCOMPARE(counts[1], workMeeting);
+        QCOMPARE(counts[2], taggedInvoice);
+        QCOMPARE(counts[3], anyOf);
+        QCOMPARE(counts[4], budget);
+
+        // "meeting" over the results of "meet" finds the same notes
+        SearchQuery shorter(QStringList() << "meet", 20);
+        query.prepare("create temp table liveResult as select lid, 0 as relevance from (" + shorter.sql() + ")");
+        shorter.bindValues(query);
+        QVERIFY(query.exec());
+        QVERIFY(SearchQuery::narrows(QStringList() << "meet", QStringList() << "meeting"));
+        SearchQuery longer(QStringList() << "meeting", 20);
+        longer.table = "liveResult";
+        query.prepare("select count(*) from (" + longer.sql() + ")");
+        longer.bindValues(query);
+        QVERIFY(query.exec() && query.next());
+        QCOMPARE(query.value(0).toInt(), meeting);
+
+        // 2100 has the word in its title & is tagged important, 2107 only has
+        // it in the text, which is shorter than the text of 2114
+        SearchQuery relevance(QStringList() << "meeting", 20);
+        query.prepare("select lid, relevance, hit from (" + relevance.sql() + ") where lid in (2100, 2107, 2114)");
+        relevance.bindValues(query);
+        QVERIFY(query.exec());
+        QHash<int, double> scores;
+        QHash<int, bool> hits;
+        while (query.next()) {
+            scores.insert(query.value(0).toInt(), query.value(1).toDouble());
+            hits.insert(query.value(0).toInt(), query.value(2).toBool());
+        }
+        QCOMPARE(scores.size(), 3);
+
+        // Only the title hit is flagged, whatever the text scored
+        QVERIFY(hits[2100]);
+        QVERIFY(!hits[2107]);
+        QVERIFY(!hits[2114]);
+        QVERIFY(scores[2100] > scores[2107] + SEARCH_BOOST_TITLE + SEARCH_BOOST_IMPORTANT - 1);
+        QVERIFY(scores[2107] > scores[2114]);
+        QVERIFY(scores[2114] > 0);
+        QVERIFY(!relevance.explain(db).isEmpty());
+        query.finish();
+        db.close();
+    }
+    QSqlDatabase::removeDatabase("searchQueryBenchmark");
+}
+
+
+
+// The folding before it was table driven (a search of the letter table for
+// every character), with the mark after a removed mark no longer skipped.
+static void removeDiacriticsReference(QString &str) {
+    static const QString letters = QString::fromUtf8("ŠŒŽšœžŸ¥µÀÁÂÃÄÅÆÇÈÉÊËÌÍÎÏÐÑÒÓÔÕÖØÙÚÛÜÝßàáâãäåæçèéêëìíîïðñòóôõöøùúûüýÿ");
+    static const QStringList replacements = QString("S OE Z s oe z Y Y u A A A A A A AE C E E E E I I I I D N O O O O O O "
+                                                    "U U U U Y s a a a a a a ae c e e e e i i i i o n o o o o o o "
+                                                    "u u u u y y").split(" ");
+    str = str.normalized(QString::NormalizationForm_KD);
+    for (int i = 0; i < str.length(); ++i) {
+        QChar::Category category = str[i].category();
+        if (category == QChar::Mark_NonSpacing || category == QChar::Mark_SpacingCombining ||
+                category == QChar::Mark_Enclosing) {
+            str.remove(i--, 1);
+            continue;
+        }
+        int index = letters.indexOf(str[i]);
+        if (index >= 0)
+            str.replace(i, 1, replacements[index]);
+    }
+}
+
+
+void Tests::diacriticFoldingBenchmark() {
+    quentier::StringUtils stringUtils;
+    QString folded = QString::fromUtf8("Crème Brûlée, Œuvre, Straße, Ærø, ﬁnal µ 日本");
+    stringUtils.removeDiacritics(folded);
+    QCOMPARE(folded, QString::fromUtf8("Creme Brulee, OEuvre, Strase, AEro, final μ 日本"));
+
+    // Random strings of plain, accented & table letters, combining marks,
+    // compatibility characters, other scripts & surrogate pairs
+    QString alphabet = QString::fromUtf8("abcXYZ 09.,ŠŒšœŸµÀÅÆÇÐÑØßàåæçðñøÿāĉĎęĞıĲŁŉŐœŕŠŧŮŷžǅǄ"
+                                         "ΆΐάϓЁйӒ ﬁﬀ①㎏ｶ日本語한국");
+    for (ushort mark = 0x300; mark < 0x370; mark += 7)
+        alphabet.append(QChar(mark));
+    alphabet.append(QChar(0x20DD));     // enclosing circle
+    alphabet.append(QChar(0x0903));     // spacing combining mark
+    quint32 seed = 4242;
+    for (int i = 0; i < 2000; i++) {
+        QString input;
+        seed = seed * 1103515245 + 12345;
+        int length = (seed >> 16) % 40;
+        for (int j = 0; j < length; j++) {
+            seed = seed * 1103515245 + 12345;
+            int pick = (seed >> 16) % (alphabet.size() + 1);
+            if (pick == alphabet.size())
+                input.append(QString::fromUtf8("😀"));
+            else
+                input.append(alphabet[pick]);
+        }
+        QString expected = input;
+        removeDiacriticsReference(expected);
+        QString actual = input;
+        stringUtils.removeDiacritics(actual);
+        QCOMPARE(actual, expected);
+    }
+
+    // 10 MB of text (5M UTF-16 characters)
+    QString paragraph = QString::fromUtf8("Le cœur déçu mais l'âme plutôt naïve, Louÿs rêva de crapaüter en canoë "
+                                          "au delà des îles, près du mälström où brûlent les novæ. "
+                                          "Plain ASCII text makes up most of a typical note body. ");
+    QString text;
+    text.reserve(5 * 1024 * 1024 + paragraph.size());
+    while (text.size() < 5 * 1024 * 1024)
+        text.append(paragraph);
+
+    QString result;
+    QBENCHMARK {
+        result = text;
+        stringUtils.removeDiacritics(result);
+    }
+    QVERIFY(result.contains("Le coeur decu mais l'ame plutot naive, Louys reva"));
+    QVERIFY(result.size() > text.size());
+}
+
+
+void Tests::searchQueryNarrowsTest() {
+    QStringList meet = QStringList() << "meet";
+    QVERIFY(SearchQuery::narrows(meet, QStringList() << "meeting"));
+    QVERIFY(SearchQuery::narrows(meet, QStringList() << "meet" << "notes"));
+    QVERIFY(SearchQuery::narrows(meet, QStringList() << "meet" << "-draft"));
+    QVERIFY(SearchQuery::narrows(QStringList() << "*voi", QStringList() << "*voice"));
+    QVERIFY(SearchQuery::narrows(QStringList() << "tag:work" << "bud", QStringList() << "tag:work" << "budget"));
+    QVERIFY(!SearchQuery::narrows(QStringList(), meet));
+    QVERIFY(!SearchQuery::narrows(QStringList() << "meeting", meet));
+    QVERIFY(!SearchQuery::narrows(QStringList() << "meet" << "notes", meet));
+    QVERIFY(!SearchQuery::narrows(QStringList() << "-dr", QStringList() << "-draft"));
+    QVERIFY(!SearchQuery::narrows(QStringList() << "tag:wo", QStringList() << "tag:work"));
+    QVERIFY(!SearchQuery::narrows(QStringList() << "tag", QStringList() << "tag:work"));
+    QVERIFY(!SearchQuery::narrows(QStringList() << "x", QStringList() << "x-ray"));
+    QVERIFY(!SearchQuery::narrows(QStringList() << "any:" << "meet", QStringList() << "any:" << "meeting"));
+    QVERIFY(!SearchQuery::narrows(QStringList() << "meet" << "bud", QStringList() << "meeting" << "bud"));
+}
+
+// Writes of either connection change the version, reads & the settled
+// writes of the connection itself don't.
+void Tests::dataVersionTest() {
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    {
+        QSqlDatabase a = QSqlDatabase::addDatabase("QSQLITE", "dataVersionA");
+        a.setDatabaseName(dir.path() + "/version.db");
+        QVERIFY(a.open());
+        QSqlDatabase b = QSqlDatabase::addDatabase("QSQLITE", "dataVersionB");
+        b.setDatabaseName(dir.path() + "/version.db");
+        QVERIFY(b.open());
+        QSqlQuery queryA(a), queryB(b);
+        QVERIFY(queryA.exec("create table DataStore (lid integer, key integer, data blob)"));
+        QVERIFY(queryA.exec("create temp table scratch (lid integer)"));
+
+        DataVersion version;
+        qint64 start = version.current(a);
+        QCOMPARE(version.current(a), start);
+        QVERIFY(queryB.exec("select count(*) from DataStore"));
+        queryB.finish();
+        QCOMPARE(version.current(a), start);
+
+        QVERIFY(queryA.exec("insert into scratch (lid) values (1)"));
+        version.settle(a);
+        QCOMPARE(version.current(a), start);
+
+        QVERIFY(queryA.exec("insert into DataStore (lid, key, data) values (1, 5001, 'title')"));
+        QVERIFY(version.current(a) > start);
+        start = version.current(a);
+
+        QVERIFY(queryB.exec("update DataStore set data='other' where lid=1"));
+        QVERIFY(version.current(a) > start);
+        start = version.current(a);
+
+        // A commit of the other connection isn't hidden by settle()
+        QVERIFY(queryB.exec("delete from DataStore"));
+        version.settle(a);
+        QVERIFY(version.current(a) > start);
+    }
+    QSqlDatabase::removeDatabase("dataVersionA");
+    QSqlDatabase::removeDatabase("dataVersionB");
+}
+
+// 5 tags selected over 20k notes, filtered by the single statement of
+// TagFilter in each mode.  Tag 6 is under tag 5 & tag 7 under tag 6.
+void Tests::tagFilterBenchmark() {
+    const int noteCount = 20000;
+
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    {
+        QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE", "tagFilterBenchmark");
+        db.setDatabaseName(dir.path() + "/fixture.db");
+        QVERIFY(db.open());
+        QSqlQuery query(db);
+        query.exec("Create table DataStore (lid integer, key integer, data blob default null collate nocase)");
+        query.exec("CREATE INDEX DataStore_Lid on DataStore (lid)");
+        query.exec("CREATE INDEX DataStore_Key on DataStore (key)");
+        query.exec("Create table filter (lid integer, relevance real)");
+
+        // Note n has tag t when n is a multiple of t+1
+        QHash<qint32, QSet<qint32> > noteTags;
+        db.transaction();
+        query.prepare("insert into DataStore (lid, key, data) values (:lid, :key, :data)");
+        for (int t = 6; t <= 7; t++) {
+            query.bindValue(":lid", t);
+            query.bindValue(":key", TAG_PARENT_LID);
+            query.bindValue(":data", t - 1);
+            query.exec();
+        }
+        for (int lid = 100; lid < 100 + noteCount; lid++) {
+            for (int t = 1; t <= 7; t++) {
+                if (lid % (t + 1) != 0)
+                    continue;
+                noteTags[lid].insert(t);
+                query.bindValue(":lid", lid);
+                query.bindValue(":key", NOTE_TAG_LID);
+                query.bindValue(":data", t);
+                query.exec();
+            }
+        }
+        db.commit();
+
+        QList<qint32> selected;
+        selected << 1 << 2 << 3 << 4 << 5;
+        auto expected = [&](bool any, bool children) {
+            QSet<qint32> result;
+            for (auto i = noteTags.constBegin(); i != noteTags.constEnd(); ++i) {
+                int found = 0;
+                for (int j = 0; j < selected.size(); j++) {
+                    bool has = i.value().contains(selected[j]);
+                    if (children && selected[j] == 5)
+                        has = has || i.value().contains(6) || i.value().contains(7);
+                    if (has)
+                        found++;
+                }
+                if (any ? found > 0 : found == selected.size())
+                    result.insert(i.key());
+            }
+            return result;
+        };
+        auto reset = [&]() {
+            query.exec("delete from filter");
+            query.prepare("insert into filter (lid, relevance) values (:lid, 0)");
+            db.transaction();
+            for (int lid = 100; lid < 100 + noteCount; lid++) {
+                query.bindValue(":lid", lid);
+                query.exec();
+            }
+            db.commit();
+        };
+        auto filtered = [&]() {
+            QSet<qint32> result;
+            query.exec("select lid from filter");
+            while (query.next())
+                result.insert(query.value(0).toInt());
+            return result;
+        };
+
+        QElapsedTimer timer;
+        for (int mode = 0; mode < 4; mode++) {
+            bool any = mode < 2;
+            bool children = mode % 2 == 1;
+            reset();
+            TagFilter tagFilter(selected, any, children);
+            timer.start();
+            QVERIFY(query.exec("delete from filter where lid not in (" + tagFilter.sql() + ")"));
+            qint64 sqlTime = timer.elapsed();
+            QSet<qint32> result = filtered();
+            QCOMPARE(result, expected(any, children));
+            qDebug() << (any ? "any" : "all") << (children ? "with children:" : ":") << result.size()
+                     << "notes in" << sqlTime << "ms";
+        }
+        QVERIFY(expected(false, true).size() > expected(false, false).size());
+
+        query.finish();
+        db.close();
+    }
+    QSqlDatabase::removeDatabase("tagFilterBenchmark");
+}
+
+// Hits in a three page PDF and in the file name of the resource, found with
+// one statement and placed on their page.
+void Tests::resourceHitsTest() {
+    QList<qint32> pageOffsets;
+    pageOffsets << 0 << 10 << 25;
+    QCOMPARE(ResourceHits::page(pageOffsets, 0), 0);
+    QCOMPARE(ResourceHits::page(pageOffsets, 9), 0);
+    QCOMPARE(ResourceHits::page(pageOffsets, 10), 1);
+    QCOMPARE(ResourceHits::page(pageOffsets, 400), 2);
+    QCOMPARE(ResourceHits::page(QList<qint32>(), 5), -1);
+
+    FixtureAccount account;
+    QVERIFY(account.isValid());
+    SearchIndexTable index(global.db);
+
+    QStringList pages;
+    pages << "Agenda for the Meeting" << "Budget review" << "X-ray results, next meeting";
+    QString text;
+    pageOffsets.clear();
+    for (int i = 0; i < pages.size(); i++) {
+        pageOffsets.append(text.length());
+        text += pages[i] + " ";
+    }
+    index.add(7, 100, "attachment", text);
+    index.add(7, 100, "recognition", "meeting.pdf");
+    index.add(8, 100, "attachment", "budget meeting");
+
+    ResourceHits hits(QStringList() << "meet" << "*ray" << "-budget" << "tag:work", 20);
+    QVERIFY(!hits.isEmpty());
+    QSqlQuery query(global.db->conn);
+    query.prepare(hits.sql());
+    hits.bindValues(query, 7);
+    QVERIFY(query.exec());
+    while (query.next())
+        hits.addRow(query.value(0).toInt(), query.value(2).toString(),
+                    query.value(1).toString() == "attachment" ? pageOffsets : QList<qint32>());
+    query.finish();
+
+    QStringList found;
+    for (int i = 0; i < hits.hits.size(); i++)
+        found.append(QString("%1:%2:%3").arg(hits.hits[i].page).arg(hits.hits[i].offset).arg(hits.hits[i].text));
+    found.sort();
+    QCOMPARE(found, QStringList() << "-1:0:meeting" << "0:15:Meeting" << "2:20:meeting" << "2:2:ray");
+    QVERIFY(ResourceHits(QStringList() << "-budget" << "notebook:x", 20).isEmpty());
+}
+
+void Tests::noteSnippetsTest() {
+    FixtureAccount account;
+    QVERIFY(account.isValid());
+    SearchIndexTable index(global.db);
+
+    // notes 1 & 2, resource 10 of note 2, note 3 without a hit & note 4
+    // which isn't asked for
+    index.add(1, 100, "text", "The quarterly meeting is about the budget and the plans for next year");
+    index.add(2, 100, "text", "Nothing to see");
+    index.add(10, 100, "attachment", "Minutes of the board meeting");
+    index.add(3, 100, "text", "Holiday pictures");
+    index.add(4, 100, "text", "Another budget meeting");
+    QSqlQuery query(global.db->conn);
+    query.prepare("insert into DataStore (lid, key, data) values (10, :key, 2)");
+    query.bindValue(":key", RESOURCE_NOTE_LID);
+    QVERIFY(query.exec());
+
+    NoteSnippets snippets(QStringList() << "meet" << "budget" << "-holiday" << "*board*", 20);
+    QVERIFY(!snippets.isEmpty());
+    QList<qint32> lids;
+    lids << 1 << 2 << 3;
+    query.prepare(snippets.sql(lids.size()));
+    snippets.bindValues(query, lids);
+    QVERIFY(query.exec());
+    QHash<qint32, QString> found;
+    while (query.next()) {
+        if (!found.contains(query.value(0).toInt()))
+            found.insert(query.value(0).toInt(), query.value(1).toString());
+    }
+    query.finish();
+    QCOMPARE(found.size(), 2);
+    QVERIFY(found[1].contains(QString(HIT_OPEN) + "budget" + QString(HIT_CLOSE)));
+    QCOMPARE(NoteSnippets::plainText(found[2]), QString("Minutes of the board meeting"));
+    QVERIFY(NoteSnippets(QStringList() << "*board*" << "tag:work", 20).isEmpty());
+}
+
+
+void Tests::extractedTextCacheTest() {
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    ExtractedTextCache cache(dir.path() + "/");
+    QByteArray hash = QByteArray::fromHex("0123456789abcdef0123456789abcdef");
+    QStringList pages;
+    pages << "Première page" << "" << "Third page\nwith two lines";
+
+    QStringList found;
+    QVERIFY(!cache.get(hash, found));
+    cache.put(hash, pages);
+    QVERIFY(QFile::exists(dir.path() + "/0123456789abcdef0123456789abcdef.txt"));
+    QVERIFY(cache.get(hash, found));
+    QCOMPARE(found, pages);
+
+    // nothing is kept without a hash, and a damaged file is a miss
+    cache.put(QByteArray(), pages);
+    QVERIFY(!cache.get(QByteArray(), found));
+    QFile file(dir.path() + "/0123456789abcdef0123456789abcdef.txt");
+    QVERIFY(file.open(QIODevice::WriteOnly));
+    file.write(QByteArray("\0\0\0\x10not zlib data", 17));
+    file.close();
+    QVERIFY(!cache.get(hash, found));
+    QVERIFY(found.isEmpty());
+}
+
+
+
+// Empty a trash of 20 notes with two attachments each.  The rows go, and so
+// do the files named after each resource's mime type, without touching others.
+// Extracted text goes with the last resource of its data: the image is also
+// attached to a note which stays.
+void Tests::trashExpungeTest() {
+    const int noteCount = 20;
+
+    FixtureAccount account;
+    QVERIFY(account.isValid());
+    bool enableIndexing = global.enableIndexing;
+    global.enableIndexing = true;
+
+    NoteTable noteTable(global.db);
+    ResourceTable resourceTable(global.db);
+    QString dbaDir = global.fileManager.getDbaDirPath();
+    QString thumbnailDir = global.fileManager.getThumbnailDirPath();
+    QStringList files;
+    for (int i = 0; i < noteCount; i++) {
+        Note note;
+        note.guid = QString("note-%1").arg(i);
+        note.title = QString("note %1").arg(i);
+        note.content = QString("<en-note/>");
+        QList<Resource> resources;
+        for (int j = 0; j < 2; j++) {
+            Data data;
+            data.body = QByteArray(j == 0 ? "body" : "image");
+            data.size = data.body.ref().size();
+            data.bodyHash = QCryptographicHash::hash(data.body.ref(), QCryptographicHash::Md5);
+            Resource resource;
+            resource.guid = QString("resource-%1-%2").arg(i).arg(j);
+            resource.noteGuid = note.guid;
+            resource.mime = QString(j == 0 ? "application/pdf" : "image/png");
+            resource.data = data;
+            resources.append(resource);
+        }
+        note.resources = resources;
+        qint32 lid = noteTable.add(0, note, false, 0);
+        noteTable.deleteNote(lid, false);
+
+        // The files under their mime extensions, plus an ink image
+        QList<qint32> resLids;
+        resourceTable.getResourceList(resLids, lid);
+        QCOMPARE(resLids.size(), 2);
+        files << dbaDir + QString::number(resLids[0]) + ".pdf"
+              << dbaDir + QString::number(resLids[0]) + ".png"
+              << dbaDir + QString::number(resLids[1]) + ".png"
+              << thumbnailDir + QString::number(lid) + ".png";
+    }
+    Data image;
+    image.body = QByteArray("image");
+    image.size = 5;
+    image.bodyHash = QCryptographicHash::hash(image.body.ref(), QCryptographicHash::Md5);
+    Resource kept;
+    kept.guid = QString("resource-kept");
+    kept.noteGuid = QString("note-kept");
+    kept.mime = QString("image/png");
+    kept.data = image;
+    Note keptNote;
+    keptNote.guid = QString("note-kept");
+    keptNote.title = QString("kept");
+    keptNote.content = QString("<en-note/>");
+    keptNote.resources = QList<Resource>() << kept;
+    noteTable.add(0, keptNote, false, 0);
+
+    ExtractedTextCache textCache(global.fileManager.getTextCacheDirPath(""));
+    textCache.put(QCryptographicHash::hash(QByteArray("body"), QCryptographicHash::Md5), QStringList() << "body");
+    textCache.put(image.bodyHash, QStringList() << "image");
+    files << textCache.fileName(QCryptographicHash::hash(QByteArray("body"), QCryptographicHash::Md5));
+    QString sharedText = textCache.fileName(image.bodyHash);
+    QVERIFY(QFile::exists(sharedText));
+    QString unrelated = dbaDir + "999999.pdf";
+    for (int i = 0; i < files.size(); i++) {
+        QFile file(files[i]);
+        QVERIFY(file.open(QIODevice::WriteOnly));
+        file.write("file");
+    }
+    QFile file(unrelated);
+    QVERIFY(file.open(QIODevice::WriteOnly));
+    file.close();
+
+    QList<qint32> lids;
+    noteTable.getAllDeleted(lids);
+    QCOMPARE(lids.size(), noteCount);
+    QStringList toRemove;
+    QCOMPARE(noteTable.expunge(lids, toRemove, true), noteCount);
+
+    QSqlQuery query(global.db->conn);
+    query.exec("select count(*) from NoteTable");
+    QVERIFY(query.next());
+    QCOMPARE(query.value(0).toInt(), 1);
+    query.exec("select count(*) from DataStore where key=" + QString::number(RESOURCE_NOTE_LID));
+    QVERIFY(query.next());
+    QCOMPARE(query.value(0).toInt(), 1);
+    query.finish();
+    QVERIFY(!toRemove.contains(sharedText));
+
+    FileRemover remover(toRemove);
+    QList<qint32> progress;
+    qint32 removed = -1;
+    connect(&remover, &FileRemover::progress, [&progress](qint32 done, qint32) { progress.append(done); });
+    connect(&remover, &FileRemover::finished, [&removed](qint32 count) { removed = count; });
+    remover.run();
+    QCOMPARE(removed, files.size());
+    QVERIFY(!progress.isEmpty());
+    for (int i = 0; i < files.size(); i++)
+        QVERIFY2(!QFile::exists(files[i]), qPrintable(files[i]));
+    QVERIFY(QFile::exists(unrelated));
+    QVERIFY(QFile::exists(sharedText));
+
+    global.enableIndexing = enableIndexing;
+}
+
+
+// Takes lids through its own connection, the way the runner threads do, with
+// an occasional bulk reservation like the importers.
+class LidThread : public QThread {
+public:
+    LidThread(QString connection, int count) : connection(connection), count(count) {}
+    QList<qint32> lids;
+
+protected:
+    void run() override {
+        {
+            DatabaseConnection db(connection);
+            ConfigStore cs(&db);
+            for (int i = 0; i < count; i++) {
+                if (i % 700 == 0)
+                    cs.reserveLids(300);
+                lids.append(cs.incrementLidCounter());
+            }
+        }
+        QSqlDatabase::removeDatabase(connection);
+    }
+
+private:
+    QString connection;
+    int count;
+};
+
+// Three connections on their own threads and the main one take lids at the
+// same time, across several block boundaries.  No lid may be handed out twice.
+void Tests::lidReservationTest() {
+    const int count = 3 * LID_BLOCK_SIZE + 17;
+
+    FixtureAccount account;
+    QVERIFY(account.isValid());
+
+    QList<LidThread *> threads;
+    for (int i = 0; i < 3; i++) {
+        threads.append(new LidThread(QString("lidReservationTest%1").arg(i), count));
+        threads.last()->start();
+    }
+    ConfigStore cs(global.db);
+    QList<qint32> lids;
+    for (int i = 0; i < count; i++)
+        lids.append(cs.incrementLidCounter());
+    for (int i = 0; i < threads.size(); i++) {
+        threads[i]->wait();
+        lids.append(threads[i]->lids);
+        delete threads[i];
+    }
+
+    QCOMPARE(lids.size(), 4 * count);
+    QSet<qint32> unique = lids.toSet();
+    QCOMPARE(unique.size(), lids.size());
+    QVERIFY(!unique.contains(-1));
+    QVERIFY(!unique.contains(0));
+}
+
+
+// Base64 the way Evernote writes it, in lines of 76 characters
+static QByteArray enexBase64(const QByteArray &data) {
+    QByteArray encoded = data.toBase64();
+    QByteArray lines;
+    lines.reserve(encoded.size() + encoded.size() / 76 + 1);
+    for (int i = 0; i < encoded.size(); i += 76) {
+        lines.append(encoded.mid(i, 76));
+        lines.append('\n');
+    }
+    return lines;
+}
+
+static QByteArray enexNote(int number, const QByteArray &encoded) {
+    return QByteArray("<note><title>note ") + QByteArray::number(number) + "</title>"
+           "<content><![CDATA[<?xml version=\"1.0\" encoding=\"UTF-8\"?>"
+           "<!DOCTYPE en-note SYSTEM \"http://xml.evernote.com/pub/enml2.dtd\">"
+           "<en-note>benchmark note " + QByteArray::number(number) + "</en-note>]]></content>"
+           "<created>20260101T120000Z</created><updated>20260101T120000Z</updated><tag>benchmark</tag>"
+           "<resource><data encoding=\"base64\">\n" + encoded + "</data>"
+           "<mime>application/octet-stream</mime>"
+           "<resource-attributes><file-name>data.bin</file-name></resource-attributes>"
+           "</resource></note>\n";
+}
+
+// Imports a synthetic ENEX export and reports notes/sec and MB/sec.  The notes
+// carry a 64 KB attachment each, except one with a single attachment large
+// enough to be decoded while it is read.  The file is 64 MB unless
+// NIXNOTE_ENEX_BENCHMARK_MB says otherwise (1024 for the 1 GB run).
+void Tests::enexImportBenchmark() {
+    qint64 targetMb = qgetenv("NIXNOTE_ENEX_BENCHMARK_MB").toLongLong();
+    if (targetMb <= 0)
+        targetMb = 64;
+
+    FixtureAccount account;
+    QVERIFY(account.isValid());
+    bool enableIndexing = global.enableIndexing;
+    global.enableIndexing = true;
+
+    QByteArray attachment(64 * 1024, 0);
+    for (int i = 0; i < attachment.size(); i++)
+        attachment[i] = static_cast<char>(i * 31 % 251);
+    QByteArray attachmentEncoded = enexBase64(attachment);
+    QByteArray large(3 * IMPORT_STREAM_DECODE_BYTES + 5, 0);
+    for (int i = 0; i < large.size(); i++)
+        large[i] = static_cast<char>(i * 17 % 253);
+
+    QString path = account.path() + "/benchmark.enex";
+    QFile file(path);
+    QVERIFY(file.open(QIODevice::WriteOnly));
+    file.write("<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+               "<!DOCTYPE en-export SYSTEM \"http://xml.evernote.com/pub/evernote-export3.dtd\">\n"
+               "<en-export export-date=\"20260101T120000Z\" application=\"Evernote\" version=\"6.x\">\n");
+    int notes = 0;
+    file.write(enexNote(notes++, enexBase64(large)));
+    while (file.size() < targetMb * 1024 * 1024)
+        file.write(enexNote(notes++, attachmentEncoded));
+    file.write("</en-export>\n");
+    qint64 fileSize = file.size();
+    file.close();
+
+    ImportEnex importer;
+    QElapsedTimer clock;
+    clock.start();
+    QBENCHMARK_ONCE {
+        importer.import(path);
+    }
+    qint64 elapsed = qMax(clock.elapsed(), static_cast<qint64>(1));
+    QCOMPARE(importer.lastError, 0);
+    double mb = static_cast<double>(fileSize) / (1024.0 * 1024.0);
+    QLOG_INFO() << "ENEX import benchmark: " << notes << " notes, " << QString::number(mb, 'f', 1) << " MB in "
+                << elapsed << " ms (" << QString::number(notes * 1000.0 / elapsed, 'f', 1) << " notes/sec, "
+                << QString::number(mb * 1000.0 / elapsed, 'f', 2) << " MB/sec)";
+
+    QSqlQuery query(global.db->conn);
+    query.exec("select count(*) from NoteTable");
+    QVERIFY(query.next());
+    QCOMPARE(query.value(0).toInt(), notes);
+
+    // The large body arrived intact, under its own hash
+    query.exec("select lid from DataStore where key=" + QString::number(RESOURCE_DATA_SIZE) +
+               " and data=" + QString::number(large.size()));
+    QVERIFY(query.next());
+    ResourceTable resourceTable(global.db);
+    Resource resource;
+    QVERIFY(resourceTable.get(resource, query.value(0).toInt(), true));
+    QVERIFY(resource.data.isSet());
+    QCOMPARE(resource.data->body.ref(), large);
+    QCOMPARE(resource.data->bodyHash.ref(), QCryptographicHash::hash(large, QCryptographicHash::Md5));
+    query.finish();
+
+    // It was decoded into dba & moved under its lid, nothing is left over
+    QDir dba(global.fileManager.getDbaDirPath());
+    QCOMPARE(dba.entryList(QStringList() << "import-*", QDir::Files).size(), 0);
+
+    global.enableIndexing = enableIndexing;
+}
+
+// Exports notes whose bodies are only in dba, one of them large enough to be
+// decoded while it is read back, then imports the file into a fresh account.
+// Every body must come back byte for byte under its hash.
+void Tests::exportRoundTripTest() {
+    const int noteCount = 40;
+
+    QTemporaryDir exportDir;
+    QVERIFY(exportDir.isValid());
+    QString path = exportDir.path() + "/export.nnex";
+    QByteArray large(2 * IMPORT_STREAM_DECODE_BYTES + 3, 0);
+    for (int i = 0; i < large.size(); i++)
+        large[i] = static_cast<char>(i * 13 % 251);
+    QHash<QByteArray, QByteArray> bodies;
+    QHash<QString, QByteArray> titles;
+
+    bool enableIndexing = global.enableIndexing;
+    global.enableIndexing = true;
+    {
+        FixtureAccount account;
+        QVERIFY(account.isValid());
+        NoteTable noteTable(global.db);
+        ResourceTable resourceTable(global.db);
+        QList<qint32> lids;
+        for (int i = 0; i < noteCount; i++) {
+            Data data;
+            data.body = i == 0 ? large : QByteArray("body of note ") + QByteArray::number(i);
+            data.size = data.body->size();
+            data.bodyHash = QCryptographicHash::hash(data.body.ref(), QCryptographicHash::Md5);
+            bodies.insert(data.bodyHash.ref(), data.body.ref());
+            Resource resource;
+            resource.guid = QString("resource-%1").arg(i);
+            resource.mime = QString("application/octet-stream");
+            resource.data = data;
+            Note note;
+            note.guid = QString("note-%1").arg(i);
+            note.title = QString("note %1").arg(i);
+            note.content = QString("<en-note/>");
+            resource.noteGuid = note.guid;
+            note.resources = QList<Resource>() << resource;
+            lids.append(noteTable.add(0, note, false, 0));
+            titles.insert(note.title, data.bodyHash.ref());
+        }
+
+        // The large body is only on disk
+        QList<qint32> resLids;
+        resourceTable.getResourceList(resLids, lids[0]);
+        QCOMPARE(resLids.size(), 1);
+        Resource resource;
+        QVERIFY(resourceTable.get(resource, resLids[0], false));
+        QVERIFY(!resource.data.isSet() || !resource.data->body.isSet());
+        QCOMPARE(QFileInfo(resourceTable.getDataFilePath(resLids[0], resource)).size(),
+                 static_cast<qint64>(large.size()));
+
+        ExportData exporter(false, true);
+        exporter.lids = lids;
+        exporter.backupData(path);
+        QCOMPARE(exporter.lastError, 0);
+    }
+
+    FixtureAccount account;
+    QVERIFY(account.isValid());
+    ImportData importer(false, true);
+    importer.import(path);
+    QCOMPARE(importer.lastError, 0);
+
+    NoteTable noteTable(global.db);
+    ResourceTable resourceTable(global.db);
+    QList<qint32> lids;
+    noteTable.getAll(lids);
+    QCOMPARE(lids.size(), noteCount);
+    for (int i = 0; i < lids.size(); i++) {
+        Note note;
+        QVERIFY(noteTable.get(note, lids[i], false, false));
+        QVERIFY(titles.contains(note.title));
+        QList<qint32> resLids;
+        resourceTable.getResourceList(resLids, lids[i]);
+        QCOMPARE(resLids.size(), 1);
+        Resource resource;
+        QVERIFY(resourceTable.get(resource, resLids[0], true));
+        QByteArray hash = resource.data->bodyHash.ref();
+        QCOMPARE(hash, titles.value(note.title));
+        QCOMPARE(resource.data->body.ref(), bodies.value(hash));
+        QCOMPARE(QCryptographicHash::hash(resource.data->body.ref(), QCryptographicHash::Md5), hash);
+    }
+
+    global.enableIndexing = enableIndexing;
+}
+
+static QString backupText(const QString &fileName) {
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly))
+        return QString();
+    return QString::fromUtf8(file.readAll());
+}
+
+// A full backup, an incremental one with a changed, a new and an expunged
+// note, then one with only an expunged note.  The chain is verified against
+// the account, restored into a fresh account and verified again.
+void Tests::incrementalBackupTest() {
+    const int noteCount = 10;
+
+    QTemporaryDir backupDir;
+    QVERIFY(backupDir.isValid());
+    QString full = backupDir.path() + "/full.nnex";
+    QString changes = backupDir.path() + "/changes.nnex";
+    QString deletes = backupDir.path() + "/deletes.nnex";
+
+    bool enableIndexing = global.enableIndexing;
+    global.enableIndexing = true;
+    {
+        FixtureAccount account;
+        QVERIFY(account.isValid());
+        NotebookTable notebookTable(global.db);
+        Notebook notebook;
+        notebook.guid = QString("notebook-0");
+        notebook.name = QString("notebook");
+        notebookTable.add(0, notebook, false);
+
+        NoteTable noteTable(global.db);
+        QList<qint32> lids;
+        for (int i = 0; i <= noteCount; i++) {
+            Data data;
+            data.body = QByteArray("body of note ") + QByteArray::number(i);
+            data.size = data.body->size();
+            data.bodyHash = QCryptographicHash::hash(data.body.ref(), QCryptographicHash::Md5);
+            Resource resource;
+            resource.guid = QString("resource-%1").arg(i);
+            resource.mime = QString("application/octet-stream");
+            resource.data = data;
+            Note note;
+            note.guid = QString("note-%1").arg(i);
+            note.title = QString("note %1").arg(i);
+            note.content = QString("<en-note>note %1</en-note>").arg(i);
+            note.contentHash = QCryptographicHash::hash(note.content->toUtf8(), QCryptographicHash::Md5);
+            note.updated = 1000 + i;
+            note.notebookGuid = notebook.guid;
+            resource.noteGuid = note.guid;
+            note.resources = QList<Resource>() << resource;
+
+            // The last note is only added after the full backup
+            if (i == noteCount) {
+                ExportData exporter(true, true);
+                exporter.backupData(full);
+                QCOMPARE(exporter.lastError, 0);
+            }
+            lids.append(noteTable.add(0, note, false, 0));
+        }
+        BackupManifest manifest;
+        QVERIFY(manifest.read(BackupManifest::manifestFile(full)));
+        QCOMPARE(manifest.notes.size(), noteCount);
+        QCOMPARE(manifest.baseFile, QString());
+
+        noteTable.updateNoteContent(lids[1], "<en-note>changed</en-note>", false);
+        noteTable.updateDate(lids[1], 5000, NOTE_UPDATED_DATE, false);
+        noteTable.expunge(lids[2]);
+        ExportData incremental(true, true);
+        incremental.setIncrementalBase(full);
+        incremental.backupData(changes);
+        QCOMPARE(incremental.lastError, 0);
+        QVERIFY(manifest.read(BackupManifest::manifestFile(changes)));
+        QCOMPARE(manifest.baseFile, QFileInfo(full).absoluteFilePath());
+        QCOMPARE(manifest.notes.size(), noteCount);
+
+        // Only what changed, plus a tombstone
+        QString text = backupText(changes);
+        QVERIFY(text.contains("exportType=\"incremental\""));
+        QVERIFY(text.contains("<Guid>note-1</Guid>"));
+        QVERIFY(text.contains(QString("<Guid>note-%1</Guid>").arg(noteCount)));
+        QVERIFY(!text.contains("<Guid>note-5</Guid>"));
+        QVERIFY(text.contains("<Tombstones>"));
+        QVERIFY(text.contains("<Note>note-2</Note>"));
+
+        noteTable.expunge(lids[3]);
+        ExportData deletesOnly(true, true);
+        deletesOnly.setIncrementalBase(changes);
+        deletesOnly.backupData(deletes);
+        QCOMPARE(deletesOnly.lastError, 0);
+        text = backupText(deletes);
+        QVERIFY(text.contains("<Note>note-3</Note>"));
+        QVERIFY(!text.contains("<Guid>note-1</Guid>"));
+
+        QCOMPARE(BackupManifest::chain(deletes), QStringList() << full << changes << deletes);
+        QStringList problems;
+        QVERIFY2(BackupManifest::verifyChain(deletes, global.db, problems), qPrintable(problems.join("\n")));
+
+        // A note expunged after the last backup is reported
+        noteTable.expunge(lids[4]);
+        problems.clear();
+        QVERIFY(!BackupManifest::verifyChain(deletes, global.db, problems));
+        QVERIFY(problems.join("\n").contains("note-4"));
+    }
+
+    FixtureAccount account;
+    QVERIFY(account.isValid());
+    ImportData importer(true, true);
+    importer.importChain(deletes);
+    QCOMPARE(importer.lastError, 0);
+
+    NoteTable noteTable(global.db);
+    QList<qint32> lids;
+    noteTable.getAll(lids);
+    QCOMPARE(lids.size(), noteCount - 1);
+    QVERIFY(noteTable.getLid(QString("note-2")) <= 0);
+    QVERIFY(noteTable.getLid(QString("note-3")) <= 0);
+    QVERIFY(noteTable.getLid(QString("note-%1").arg(noteCount)) > 0);
+    Note note;
+    QVERIFY(noteTable.get(note, noteTable.getLid(QString("note-1")), false, false));
+    QCOMPARE(note.content.ref(), QString("<en-note>changed</en-note>"));
+
+    QStringList problems;
+    QVERIFY2(BackupManifest::verifyChain(deletes, global.db, problems), qPrintable(problems.join("\n")));
+
+    global.enableIndexing = enableIndexing;
+}
+
+// A note moved to another notebook, one retagged and one sent to the trash
+// keep their content & update date, but must still be in the next
+// incremental backup.
+void Tests::incrementalBackupMoveTest() {
+    QTemporaryDir backupDir;
+    QVERIFY(backupDir.isValid());
+    QString full = backupDir.path() + "/full.nnex";
+    QString first = backupDir.path() + "/first.nnex";
+    QString second = backupDir.path() + "/second.nnex";
+
+    bool enableIndexing = global.enableIndexing;
+    global.enableIndexing = true;
+    {
+        FixtureAccount account;
+        QVERIFY(account.isValid());
+        NotebookTable notebookTable(global.db);
+        Notebook notebook;
+        notebook.guid = QString("notebook-0");
+        notebook.name = QString("notebook");
+        notebookTable.add(0, notebook, false);
+        Notebook other;
+        other.guid = QString("notebook-1");
+        other.name = QString("other");
+        qint32 otherLid = notebookTable.add(0, other, false);
+        TagTable tagTable(global.db);
+        Tag tag;
+        tag.guid = QString("tag-0");
+        tag.name = QString("tag");
+        qint32 tagLid = tagTable.add(0, tag, false, 0);
+
+        NoteTable noteTable(global.db);
+        QList<qint32> lids;
+        for (int i = 0; i < 4; i++) {
+            Note note;
+            note.guid = QString("note-%1").arg(i);
+            note.title = QString("note %1").arg(i);
+            note.content = QString("<en-note>note %1</en-note>").arg(i);
+            note.contentHash = QCryptographicHash::hash(note.content->toUtf8(), QCryptographicHash::Md5);
+            note.updated = 1000 + i;
+            note.notebookGuid = notebook.guid;
+            lids.append(noteTable.add(0, note, false, 0));
+        }
+        ExportData exporter(true, true);
+        exporter.backupData(full);
+        QCOMPARE(exporter.lastError, 0);
+
+        // Nothing changed yet
+        ExportData firstBackup(true, true);
+        firstBackup.setIncrementalBase(full);
+        firstBackup.backupData(first);
+        QCOMPARE(firstBackup.lastError, 0);
+        QVERIFY(!backupText(first).contains("<Guid>note-"));
+
+        noteTable.updateNotebook(lids[1], otherLid, false);
+        noteTable.addTag(lids[2], tagLid, false);
+        noteTable.deleteNote(lids[3], false);
+        ExportData secondBackup(true, true);
+        secondBackup.setIncrementalBase(first);
+        secondBackup.backupData(second);
+        QCOMPARE(secondBackup.lastError, 0);
+        QString text = backupText(second);
+        QVERIFY(!text.contains("<Guid>note-0</Guid>"));
+        QVERIFY(text.contains("<Guid>note-1</Guid>"));
+        QVERIFY(text.contains("<Guid>note-2</Guid>"));
+        QVERIFY(text.contains("<Guid>note-3</Guid>"));
+
+        QStringList problems;
+        QVERIFY2(BackupManifest::verifyChain(second, global.db, problems), qPrintable(problems.join("\n")));
+    }
+
+    FixtureAccount account;
+    QVERIFY(account.isValid());
+    ImportData importer(true, true);
+    importer.importChain(second);
+    QCOMPARE(importer.lastError, 0);
+
+    NoteTable noteTable(global.db);
+    Note moved, tagged;
+    QVERIFY(noteTable.get(moved, noteTable.getLid(QString("note-1")), false, false));
+    QCOMPARE(moved.notebookGuid.ref(), QString("notebook-1"));
+    QVERIFY(noteTable.get(tagged, noteTable.getLid(QString("note-2")), false, false));
+    QVERIFY(tagged.tagGuids.isSet() && tagged.tagGuids->contains(QString("tag-0")));
+    QVERIFY(noteTable.isDeleted(noteTable.getLid(QString("note-3"))));
+
+    QStringList problems;
+    QVERIFY2(BackupManifest::verifyChain(second, global.db, problems), qPrintable(problems.join("\n")));
+
+    global.enableIndexing = enableIndexing;
+}
+
+static QStringList indexSources(qint32 lid) {
+    QSqlQuery query(global.db->conn);
+    query.prepare("select source from SearchIndex where lid=:lid order by source");
+    query.bindValue(":lid", lid);
+    query.exec();
+    QStringList sources;
+    while (query.next())
+        sources.append(query.value(0).toString());
+    return sources;
+}
+
+// Attachment text indexed under the note before it moved to the resource is
+// removed from both indexes and the resources are queued to be indexed again.
+// The note has a PDF and an office document, whose soffice text was also
+// indexed under the note.
+void Tests::noteAttachmentIndexUpgradeTest() {
+    FixtureAccount account;
+    QVERIFY(account.isValid());
+    bool enableIndexing = global.enableIndexing;
+    global.enableIndexing = true;
+
+    QStringList mimes;
+    mimes << "application/pdf" << "application/vnd.openxmlformats-officedocument.wordprocessingml.document";
+    Note note;
+    note.guid = QString("note-0");
+    note.title = QString("note");
+    note.content = QString("<en-note/>");
+    QList<Resource> resources;
+    for (int i = 0; i < mimes.size(); i++) {
+        Data data;
+        data.body = QByteArray("body ") + QByteArray::number(i);
+        data.size = data.body.ref().size();
+        data.bodyHash = QCryptographicHash::hash(data.body.ref(), QCryptographicHash::Md5);
+        Resource resource;
+        resource.guid = QString("resource-%1").arg(i);
+        resource.noteGuid = note.guid;
+        resource.mime = mimes[i];
+        resource.data = data;
+        resources.append(resource);
+    }
+    note.resources = resources;
+    NoteTable noteTable(global.db);
+    qint32 noteLid = noteTable.add(0, note, false, 0);
+    ResourceTable resourceTable(global.db);
+    QList<qint32> resLids;
+    resourceTable.getResourceList(resLids, noteLid);
+    QCOMPARE(resLids.size(), 2);
+
+    SearchIndexTable index(global.db);
+    index.add(noteLid, 100, "text", "note text");
+    index.add(noteLid, 100, "attachment", "quarterly figures");
+    index.add(noteLid, 100, "attachment", "office minutes");
+    index.add(noteLid, 50, "recognition", "scanned receipt");
+    index.add(resLids[0], 100, "attachment", "annual figures");
+    QSqlQuery query(global.db->conn);
+    query.prepare("delete from DataStore where key=:key");
+    query.bindValue(":key", RESOURCE_INDEX_NEEDED);
+    QVERIFY(query.exec());
+
+    DatabaseUpgrade dbu;
+    dbu.removeNoteAttachmentIndex();
+
+    QCOMPARE(indexSources(noteLid), QStringList() << "text");
+    QCOMPARE(indexSources(resLids[0]), QStringList() << "attachment");
+    QVERIFY(query.exec("select count(*) from SearchIndexTrigram where SearchIndexTrigram match '\"quarterly\"'"));
+    QVERIFY(query.next());
+    QCOMPARE(query.value(0).toInt(), 0);
+    QVERIFY(query.exec("select count(*) from SearchIndexTrigram where SearchIndexTrigram match '\"minutes\"'"));
+    QVERIFY(query.next());
+    QCOMPARE(query.value(0).toInt(), 0);
+    QVERIFY(query.exec("select count(*) from SearchIndexTrigram where SearchIndexTrigram match '\"annual\"'"));
+    QVERIFY(query.next());
+    QCOMPARE(query.value(0).toInt(), 1);
+    query.prepare("select lid from DataStore where key=:key");
+    query.bindValue(":key", RESOURCE_INDEX_NEEDED);
+    QVERIFY(query.exec());
+    QList<qint32> queued;
+    while (query.next())
+        queued.append(query.value(0).toInt());
+    QCOMPARE(queued.size(), 2);
+    QCOMPARE(queued.toSet(), resLids.toSet());
+    query.finish();
+
+    global.enableIndexing = enableIndexing;
+}
+
+static QStringList indexRows(qint32 lid) {
+    QSqlQuery query(global.db->conn);
+    query.prepare("select rowid, weight, content from SearchIndex where lid=:lid order by rowid");
+    query.bindValue(":lid", lid);
+    query.exec();
+    QStringList rows;
+    while (query.next())
+        rows.append(query.value(0).toString() + ":" + query.value(1).toString() + ":" + query.value(2).toString());
+    return rows;
+}
+
+static int trigramCount(const QString &text) {
+    QSqlQuery query(global.db->conn);
+    query.exec("select count(*) from SearchIndexTrigram where SearchIndexTrigram match '\"" + text + "\"'");
+    return query.next() ? query.value(0).toInt() : -1;
+}
+
+// Rows are only rewritten when the hash of what they are indexed from
+// changed, or after the hashes were cleared.
+void Tests::searchIndexReplaceTest() {
+    FixtureAccount account;
+    QVERIFY(account.isValid());
+    SearchIndexTable index(global.db);
+
+    QList<SearchIndexRow> rows;
+    rows << SearchIndexRow(100, "alpha bravo") << SearchIndexRow(50, "charlie");
+    QString hash = SearchIndexTable::contentHash(rows);
+    QVERIFY(index.replace(7, "recognition", hash, rows));
+    QCOMPARE(index.getHash(7, "recognition"), hash);
+    QStringList written = indexRows(7);
+    QCOMPARE(written.size(), 2);
+
+    // Same rows, nothing written
+    QVERIFY(!index.replace(7, "recognition", hash, rows));
+    QCOMPARE(indexRows(7), written);
+
+    // Changed rows replace the old ones in both indexes
+    QList<SearchIndexRow> changed;
+    changed << SearchIndexRow(100, "alpha bravo") << SearchIndexRow(50, "delta");
+    QString changedHash = SearchIndexTable::contentHash(changed);
+    QVERIFY(changedHash != hash);
+    QVERIFY(index.replace(7, "recognition", changedHash, changed));
+    QStringList rewritten = indexRows(7);
+    QCOMPARE(rewritten.size(), 2);
+    QVERIFY(rewritten.last().endsWith(":50:delta"));
+    QCOMPARE(trigramCount("charlie"), 0);
+    QCOMPARE(trigramCount("delta"), 1);
+    QCOMPARE(index.getHash(7, "recognition"), changedHash);
+
+    // An empty hash is never current.  These rows also take the next rowids,
+    // so rows written again below can't get their old ones back.
+    QVERIFY(index.replace(8, "text", "", rows));
+    QVERIFY(index.replace(8, "text", "", rows));
+    QCOMPARE(indexRows(8).size(), 2);
+
+    // Once the hashes are cleared the same rows are written again
+    index.clearHashes();
+    QCOMPARE(index.getHash(7, "recognition"), QString());
+    QVERIFY(index.replace(7, "recognition", changedHash, changed));
+    QStringList again = indexRows(7);
+    QCOMPARE(again.size(), 2);
+    QVERIFY(again.first() != rewritten.first());
+    QCOMPARE(trigramCount("delta"), 1);
+    QVERIFY(!index.replace(7, "recognition", changedHash, changed));
+
+    index.clearHashes(QList<qint32>() << 7);
+    QVERIFY(index.replace(7, "recognition", changedHash, changed));
+
+    // The rows are found by lid & source through SearchIndexRows
+    QSqlQuery query(global.db->conn);
+    QVERIFY(query.exec("select count(*) from SearchIndexRows r join SearchIndex s on s.rowid=r.row "
+                       "and s.lid=r.lid and s.source=r.source"));
+    QVERIFY(query.next());
+    QCOMPARE(query.value(0).toInt(), 4);
+    QVERIFY(query.exec("select count(*) from SearchIndexRows"));
+    QVERIFY(query.next());
+    QCOMPARE(query.value(0).toInt(), 4);
+    index.remove(QList<qint32>() << 8);
+    QCOMPARE(indexRows(8).size(), 0);
+    QCOMPARE(indexRows(7).size(), 2);
+    query.finish();
+}
+
+// The live search base leaves trashed notes out, and opening the search
+// runner's connection doesn't reset the note list.
+void Tests::liveSearchBaseTest() {
+    FixtureAccount account;
+    QVERIFY(account.isValid());
+    NoteTable noteTable(global.db);
+    QList<qint32> lids;
+    for (int i = 0; i < 3; i++) {
+        Note note;
+        note.guid = QString("note-%1").arg(i);
+        note.title = QString("note %1").arg(i);
+        note.content = QString("<en-note/>");
+        note.active = true;
+        lids.append(noteTable.add(0, note, false, 0));
+    }
+    noteTable.deleteNote(lids[2], false);
+
+    FilterCriteria criteria;
+    QSqlQuery query(global.db->conn);
+    QVERIFY(query.exec("select lid from (" + FilterEngine::searchBaseSql(&criteria) + ") order by lid"));
+    QList<qint32> base;
+    while (query.next())
+        base.append(query.value(0).toInt());
+    QCOMPARE(base, QList<qint32>() << lids[0] << lids[1]);
+
+    QVERIFY(query.exec("delete from filter"));
+    QVERIFY(query.exec("insert into filter (lid, relevance, hit) values (" + QString::number(lids[0]) + ", 5, 1)"));
+    {
+        DatabaseConnection other("liveSearchBaseTest");
+    }
+    QSqlDatabase::removeDatabase("liveSearchBaseTest");
+    QVERIFY(query.exec("select lid, hit from filter"));
+    QVERIFY(query.next());
+    QCOMPARE(query.value(0).toInt(), lids[0]);
+    QVERIFY(query.value(1).toBool());
+    QVERIFY(!query.next());
+    query.finish();
+}
+
 
 QT_BEGIN_NAMESPACE
 QTEST_ADD_GPU_BLACKLIST_SUPPORT_DEFS
@@ -2,6 +2,50 @@
 #define NIXNOTE2_TESTS_H
 
 #include <QObject>
+#include <QSet>
+#include <QTemporaryDir>
+#include "../src/threads/uploadpipeline.h"
+
+class DatabaseConnection;
+
+
+// Stands in for the Evernote NoteStore in the upload pipeline tests.
+// Answers arrive after a short delay, out of order, and the server hands
+// out update sequence numbers as it answers.  Failures can be injected.
+class MockNoteStore : public UploadSender
+{
+    Q_OBJECT
+public:
+    explicit MockNoteStore(qint32 usn) : serverUsn(usn), inFlight(0), maxInFlight(0) {}
+    void send(qint32 lid);
+
+    qint32 serverUsn;
+    qint32 inFlight;
+    qint32 maxInFlight;
+    QSet<qint32> rejected;          // answered with a problem in the note
+    QSet<qint32> networkFailures;   // answered with a network error, once
+    QList<qint32> stored;
+};
+
+
+// A scratch account for the tests which drive the real tables.  File paths,
+// settings and the main database connection all point into a temporary
+// directory, the way Global::setup() prepares them for a real account.
+class FixtureAccount
+{
+public:
+    FixtureAccount();
+    ~FixtureAccount();
+    bool isValid() const { return valid; }
+    QString path() const { return dir.path(); }
+
+    DatabaseConnection *db;
+
+private:
+    QTemporaryDir dir;
+    bool valid;
+};
+
 
 class Tests: public QObject
 {
@@ -37,6 +81,29 @@ private slots:
 
 private slots:
     void enmlHtmlSvgTest();
+    void asyncFileLogTest();
+    void metricsHistogramTest();
+    void tagRenameBenchmark();
+    void mimeReferenceBenchmark();
+    void uploadPipelineTest();
+    void searchIndexBenchmark();
+    void searchQueryBenchmark();
+    void searchQueryNarrowsTest();
+    void diacriticFoldingBenchmark();
+    void dataVersionTest();
+    void tagFilterBenchmark();
+    void resourceHitsTest();
+    void noteSnippetsTest();
+    void extractedTextCacheTest();
+    void trashExpungeTest();
+    void lidReservationTest();
+    void enexImportBenchmark();
+    void exportRoundTripTest();
+    void incrementalBackupTest();
+    void noteAttachmentIndexUpgradeTest();
+    void searchIndexReplaceTest();
+    void incrementalBackupMoveTest();
+    void liveSearchBaseTest();
 };
 
 #endif // NIXNOTE2_TESTS_H
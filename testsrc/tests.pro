@@ -3,30 +3,29 @@ message("Out path: $${OUT_PWD}")
 QT += core widgets printsupport webkit webkitwidgets sql network xml dbus qml testlib
 
 CONFIG += link_pkgconfig
-PKGCONFIG += tidy
+PKGCONFIG += poppler-qt5 libcurl tidy hunspell zlib
 
 # -g flag needed for linker - https://stackoverflow.com/questions/5244509/no-debugging-symbols-found-when-using-gdb
-LIBS += -g
+LIBS += -lpthread -g -rdynamic
+
+INCLUDEPATH += "$$PWD/.." "$$PWD/../src/qevercloud/QEverCloud/headers"
+RESOURCES = ../nixnote2.qrc
 
 
 TARGET = tests
 TEMPLATE = app
 
-SOURCES += tests.cpp \
-           ../src/html/enmlformatter.cpp \
-           ../src/logger/qslog.cpp \
-           ../src/logger/qslogdest.cpp \
-           ../src/logger/qsdebugoutput.cpp \
-           ../src/utilities/NixnoteStringUtils.cpp \
-           ../src/utilities/encrypt.cpp
-
-HEADERS += tests.h \
-           ../src/html/enmlformatter.h \
-           ../src/logger/qslog.h \
-           ../src/logger/qslogdest.h \
-           ../src/logger/qsdebugoutput.h \
-           ../src/utilities/NixnoteStringUtils.h \
-           ../src/utilities/encrypt.h
+# The database tests drive the real tables, so everything but the
+# application's main() is linked in.
+APP_SOURCES = $$fromfile($$PWD/../nixnote2.pro, SOURCES)
+APP_SOURCES -= src/main.cpp
+APP_HEADERS = $$fromfile($$PWD/../nixnote2.pro, HEADERS)
+
+SOURCES += tests.cpp
+for(file, APP_SOURCES): SOURCES += ../$$file
+
+HEADERS += tests.h
+for(file, APP_HEADERS): HEADERS += ../$$file
 
 CONFIG(debug, debug|release) {
     DESTDIR = qmake-build-debug-t